@@ -5,6 +5,7 @@
 #include "ReTurnSubsystem.hxx"
 
 #include <boost/bind.hpp>
+#include <atomic>
 
 #define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
 
@@ -18,7 +19,8 @@ AsyncSocketBase::AsyncSocketBase(asio::io_service& ioService) :
   mIOService(ioService),
   mReceiving(false),
   mConnected(false),
-  mAsyncSocketBaseHandler(nullptr)
+  mAsyncSocketBaseHandler(nullptr),
+  mReceiveBufferPoolSize(RECEIVE_BUFFER_POOL_SIZE)
 {
 }
 
@@ -47,26 +49,34 @@ AsyncSocketBase::doSend(const StunTuple& destination, const std::shared_ptr<Data
 
 void
 AsyncSocketBase::doSend(const StunTuple& destination, unsigned short channel, const std::shared_ptr<DataBuffer>& data, const size_t bufferStartPos)
+{
+   queueSendData(SendData(destination, channel, data, bufferStartPos));
+}
+
+void
+AsyncSocketBase::queueSendData(SendData&& sendData)
 {
    bool writeInProgress = !mSendDataQueue.empty();
-   if (channel == NO_CHANNEL)
+   mSendDataQueue.push_back(std::move(sendData));
+   if (!writeInProgress)
    {
-      mSendDataQueue.push_back(SendData(destination, nullptr, data, bufferStartPos));
+      sendFirstQueuedData();
    }
-   else
+}
+
+AsyncSocketBase::SendData::SendData(const StunTuple& destination, unsigned short channel, std::shared_ptr<DataBuffer> data, size_t bufferStartPos) :
+   mDestination(destination),
+   mFramed(channel != NO_CHANNEL),
+   mData(std::move(data)),
+   mBufferStartPos(bufferStartPos)
+{
+   if (mFramed)
    {
       // Add Turn Framing
-      const auto frame = allocateBuffer(4);
       channel = htons(channel);
-      memcpy(&(*frame)[0], &channel, 2);
-      unsigned short msgsize = htons((unsigned short)data->size());
-      memcpy(&(*frame)[2], (void*)&msgsize, 2);  // UDP doesn't need size - but shouldn't hurt to send it anyway
-
-      mSendDataQueue.push_back(SendData(destination, frame, data, bufferStartPos));
-   }
-   if (!writeInProgress)
-   {
-      sendFirstQueuedData();
+      memcpy(&mFrame[0], &channel, 2);
+      unsigned short msgsize = htons((unsigned short)mData->size());
+      memcpy(&mFrame[2], (void*)&msgsize, 2);  // UDP doesn't need size - but shouldn't hurt to send it anyway
    }
 }
 
@@ -96,9 +106,9 @@ void
 AsyncSocketBase::sendFirstQueuedData()
 {
    std::vector<asio::const_buffer> bufs;
-   if (mSendDataQueue.front().mFrameData) // If we have frame data
+   if (mSendDataQueue.front().mFramed) // If we have frame data
    {
-      bufs.push_back(asio::buffer(mSendDataQueue.front().mFrameData->data(), mSendDataQueue.front().mFrameData->size()));
+      bufs.push_back(asio::buffer(mSendDataQueue.front().mFrame, sizeof(mSendDataQueue.front().mFrame)));
    }
    bufs.push_back(asio::buffer(mSendDataQueue.front().mData->data()+mSendDataQueue.front().mBufferStartPos, mSendDataQueue.front().mData->size()-mSendDataQueue.front().mBufferStartPos));
    transportSend(mSendDataQueue.front().mDestination, bufs);
@@ -116,7 +126,8 @@ AsyncSocketBase::doReceive()
    if(!mReceiving)
    {
       mReceiving=true;
-      mReceiveBuffer = allocateBuffer(RECEIVE_BUFFER_SIZE);
+      mReceiveBuffer.reset();  // so that it can be reused, if the last receive is done with
+      mReceiveBuffer = allocateReceiveBuffer();
       transportReceive();
    }
 }
@@ -133,7 +144,8 @@ AsyncSocketBase::doFramedReceive()
    if(!mReceiving)
    {
       mReceiving=true;
-      mReceiveBuffer = allocateBuffer(RECEIVE_BUFFER_SIZE);
+      mReceiveBuffer.reset();
+      mReceiveBuffer = allocateReceiveBuffer();
       transportFramedReceive();
    }
 }
@@ -168,6 +180,45 @@ AsyncSocketBase::allocateBuffer(const size_t size)
    return std::make_shared<DataBuffer>(size);
 }
 
+std::shared_ptr<DataBuffer>
+AsyncSocketBase::allocateReceiveBuffer()
+{
+   for(auto& buffer : mReceiveBufferPool)
+   {
+      // Only the pool holds it, so it cannot be taken again by anyone else
+      if(buffer.use_count() == 1)
+      {
+         // the last holder may have released it on another thread
+         std::atomic_thread_fence(std::memory_order_acquire);
+         buffer->reset();
+         return buffer;
+      }
+   }
+   const auto buffer = allocateBuffer(RECEIVE_BUFFER_SIZE);
+   if(mReceiveBufferPool.size() < mReceiveBufferPoolSize)
+   {
+      mReceiveBufferPool.push_back(buffer);
+   }
+   return buffer;
+}
+
+void
+AsyncSocketBase::trimReceiveBufferPool(size_t keep)
+{
+   size_t idle = 0;
+   for(auto it = mReceiveBufferPool.begin(); it != mReceiveBufferPool.end(); )
+   {
+      if(it->use_count() == 1 && ++idle > keep)
+      {
+         it = mReceiveBufferPool.erase(it);
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
 } // namespace
 
 
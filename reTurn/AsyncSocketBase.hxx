@@ -17,6 +17,7 @@
 #include <vector>
 
 constexpr size_t RECEIVE_BUFFER_SIZE = 4096; // ?slg? should we shrink this to something closer to MTU (1500 bytes)? !hbr! never actually increase it otherwise re-assembled UDP packets get lost. (was 2048)
+constexpr size_t RECEIVE_BUFFER_POOL_SIZE = 32; // receive buffers kept by each socket for reuse
 
 namespace reTurn {
 
@@ -34,6 +35,9 @@ public:
 
    virtual unsigned int getSocketDescriptor() = 0;
 
+   /// The io_service that runs all of this socket's handlers
+   asio::io_service& getIOService() noexcept { return mIOService; }
+
    virtual void registerAsyncSocketBaseHandler(AsyncSocketBaseHandler* handler) { mAsyncSocketBaseHandler = handler; }
 
    /// Note:  The following API's are thread safe and queue the request to be handled by the ioService thread
@@ -93,6 +97,16 @@ protected:
    std::shared_ptr<DataBuffer> mReceiveBuffer;
    bool mReceiving;
 
+   /// Returns a receive buffer of RECEIVE_BUFFER_SIZE, reusing one from the
+   /// pool that nothing else holds any more, so that a steady flow of packets
+   /// does not allocate
+   std::shared_ptr<DataBuffer> allocateReceiveBuffer();
+   /// Sets how many receive buffers the pool keeps (RECEIVE_BUFFER_POOL_SIZE
+   /// by default)
+   void setReceiveBufferPoolSize(size_t size) { mReceiveBufferPoolSize = size; }
+   /// Frees the pooled buffers nothing else holds, beyond the first keep
+   void trimReceiveBufferPool(size_t keep);
+
    /// Connected Info and State
    asio::ip::address mConnectedAddress;
    unsigned short mConnectedPort;
@@ -105,6 +119,19 @@ protected:
    /// just before the socket is closed
    BeforeClosedHandler mOnBeforeSocketCloseFp;
 
+   class SendData
+   {
+   public:
+      SendData(const StunTuple& destination, unsigned short channel, std::shared_ptr<DataBuffer> data, size_t bufferStartPos = 0);
+      StunTuple mDestination;
+      bool mFramed;
+      char mFrame[4];  // Turn framing, if mFramed
+      std::shared_ptr<DataBuffer> mData;
+      size_t mBufferStartPos;
+   };
+   /// Adds data to the send queue, and starts sending if nothing is in progress
+   void queueSendData(SendData&& sendData);
+
 private:
    virtual void transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers) = 0;
    virtual void transportReceive() = 0;
@@ -115,19 +142,12 @@ private:
    virtual unsigned short getSenderEndpointPort() = 0;
 
    virtual void sendFirstQueuedData();
-   class SendData
-   {
-   public:
-      SendData(const StunTuple& destination, std::shared_ptr<DataBuffer> frameData, std::shared_ptr<DataBuffer> data, size_t bufferStartPos = 0) :
-         mDestination(destination), mFrameData(std::move(frameData)), mData(std::move(data)), mBufferStartPos(bufferStartPos) {}
-      StunTuple mDestination;
-      std::shared_ptr<DataBuffer> mFrameData;
-      std::shared_ptr<DataBuffer> mData;
-      size_t mBufferStartPos;
-   };
    /// Queue of data to send
    typedef std::deque<SendData> SendDataQueue;
    SendDataQueue mSendDataQueue;
+
+   std::vector<std::shared_ptr<DataBuffer> > mReceiveBufferPool;
+   size_t mReceiveBufferPoolSize;
 };
 
 typedef std::shared_ptr<AsyncSocketBase> ConnectionPtr;
@@ -1,5 +1,10 @@
 #include <boost/bind.hpp>
 
+#ifdef __linux__
+#include <sys/socket.h>
+#include <cerrno>
+#endif
+
 #include "AsyncUdpSocketBase.hxx"
 #include "AsyncSocketBaseHandler.hxx"
 #include <rutil/Logger.hxx>
@@ -14,10 +19,37 @@ namespace reTurn {
 AsyncUdpSocketBase::AsyncUdpSocketBase(asio::io_service& ioService) 
    : AsyncSocketBase(ioService),
      mSocket(ioService),
-     mResolver(ioService)
+     mResolver(ioService),
+     mReusePort(false),
+     mBatching(false),
+     mReceiveBatchSize(1),
+     mReceiveBatchFull(false),
+     mQueuedSends(0)
 {
 }
 
+bool
+AsyncUdpSocketBase::isReusePortSupported()
+{
+   // Other platforms either lack SO_REUSEPORT, or deliver each datagram to
+   // just one of the sockets
+#if defined(__linux__) && defined(SO_REUSEPORT)
+   return true;
+#else
+   return false;
+#endif
+}
+
+bool
+AsyncUdpSocketBase::isBatchingSupported()
+{
+#ifdef __linux__
+   return true;
+#else
+   return false;
+#endif
+}
+
 unsigned int 
 AsyncUdpSocketBase::getSocketDescriptor() 
 { 
@@ -41,6 +73,17 @@ AsyncUdpSocketBase::bind(const asio::ip::address& address, unsigned short port)
 #endif
 #endif
       mSocket.set_option(asio::ip::udp::socket::reuse_address(true), errorCode);
+#if defined(__linux__) && defined(SO_REUSEPORT)
+      if(mReusePort)
+      {
+         typedef asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+         mSocket.set_option(reuse_port(true), errorCode);
+         if(errorCode)
+         {
+            return errorCode;
+         }
+      }
+#endif
       mSocket.set_option(asio::socket_base::receive_buffer_size(66560));
       //mSocket.set_option(asio::socket_base::send_buffer_size(66560));
       mSocket.bind(asio::ip::udp::endpoint(address, port), errorCode);
@@ -97,22 +140,249 @@ AsyncUdpSocketBase::getSenderEndpointPort()
    return mSenderEndpoint.port(); 
 }
 
+void
+AsyncUdpSocketBase::doSend(const StunTuple& destination, unsigned short channel, const std::shared_ptr<DataBuffer>& data, size_t bufferStartPos)
+{
+#ifdef __linux__
+   if(mBatching)
+   {
+      if(mQueuedSends == 0)
+      {
+         if(mSendBatch.empty())
+         {
+            mIOService.post(boost::bind(&AsyncUdpSocketBase::flushSendBatch, std::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this())));
+         }
+         mSendBatch.push_back(SendData(destination, channel, data, bufferStartPos));
+         if(mSendBatch.size() == MaxBatchSize)
+         {
+            flushSendBatch();
+         }
+         return;
+      }
+      mQueuedSends++;
+   }
+#endif
+   AsyncSocketBase::doSend(destination, channel, data, bufferStartPos);
+}
+
+void
+AsyncUdpSocketBase::flushSendBatch()
+{
+#ifdef __linux__
+   if(mSendBatch.empty())
+   {
+      return;
+   }
+   if(!mSocket.is_open())
+   {
+      // Closed meanwhile - these are dropped, like the sends still queued on close
+      mSendBatch.clear();
+      return;
+   }
+
+   asio::ip::udp::endpoint destinations[MaxBatchSize];
+   struct mmsghdr msgs[MaxBatchSize];
+   struct iovec iovs[MaxBatchSize * 2];
+   const unsigned int count = (unsigned int)mSendBatch.size();
+   for(unsigned int i = 0; i < count; i++)
+   {
+      const SendData& sendData = mSendBatch[i];
+      destinations[i] = asio::ip::udp::endpoint(sendData.mDestination.getAddress(), sendData.mDestination.getPort());
+      struct iovec* iov = &iovs[i * 2];
+      size_t iovCount = 0;
+      if(sendData.mFramed)
+      {
+         iov[iovCount].iov_base = const_cast<char*>(sendData.mFrame);
+         iov[iovCount++].iov_len = sizeof(sendData.mFrame);
+      }
+      iov[iovCount].iov_base = const_cast<char*>(sendData.mData->data() + sendData.mBufferStartPos);
+      iov[iovCount++].iov_len = sendData.mData->size() - sendData.mBufferStartPos;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = destinations[i].data();
+      msgs[i].msg_hdr.msg_namelen = (socklen_t)destinations[i].size();
+      msgs[i].msg_hdr.msg_iov = iov;
+      msgs[i].msg_hdr.msg_iovlen = iovCount;
+   }
+
+   // The callbacks are made once the batch is done with, in case they send
+   unsigned int sent = 0;
+   asio::error_code failures[MaxBatchSize];
+   unsigned int failed = 0;
+   unsigned int done = 0;
+   while(done < count)
+   {
+      int result = sendmmsg(mSocket.native_handle(), &msgs[done], count - done, MSG_DONTWAIT);
+      if(result < 0)
+      {
+         int err = errno;
+         if(err == EAGAIN || err == EWOULDBLOCK)
+         {
+            break;
+         }
+         if(err != EINTR)
+         {
+            // sendmmsg() only reports an error for the first message; fail
+            // that one and carry on with the rest
+            failures[failed++] = asio::error_code(err, asio::error::get_system_category());
+            done++;
+         }
+         continue;
+      }
+      sent += result;
+      done += result;
+   }
+   // The socket buffer is full: the rest wait for the socket in the send queue
+   for(; done < count; done++)
+   {
+      mQueuedSends++;
+      queueSendData(std::move(mSendBatch[done]));
+   }
+   mSendBatch.clear();
+
+   for(unsigned int i = 0; i < failed; i++)
+   {
+      onSendFailure(failures[i]);
+   }
+   for(unsigned int i = 0; i < sent; i++)
+   {
+      onSendSuccess();
+   }
+#endif
+}
+
+void
+AsyncUdpSocketBase::handleSend(const asio::error_code& e)
+{
+   if(mQueuedSends > 0)
+   {
+      mQueuedSends--;
+   }
+   AsyncSocketBase::handleSend(e);
+}
+
 void 
 AsyncUdpSocketBase::transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers)
 {
    //InfoLog(<< "AsyncUdpSocketBase::transportSend " << buffers.size() << " buffer(s) to " << destination << " - buf1 size=" << buffer_size(buffers.front()));
    mSocket.async_send_to(buffers, 
                          asio::ip::udp::endpoint(destination.getAddress(), destination.getPort()), 
-                         boost::bind(&AsyncUdpSocketBase::handleSend, shared_from_this(), asio::placeholders::error));
+                         boost::bind(&AsyncUdpSocketBase::handleSend, std::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()), asio::placeholders::error));
 }
 
 void 
 AsyncUdpSocketBase::transportReceive()
 {
+#ifdef __linux__
+   if(mBatching)
+   {
+      if(mReceiveBatchFull)
+      {
+         // More is likely queued: read again without waiting on the reactor
+         mIOService.post(boost::bind(&AsyncUdpSocketBase::handleReceiveBatch, std::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()), asio::error_code()));
+      }
+      else
+      {
+         mSocket.async_wait(asio::ip::udp::socket::wait_read,
+                            boost::bind(&AsyncUdpSocketBase::handleReceiveBatch, std::static_pointer_cast<AsyncUdpSocketBase>(shared_from_this()), asio::placeholders::error));
+      }
+      return;
+   }
+#endif
    mSocket.async_receive_from(asio::buffer((void*)mReceiveBuffer->data(), RECEIVE_BUFFER_SIZE), mSenderEndpoint,
                boost::bind(&AsyncUdpSocketBase::handleReceive, shared_from_this(), asio::placeholders::error, asio::placeholders::bytes_transferred));
 }
 
+void
+AsyncUdpSocketBase::handleReceiveBatch(const asio::error_code& e)
+{
+#ifdef __linux__
+   if(e)
+   {
+      handleReceive(e, 0);
+      return;
+   }
+
+   // mReceiveBuffer, from doReceive(), is the first one
+   const unsigned int batchSize = mReceiveBatchSize;
+   std::shared_ptr<DataBuffer> buffers[MaxBatchSize];
+   asio::ip::udp::endpoint senders[MaxBatchSize];
+   struct mmsghdr msgs[MaxBatchSize];
+   struct iovec iovs[MaxBatchSize];
+   for(unsigned int i = 0; i < batchSize; i++)
+   {
+      buffers[i] = i == 0 ? std::move(mReceiveBuffer) : allocateReceiveBuffer();
+      iovs[i].iov_base = buffers[i]->mutableData();
+      iovs[i].iov_len = RECEIVE_BUFFER_SIZE;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = senders[i].data();
+      msgs[i].msg_hdr.msg_namelen = (socklen_t)senders[i].capacity();
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+   }
+
+   int count = recvmmsg(mSocket.native_handle(), msgs, batchSize, MSG_DONTWAIT, 0);
+   if(count <= 0)
+   {
+      int err = errno;
+      mReceiveBatchFull = false;
+      mReceiveBuffer = std::move(buffers[0]);
+      for(unsigned int i = 1; i < batchSize; i++)
+      {
+         buffers[i].reset();  // back to the pool
+      }
+      if(count == 0 || err == EAGAIN || err == EWOULDBLOCK || err == EINTR)
+      {
+         shrinkReceiveBatch();
+         transportReceive();
+      }
+      else
+      {
+         handleReceive(asio::error_code(err, asio::error::get_system_category()), 0);
+      }
+      return;
+   }
+   for(unsigned int i = count; i < batchSize; i++)
+   {
+      buffers[i].reset();  // back to the pool
+   }
+   if(count == (int)batchSize)
+   {
+      // Read again at once if this was a real batch; a single datagram says
+      // little about what else is waiting
+      mReceiveBatchFull = batchSize > 1;
+      mReceiveBatchSize = batchSize * 2 < MaxBatchSize ? batchSize * 2 : MaxBatchSize;
+   }
+   else
+   {
+      mReceiveBatchFull = false;
+      if(2 * (unsigned int)count <= batchSize)
+      {
+         shrinkReceiveBatch();
+      }
+   }
+
+   for(int i = 0; i < count; i++)
+   {
+      // As for a single datagram, it is the handler of the last one that
+      // asks for the next receive
+      mReceiving = (i + 1 < count);
+      senders[i].resize(msgs[i].msg_hdr.msg_namelen);
+      mSenderEndpoint = senders[i];
+      mReceiveBuffer = std::move(buffers[i]);
+      mReceiveBuffer->truncate(msgs[i].msg_len);
+      onReceiveSuccess(mSenderEndpoint.address(), mSenderEndpoint.port(), mReceiveBuffer);
+   }
+#endif
+}
+
+void
+AsyncUdpSocketBase::shrinkReceiveBatch()
+{
+   // halve the batch, and free the buffers a burst left in the pool
+   mReceiveBatchSize = mReceiveBatchSize > 1 ? mReceiveBatchSize / 2 : 1;
+   trimReceiveBufferPool(mReceiveBatchSize);
+}
+
 void 
 AsyncUdpSocketBase::transportFramedReceive()
 {
@@ -18,8 +18,25 @@ public:
    unsigned int getSocketDescriptor() override;
 
    asio::error_code bind(const asio::ip::address& address, unsigned short port) override;
+   /// Lets several sockets bind the same address and port (SO_REUSEPORT), with
+   /// the kernel spreading the datagrams across them by sender.  Must be set
+   /// before bind(); has no effect where load balancing is not supported.
+   void setReusePort(bool reusePort) noexcept { mReusePort = reusePort; }
+   static bool isReusePortSupported();
+   /// Moves up to MaxBatchSize datagrams per system call, with recvmmsg() and
+   /// sendmmsg().  The receive batch starts at one datagram and doubles while
+   /// the socket keeps filling it, so a quiet socket holds few buffers.  Each
+   /// datagram received is still handed to onReceiveSuccess() on its own; the
+   /// sends made meanwhile go out together once the handlers already queued on
+   /// the io_service have run.  Has no effect where recvmmsg() and sendmmsg()
+   /// are not available.
+   void setBatching(bool batching) noexcept { mBatching = batching; }
+   static bool isBatchingSupported();
    void connect(const std::string& address, unsigned short port) override;
 
+   using AsyncSocketBase::doSend;
+   void doSend(const StunTuple& destination, unsigned short channel, const std::shared_ptr<DataBuffer>& data, size_t bufferStartPos = 0) override;
+
    void transportReceive() override;
    void transportFramedReceive() override;
    void transportSend(const StunTuple& destination, std::vector<asio::const_buffer>& buffers) override;
@@ -35,10 +52,29 @@ protected:
    /// Endpoint info for current sender
    asio::ip::udp::endpoint mSenderEndpoint;
 
+   bool mReusePort;
+
    void handleUdpResolve(const asio::error_code& ec,
                          asio::ip::udp::resolver::iterator endpoint_iterator) override;
+   void handleSend(const asio::error_code& e) override;
 
 private:
+   static const unsigned int MaxBatchSize = 16;
+
+   void handleReceiveBatch(const asio::error_code& e);
+   void shrinkReceiveBatch();
+   void flushSendBatch();
+
+   bool mBatching;
+   /// Datagrams to ask the next recvmmsg() for
+   unsigned int mReceiveBatchSize;
+   /// The last recvmmsg() filled the batch, so there may be more to read
+   bool mReceiveBatchFull;
+   /// Sends waiting for sendmmsg()
+   std::vector<SendData> mSendBatch;
+   /// Sends handed to the asio send queue and not completed yet; later sends
+   /// go that way too, to keep the order
+   unsigned int mQueuedSends;
 
 };
 
@@ -26,8 +26,9 @@ public:
    RemotePeer* findRemotePeerByPeerAddress(const StunTuple& peerAddress);
 
 private:
-   typedef std::map<unsigned short,RemotePeer*> ChannelRemotePeerMap;
-   typedef std::map<StunTuple,RemotePeer*> TupleRemotePeerMap;
+   // Looked up for every relayed packet
+   typedef HashMap<unsigned short,RemotePeer*> ChannelRemotePeerMap;
+   typedef HashMap<StunTuple,RemotePeer*> TupleRemotePeerMap;
    ChannelRemotePeerMap mChannelRemotePeerMap;
    TupleRemotePeerMap mTupleRemotePeerMap;
 
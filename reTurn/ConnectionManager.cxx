@@ -1,6 +1,7 @@
 #include <algorithm>
 #include <boost/bind.hpp>
 
+#include <rutil/Lock.hxx>
 #include "ConnectionManager.hxx"
 
 namespace reTurn {
@@ -8,27 +9,38 @@ namespace reTurn {
 void 
 ConnectionManager::start(ConnectionPtr c)
 {
-  mConnections.insert(c);
-  c->start();
+  {
+     resip::Lock lock(mMutex);
+     mConnections.insert(c);
+  }
+  // The connection may run on another io_service than the acceptor
+  c->getIOService().post(boost::bind(&AsyncSocketBase::start, c));
 }
 
 void 
 ConnectionManager::stop(ConnectionPtr c)
 {
-  mConnections.erase(c);
+  {
+     resip::Lock lock(mMutex);
+     mConnections.erase(c);
+  }
   c->stop();
 }
 
 void 
 ConnectionManager::stopAll()
 {
-   std::set<ConnectionPtr>::iterator it = mConnections.begin();
+   std::set<ConnectionPtr> connections;
+   {
+      resip::Lock lock(mMutex);
+      connections.swap(mConnections);
+   }
 
-   for(; it != mConnections.end(); it++)
+   std::set<ConnectionPtr>::iterator it = connections.begin();
+   for(; it != connections.end(); it++)
    {
-      (*it)->stop();
+      (*it)->getIOService().post(boost::bind(&AsyncSocketBase::stop, *it));
    }
-   mConnections.clear();
 }
 
 } 
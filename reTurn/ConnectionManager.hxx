@@ -3,12 +3,14 @@
 
 #include <set>
 #include <boost/noncopyable.hpp>
+#include <rutil/Mutex.hxx>
 #include "AsyncSocketBase.hxx"
 
 namespace reTurn {
 
 /// Manages open connections so that they may be cleanly stopped when the server
-/// needs to shut down.
+/// needs to shut down.  Thread safe, since the connections of one server may
+/// run on different io_services.
 class ConnectionManager
   : private boost::noncopyable
 {
@@ -25,6 +27,7 @@ public:
 private:
   /// The managed connections.
   std::set<ConnectionPtr> mConnections;
+  resip::Mutex mMutex;
 };
 
 } 
@@ -13,6 +13,7 @@ void ArrayDeallocator(char* data)
 DataBuffer::DataBuffer(const char* const data, const size_t size, deallocator dealloc)
    : mBuffer(nullptr)
    , mSize(size)
+   , mCapacity(size)
    , mDealloc(dealloc)
 {
    if (mSize > 0)
@@ -26,6 +27,7 @@ DataBuffer::DataBuffer(const char* const data, const size_t size, deallocator de
 DataBuffer::DataBuffer(const size_t size, deallocator dealloc)
    : mBuffer(nullptr)
    , mSize(size)
+   , mCapacity(size)
    , mDealloc(dealloc)
 {
    if (mSize > 0)
@@ -47,6 +49,7 @@ DataBuffer* DataBuffer::own(char* const data, const size_t size, deallocator dea
    DataBuffer* buff = new reTurn::DataBuffer(0, dealloc);
    buff->mBuffer = data;
    buff->mSize = size;
+   buff->mCapacity = size;
    buff->mStart = buff->mBuffer;
    return buff;
 }
@@ -106,6 +109,14 @@ DataBuffer::offset(const size_t bytes)
    return mSize;
 }
 
+size_t
+DataBuffer::reset() noexcept
+{
+   mStart = mBuffer;
+   mSize = mCapacity;
+   return mSize;
+}
+
 } // namespace
 
 
@@ -25,6 +25,8 @@ public:
 
    size_t truncate(size_t newSize);
    size_t offset(size_t bytes);
+   /// Undoes truncate() and offset(), so the buffer can be used again
+   size_t reset() noexcept;
 
    char* mutableData() noexcept;
    size_t& mutableSize() noexcept;
@@ -32,6 +34,7 @@ public:
 private:
    char* mBuffer;
    size_t mSize;
+   size_t mCapacity;
    char* mStart;
    deallocator mDealloc;
 };
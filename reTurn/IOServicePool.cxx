@@ -0,0 +1,109 @@
+#include <thread>
+
+#include "IOServicePool.hxx"
+#include <rutil/WinLeakCheck.hxx>
+#include <rutil/Logger.hxx>
+#include "ReTurnSubsystem.hxx"
+
+#define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
+
+namespace reTurn {
+
+IOServicePool::IOServicePool(unsigned int size)
+: mNext(0)
+{
+   if(size == 0)
+   {
+      size = std::thread::hardware_concurrency();
+      if(size == 0)
+      {
+         size = 1;
+      }
+   }
+   for(unsigned int i = 0; i < size; i++)
+   {
+      std::shared_ptr<asio::io_service> ioService = std::make_shared<asio::io_service>(1 /* concurrency hint:  one thread per io_service */);
+      mIOServices.push_back(ioService);
+      mWork.push_back(std::make_shared<asio::io_service::work>(*ioService));
+   }
+}
+
+IOServicePool::~IOServicePool()
+{
+   stop();
+   join();
+}
+
+asio::io_service& 
+IOServicePool::getNextIOService()
+{
+   return *mIOServices[mNext++ % mIOServices.size()];
+}
+
+void 
+IOServicePool::run()
+{
+   InfoLog(<< "Starting " << mIOServices.size() << " io_service thread(s)");
+   for(size_t i = 0; i < mIOServices.size(); i++)
+   {
+      std::shared_ptr<asio::io_service> ioService = mIOServices[i];
+      mThreads.push_back(std::make_shared<asio::thread>([ioService] { ioService->run(); }));
+   }
+}
+
+void 
+IOServicePool::stop()
+{
+   mWork.clear();
+   for(size_t i = 0; i < mIOServices.size(); i++)
+   {
+      mIOServices[i]->stop();
+   }
+}
+
+void 
+IOServicePool::join()
+{
+   for(size_t i = 0; i < mThreads.size(); i++)
+   {
+      mThreads[i]->join();
+   }
+   mThreads.clear();
+}
+
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -0,0 +1,81 @@
+#ifndef IOSERVICEPOOL_HXX
+#define IOSERVICEPOOL_HXX
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <asio.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace reTurn {
+
+/// A set of io_services, each run by a thread of its own.  Everything
+/// belonging to one client - its connection, allocations, relay sockets
+/// and timers - is kept on one io_service, so that its handlers never run
+/// concurrently and need no locking; only state shared between clients
+/// (see TurnManager and ConnectionManager) has to be thread safe.
+class IOServicePool
+  : private boost::noncopyable
+{
+public:
+   /// size 0 means one io_service per CPU core
+   explicit IOServicePool(unsigned int size);
+   ~IOServicePool();
+
+   size_t size() const { return mIOServices.size(); }
+   asio::io_service& getIOService(size_t index) { return *mIOServices[index]; }
+   /// The io_services in turn; used to spread new clients across the threads.
+   asio::io_service& getNextIOService();
+
+   /// Start a thread running each io_service.
+   void run();
+   /// Stop all the io_services; join() then waits for their threads to exit.
+   void stop();
+   void join();
+
+private:
+   std::vector<std::shared_ptr<asio::io_service> > mIOServices;
+   // keeps the io_services running while they have nothing to do
+   std::vector<std::shared_ptr<asio::io_service::work> > mWork;
+   std::vector<std::shared_ptr<asio::thread> > mThreads;
+   std::atomic<size_t> mNext;
+};
+
+}
+
+#endif
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -37,6 +37,12 @@ using namespace boost::chrono;
 
 namespace reTurn {
 
+UserCredentials::UserCredentials(const UserAuthData& authData) :
+   mAuthData(authData),
+   mHmacKey(std::make_shared<StunHmacKey>(authData.getHa1()))
+{
+}
+
 ReTurnConfig::ReTurnConfig() :
    mSoftwareName(SOFTWARE_STRING),
    mPadSoftwareName(true),
@@ -46,6 +52,7 @@ ReTurnConfig::ReTurnConfig() :
    mTurnAddress(asio::ip::address::from_string("0.0.0.0")),
    mTurnV6Address(asio::ip::address::from_string("::0")),
    mAltStunAddress(asio::ip::address::from_string("0.0.0.0")),
+   mIOServiceThreads(1),
    mAuthenticationRealm("reTurn"),
    mUserDatabaseCheckInterval(60),
    mNonceLifetime(3600),            // 1 hour - at least 1 hours is recommended by the RFC
@@ -70,7 +77,8 @@ ReTurnConfig::ReTurnConfig() :
    mDaemonize(false),
    mPidFile(""),
    mRunAsUser(""),
-   mRunAsGroup("")
+   mRunAsGroup(""),
+   mUserDatabase(std::make_shared<UserDatabase>())
 {
 }
 
@@ -86,6 +94,7 @@ void ReTurnConfig::parseConfig(int argc, char** argv, const resip::Data& default
    mTurnAddress = asio::ip::address::from_string(getConfigData("TurnAddress", "0.0.0.0").c_str());
    mTurnV6Address = asio::ip::address::from_string(getConfigData("TurnV6Address", "::0").c_str());
    mAltStunAddress = asio::ip::address::from_string(getConfigData("AltStunAddress", "0.0.0.0").c_str());
+   mIOServiceThreads = getConfigUnsignedLong("IOServiceThreads", mIOServiceThreads);
    mAuthenticationRealm = getConfigData("AuthenticationRealm", mAuthenticationRealm);
    mUserDatabaseCheckInterval = getConfigUnsignedShort("UserDatabaseCheckInterval", 60);
    mNonceLifetime = getConfigUnsignedLong("NonceLifetime", mNonceLifetime);
@@ -154,14 +163,29 @@ ReTurnConfig::~ReTurnConfig()
 void
 ReTurnConfig::addUser(const resip::Data& username, const resip::Data& password, const resip::Data& realm)
 {
-   UserAuthData newUser(
+   std::shared_ptr<UserDatabase> users = std::make_shared<UserDatabase>(*getUserDatabase());
+   addUser(*users, username, password, realm);
+   std::atomic_store(&mUserDatabase, std::shared_ptr<const UserDatabase>(users));
+}
+
+void
+ReTurnConfig::addUser(UserDatabase& users, const resip::Data& username, const resip::Data& password, const resip::Data& realm) const
+{
+   UserCredentials newUser(
       mUserDatabaseHashedPasswords ?
          UserAuthData::createFromHex(username, realm, password)
        : UserAuthData::createFromPassword(username, realm, password)
       );
-   mRealmUsersAuthenticaionCredentials[std::make_pair(username, realm)] = newUser.getHa1();
-   RealmUsers& realmUsers(mUsers[realm]);
-   realmUsers.insert(pair<resip::Data,UserAuthData>(username, newUser));
+   RealmUsers& realmUsers(users[realm]);
+   RealmUsers::iterator it = realmUsers.find(username);
+   if(it != realmUsers.end())
+   {
+      it->second = newUser;
+   }
+   else
+   {
+      realmUsers.insert(RealmUsers::value_type(username, newUser));
+   }
 }
 
 void
@@ -175,8 +199,7 @@ ReTurnConfig::authParse(const resip::Data& accountDatabaseFilename)
       throw ReTurnConfig::Exception("Error opening/reading user database file!", __FILE__, __LINE__);
    }
 
-   mUsers.clear();
-   mRealmUsersAuthenticaionCredentials.clear();
+   std::shared_ptr<UserDatabase> users = std::make_shared<UserDatabase>();
 
    while(std::getline(accountDatabaseFile, sline))
    {
@@ -293,7 +316,7 @@ ReTurnConfig::authParse(const resip::Data& accountDatabaseFilename)
       if(accountState != REFUSED) 
       {
          try {
-            addUser(username, password, realm);
+            addUser(*users, username, password, realm);
          } catch (ConfigParse::Exception& ex) {
             ErrLog(<< "Exception adding user: " << username << ", cause: " << ex << ", skipping record");
          }
@@ -304,7 +327,9 @@ ReTurnConfig::authParse(const resip::Data& accountDatabaseFilename)
    InfoLog(<< "Processed " << userCount << " user(s) from " << lineNbr << " line(s) in " << accountDatabaseFilename);
    accountDatabaseFile.close();
 
-   if(mUsers.find(mAuthenticationRealm) == mUsers.end())
+   std::atomic_store(&mUserDatabase, std::shared_ptr<const UserDatabase>(users));
+
+   if(users->find(mAuthenticationRealm) == users->end())
    {
       WarningLog(<<"AuthenticationRealm = " << mAuthenticationRealm << " but no users defined for this realm in " << accountDatabaseFilename);
    }
@@ -323,17 +348,18 @@ ReTurnConfig::printHelpText(int argc, char **argv)
 bool
 ReTurnConfig::isUserNameValid(const resip::Data& username, const resip::Data& realm) const
 {
-   return getUser(username, realm).get() != NULL;
+   std::shared_ptr<const UserDatabase> users = getUserDatabase();
+   return findUser(*users, username, realm) != 0;
 }
 
 Data
 ReTurnConfig::getHa1ForUsername(const Data& username, const resip::Data& realm) const
 {
-   ReadLock lock(mUserDataMutex);
-   std::map<RealmUserPair, resip::Data>::const_iterator it = mRealmUsersAuthenticaionCredentials.find(std::make_pair(username, realm));
-   if(it != mRealmUsersAuthenticaionCredentials.end())
+   std::shared_ptr<const UserDatabase> users = getUserDatabase();
+   const UserCredentials* user = findUser(*users, username, realm);
+   if(user)
    {
-      return it->second;
+      return user->mAuthData.getHa1();
    }
    else
    {
@@ -344,18 +370,37 @@ ReTurnConfig::getHa1ForUsername(const Data& username, const resip::Data& realm)
 std::unique_ptr<UserAuthData>
 ReTurnConfig::getUser(const resip::Data& userName, const resip::Data& realm) const
 {
-   ReadLock lock(mUserDataMutex);
-   std::unique_ptr<UserAuthData> ret;
-   std::map<resip::Data,RealmUsers>::const_iterator it = mUsers.find(realm);
-   if(it == mUsers.end())
-      return ret;
-
-   RealmUsers realmUsers = it->second;
-   RealmUsers::const_iterator it2 = realmUsers.find(userName);
-   if(it2 == realmUsers.end())
-      return ret;
-
-   return std::unique_ptr<UserAuthData>(new UserAuthData(it2->second));
+   std::shared_ptr<const UserDatabase> users = getUserDatabase();
+   const UserCredentials* user = findUser(*users, userName, realm);
+   if(!user)
+      return std::unique_ptr<UserAuthData>();
+
+   return std::unique_ptr<UserAuthData>(new UserAuthData(user->mAuthData));
+}
+
+std::shared_ptr<const StunHmacKey>
+ReTurnConfig::getHmacKey(const resip::Data& username, const resip::Data& realm) const
+{
+   std::shared_ptr<const UserDatabase> users = getUserDatabase();
+   const UserCredentials* user = findUser(*users, username, realm);
+   if(!user)
+      return std::shared_ptr<const StunHmacKey>();
+
+   return user->mHmacKey;
+}
+
+const UserCredentials*
+ReTurnConfig::findUser(const UserDatabase& users, const resip::Data& username, const resip::Data& realm)
+{
+   UserDatabase::const_iterator it = users.find(realm);
+   if(it == users.end())
+      return 0;
+
+   RealmUsers::const_iterator it2 = it->second.find(username);
+   if(it2 == it->second.end())
+      return 0;
+
+   return &it2->second;
 }
 
 bool ReTurnUserFileScanner::mHup = false;
@@ -2,6 +2,7 @@
 #define RETURN_CONFIG_HXX 
 
 #include <map>
+#include <memory>
 #include <asio.hpp>
 #ifdef USE_SSL
 #include <asio/ssl.hpp>
@@ -12,12 +13,25 @@
 #include <rutil/BaseException.hxx>
 #include <rutil/RWMutex.hxx>
 #include <rutil/Lock.hxx>
+#include <rutil/HashMap.hxx>
 
+#include <reTurn/StunMessage.hxx>
 #include <reTurn/UserAuthData.hxx>
 
 namespace reTurn {
 
-typedef std::map<resip::Data,reTurn::UserAuthData> RealmUsers;
+/// A user from the users file, with its MessageIntegrity key (H(A1)) ready for use
+struct UserCredentials
+{
+   explicit UserCredentials(const UserAuthData& authData);
+
+   UserAuthData mAuthData;
+   std::shared_ptr<const StunHmacKey> mHmacKey;
+};
+typedef HashMap<resip::Data,UserCredentials> RealmUsers;
+/// The users, by realm.  Never changed once in use: adding users or reloading
+/// the users file builds a new one and swaps it in.
+typedef HashMap<resip::Data,RealmUsers> UserDatabase;
 typedef std::pair<resip::Data, resip::Data> RealmUserPair;
 
 class ReTurnConfig : public resip::ConfigParse
@@ -58,10 +72,11 @@ public:
    asio::ip::address mTurnAddress;
    asio::ip::address mTurnV6Address;
    asio::ip::address mAltStunAddress;
+   unsigned int mIOServiceThreads;
 
    resip::Data mAuthenticationRealm;
    int mUserDatabaseCheckInterval;
-   mutable resip::RWMutex mUserDataMutex;
+   mutable resip::RWMutex mUserDataMutex;  // held for writing while the users file is reloaded; the lookups below don't need it
    unsigned long mNonceLifetime;
 
    unsigned short mAllocationPortRangeMin;
@@ -93,12 +108,16 @@ public:
    bool isUserNameValid(const resip::Data& username,  const resip::Data& realm) const;
    resip::Data getHa1ForUsername(const resip::Data& username, const resip::Data& realm) const;
    std::unique_ptr<UserAuthData> getUser(const resip::Data& userName, const resip::Data& realm) const;
-   void addUser(const resip::Data& username, const resip::Data& password, const resip::Data& realm);
+   /// the user's long term credential MessageIntegrity key, or null if the user is unknown
+   std::shared_ptr<const StunHmacKey> getHmacKey(const resip::Data& username, const resip::Data& realm) const;
+   void addUser(const resip::Data& username, const resip::Data& password, const resip::Data& realm);  // copies the user database, authParse loads many users at once
    void authParse(const resip::Data& accountDatabaseFilename);
 
 private:
-   std::map<resip::Data,RealmUsers> mUsers;
-   std::map<RealmUserPair, resip::Data> mRealmUsersAuthenticaionCredentials;
+   std::shared_ptr<const UserDatabase> mUserDatabase;  // only accessed with std::atomic_load/std::atomic_store
+   std::shared_ptr<const UserDatabase> getUserDatabase() const { return std::atomic_load(&mUserDatabase); }
+   static const UserCredentials* findUser(const UserDatabase& users, const resip::Data& username, const resip::Data& realm);
+   void addUser(UserDatabase& users, const resip::Data& username, const resip::Data& password, const resip::Data& realm) const;
 
    friend class ReTurnUserFileScanner;
 };
@@ -289,7 +289,8 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
 
       // !slg! need to determine whether the USERNAME contains a known entity, and is known 
       //       within the realm of the REALM attribute of the request
-      if (!getConfig().isUserNameValid(*request.mUsername, *request.mRealm))
+      std::shared_ptr<const StunHmacKey> hmacKey = getConfig().getHmacKey(*request.mUsername, *request.mRealm);
+      if (!hmacKey)
       {
          WarningLog(<< "Invalid username '" << *request.mUsername << "' or realm '" << *request.mRealm << "' (username unknown or potential AuthorizationRealm mismatch). Sending 401. Sender=" << request.mRemoteTuple);
          buildErrorResponse(response, 401, "Unauthorized", getConfig().mAuthenticationRealm.c_str());
@@ -299,13 +300,10 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
       StackLog(<< "Validating MessageIntegrity");
 
       // Need to calculate HMAC across entire message - for LongTermAuthentication we use 
-      // username:realm:password string as the key
-      Data hmacKey;
+      // MD5(username:realm:password) as the key, computed when the users were loaded
       resip_assert(request.mHasUsername);  // Note:  This is checked above
 
-      request.calculateHmacKeyForHa1(hmacKey, getConfig().getHa1ForUsername(*request.mUsername, *request.mRealm));
-
-      if(!request.checkMessageIntegrity(hmacKey))
+      if(!request.checkMessageIntegrity(*hmacKey))
       {
          WarningLog(<< "MessageIntegrity is bad. Sending 401. Sender=" << request.mRemoteTuple);
          buildErrorResponse(response, 401, "Unauthorized", getConfig().mAuthenticationRealm.c_str());
@@ -314,7 +312,8 @@ RequestHandler::handleAuthentication(StunMessage& request, StunMessage& response
 
       // need to compute this later after message is filled in
       response.mHasMessageIntegrity = true;
-      response.mHmacKey = hmacKey;  // Used to later calculate Message Integrity during encoding
+      response.mHmacKey = hmacKey->getKey();  // Used to later calculate Message Integrity during encoding
+      response.mCachedHmacKey = hmacKey;
    }
 
    return true;
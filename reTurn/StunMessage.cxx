@@ -19,7 +19,13 @@
 #define RESIPROCATE_SUBSYSTEM ReTurnSubsystem::RETURN
 
 #ifdef USE_SSL
-#include <openssl/hmac.h>
+#include <openssl/evp.h>
+#include <openssl/opensslv.h>
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_new EVP_MD_CTX_create
+#define EVP_MD_CTX_free EVP_MD_CTX_destroy
+#endif // OPENSSL_VERSION_NUMBER < 0x10100000L
 #endif
 
 using namespace std;
@@ -1643,7 +1649,14 @@ StunMessage::stunEncodeMessage(char* buf, unsigned int bufLen)
       int len = ptr - buf;
       StackLog(<< "Adding message integrity: buffer size=" << len << ", hmacKey=" << mHmacKey.hex());
       StunAtrIntegrity integrity;
-      computeHmac(integrity.hash, buf, len, mHmacKey.c_str(), (int)mHmacKey.size());
+      if(mCachedHmacKey)
+      {
+         mCachedHmacKey->compute(integrity.hash, buf, len);
+      }
+      else
+      {
+         computeHmac(integrity.hash, buf, len, mHmacKey.c_str(), (int)mHmacKey.size());
+      }
 	   ptr = encodeAtrIntegrity(ptr, integrity);
    }
 
@@ -1677,25 +1690,98 @@ StunMessage::stunEncodeFramedMessage(char* buf, unsigned int bufLen)
    return size+4;
 }
 
-#ifndef USE_SSL
 void
 StunMessage::computeHmac(char* hmac, const char* input, int length, const char* key, int sizeKey)
+{
+   //StackLog(<< "***computeHmac: input='" << Data(input, length).hex() << "', length=" << length << ", key='" << Data(key, sizeKey).hex() << "', keySize=" << sizeKey);
+   StunHmacKey(Data(Data::Share, key, sizeKey)).compute(hmac, input, length);
+}
+
+#ifndef USE_SSL
+StunHmacKey::StunHmacKey(const Data& key) :
+   mKey(key),
+   mPads(0)
+{
+}
+
+StunHmacKey::~StunHmacKey()
+{
+}
+
+void
+StunHmacKey::compute(char* hmac, const char* input, int length) const
 {
    // !slg! TODO - use newly added rutil/SHA1.hxx class  - will need to add new method to it to support this
    strncpy(hmac,"hmac-not-implemented",20);
 }
 #else
-void
-StunMessage::computeHmac(char* hmac, const char* input, int length, const char* key, int sizeKey)
+// The digest states after hashing the inner and the outer key pads (RFC 2104)
+struct StunHmacKey::Pads
 {
-   //StackLog(<< "***computeHmac: input='" << Data(input, length).hex() << "', length=" << length << ", key='" << Data(key, sizeKey).hex() << "', keySize=" << sizeKey);
+   EVP_MD_CTX* mInner;
+   EVP_MD_CTX* mOuter;
+};
 
-   unsigned int resultSize=20;
-   HMAC(EVP_sha1(), 
-        key, sizeKey, 
-        reinterpret_cast<const unsigned char*>(input), length, 
-        reinterpret_cast<unsigned char*>(hmac), &resultSize);
-   resip_assert(resultSize == 20);
+StunHmacKey::StunHmacKey(const Data& key) :
+   mKey(key),
+   mPads(new Pads)
+{
+   static const unsigned int BlockSize = 64;  // of SHA1
+   unsigned char block[BlockSize];
+   memset(block, 0, sizeof(block));
+   if(mKey.size() > BlockSize)
+   {
+      // Long keys are replaced by their hash
+      unsigned int size = 0;
+      EVP_Digest(mKey.data(), mKey.size(), block, &size, EVP_sha1(), 0);
+   }
+   else
+   {
+      memcpy(block, mKey.data(), mKey.size());
+   }
+
+   unsigned char pad[BlockSize];
+   for(unsigned int i = 0; i < BlockSize; i++)
+   {
+      pad[i] = block[i] ^ 0x36;
+   }
+   mPads->mInner = EVP_MD_CTX_new();
+   EVP_DigestInit_ex(mPads->mInner, EVP_sha1(), 0);
+   EVP_DigestUpdate(mPads->mInner, pad, BlockSize);
+
+   for(unsigned int i = 0; i < BlockSize; i++)
+   {
+      pad[i] = block[i] ^ 0x5c;
+   }
+   mPads->mOuter = EVP_MD_CTX_new();
+   EVP_DigestInit_ex(mPads->mOuter, EVP_sha1(), 0);
+   EVP_DigestUpdate(mPads->mOuter, pad, BlockSize);
+}
+
+StunHmacKey::~StunHmacKey()
+{
+   EVP_MD_CTX_free(mPads->mInner);
+   EVP_MD_CTX_free(mPads->mOuter);
+   delete mPads;
+}
+
+void
+StunHmacKey::compute(char* hmac, const char* input, int length) const
+{
+   // The pads are only copied from, so any number of threads can use them at once
+   EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+   unsigned char inner[EVP_MAX_MD_SIZE];
+   unsigned int size = 0;
+   EVP_MD_CTX_copy_ex(ctx, mPads->mInner);
+   EVP_DigestUpdate(ctx, input, length);
+   EVP_DigestFinal_ex(ctx, inner, &size);
+   resip_assert(size == 20);
+
+   EVP_MD_CTX_copy_ex(ctx, mPads->mOuter);
+   EVP_DigestUpdate(ctx, inner, size);
+   EVP_DigestFinal_ex(ctx, reinterpret_cast<unsigned char*>(hmac), &size);
+   resip_assert(size == 20);
+   EVP_MD_CTX_free(ctx);
 }
 #endif
 
@@ -1837,6 +1923,12 @@ StunMessage::calculateHmacKey(Data& hmacKey, const Data& username, const Data& r
 
 bool 
 StunMessage::checkMessageIntegrity(const Data& hmacKey)
+{
+   return checkMessageIntegrity(StunHmacKey(hmacKey));
+}
+
+bool 
+StunMessage::checkMessageIntegrity(const StunHmacKey& hmacKey)
 {
    if(mHasMessageIntegrity)
    {
@@ -1853,8 +1945,8 @@ StunMessage::checkMessageIntegrity(const Data& hmacKey)
 
       // Calculate HMAC
       int iHMACBufferSize = mMessageIntegrityMsgLength - 24 /* MessageIntegrity size */ + sizeof(StunMsgHdr); // The entire message proceeding the message integrity attribute
-      StackLog(<< "Checking message integrity: length=" << mMessageIntegrityMsgLength << ", size=" << iHMACBufferSize << ", hmacKey=" << hmacKey.hex());
-      computeHmac((char*)hmac, mBuffer.data(), iHMACBufferSize, hmacKey.c_str(), hmacKey.size());
+      StackLog(<< "Checking message integrity: length=" << mMessageIntegrityMsgLength << ", size=" << iHMACBufferSize << ", hmacKey=" << hmacKey.getKey().hex());
+      hmacKey.compute((char*)hmac, mBuffer.data(), iHMACBufferSize);
 
       // Restore original stun message length in mBuffer
       memcpy(lengthposition, &originalLength, 2);
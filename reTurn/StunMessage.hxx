@@ -1,6 +1,7 @@
 #if !defined(STUNMESSAGE_HXX)
 #define STUNMESSAGE_HXX 
 
+#include <memory>
 #include <ostream>
 #include <rutil/compat.hxx>
 #include <rutil/Data.hxx>
@@ -25,6 +26,28 @@ bool operator<(const UInt128&, const UInt128&);
 bool operator==(const UInt128&, const UInt128&);
 #endif
 
+/// A MessageIntegrity key, with its HMAC-SHA1 key pads hashed once up front,
+/// so that each message only costs hashing the message itself.  It can't be
+/// changed once built, so one can be shared by all the threads.
+class StunHmacKey
+{
+public:
+   explicit StunHmacKey(const resip::Data& key);
+   ~StunHmacKey();
+
+   const resip::Data& getKey() const { return mKey; }
+   void compute(char* hmac, const char* input, int length) const;  // hmac is 20 bytes
+
+private:
+   resip::Data mKey;
+   struct Pads;
+   Pads* mPads;
+
+   // no value semantics
+   StunHmacKey(const StunHmacKey&);
+   StunHmacKey& operator=(const StunHmacKey&);
+};
+
 class StunMessage
 {
 public:
@@ -66,6 +89,7 @@ public:
    void calculateHmacKeyForHa1(resip::Data& hmacKey, const resip::Data& ha1);
    void calculateHmacKey(resip::Data& hmacKey, const resip::Data& username, const resip::Data& realm, const resip::Data& longtermAuthenticationPassword);
    bool checkMessageIntegrity(const resip::Data& hmacKey);
+   bool checkMessageIntegrity(const StunHmacKey& hmacKey);
    bool checkFingerprint();
 
    /// define stun address families
@@ -239,6 +263,7 @@ public:
    StunTuple mRemoteTuple; // Remote address and port that sent the stun message
    resip::Data mBuffer;
    resip::Data mHmacKey;
+   std::shared_ptr<const StunHmacKey> mCachedHmacKey;  // if set, used instead of mHmacKey (and holds the same key) when encoding
 
    UInt16 mMessageIntegrityMsgLength;
 
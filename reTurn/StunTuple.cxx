@@ -60,6 +60,28 @@ StunTuple::operator<(const StunTuple& rhs) const
    return false;
 }
 
+size_t
+StunTuple::hash() const
+{
+   return AddressHash()(mAddress) * 31 + (mPort << 2) + mTransport;
+}
+
+size_t
+AddressHash::operator()(const asio::ip::address& address) const
+{
+   if(address.is_v4())
+   {
+      return address.to_v4().to_ulong();
+   }
+   asio::ip::address_v6::bytes_type bytes = address.to_v6().to_bytes();
+   size_t result = 0;
+   for(size_t i = 0; i < bytes.size(); i++)
+   {
+      result = result * 31 + bytes[i];
+   }
+   return result;
+}
+
 void
 StunTuple::toSockaddr(sockaddr* addr) const
 {
@@ -115,6 +137,8 @@ operator<<(EncodeStream& strm, const StunTuple& tuple)
 
 } // namespace
 
+HashValueImp(reTurn::StunTuple, data.hash());
+
 
 /* ====================================================================
 
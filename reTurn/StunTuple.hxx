@@ -12,6 +12,7 @@
 
 #include "rutil/Socket.hxx"
 #include "rutil/compat.hxx"
+#include "rutil/HashMap.hxx"
 
 
 #include <asio.hpp>
@@ -22,6 +23,12 @@
 
 namespace reTurn {
 
+/// Hashes an address, for use as a HashMap key
+struct AddressHash
+{
+   size_t operator()(const asio::ip::address& address) const;
+};
+
 class StunTuple
 {
 public:
@@ -51,6 +58,8 @@ public:
 
    void toSockaddr(sockaddr* addr) const;
 
+   size_t hash() const;
+
 private:
    TransportType mTransport;
    asio::ip::address mAddress;
@@ -63,6 +72,8 @@ EncodeStream& operator<<(EncodeStream& strm, const StunTuple& tuple);
 
 } 
 
+HashValue(reTurn::StunTuple);
+
 #endif
 
 
@@ -8,11 +8,11 @@
 
 namespace reTurn {
 
-TcpServer::TcpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
-: mIOService(ioService),
-  mAcceptor(ioService),
+TcpServer::TcpServer(IOServicePool& ioServicePool, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+: mIOServicePool(ioServicePool),
+  mAcceptor(ioServicePool.getIOService(0)),
   mConnectionManager(),
-  mNewConnection(new TcpConnection(ioService, mConnectionManager, requestHandler)),
+  mNewConnection(new TcpConnection(ioServicePool.getNextIOService(), mConnectionManager, requestHandler)),
   mRequestHandler(requestHandler)
 {
    // Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
@@ -48,7 +48,7 @@ TcpServer::handleAccept(const asio::error_code& e)
    {
       mConnectionManager.start(mNewConnection);
 
-      mNewConnection.reset(new TcpConnection(mIOService, mConnectionManager, mRequestHandler));
+      mNewConnection.reset(new TcpConnection(mIOServicePool.getNextIOService(), mConnectionManager, mRequestHandler));
       mAcceptor.async_accept(((TcpConnection*)mNewConnection.get())->socket(), boost::bind(&TcpServer::handleAccept, this, asio::placeholders::error));
    }
    else
@@ -57,7 +57,7 @@ TcpServer::handleAccept(const asio::error_code& e)
       if(e == asio::error::no_descriptors)
       {
          // Retry if too many open files (ie. out of socket descriptors)
-         mNewConnection.reset(new TcpConnection(mIOService, mConnectionManager, mRequestHandler));
+         mNewConnection.reset(new TcpConnection(mIOServicePool.getNextIOService(), mConnectionManager, mRequestHandler));
          mAcceptor.async_accept(((TcpConnection*)mNewConnection.get())->socket(), boost::bind(&TcpServer::handleAccept, this, asio::placeholders::error));
       }
    }
@@ -9,6 +9,7 @@
 #include <boost/noncopyable.hpp>
 #include "TcpConnection.hxx"
 #include "ConnectionManager.hxx"
+#include "IOServicePool.hxx"
 #include "RequestHandler.hxx"
 
 namespace reTurn {
@@ -17,8 +18,10 @@ class TcpServer
   : private boost::noncopyable
 {
 public:
-  /// Create the server to listen on the specified TCP address and port
-  explicit TcpServer(asio::io_service& ioService, RequestHandler& rqeuestHandler, const asio::ip::address& address, unsigned short port);
+  /// Create the server to listen on the specified TCP address and port.  The
+  /// acceptor runs on the first io_service of the pool, and the accepted
+  /// connections on each of them in turn.
+  explicit TcpServer(IOServicePool& ioServicePool, RequestHandler& rqeuestHandler, const asio::ip::address& address, unsigned short port);
 
   void start();
 
@@ -26,8 +29,8 @@ private:
   /// Handle completion of an asynchronous accept operation.
   void handleAccept(const asio::error_code& e);
 
-  /// The io_service used to perform asynchronous operations.
-  asio::io_service& mIOService;
+  /// The io_services used to perform asynchronous operations.
+  IOServicePool& mIOServicePool;
 
   /// Acceptor used to listen for incoming connections.
   asio::ip::tcp::acceptor mAcceptor;
@@ -15,9 +15,9 @@
 
 namespace reTurn {
 
-TlsServer::TlsServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
-: mIOService(ioService),
-  mAcceptor(ioService),
+TlsServer::TlsServer(IOServicePool& ioServicePool, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+: mIOServicePool(ioServicePool),
+  mAcceptor(ioServicePool.getIOService(0)),
   mContext(asio::ssl::context::sslv23),  // SSLv23 (actually chooses TLS version dynamically)
   mConnectionManager(),
   mRequestHandler(requestHandler)
@@ -82,7 +82,7 @@ TlsServer::TlsServer(asio::io_service& ioService, RequestHandler& requestHandler
 void
 TlsServer::start()
 {
-   mNewConnection.reset(new TlsConnection(mIOService, mConnectionManager, mRequestHandler, mContext));
+   mNewConnection.reset(new TlsConnection(mIOServicePool.getNextIOService(), mConnectionManager, mRequestHandler, mContext));
    mAcceptor.async_accept(((TlsConnection*)mNewConnection.get())->socket(), boost::bind(&TlsServer::handleAccept, this, asio::placeholders::error));
 }
 
@@ -99,7 +99,7 @@ TlsServer::handleAccept(const asio::error_code& e)
    {
       mConnectionManager.start(mNewConnection);
 
-      mNewConnection.reset(new TlsConnection(mIOService, mConnectionManager, mRequestHandler, mContext));
+      mNewConnection.reset(new TlsConnection(mIOServicePool.getNextIOService(), mConnectionManager, mRequestHandler, mContext));
       mAcceptor.async_accept(((TlsConnection*)mNewConnection.get())->socket(), boost::bind(&TlsServer::handleAccept, this, asio::placeholders::error));
    }
    else
@@ -108,7 +108,7 @@ TlsServer::handleAccept(const asio::error_code& e)
       if(e == asio::error::no_descriptors)
       {
          // Retry if too many open files (ie. out of socket descriptors)
-         mNewConnection.reset(new TlsConnection(mIOService, mConnectionManager, mRequestHandler, mContext));
+         mNewConnection.reset(new TlsConnection(mIOServicePool.getNextIOService(), mConnectionManager, mRequestHandler, mContext));
          mAcceptor.async_accept(((TlsConnection*)mNewConnection.get())->socket(), boost::bind(&TlsServer::handleAccept, this, asio::placeholders::error));
       }
    }
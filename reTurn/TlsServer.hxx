@@ -13,6 +13,7 @@
 #include <boost/noncopyable.hpp>
 #include "TlsConnection.hxx"
 #include "ConnectionManager.hxx"
+#include "IOServicePool.hxx"
 #include "RequestHandler.hxx"
 
 namespace reTurn {
@@ -21,8 +22,10 @@ class TlsServer
   : private boost::noncopyable
 {
 public:
-  /// Create the server to listen on the specified TCP address and port
-  explicit TlsServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port);
+  /// Create the server to listen on the specified TCP address and port.  The
+  /// acceptor runs on the first io_service of the pool, and the accepted
+  /// connections on each of them in turn.
+  explicit TlsServer(IOServicePool& ioServicePool, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port);
 
   void start();
 
@@ -33,8 +36,8 @@ private:
   /// Callback for private key password
   std::string getPassword() const;
 
-  /// The io_service used to perform asynchronous operations.
-  asio::io_service& mIOService;
+  /// The io_services used to perform asynchronous operations.
+  IOServicePool& mIOServicePool;
 
   /// Acceptor used to listen for incoming connections.
   asio::ip::tcp::acceptor mAcceptor;
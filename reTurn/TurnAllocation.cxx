@@ -41,7 +41,7 @@ TurnAllocation::TurnAllocation(TurnManager& turnManager,
    mRequestedTuple(requestedTuple),
    mTurnManager(turnManager),
    mTurnAllocationManager(turnAllocationManager),
-   mAllocationTimer(turnManager.getIOService()),
+   mAllocationTimer(localTurnSocket->getIOService()),
    mLocalTurnSocket(localTurnSocket),
    mBadChannelErrorLogged(false),
    mNoPermissionToPeerLogged(false),
@@ -85,7 +85,9 @@ TurnAllocation::startRelay()
 {
    if(mRequestedTuple.getTransportType() == StunTuple::UDP)
    {
-      mUdpRelayServer = std::make_shared<UdpRelayServer>(mTurnManager.getIOService(), *this);
+      // The relay runs on the client's io_service, so that everything to do with
+      // this allocation is handled by the one thread
+      mUdpRelayServer = std::make_shared<UdpRelayServer>(mLocalTurnSocket->getIOService(), *this);
       if(!mUdpRelayServer->startReceiving())
       {
          stopRelay();  // Ensure allocation timer is stopped
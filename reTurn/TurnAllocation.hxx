@@ -82,7 +82,7 @@ private:
    time_t    mExpires;
    //unsigned int mBandwidth; // future use
 
-   typedef std::map<asio::ip::address,TurnPermission*> TurnPermissionMap;
+   typedef HashMap<asio::ip::address,TurnPermission*,AddressHash> TurnPermissionMap;
    TurnPermissionMap mTurnPermissionMap;
 
    TurnManager& mTurnManager;
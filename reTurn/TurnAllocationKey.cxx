@@ -38,9 +38,16 @@ TurnAllocationKey::operator<(const TurnAllocationKey& rhs) const
    return false;
 }
 
+size_t
+TurnAllocationKey::hash() const
+{
+   return mClientLocalTuple.hash() * 31 + mClientRemoteTuple.hash();
+}
 
 } // namespace
 
+HashValueImp(reTurn::TurnAllocationKey, data.hash());
+
 
 /* ====================================================================
 
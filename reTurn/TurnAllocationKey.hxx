@@ -20,6 +20,8 @@ public:
    const StunTuple& getClientLocalTuple() const { return mClientLocalTuple; }
    const StunTuple& getClientRemoteTuple() const { return mClientRemoteTuple; }
 
+   size_t hash() const;
+
 private:
    StunTuple mClientLocalTuple;
    StunTuple mClientRemoteTuple;
@@ -27,6 +29,8 @@ private:
 
 } 
 
+HashValue(reTurn::TurnAllocationKey);
+
 #endif
 
 
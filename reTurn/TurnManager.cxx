@@ -11,18 +11,11 @@ using namespace std;
 
 namespace reTurn {
 
-TurnManager::TurnManager(asio::io_service& ioService, const ReTurnConfig& config) : 
-   mLastAllocatedUdpPort(config.mAllocationPortRangeMin-1),
-   mLastAllocatedTcpPort(config.mAllocationPortRangeMin-1),
-   mIOService(ioService),
+TurnManager::TurnManager(const ReTurnConfig& config) : 
+   mUdpAllocationPorts(config.mAllocationPortRangeMin, config.mAllocationPortRangeMax),
+   mTcpAllocationPorts(config.mAllocationPortRangeMin, config.mAllocationPortRangeMax),
    mConfig(config)
 {
-   // Initialize Allocation Ports
-   for(unsigned short i = config.mAllocationPortRangeMin; i <= config.mAllocationPortRangeMax && i != 0; i++) // i != 0 catches case where we increment 65535 (as an unsigned short)
-   {
-      mUdpAllocationPorts[i] = PortStateUnallocated;
-      mTcpAllocationPorts[i] = PortStateUnallocated;
-   }
 }
 
 TurnManager::~TurnManager()
@@ -33,167 +26,195 @@ TurnManager::~TurnManager()
 unsigned short 
 TurnManager::allocateAnyPort(StunTuple::TransportType transport)
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
-   {
-      portToCheck = advanceLastAllocatedPort(transport);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
-   }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
+   resip::Lock lock(mMutex);
+   return getPortAllocator(transport).allocateAny();
 }
 
 unsigned short 
 TurnManager::allocateEvenPort(StunTuple::TransportType transport)
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is even
-   while(startPortToCheck % 2 != 0)
+   resip::Lock lock(mMutex);
+   return getPortAllocator(transport).allocateEven();
+}
+
+// Note:  This is not used, since requesting an odd port was removed
+unsigned short 
+TurnManager::allocateOddPort(StunTuple::TransportType transport)
+{
+   resip::Lock lock(mMutex);
+   return getPortAllocator(transport).allocateOdd();
+}
+
+unsigned short 
+TurnManager::allocateEvenPortPair(StunTuple::TransportType transport)
+{
+   resip::Lock lock(mMutex);
+   return getPortAllocator(transport).allocateEvenPair();
+}
+
+bool 
+TurnManager::allocatePort(StunTuple::TransportType transport, unsigned short port, bool reserved)
+{
+   resip::Lock lock(mMutex);
+   return getPortAllocator(transport).allocate(port, reserved);
+}
+
+void 
+TurnManager::deallocatePort(StunTuple::TransportType transport, unsigned short port)
+{
+   resip::Lock lock(mMutex);
+   getPortAllocator(transport).deallocate(port);
+}
+
+TurnManager::PortAllocator& 
+TurnManager::getPortAllocator(StunTuple::TransportType transport)
+{
+   switch(transport)
    {
-      startPortToCheck = advanceLastAllocatedPort(transport);
+   case StunTuple::TCP:
+   case StunTuple::TLS:
+      return mTcpAllocationPorts;
+   case StunTuple::UDP:
+   default:
+      return mUdpAllocationPorts;
+   }
+}
+
+TurnManager::PortAllocator::PortAllocator(unsigned short min, unsigned short max) :
+   mMin(min),
+   mMax(max)
+{
+   if(min == 0 || max < min)
+   {
+      return;
    }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
+   mPortStates.resize(max - min + 1, PortStateUnallocated);
+   mQueued.resize(mPortStates.size(), true);
+   for(unsigned int port = min; port <= max; port++)
    {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
+      (port % 2 == 0 ? mFreeEvenPorts : mFreeOddPorts).push_back((unsigned short)port);
    }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
 }
 
-// Note:  This is not used, since requesting an odd port was removed
 unsigned short 
-TurnManager::allocateOddPort(StunTuple::TransportType transport)
+TurnManager::PortAllocator::allocateAny()
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is odd
-   while(startPortToCheck % 2 != 1)
+   // Take from the longer list, to leave both even and odd ports for as long as possible
+   unsigned short port = mFreeEvenPorts.size() >= mFreeOddPorts.size() ? popFreePort(mFreeEvenPorts) : popFreePort(mFreeOddPorts);
+   if(port == 0)
    {
-      startPortToCheck = advanceLastAllocatedPort(transport);
+      port = popFreePort(mFreeEvenPorts);
+      if(port == 0)
+      {
+         port = popFreePort(mFreeOddPorts);
+      }
    }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated)
+   if(port != 0)
    {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
+      state(port) = PortStateAllocated;
    }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   return portToCheck;
+   return port;
 }
 
 unsigned short 
-TurnManager::allocateEvenPortPair(StunTuple::TransportType transport)
+TurnManager::PortAllocator::allocateEven()
 {
-   PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-   unsigned short startPortToCheck = advanceLastAllocatedPort(transport);
-   // Ensure start port is even and that start port + 1 is in range
-   while(startPortToCheck % 2 != 0 ||
-         startPortToCheck + 1 == 0 ||
-         startPortToCheck + 1 > mConfig.mAllocationPortRangeMax )
+   unsigned short port = popFreePort(mFreeEvenPorts);
+   if(port != 0)
    {
-      startPortToCheck = advanceLastAllocatedPort(transport);
+      state(port) = PortStateAllocated;
    }
-   unsigned short portToCheck = startPortToCheck;
-   while(portAllocationMap[portToCheck] != PortStateUnallocated || portAllocationMap[portToCheck+1] != PortStateUnallocated)
+   return port;
+}
+
+unsigned short 
+TurnManager::PortAllocator::allocateOdd()
+{
+   unsigned short port = popFreePort(mFreeOddPorts);
+   if(port != 0)
    {
-      portToCheck = advanceLastAllocatedPort(transport, 2);
-      if(portToCheck == startPortToCheck) return 0;  // If we checked all available ports and none found - then return 0
+      state(port) = PortStateAllocated;
    }
-   portAllocationMap[portToCheck] = PortStateAllocated;
-   portAllocationMap[portToCheck+1] = PortStateReserved;
-   return portToCheck;
+   return port;
 }
 
-bool 
-TurnManager::allocatePort(StunTuple::TransportType transport, unsigned short port, bool reserved)
+unsigned short 
+TurnManager::PortAllocator::allocateEvenPair()
 {
-   if(port >= mConfig.mAllocationPortRangeMin && port <= mConfig.mAllocationPortRangeMax)
+   // Free even ports whose odd neighbour is in use go back to the end of the
+   // list, so this can look at every free even port once in the worst case
+   size_t candidates = mFreeEvenPorts.size();
+   while(candidates-- > 0)
    {
-      PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-      if(reserved)
+      unsigned short port = popFreePort(mFreeEvenPorts);
+      if(port == 0)
       {
-         if(portAllocationMap[port] == PortStateReserved)
-         {
-            portAllocationMap[port] = PortStateAllocated;
-            return true;
-         }
+         break;
       }
-      else
+      if((unsigned int)port + 1 <= mMax && state(port+1) == PortStateUnallocated)
       {
-         if(portAllocationMap[port] == PortStateUnallocated)  
-         {
-            portAllocationMap[port] = PortStateAllocated;
-            return true;
-         }
+         state(port) = PortStateAllocated;
+         state(port+1) = PortStateReserved;
+         return port;
       }
+      pushFreePort(port);
+   }
+   return 0;
+}
+
+bool 
+TurnManager::PortAllocator::allocate(unsigned short port, bool reserved)
+{
+   if(inRange(port) && state(port) == (reserved ? PortStateReserved : PortStateUnallocated))
+   {
+      // If the port is still on a free list, it is skipped when it is reached
+      state(port) = PortStateAllocated;
+      return true;
    }
    return false;
 }
 
 void 
-TurnManager::deallocatePort(StunTuple::TransportType transport, unsigned short port)
+TurnManager::PortAllocator::deallocate(unsigned short port)
 {
-   if(port >= mConfig.mAllocationPortRangeMin && port <= mConfig.mAllocationPortRangeMax)
+   if(inRange(port))
    {
-      PortAllocationMap& portAllocationMap = getPortAllocationMap(transport);
-      portAllocationMap[port] = PortStateUnallocated;
+      state(port) = PortStateUnallocated;
+      pushFreePort(port);
 
       // If port is even - check if next higher port is reserved - if so unallocate it
-      if(port % 2 == 0 && portAllocationMap[port+1] == PortStateReserved)
+      if(port % 2 == 0 && inRange(port+1) && state(port+1) == PortStateReserved)
       {
-         portAllocationMap[port+1] = PortStateUnallocated;
+         state(port+1) = PortStateUnallocated;
+         pushFreePort(port+1);
       }
    }
 }
 
-TurnManager::PortAllocationMap& 
-TurnManager::getPortAllocationMap(StunTuple::TransportType transport)
+unsigned short 
+TurnManager::PortAllocator::popFreePort(std::deque<unsigned short>& freePorts)
 {
-   switch(transport)
+   while(!freePorts.empty())
    {
-   case StunTuple::TCP:
-   case StunTuple::TLS:
-      return mTcpAllocationPorts;
-   case StunTuple::UDP:
-   default:
-      return mUdpAllocationPorts;
+      unsigned short port = freePorts.front();
+      freePorts.pop_front();
+      mQueued[port - mMin] = false;
+      if(state(port) == PortStateUnallocated)
+      {
+         return port;
+      }
+      // else allocated by number since it was freed
    }
+   return 0;
 }
 
-unsigned short 
-TurnManager::advanceLastAllocatedPort(StunTuple::TransportType transport, unsigned int numToAdvance)
+void 
+TurnManager::PortAllocator::pushFreePort(unsigned short port)
 {
-   switch(transport)
+   if(!mQueued[port - mMin])
    {
-   case StunTuple::TCP:
-   case StunTuple::TLS:
-      mLastAllocatedTcpPort+=numToAdvance;
-      if(mLastAllocatedTcpPort > mConfig.mAllocationPortRangeMax) 
-      {
-         mLastAllocatedTcpPort = mConfig.mAllocationPortRangeMin+(mLastAllocatedTcpPort-mConfig.mAllocationPortRangeMax-1);
-      }
-      else if(mLastAllocatedTcpPort == 0 /* Wrap around */)
-      {
-         mLastAllocatedTcpPort = mConfig.mAllocationPortRangeMin;
-      }
-      return mLastAllocatedTcpPort;
-   case StunTuple::UDP:
-   default:
-      mLastAllocatedUdpPort+=numToAdvance;
-      if(mLastAllocatedUdpPort > mConfig.mAllocationPortRangeMax) 
-      {
-         mLastAllocatedUdpPort = mConfig.mAllocationPortRangeMin+(mLastAllocatedUdpPort-mConfig.mAllocationPortRangeMax-1);
-      }
-      else if(mLastAllocatedUdpPort == 0 /* Wrap around */)
-      {
-         mLastAllocatedUdpPort = mConfig.mAllocationPortRangeMin;
-      }
-      return mLastAllocatedUdpPort;
+      mQueued[port - mMin] = true;
+      (port % 2 == 0 ? mFreeEvenPorts : mFreeOddPorts).push_back(port);
    }
 }
 
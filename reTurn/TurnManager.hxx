@@ -1,24 +1,26 @@
 #ifndef TURNMANAGER_HXX
 #define TURNMANAGER_HXX
 
-#include <map>
+#include <deque>
+#include <vector>
 #include <asio.hpp>
 #ifdef USE_SSL
 #include <asio/ssl.hpp>
 #endif
+#include <rutil/Mutex.hxx>
 #include "ReTurnConfig.hxx"
 #include "StunTuple.hxx"
 
 namespace reTurn {
 
+/// Hands out the relay ports.  The port allocation API's are thread safe, as
+/// allocations are made from all of the io_service threads.
 class TurnManager
 {
 public:
-   explicit TurnManager(asio::io_service& ioService, const ReTurnConfig& config);  // ioService used to start timers
+   explicit TurnManager(const ReTurnConfig& config);
    ~TurnManager();
 
-   asio::io_service& getIOService() { return mIOService; }
-
    unsigned short allocateAnyPort(StunTuple::TransportType transport);
    unsigned short allocateEvenPort(StunTuple::TransportType transport);
    unsigned short allocateOddPort(StunTuple::TransportType transport);
@@ -36,15 +38,45 @@ private:
       PortStateAllocated,
       PortStateReserved
    } PortState;
-   typedef std::map<unsigned short, PortState> PortAllocationMap;
-   PortAllocationMap mUdpAllocationPorts;  // .slg. expand to be a map/hash table per ip address/interface
-   PortAllocationMap mTcpAllocationPorts;
-   unsigned short mLastAllocatedUdpPort;
-   unsigned short mLastAllocatedTcpPort;
-   PortAllocationMap& getPortAllocationMap(StunTuple::TransportType transport);
-   unsigned short advanceLastAllocatedPort(StunTuple::TransportType transport, unsigned int numToAdvance = 1);
-
-   asio::io_service& mIOService;
+
+   // The relay ports of one transport.  The state of each port in the range
+   // is indexed by port number, and the free ports are kept in FIFO lists,
+   // one for the even and one for the odd ports, so allocating doesn't scan
+   // the range and a freed port is the last one to be handed out again.
+   class PortAllocator
+   {
+   public:
+      PortAllocator(unsigned short min, unsigned short max);
+
+      unsigned short allocateAny();
+      unsigned short allocateEven();
+      unsigned short allocateOdd();
+      unsigned short allocateEvenPair();
+      bool allocate(unsigned short port, bool reserved);
+      void deallocate(unsigned short port);
+
+   private:
+      bool inRange(unsigned int port) const { return port >= mMin && port <= mMax && !mPortStates.empty(); }
+      unsigned char& state(unsigned short port) { return mPortStates[port - mMin]; }
+      unsigned short popFreePort(std::deque<unsigned short>& freePorts);
+      void pushFreePort(unsigned short port);
+
+      unsigned short mMin;
+      unsigned short mMax;
+      std::vector<unsigned char> mPortStates;
+      // set while a port is on a free list; ports allocated by number stay
+      // on the list and are dropped when they reach the front
+      std::vector<bool> mQueued;
+      std::deque<unsigned short> mFreeEvenPorts;
+      std::deque<unsigned short> mFreeOddPorts;
+   };
+   PortAllocator mUdpAllocationPorts;  // .slg. expand to be a map/hash table per ip address/interface
+   PortAllocator mTcpAllocationPorts;
+   PortAllocator& getPortAllocator(StunTuple::TransportType transport);
+
+   // protects the port allocators
+   resip::Mutex mMutex;
+
    const ReTurnConfig& mConfig;
 };
 
@@ -19,6 +19,9 @@ UdpRelayServer::UdpRelayServer(asio::io_service& ioService, TurnAllocation& turn
   mStopping(false),
   mBindSuccess(false)
 {
+   setBatching(true);
+   // there is one of these per allocation, and most relay little traffic
+   setReceiveBufferPoolSize(4);
    asio::error_code ec = bind(turnAllocation.getRequestedTuple().getAddress(), turnAllocation.getRequestedTuple().getPort());
    if(ec)
    {
@@ -19,13 +19,15 @@ using namespace boost::chrono;
 
 namespace reTurn {
 
-UdpServer::UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port)
+UdpServer::UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort)
 : AsyncUdpSocketBase(ioService),
   mRequestHandler(requestHandler),
   mAlternatePortUdpServer(0),
   mAlternateIpUdpServer(0),
   mAlternateIpPortUdpServer(0)
 {
+   setReusePort(reusePort);
+   setBatching(true);
    asio::error_code ec = bind(address, port);
    if(ec)
    {
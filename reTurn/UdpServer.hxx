@@ -17,8 +17,10 @@ class UdpServer
   : public AsyncUdpSocketBase
 {
 public:
-   /// Create the server to listen on the specified UDP address and port
-   explicit UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port);
+   /// Create the server to listen on the specified UDP address and port.  With
+   /// reusePort, other UdpServers (on other io_services) may listen on the same
+   /// address and port, and share the clients.
+   explicit UdpServer(asio::io_service& ioService, RequestHandler& requestHandler, const asio::ip::address& address, unsigned short port, bool reusePort = false);
    UdpServer(const UdpServer&) = delete;
    UdpServer(UdpServer&&) = delete;
    ~UdpServer();
@@ -15,9 +15,9 @@ public:
    static UserAuthData createFromPassword(const resip::Data& userName, const resip::Data& realm, const resip::Data& password);
    static UserAuthData createFromHex(const resip::Data& userName, const resip::Data& realm, const resip::Data& ha1Hex);
 
-   resip::Data getUserName() { return mUserName; };
-   resip::Data getRealm() { return mRealm; };
-   resip::Data getHa1() { return mHa1; };
+   resip::Data getUserName() const { return mUserName; };
+   resip::Data getRealm() const { return mRealm; };
+   resip::Data getHa1() const { return mHa1; };
 
 private:
    resip::Data mUserName;
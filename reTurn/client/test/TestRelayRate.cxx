@@ -0,0 +1,253 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#ifdef WIN32
+#pragma warning(disable : 4267)
+#endif
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <asio.hpp>
+#ifdef USE_SSL
+#include <asio/ssl.hpp>
+#endif
+#include <rutil/ThreadIf.hxx>
+#include <rutil/Logger.hxx>
+#include <rutil/Time.hxx>
+
+#include "../../StunTuple.hxx"
+#include "../../StunMessage.hxx"
+#include "../TurnUdpSocket.hxx"
+
+// Measures how many ChannelData packets per second a TURN server relays
+// over UDP, in each direction, between a TurnUdpSocket client and a peer
+// socket on the loopback interface.  Both sides send as fast as they can,
+// so what arrives at the other end is what the server kept up with.
+
+using namespace reTurn;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::TEST
+
+typedef std::chrono::steady_clock Clock;
+
+static double
+elapsedSeconds(const Clock::time_point& start, const Clock::time_point& end)
+{
+   return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000000.0;
+}
+
+static void
+report(const char* direction, unsigned int sent, unsigned int received, double seconds)
+{
+   std::cout << direction << ": sent " << sent << ", received " << received
+             << " (" << (sent ? 100.0 * (sent - received) / sent : 0.0) << "% lost) in " << seconds << "s = "
+             << (seconds > 0 ? (unsigned int)(received / seconds) : 0) << " packets/s" << std::endl;
+}
+
+// Counts the packets relayed to it until it gets a one byte packet
+class RelayPeer : public resip::ThreadIf
+{
+public:
+   RelayPeer(asio::io_service& ioService) :
+      mSocket(ioService, asio::ip::udp::endpoint(asio::ip::address::from_string("127.0.0.1"), 0)),
+      mReceived(0) {}
+
+   virtual ~RelayPeer() {}
+
+   asio::ip::udp::socket& socket() { return mSocket; }
+   unsigned int received() const { return mReceived; }
+   const Clock::time_point& lastReceived() const { return mLastReceived; }
+
+   virtual void thread()
+   {
+      char buffer[RECEIVE_BUFFER];
+      asio::ip::udp::endpoint sender;
+      asio::error_code rc;
+      while(!isShutdown())
+      {
+         size_t size = mSocket.receive_from(asio::buffer(buffer), sender, 0, rc);
+         if(rc)
+         {
+            ErrLog(<< "PEER: Receive error: " << rc.message());
+            break;
+         }
+         if(size == 1)
+         {
+            break;
+         }
+         mReceived++;
+         mLastReceived = Clock::now();
+      }
+   }
+
+private:
+   enum { RECEIVE_BUFFER = 2048 };
+   asio::ip::udp::socket mSocket;
+   unsigned int mReceived;
+   Clock::time_point mLastReceived;
+};
+
+// Sends packets from the peer's socket to the relay
+class PeerSender : public resip::ThreadIf
+{
+public:
+   PeerSender(asio::ip::udp::socket& socket, const asio::ip::udp::endpoint& destination, const std::string& payload, unsigned int count) :
+      mSocket(socket),
+      mDestination(destination),
+      mPayload(payload),
+      mCount(count) {}
+
+   virtual ~PeerSender() {}
+
+   virtual void thread()
+   {
+      asio::error_code rc;
+      for(unsigned int i = 0; i < mCount; i++)
+      {
+         mSocket.send_to(asio::buffer(mPayload), mDestination, 0, rc);
+      }
+   }
+
+private:
+   asio::ip::udp::socket& mSocket;
+   asio::ip::udp::endpoint mDestination;
+   const std::string& mPayload;
+   unsigned int mCount;
+};
+
+int main(int argc, char* argv[])
+{
+   resip::Log::initialize("cout", "WARNING", "TestRelayRate");
+
+   try
+   {
+      if (argc < 3)
+      {
+         std::cerr << "Usage: TestRelayRate <turn host> <turn port> [<packets>] [<payload size>]\n";
+         return 1;
+      }
+      unsigned int port = resip::Data(argv[2]).convertUnsignedLong();
+      unsigned int packets = argc > 3 ? resip::Data(argv[3]).convertUnsignedLong() : 100000;
+      unsigned int payloadSize = argc > 4 ? resip::Data(argv[4]).convertUnsignedLong() : 172;  // a 20ms G.711 RTP packet
+      if(payloadSize < 2 || payloadSize > 1024)
+      {
+         std::cerr << "Payload size must be between 2 and 1024 bytes\n";
+         return 1;
+      }
+      std::string payload(payloadSize, 'x');
+
+      asio::error_code rc;
+      asio::io_service ioService;
+      RelayPeer peer(ioService);
+      asio::ip::udp::endpoint peerEndpoint = peer.socket().local_endpoint();
+
+      TurnUdpSocket turnSocket(asio::ip::address::from_string("127.0.0.1"), 0);
+      rc = turnSocket.connect(argv[1], port);
+      if(rc)
+      {
+         std::cerr << "Error calling connect: rc=" << rc.message() << std::endl;
+         return 1;
+      }
+      turnSocket.setUsernameAndPassword("test", "1234");
+
+      rc = turnSocket.createAllocation(60,
+                                       TurnSocket::UnspecifiedBandwidth,
+                                       StunMessage::PropsNone,
+                                       TurnSocket::UnspecifiedToken,
+                                       StunTuple::UDP);
+      if(rc)
+      {
+         std::cerr << "Error creating allocation: rc=" << rc.message() << std::endl;
+         return 1;
+      }
+
+      // Binds a channel to the peer, so that everything after is ChannelData
+      rc = turnSocket.setActiveDestination(peerEndpoint.address(), peerEndpoint.port());
+      if(rc)
+      {
+         std::cerr << "Error binding channel: rc=" << rc.message() << std::endl;
+         return 1;
+      }
+      std::cout << "Relay=" << turnSocket.getRelayTuple() << " Peer=" << peerEndpoint << " payload=" << payloadSize << " bytes" << std::endl;
+
+      // Client to peer
+      peer.run();
+      Clock::time_point start = Clock::now();
+      for(unsigned int i = 0; i < packets; i++)
+      {
+         turnSocket.send(payload.data(), payloadSize);
+      }
+      // let the relay drain, then stop the peer directly
+      resip::sleepMs(500);
+      asio::ip::udp::socket control(ioService, asio::ip::udp::endpoint(asio::ip::udp::v4(), 0));
+      control.send_to(asio::buffer("", 1), peerEndpoint, 0, rc);
+      peer.join();
+      report("client->peer", packets, peer.received(), peer.received() ? elapsedSeconds(start, peer.lastReceived()) : 0);
+
+      // Peer to client
+      asio::ip::udp::endpoint relayEndpoint(turnSocket.getRelayTuple().getAddress(), turnSocket.getRelayTuple().getPort());
+      char buffer[2048];
+      unsigned int received = 0;
+      Clock::time_point lastReceived;
+      PeerSender sender(peer.socket(), relayEndpoint, payload, packets);
+      start = Clock::now();
+      sender.run();
+      while(true)
+      {
+         unsigned int size = sizeof(buffer);
+         if(turnSocket.receive(buffer, size, 500))
+         {
+            break;
+         }
+         received++;
+         lastReceived = Clock::now();
+      }
+      sender.join();
+      report("peer->client", packets, received, received ? elapsedSeconds(start, lastReceived) : 0);
+   }
+   catch (std::exception& e)
+   {
+      std::cerr << "Exception: " << e.what() << "\n";
+      return 1;
+   }
+
+   return 0;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are 
+ met:
+
+ 1. Redistributions of source code must retain the above copyright 
+    notice, this list of conditions and the following disclaimer. 
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution. 
+
+ 3. Neither the name of Plantronics nor the names of its contributors 
+    may be used to endorse or promote products derived from this 
+    software without specific prior written permission. 
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR 
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, 
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
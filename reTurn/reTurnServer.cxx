@@ -5,6 +5,7 @@
 #include <iostream>
 #include <csignal>
 #include <string>
+#include <vector>
 #include <asio.hpp>
 #ifdef USE_SSL
 #include <asio/ssl.hpp>
@@ -14,6 +15,7 @@
 #include "TcpServer.hxx"
 #include "TlsServer.hxx"
 #include "UdpServer.hxx"
+#include "IOServicePool.hxx"
 #include "ReTurnConfig.hxx"
 #include "RequestHandler.hxx"
 #include "TurnManager.hxx"
@@ -94,10 +96,12 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
       resip::Log::setMaxLineCount(reTurnConfig.mLoggingFileMaxLineCount);
 
       // Initialize server.
-      asio::io_service ioService;                                // The one and only ioService for the stunServer
-      reTurn::TurnManager turnManager(ioService, reTurnConfig);  // The one and only Turn Manager
+      reTurn::TurnManager turnManager(reTurnConfig);  // The one and only Turn Manager - must outlive the io_services, which may still hold allocations
+      reTurn::IOServicePool ioServicePool(reTurnConfig.mIOServiceThreads);
+      asio::io_service& ioService = ioServicePool.getIOService(0);  // Runs the listeners, and the user file scanner
 
-      std::shared_ptr<reTurn::UdpServer> udpTurnServer;  // also a1p1StunUdpServer
+      std::vector<std::shared_ptr<reTurn::UdpServer> > udpTurnServers;  // One per io_service when the sockets can share the port
+      std::shared_ptr<reTurn::UdpServer> udpTurnServer;  // The first of udpTurnServers - also a1p1StunUdpServer
       std::shared_ptr<reTurn::TcpServer> tcpTurnServer;
 #ifdef USE_SSL
       std::shared_ptr<reTurn::TlsServer> tlsTurnServer;
@@ -107,7 +111,7 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
       std::shared_ptr<reTurn::UdpServer> a2p2StunUdpServer;
 
 #ifdef USE_IPV6
-      std::shared_ptr<reTurn::UdpServer> udpV6TurnServer;
+      std::vector<std::shared_ptr<reTurn::UdpServer> > udpV6TurnServers;
       std::shared_ptr<reTurn::TcpServer> tcpV6TurnServer;
       std::shared_ptr<reTurn::TlsServer> tlsV6TurnServer;
 #endif
@@ -119,21 +123,37 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
          reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunAddress : 0, 
          reTurnConfig.mAltStunPort != 0 ? &reTurnConfig.mAltStunPort : 0); 
 
-      udpTurnServer = std::make_shared<reTurn::UdpServer>(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort);
-      tcpTurnServer = std::make_shared<reTurn::TcpServer>(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort);
+      // Each UDP TURN server handles its clients, and their allocations, on its own io_service.  Several
+      // can only share the TURN port where the kernel spreads the clients across the sockets.  The RFC3489
+      // servers below are paired with a single UDP TURN server, so then all UDP clients stay on the first
+      // io_service.  TCP and TLS connections are spread across the io_services as they are accepted.
+      size_t numUdpTurnServers = 1;
+      if(reTurnConfig.mAltStunPort == 0 && reTurn::UdpServer::isReusePortSupported())
+      {
+         numUdpTurnServers = ioServicePool.size();
+      }
+      for(size_t i = 0; i < numUdpTurnServers; i++)
+      {
+         udpTurnServers.push_back(std::make_shared<reTurn::UdpServer>(ioServicePool.getIOService(i), requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort, numUdpTurnServers > 1));
+      }
+      udpTurnServer = udpTurnServers.front();
+      tcpTurnServer = std::make_shared<reTurn::TcpServer>(ioServicePool, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTurnPort);
 #ifdef USE_SSL
       if(reTurnConfig.mTlsTurnPort != 0)
       {
-         tlsTurnServer = std::make_shared<reTurn::TlsServer>(ioService, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTlsTurnPort);
+         tlsTurnServer = std::make_shared<reTurn::TlsServer>(ioServicePool, requestHandler, reTurnConfig.mTurnAddress, reTurnConfig.mTlsTurnPort);
       }
 #endif
 
 #ifdef USE_IPV6
-      udpV6TurnServer = std::make_shared<reTurn::UdpServer>(ioService, requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTurnPort);
-      tcpV6TurnServer = std::make_shared<reTurn::TcpServer>(ioService, requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTurnPort);
+      for(size_t i = 0; i < numUdpTurnServers; i++)
+      {
+         udpV6TurnServers.push_back(std::make_shared<reTurn::UdpServer>(ioServicePool.getIOService(i), requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTurnPort, numUdpTurnServers > 1));
+      }
+      tcpV6TurnServer = std::make_shared<reTurn::TcpServer>(ioServicePool, requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTurnPort);
       if(reTurnConfig.mTlsTurnPort != 0)
       {
-         tlsV6TurnServer = std::make_shared<reTurn::TlsServer>(ioService, requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTlsTurnPort);
+         tlsV6TurnServer = std::make_shared<reTurn::TlsServer>(ioServicePool, requestHandler, reTurnConfig.mTurnV6Address, reTurnConfig.mTlsTurnPort);
       }
 #endif
 
@@ -151,7 +171,10 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
          a2p2StunUdpServer->start();
       }
 
-      udpTurnServer->start();
+      for(size_t i = 0; i < udpTurnServers.size(); i++)
+      {
+         udpTurnServers[i]->start();
+      }
       tcpTurnServer->start();
 #ifdef USE_SSL
       if(tlsTurnServer)
@@ -161,7 +184,10 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
 #endif
 
 #ifdef USE_IPV6
-      udpV6TurnServer->start();
+      for(size_t i = 0; i < udpV6TurnServers.size(); i++)
+      {
+         udpV6TurnServers[i]->start();
+      }
       tcpV6TurnServer->start();
 #ifdef USE_SSL
       if(tlsV6TurnServer)
@@ -183,19 +209,19 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
 
 #ifdef _WIN32
       // Set console control handler to allow server to be stopped.
-      console_ctrl_function = [&ioService] { ioService.stop(); };
+      console_ctrl_function = [&ioServicePool] { ioServicePool.stop(); };
       SetConsoleCtrlHandler(console_ctrl_handler, TRUE);
 #else
-      // Block all signals for background thread.
+      // Block all signals for background threads.
       sigset_t new_mask;
       sigfillset(&new_mask);
       sigset_t old_mask;
       pthread_sigmask(SIG_BLOCK, &new_mask, &old_mask);
 #endif
 
-      // Run the ioService until stopped.
+      // Run the io_services until stopped.
       // Create a pool of threads to run all of the io_services.
-      asio::thread thread([&ioService] { ioService.run(); });
+      ioServicePool.run();
 
 #ifndef _WIN32
       // Restore previous signals.
@@ -210,11 +236,11 @@ reTurn::ReTurnServerProcess::main(int argc, char* argv[])
       pthread_sigmask(SIG_BLOCK, &wait_mask, 0);
       int sig = 0;
       sigwait(&wait_mask, &sig);
-      ioService.stop();
+      ioServicePool.stop();
 #endif
 
-      // Wait for thread to exit
-      thread.join();
+      // Wait for threads to exit
+      ioServicePool.join();
    }
    catch (const std::exception& e)
    {
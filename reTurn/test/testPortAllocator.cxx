@@ -0,0 +1,184 @@
+// Exercises the relay port allocation of TurnManager
+
+#include <cassert>
+#include <set>
+
+#include "../ReTurnConfig.hxx"
+#include "../TurnManager.hxx"
+#include <rutil/Logger.hxx>
+
+using namespace reTurn;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM resip::Subsystem::TEST
+
+static const StunTuple::TransportType udp = StunTuple::UDP;
+
+static void
+setRange(ReTurnConfig& config, unsigned short min, unsigned short max)
+{
+   config.mAllocationPortRangeMin = min;
+   config.mAllocationPortRangeMax = max;
+}
+
+// A port allocated by number stays on its free list, and is skipped when
+// it reaches the front
+static void
+testAllocatedWhileQueued()
+{
+   ReTurnConfig config;
+   setRange(config, 50000, 50003);
+   TurnManager manager(config);
+
+   assert(manager.allocatePort(udp, 50000));
+   assert(!manager.allocatePort(udp, 50000));
+   assert(manager.allocateEvenPort(udp) == 50002);
+   assert(manager.allocateEvenPort(udp) == 0);
+
+   // freed again while still queued: queued once only
+   manager.deallocatePort(udp, 50002);
+   assert(manager.allocatePort(udp, 50002));
+   manager.deallocatePort(udp, 50002);
+   assert(manager.allocateEvenPort(udp) == 50002);
+   assert(manager.allocateEvenPort(udp) == 0);
+
+   manager.deallocatePort(udp, 50000);
+   assert(manager.allocateEvenPort(udp) == 50000);
+   assert(manager.allocateEvenPort(udp) == 0);
+}
+
+// No even port has a free neighbour; the search gives up without losing any
+// of the free even ports
+static void
+testEvenPairNoNeighbour()
+{
+   ReTurnConfig config;
+   setRange(config, 50000, 50007);
+   TurnManager manager(config);
+
+   for (unsigned short port = 50001; port <= 50007; port += 2)
+   {
+      assert(manager.allocatePort(udp, port));
+   }
+   assert(manager.allocateEvenPortPair(udp) == 0);
+   assert(manager.allocateOddPort(udp) == 0);
+
+   manager.deallocatePort(udp, 50005);
+   assert(manager.allocateEvenPortPair(udp) == 50004);
+   assert(!manager.allocatePort(udp, 50005));
+   assert(manager.allocateEvenPortPair(udp) == 0);
+
+   set<unsigned short> even;
+   for (int i = 0; i < 3; ++i)
+   {
+      even.insert(manager.allocateEvenPort(udp));
+   }
+   assert(even.size() == 3 && !even.count(0) && !even.count(50004));
+   assert(manager.allocateEvenPort(udp) == 0);
+}
+
+// The reserved odd port of a pair can be released on its own
+static void
+testDeallocateReservedOdd()
+{
+   ReTurnConfig config;
+   setRange(config, 50000, 50003);
+   TurnManager manager(config);
+
+   unsigned short port = manager.allocateEvenPortPair(udp);
+   assert(port == 50000);
+   manager.deallocatePort(udp, port + 1);
+   assert(!manager.allocatePort(udp, port + 1, true));
+   assert(manager.allocatePort(udp, port + 1));
+
+   // releasing the even port leaves the odd one, no longer reserved, alone
+   manager.deallocatePort(udp, port);
+   assert(!manager.allocatePort(udp, port + 1));
+   manager.deallocatePort(udp, port + 1);
+
+   // both are free and queued once each
+   set<unsigned short> ports;
+   for (int i = 0; i < 4; ++i)
+   {
+      ports.insert(manager.allocateAnyPort(udp));
+   }
+   assert(ports.size() == 4 && !ports.count(0));
+   assert(manager.allocateAnyPort(udp) == 0);
+}
+
+// The top of the port range
+static void
+testMaxPort()
+{
+   ReTurnConfig config;
+   setRange(config, 65532, 65535);
+   TurnManager manager(config);
+
+   assert(manager.allocateEvenPortPair(udp) == 65532);
+   assert(manager.allocateEvenPortPair(udp) == 65534);
+   assert(manager.allocateEvenPortPair(udp) == 0);
+
+   // releasing the pair at the top frees 65535 with it
+   manager.deallocatePort(udp, 65534);
+   assert(!manager.allocatePort(udp, 65535, true));
+   assert(manager.allocatePort(udp, 65535));
+   assert(manager.allocatePort(udp, 65534));
+   assert(manager.allocateAnyPort(udp) == 0);
+
+   ReTurnConfig single;
+   setRange(single, 65535, 65535);
+   TurnManager top(single);
+   assert(top.allocateEvenPortPair(udp) == 0);
+   assert(top.allocateAnyPort(udp) == 65535);
+   assert(top.allocateAnyPort(udp) == 0);
+   top.deallocatePort(udp, 65535);
+   assert(top.allocateOddPort(udp) == 65535);
+}
+
+int main(int argc, char* argv[])
+{
+   resip::Log::initialize(resip::Log::Cout, resip::Log::Info, "");
+
+   testAllocatedWhileQueued();
+   testEvenPairNoNeighbour();
+   testDeallocateReservedOdd();
+   testMaxPort();
+
+   InfoLog(<< "All tests passed!");
+   return 0;
+}
+
+
+/* ====================================================================
+
+ Copyright (c) 2007-2008, Plantronics, Inc.
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are
+ met:
+
+ 1. Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+ 2. Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+ 3. Neither the name of Plantronics nor the names of its contributors
+    may be used to endorse or promote products derived from this
+    software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ ==================================================================== */
@@ -12,6 +12,7 @@
 #endif
 #include <boost/function.hpp>
 #include <map>
+#include <thread>
 
 #include <rutil/Log.hxx>
 #include <rutil/Logger.hxx>
@@ -57,18 +58,37 @@ private:
 };
 }
 
-FlowManager::FlowManager()
+FlowManager::FlowManager() : FlowManager(1)
+{
+}
+
+FlowManager::FlowManager(unsigned int ioServiceThreads) :
+   mNextIOService(0)
 #ifdef USE_SSL
-   : 
+   ,
    mSslContext(asio::ssl::context::sslv23),
    mClientCert(0),
-   mClientKey(0),
-   mDtlsFactory(0)
+   mClientKey(0)
 #endif  
 {
-   mIOServiceWork = new asio::io_service::work(mIOService);
-   mIOServiceThread = new IOServiceThread(mIOService);
-   mIOServiceThread->run();
+   if(ioServiceThreads == 0)
+   {
+      ioServiceThreads = std::thread::hardware_concurrency();
+      if(ioServiceThreads == 0)
+      {
+         ioServiceThreads = 1;
+      }
+   }
+   InfoLog(<< "Starting " << ioServiceThreads << " io_service thread(s)");
+   for(unsigned int i = 0; i < ioServiceThreads; i++)
+   {
+      std::shared_ptr<asio::io_service> ioService = std::make_shared<asio::io_service>(1 /* concurrency hint:  one thread per io_service */);
+      mIOServices.push_back(ioService);
+      mIOServiceWork.push_back(new asio::io_service::work(*ioService));
+      IOServiceThread* ioServiceThread = new IOServiceThread(*ioService);
+      mIOServiceThreads.push_back(ioServiceThread);
+      ioServiceThread->run();
+   }
 
 #ifdef USE_SSL
    // Setup SSL context
@@ -96,12 +116,21 @@ FlowManager::FlowManager()
 
 FlowManager::~FlowManager()
 {
-   delete mIOServiceWork;
-   mIOServiceThread->join();
-   delete mIOServiceThread;
+   for(size_t i = 0; i < mIOServiceWork.size(); i++)
+   {
+      delete mIOServiceWork[i];
+   }
+   for(size_t i = 0; i < mIOServiceThreads.size(); i++)
+   {
+      mIOServiceThreads[i]->join();
+      delete mIOServiceThreads[i];
+   }
  
  #ifdef USE_SSL
-   if(mDtlsFactory) delete mDtlsFactory;
+   for(size_t i = 0; i < mDtlsFactories.size(); i++)
+   {
+      delete mDtlsFactories[i];
+   }
    if(mClientCert) X509_free(mClientCert);
    if(mClientKey) EVP_PKEY_free(mClientKey);
  #endif 
@@ -111,7 +140,7 @@ FlowManager::~FlowManager()
 void 
 FlowManager::initializeDtlsFactory(const char* certAor)
 {
-   if(mDtlsFactory)
+   if(!mDtlsFactories.empty())
    {
       ErrLog(<< "initializeDtlsFactory called when DtlsFactory is already initialized.");    
       return;
@@ -120,9 +149,14 @@ FlowManager::initializeDtlsFactory(const char* certAor)
    Data aor(certAor);  
    if(createCert(aor, 365 /* expireDays */, 1024 /* keyLen */, mClientCert, mClientKey))
    {
-      FlowDtlsTimerContext* timerContext = new FlowDtlsTimerContext(mIOService);
-      mDtlsFactory = new DtlsFactory(std::unique_ptr<DtlsTimerContext>(timerContext), mClientCert, mClientKey);
-      resip_assert(mDtlsFactory);
+      // One per io_service, so that the DTLS timers fire on the thread of the Flows using them
+      for(size_t i = 0; i < mIOServices.size(); i++)
+      {
+         FlowDtlsTimerContext* timerContext = new FlowDtlsTimerContext(*mIOServices[i]);
+         DtlsFactory* dtlsFactory = new DtlsFactory(std::unique_ptr<DtlsTimerContext>(timerContext), mClientCert, mClientKey);
+         resip_assert(dtlsFactory);
+         mDtlsFactories.push_back(dtlsFactory);
+      }
    }
    else
    {
@@ -165,10 +199,15 @@ FlowManager::createMediaStream(MediaStreamHandler& mediaStreamHandler,
                                std::shared_ptr<FlowContext> context)
 {
    MediaStream* newMediaStream = 0;
+   size_t index = mNextIOService++ % mIOServices.size();
+   asio::io_service& ioService = *mIOServices[index];
+#ifdef USE_SSL
+   DtlsFactory* dtlsFactory = mDtlsFactories.empty() ? 0 : mDtlsFactories[index];
+#endif
    if(rtcpEnabled)
    {
       StunTuple localRtcpBinding(localBinding.getTransportType(), localBinding.getAddress(), localBinding.getPort() + 1);
-      newMediaStream = new MediaStream(mIOService,
+      newMediaStream = new MediaStream(ioService,
 #ifdef USE_SSL
                                        mSslContext,
 #endif
@@ -176,7 +215,7 @@ FlowManager::createMediaStream(MediaStreamHandler& mediaStreamHandler,
                                        localBinding,
                                        localRtcpBinding,
 #ifdef USE_SSL
-                                       mDtlsFactory,
+                                       dtlsFactory,
 #endif 
                                        natTraversalMode,
                                        natTraversalServerHostname, 
@@ -190,7 +229,7 @@ FlowManager::createMediaStream(MediaStreamHandler& mediaStreamHandler,
    else
    {
       StunTuple rtcpDisabled;  // Default constructor sets transport type to None - this signals Rtcp is disabled
-      newMediaStream = new MediaStream(mIOService,
+      newMediaStream = new MediaStream(ioService,
 #ifdef USE_SSL
                                        mSslContext, 
 #endif
@@ -198,7 +237,7 @@ FlowManager::createMediaStream(MediaStreamHandler& mediaStreamHandler,
                                        localBinding, 
                                        rtcpDisabled, 
 #ifdef USE_SSL
-                                       mDtlsFactory,
+                                       dtlsFactory,
 #endif 
                                        natTraversalMode, 
                                        natTraversalServerHostname, 
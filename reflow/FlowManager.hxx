@@ -14,9 +14,11 @@
 #include <openssl/crypto.h>
 #include <openssl/ssl.h>
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 using namespace reTurn;
 
@@ -27,9 +29,13 @@ namespace flowmanager
   This class represents the Flow Manager.  It is responsible for sending/receiving
   media and performing the necessary NAT traversal.  
   
-  Threading Notes:  This class implements a thread
-  to manage the asyncrouns reTurn client library calls.  Essentially all
-  asyncrounous operations for all Flows will be called from this one thread.
+  Threading Notes:  This class implements one or more threads, each running
+  an io_service of its own, to manage the asyncrouns reTurn client library
+  calls.  Each MediaStream is given to the next io_service in turn, and all
+  asyncrounous operations for its Flows (including ICE, DTLS and SRTP
+  processing) will be called from that one thread.  With more than one
+  thread, MediaStreamHandler and RTCPEventLoggingHandler callbacks for
+  different MediaStreams may run at the same time.
 
   Author: Scott Godin (sgodin AT SipSpectrum DOT com)
 */
@@ -39,8 +45,12 @@ class FlowManager
 {
 public:  
    FlowManager();  // throws FlowManagerException
+   // ioServiceThreads of 0 means one thread per CPU core
+   explicit FlowManager(unsigned int ioServiceThreads);  // throws FlowManagerException
    virtual ~FlowManager();
 
+   size_t getNumIOServiceThreads() const { return mIOServices.size(); }
+
    // This API assumes that RTCP localBinding is always the same as RTP binding but add one to the port number
    // We can add a new API in the future to accomodate, custom RTCP bindings as required
    MediaStream* createMediaStream(MediaStreamHandler& mediaStreamHandler,
@@ -55,7 +65,8 @@ public:
                                   std::shared_ptr<FlowContext> context = nullptr);
 
    void initializeDtlsFactory(const char* certAor);
-   dtls::DtlsFactory* getDtlsFactory() { return mDtlsFactory; }
+   // Note:  there is a DtlsFactory per io_service, all with the same certificate
+   dtls::DtlsFactory* getDtlsFactory() { return mDtlsFactories.empty() ? 0 : mDtlsFactories.front(); }
 
    void setRTCPEventLoggingHandler(std::shared_ptr<RTCPEventLoggingHandler> handler) { mRtcpEventLoggingHandler = std::move(handler); }
    RTCPEventLoggingHandler* getRTCPEventLoggingHandler() { return 0 != mRtcpEventLoggingHandler.get() ? mRtcpEventLoggingHandler.get() : 0; }
@@ -67,16 +78,20 @@ private:
 
    std::shared_ptr<RTCPEventLoggingHandler> mRtcpEventLoggingHandler;
 
-   // Member variables used to manager asio io service thread
-   asio::io_service mIOService;
-   IOServiceThread* mIOServiceThread;
-   asio::io_service::work* mIOServiceWork;
+   // Member variables used to manager asio io service threads
+   std::vector<std::shared_ptr<asio::io_service> > mIOServices;
+   std::vector<IOServiceThread*> mIOServiceThreads;
+   std::vector<asio::io_service::work*> mIOServiceWork;
+   std::atomic<size_t> mNextIOService;  // the io_service for the next MediaStream
+
    static int createCert (const resip::Data& pAor, int expireDays, int keyLen, X509*& outCert, EVP_PKEY*& outKey );
    asio::ssl::context mSslContext;
    
    X509* mClientCert;
    EVP_PKEY* mClientKey;
-   dtls::DtlsFactory* mDtlsFactory;
+   // Indexed like mIOServices.  A DtlsFactory isn't thread safe, and its timers
+   // must fire on the thread doing the DTLS processing.
+   std::vector<dtls::DtlsFactory*> mDtlsFactories;
 };
 
 }
@@ -874,29 +874,33 @@ AbstractDb::nextFilterKey()
    return dbNextKey(FilterTable);
 }
 
+void
+AbstractDb::encodeSiloRecord(const SiloRecord& rec, resip::Data& data)
+{
+   oDataStream s(data);
+
+   short version=1;
+   resip_assert(sizeof( version) == 2);
+   s.write((char*)(&version) , sizeof(version));
+
+   encodeString(s, rec.mDestUri);
+   encodeString(s, rec.mSourceUri);
+   s.write((char*)(&rec.mOriginalSentTime), sizeof (rec.mOriginalSentTime));
+   resip_assert(sizeof(rec.mOriginalSentTime) == 8);
+   encodeString(s, rec.mTid);
+   encodeString(s, rec.mMimeType);
+   encodeString(s, rec.mMessageBody);
+
+   s.flush();
+}
+
 bool
 AbstractDb::addToSilo(const Key& key, const SiloRecord& rec)
 {
    resip_assert( !key.empty() );
    
    Data data;
-   {
-      oDataStream s(data);
-
-      short version=1;
-      resip_assert(sizeof( version) == 2);
-      s.write((char*)(&version) , sizeof(version));
-
-      encodeString(s, rec.mDestUri);
-      encodeString(s, rec.mSourceUri);
-      s.write((char*)(&rec.mOriginalSentTime), sizeof (rec.mOriginalSentTime));
-      resip_assert(sizeof(rec.mOriginalSentTime) == 8);
-      encodeString(s, rec.mTid);
-      encodeString(s, rec.mMimeType);
-      encodeString(s, rec.mMessageBody);
-
-      s.flush();
-   }
+   encodeSiloRecord(rec, data);
    return dbWriteRecord(SiloTable, key, data);
 }
 
@@ -956,6 +960,26 @@ AbstractDb::eraseSiloRecord(const Key& key)
    dbEraseRecord(SiloTable, key);
 }
 
+bool
+AbstractDb::writeSiloBatch(const SiloBatch& batch)
+{
+   bool ok = true;
+   for(std::vector<std::pair<Key, SiloRecord> >::const_iterator it = batch.mRecords.begin();
+       it != batch.mRecords.end(); ++it)
+   {
+      if(!addToSilo(it->first, it->second))
+      {
+         ok = false;
+      }
+   }
+   for(std::vector<Key>::const_iterator it = batch.mErasedKeys.begin();
+       it != batch.mErasedKeys.end(); ++it)
+   {
+      eraseSiloRecord(*it);
+   }
+   return ok;
+}
+
 void 
 AbstractDb::cleanupExpiredSiloRecords(UInt64 now, unsigned long expirationTime)
 {
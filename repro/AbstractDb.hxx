@@ -111,6 +111,15 @@ class AbstractDb
       typedef std::vector<FilterRecord> FilterRecordList;
       typedef std::vector<SiloRecord> SiloRecordList;
 
+      // Silo changes written together by SiloStore's write-behind thread:
+      // mRecords are stored first, then the records keyed mErasedKeys erased.
+      class SiloBatch
+      {
+         public:
+            std::vector<std::pair<Key, SiloRecord> > mRecords;
+            std::vector<Key> mErasedKeys;
+      };
+
       virtual bool isSane() = 0;
 
       // functions for User Records 
@@ -174,6 +183,9 @@ class AbstractDb
       virtual bool getSiloRecords(const Key& skey, SiloRecordList& recordList); 
       virtual void eraseSiloRecord(const Key& key);
       virtual void cleanupExpiredSiloRecords(UInt64 now, unsigned long expirationTime);
+      // Returns false if any change failed.  The default writes one record
+      // at a time; SQL databases store the batch in one transaction.
+      virtual bool writeSiloBatch(const SiloBatch& batch);
 
    protected:
       typedef enum 
@@ -227,6 +239,7 @@ class AbstractDb
       virtual void encodeUser(const UserRecord& rec, resip::Data& buffer);
       virtual void encodeRoute(const RouteRecord& rec, resip::Data& buffer);
       virtual void encodeFilter(const FilterRecord& rec, resip::Data& buffer);
+      virtual void encodeSiloRecord(const SiloRecord& rec, resip::Data& buffer);
       virtual void decodeSiloRecord(resip::Data& data, SiloRecord& rec);
 };
 
@@ -18,6 +18,7 @@
 #include "repro/XmlRpcConnection.hxx"
 #include "repro/ReproRunner.hxx"
 #include "repro/CommandServer.hxx"
+#include "repro/Store.hxx"
 
 using namespace repro;
 using namespace resip;
@@ -125,6 +126,18 @@ CommandServer::handleRequest(unsigned int connectionId, unsigned int requestId,
       {
          handleRemoveTransportRequest(connectionId, requestId, xml);
       }
+      else if(isEqualNoCase(xml.getTag(), "GetAuthCacheStats"))
+      {
+         handleGetAuthCacheStatsRequest(connectionId, requestId, xml);
+      }
+      else if(isEqualNoCase(xml.getTag(), "ClearAuthCache"))
+      {
+         handleClearAuthCacheRequest(connectionId, requestId, xml);
+      }
+      else if(isEqualNoCase(xml.getTag(), "GetSiloStats"))
+      {
+         handleGetSiloStatsRequest(connectionId, requestId, xml);
+      }
       else 
       {
          WarningLog(<< "CommandServer::handleRequest: Received XML message with unknown method: " << xml.getTag());
@@ -746,6 +759,114 @@ CommandServer::handleRemoveTransportRequest(unsigned int connectionId, unsigned
 }
 
 
+void 
+CommandServer::handleGetAuthCacheStatsRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml)
+{
+   InfoLog(<< "CommandServer::handleGetAuthCacheStatsRequest");
+
+   UserStore::AuthCacheStats stats = mReproRunner.getProxy()->getConfig().getDataStore()->mUserStore.getAuthCacheStats();
+   UInt64 lookups = stats.mHits + stats.mNegativeHits + stats.mMisses;
+
+   Data buffer;
+   {
+      DataStream strm(buffer);
+      strm << "Entries: " << stats.mEntries << Symbols::CRLF
+           << "Hits: " << stats.mHits << Symbols::CRLF
+           << "NegativeHits: " << stats.mNegativeHits << Symbols::CRLF
+           << "Misses: " << stats.mMisses << Symbols::CRLF
+           << "Evictions: " << stats.mEvictions << Symbols::CRLF
+           << "HitRate: " << (lookups ? (stats.mHits + stats.mNegativeHits) * 100 / lookups : 0) << "%" << Symbols::CRLF;
+   }
+   sendResponse(connectionId, requestId, buffer, 200, "Auth cache stats retrieved.");
+}
+
+void 
+CommandServer::handleGetSiloStatsRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml)
+{
+   InfoLog(<< "CommandServer::handleGetSiloStatsRequest");
+
+   SiloWriter::Stats stats = mReproRunner.getProxy()->getConfig().getDataStore()->mSiloStore.getWriteBehindStats();
+
+   Data buffer;
+   {
+      DataStream strm(buffer);
+      strm << "QueueDepth: " << stats.mQueueDepth << Symbols::CRLF
+           << "MaxQueueDepth: " << stats.mMaxQueueDepth << Symbols::CRLF
+           << "Queued: " << stats.mQueued << Symbols::CRLF
+           << "QueueFull: " << stats.mRejected << Symbols::CRLF
+           << "Batches: " << stats.mBatches << Symbols::CRLF
+           << "FailedBatches: " << stats.mFailedBatches << Symbols::CRLF
+           << "RecordsWritten: " << stats.mRecordsWritten << Symbols::CRLF
+           << "RecordsErased: " << stats.mRecordsErased << Symbols::CRLF
+           << "LastFlushMs: " << stats.mLastFlushMs << Symbols::CRLF
+           << "MaxFlushMs: " << stats.mMaxFlushMs << Symbols::CRLF
+           << "AvgFlushMs: " << (stats.mBatches ? stats.mTotalFlushMs / stats.mBatches : 0) << Symbols::CRLF;
+   }
+   sendResponse(connectionId, requestId, buffer, 200, "Silo stats retrieved.");
+}
+
+void 
+CommandServer::handleClearAuthCacheRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml)
+{
+   Data user;
+   Data realm;
+
+   InfoLog(<< "CommandServer::handleClearAuthCacheRequest");
+
+   // Check for Parameters
+   if(xml.firstChild())
+   {
+      if(isEqualNoCase(xml.getTag(), "request"))
+      {
+         if(xml.firstChild())
+         {
+            while(true)
+            {
+               if(isEqualNoCase(xml.getTag(), "user"))
+               {
+                  if(xml.firstChild())
+                  {
+                     user = xml.getValue();
+                     xml.parent();
+                  }
+               }
+               else if(isEqualNoCase(xml.getTag(), "realm"))
+               {
+                  if(xml.firstChild())
+                  {
+                     realm = xml.getValue();
+                     xml.parent();
+                  }
+               }
+               if(!xml.nextSibling())
+               {
+                  // break on no more sibilings
+                  break;
+               }
+            }
+            xml.parent();
+         }
+      }
+      xml.parent();
+   }
+
+   UserStore& userStore = mReproRunner.getProxy()->getConfig().getDataStore()->mUserStore;
+   if(user.empty() && realm.empty())
+   {
+      userStore.clearAuthCache();
+      sendResponse(connectionId, requestId, Data::Empty, 200, "Auth cache cleared.");
+   }
+   else if(user.empty() || realm.empty())
+   {
+      sendResponse(connectionId, requestId, Data::Empty, 400, "Both user and realm, or neither, must be specified.");
+   }
+   else
+   {
+      userStore.invalidateAuthInfo(user, realm);
+      sendResponse(connectionId, requestId, Data::Empty, 200, "Auth cache entry cleared: " + user + "@" + realm);
+   }
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
@@ -60,6 +60,9 @@ private:
    void handleRestartRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
    void handleAddTransportRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
    void handleRemoveTransportRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
+   void handleGetAuthCacheStatsRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
+   void handleClearAuthCacheRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
+   void handleGetSiloStatsRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
 
    ReproRunner& mReproRunner;
    resip::Mutex mStatisticsWaitersMutex;
@@ -15,6 +15,7 @@
 
 #include "rutil/Data.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 
@@ -81,15 +82,26 @@ MySqlDb::MySqlDb(const resip::ConfigParse& config,
    mDBName(databaseName),
    mDBPort(port),
    mCustomUserAuthQuery(customUserAuthQuery),
-   mConn(0)
+   mCustomUserAuthPrepared(false),
+   mConnections(connectionCount())
 { 
-   InfoLog( << "Using MySQL DB with server=" << server << ", user=" << user << ", dbName=" << databaseName << ", port=" << port);
+   InfoLog( << "Using MySQL DB with server=" << server << ", user=" << user << ", dbName=" << databaseName << ", port=" << port
+            << ", connections=" << connectionCount());
 
    for (int i=0;i<MaxTable;i++)
    {
       mResult[i]=0;
    }
 
+   if(!mCustomUserAuthQuery.empty())
+   {
+      mCustomUserAuthPrepared = parameterizeQuery(mCustomUserAuthQuery, "?", 3, mCustomUserAuthStatement, mCustomUserAuthTags);
+      if(!mCustomUserAuthPrepared)
+      {
+         WarningLog( << "CustomUserAuthQuery uses $user or $domain outside of single quotes, it cannot be run as a prepared statement");
+      }
+   }
+
    mysql_library_init(0, 0, 0);
    if(!mysql_thread_safe())
    {
@@ -97,14 +109,26 @@ MySqlDb::MySqlDb(const resip::ConfigParse& config,
    }
    else
    {
-      connectToDatabase();
+      // the other connections are opened when first needed
+      connectToDatabase(0);
    }
 }
 
 
 MySqlDb::~MySqlDb()
 {
-   disconnectFromDatabase();
+   for (int i=0;i<MaxTable;i++)
+   {
+      if (mResult[i])
+      {  
+         mysql_free_result(mResult[i]); 
+         mResult[i]=0;
+      }
+   }
+   for (unsigned int i=0;i<mConnections.size();i++)
+   {
+      disconnectFromDatabase(i);
+   }
 }
 
 void
@@ -118,43 +142,41 @@ MySqlDb::initialize() const
 }
 
 void
-MySqlDb::disconnectFromDatabase() const
+MySqlDb::disconnectFromDatabase(unsigned int connection) const
 {
-   if(mConn)
+   Connection& conn = mConnections[connection];
+   for (Connection::StatementMap::iterator it = conn.mStatements.begin(); it != conn.mStatements.end(); ++it)
    {
-      for (int i=0;i<MaxTable;i++)
-      {
-         if (mResult[i])
-         {  
-            mysql_free_result(mResult[i]); 
-            mResult[i]=0;
-         }
-      }
-   
-      mysql_close(mConn);
-      mConn = 0;
-      setConnected(false);
+      mysql_stmt_close(it->second);
+   }
+   conn.mStatements.clear();
+
+   if(conn.mConn)
+   {
+      mysql_close(conn.mConn);
+      conn.mConn = 0;
    }
 }
 
 int 
-MySqlDb::connectToDatabase() const
+MySqlDb::connectToDatabase(unsigned int connection) const
 {
    // Disconnect from database first (if required)
-   disconnectFromDatabase();
+   disconnectFromDatabase(connection);
 
    // Now try to connect
-   resip_assert(mConn == 0);
-   resip_assert(isConnected() == false);
+   MYSQL*& conn = mConnections[connection].mConn;
+   resip_assert(conn == 0);
 
-   mConn = mysql_init(0);
-   if(mConn == 0)
+   conn = mysql_init(0);
+   if(conn == 0)
    {
       ErrLog( << "MySQL init failed: insufficient memory.");
+      setConnected(connection, false);
       return CR_OUT_OF_MEMORY;
    }
 
-   MYSQL* ret = mysql_real_connect(mConn,
+   MYSQL* ret = mysql_real_connect(conn,
                                    mDBServer.c_str(),   // hostname
                                    mDBUser.c_str(),     // user
                                    mDBPassword.c_str(), // password
@@ -165,16 +187,16 @@ MySqlDb::connectToDatabase() const
 
    if (ret == 0)
    { 
-      int rc = mysql_errno(mConn);
-      ErrLog( << "MySQL connect failed: error=" << rc << ": " << mysql_error(mConn));
-      mysql_close(mConn); 
-      mConn = 0;
-      setConnected(false);
+      int rc = mysql_errno(conn);
+      ErrLog( << "MySQL connect failed: error=" << rc << ": " << mysql_error(conn));
+      mysql_close(conn); 
+      conn = 0;
+      setConnected(connection, false);
       return rc;
    }
    else
    {
-      setConnected(true);
+      setConnected(connection, true);
       return 0;
    }
 }
@@ -188,37 +210,37 @@ MySqlDb::query(const Data& queryCommand, MYSQL_RES** result) const
 
    DebugLog( << "MySqlDb::query: executing query: " << queryCommand);
 
-   Lock lock(mMutex);
-   if(mConn == 0 || !isConnected())
+   ConnectionGuard guard(*this);
+   MYSQL*& conn = mConnections[guard.connection()].mConn;
+   if(conn == 0)
    {
-      rc = connectToDatabase();
+      rc = connectToDatabase(guard.connection());
    }
    if(rc == 0)
    {
-      resip_assert(mConn!=0);
-      resip_assert(isConnected());
-      rc = mysql_query(mConn,queryCommand.c_str());
+      resip_assert(conn!=0);
+      rc = mysql_query(conn,queryCommand.c_str());
       if(rc != 0)
       {
-         rc = mysql_errno(mConn);
+         rc = mysql_errno(conn);
          if(rc == CR_SERVER_GONE_ERROR ||
             rc == CR_SERVER_LOST)
          {
             // First failure is a connection error - try to re-connect and then try again
-            rc = connectToDatabase();
+            rc = connectToDatabase(guard.connection());
             if(rc == 0)
             {
                // OK - we reconnected - try query again
-               rc = mysql_query(mConn,queryCommand.c_str());
+               rc = mysql_query(conn,queryCommand.c_str());
                if( rc != 0)
                {
-                  ErrLog( << "MySQL query failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+                  ErrLog( << "MySQL query failed: error=" << mysql_errno(conn) << ": " << mysql_error(conn));
                }
             }
          }
          else
          {
-            ErrLog( << "MySQL query failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+            ErrLog( << "MySQL query failed: error=" << mysql_errno(conn) << ": " << mysql_error(conn));
          }
       }
    }
@@ -226,13 +248,13 @@ MySqlDb::query(const Data& queryCommand, MYSQL_RES** result) const
    // Now store result - if pointer to result pointer was supplied and no errors
    if(rc == 0 && result)
    {
-      *result = mysql_store_result(mConn);
+      *result = mysql_store_result(conn);
       if(*result == 0)
       {
-         rc = mysql_errno(mConn);
+         rc = mysql_errno(conn);
          if(rc != 0)
          {
-            ErrLog( << "MySQL store result failed: error=" << rc << ": " << mysql_error(mConn));
+            ErrLog( << "MySQL store result failed: error=" << rc << ": " << mysql_error(conn));
          }
       }
    }
@@ -250,6 +272,152 @@ MySqlDb::query(const Data& queryCommand) const
    return query(queryCommand, 0);
 }
 
+int
+MySqlDb::execute(const Data& statement,
+                 const std::vector<Data>& params,
+                 std::vector<Data>* fields) const
+{
+   int rc = 0;
+
+   initialize();
+
+   DebugLog( << "MySqlDb::execute: executing statement: " << statement);
+
+   ConnectionGuard guard(*this);
+   Connection& conn = mConnections[guard.connection()];
+   for(int attempt = 0; attempt < 2; attempt++)
+   {
+      if(conn.mConn == 0)
+      {
+         rc = connectToDatabase(guard.connection());
+         if(rc != 0)
+         {
+            break;
+         }
+      }
+      rc = executeOnConnection(conn, statement, params, fields);
+      if(rc != CR_SERVER_GONE_ERROR && rc != CR_SERVER_LOST)
+      {
+         break;
+      }
+      // A connection error - re-connect (preparing the statement again) and try again
+      disconnectFromDatabase(guard.connection());
+   }
+
+   if(rc != 0)
+   {
+      ErrLog( << " SQL statement was: " << statement);
+   }
+   return rc;
+}
+
+int
+MySqlDb::executeOnConnection(Connection& conn,
+                             const Data& statement,
+                             const std::vector<Data>& params,
+                             std::vector<Data>* fields) const
+{
+   MYSQL_STMT* stmt = 0;
+   Connection::StatementMap::iterator it = conn.mStatements.find(statement);
+   if(it != conn.mStatements.end())
+   {
+      stmt = it->second;
+   }
+   else
+   {
+      stmt = mysql_stmt_init(conn.mConn);
+      if(stmt == 0)
+      {
+         ErrLog( << "MySQL statement init failed: insufficient memory.");
+         return CR_OUT_OF_MEMORY;
+      }
+      if(mysql_stmt_prepare(stmt, statement.data(), statement.size()) != 0)
+      {
+         int rc = mysql_stmt_errno(stmt);
+         ErrLog( << "MySQL prepare failed: error=" << rc << ": " << mysql_stmt_error(stmt));
+         mysql_stmt_close(stmt);
+         return rc;
+      }
+      conn.mStatements[statement] = stmt;
+   }
+   resip_assert(mysql_stmt_param_count(stmt) == params.size());
+
+   // all parameters are passed as strings
+   std::vector<MYSQL_BIND> paramBinds(params.size());
+   std::vector<unsigned long> paramLengths(params.size());
+   for(size_t i = 0; i < params.size(); i++)
+   {
+      paramLengths[i] = params[i].size();
+      paramBinds[i].buffer_type = MYSQL_TYPE_STRING;
+      paramBinds[i].buffer = (void*)params[i].data();
+      paramBinds[i].buffer_length = paramLengths[i];
+      paramBinds[i].length = &paramLengths[i];
+   }
+   if((!params.empty() && mysql_stmt_bind_param(stmt, &paramBinds[0]) != 0) ||
+      mysql_stmt_execute(stmt) != 0)
+   {
+      int rc = mysql_stmt_errno(stmt);
+      ErrLog( << "MySQL statement failed: error=" << rc << ": " << mysql_stmt_error(stmt));
+      return rc;
+   }
+
+   unsigned int columns = mysql_stmt_field_count(stmt);
+   if(fields == 0 || columns == 0)
+   {
+      mysql_stmt_free_result(stmt);
+      return 0;
+   }
+
+   // Fetch the lengths of the first row's columns, then each column into
+   // a buffer of that size
+   int rc = 0;
+   std::vector<MYSQL_BIND> resultBinds(columns);
+   std::vector<unsigned long> resultLengths(columns);
+   for(unsigned int i = 0; i < columns; i++)
+   {
+      resultBinds[i].buffer_type = MYSQL_TYPE_STRING;
+      resultBinds[i].length = &resultLengths[i];
+   }
+   if(mysql_stmt_bind_result(stmt, &resultBinds[0]) != 0)
+   {
+      rc = mysql_stmt_errno(stmt);
+      ErrLog( << "MySQL bind result failed: error=" << rc << ": " << mysql_stmt_error(stmt));
+   }
+   else
+   {
+      int ret = mysql_stmt_fetch(stmt);
+      if(ret == 0 || ret == MYSQL_DATA_TRUNCATED)
+      {
+         for(unsigned int i = 0; i < columns && rc == 0; i++)
+         {
+            Data value;
+            if(resultLengths[i] > 0)
+            {
+               resultBinds[i].buffer = value.getBuf((Data::size_type)resultLengths[i]);
+               resultBinds[i].buffer_length = resultLengths[i];
+               if(mysql_stmt_fetch_column(stmt, &resultBinds[i], i, 0) != 0)
+               {
+                  rc = mysql_stmt_errno(stmt);
+                  ErrLog( << "MySQL fetch column failed: error=" << rc << ": " << mysql_stmt_error(stmt));
+               }
+            }
+            fields->push_back(value);
+         }
+      }
+      else if(ret == MYSQL_NO_DATA)
+      {
+         DebugLog(<<"execute: no rows returned by statement");
+      }
+      else
+      {
+         rc = mysql_stmt_errno(stmt);
+         ErrLog( << "MySQL fetch row failed: error=" << rc << ": " << mysql_stmt_error(stmt));
+      }
+   }
+   mysql_stmt_free_result(stmt);
+   return rc;
+}
+
 int
 MySqlDb::singleResultQuery(const Data& queryCommand, std::vector<Data>& fields) const
 {
@@ -274,15 +442,8 @@ MySqlDb::singleResultQuery(const Data& queryCommand, std::vector<Data>& fields)
       }
       else
       {
-         rc = mysql_errno(mConn);
-         if(rc != 0)
-         {
-            ErrLog( << "MySQL fetch row failed: error=" << rc << ": " << mysql_error(mConn));
-         }
-         else
-         {
-            DebugLog(<<"singleResultQuery: no rows returned by query");
-         }
+         // the result is stored, so there are no errors from fetching
+         DebugLog(<<"singleResultQuery: no rows returned by query");
       }
       mysql_free_result(result);
    }
@@ -292,7 +453,21 @@ MySqlDb::singleResultQuery(const Data& queryCommand, std::vector<Data>& fields)
 resip::Data& 
 MySqlDb::escapeString(const resip::Data& str, resip::Data& escapedStr) const
 {
-   escapedStr.truncate2(mysql_real_escape_string(mConn, (char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size()));
+   // escaping depends on the connection's character set
+   ConnectionGuard guard(*this);
+   MYSQL* conn = mConnections[guard.connection()].mConn;
+   if(conn == 0 && connectToDatabase(guard.connection()) == 0)
+   {
+      conn = mConnections[guard.connection()].mConn;
+   }
+   if(conn)
+   {
+      escapedStr.truncate2(mysql_real_escape_string(conn, (char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size()));
+   }
+   else
+   {
+      escapedStr.truncate2(mysql_escape_string((char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size()));
+   }
    return escapedStr;
 }
 
@@ -347,7 +522,7 @@ MySqlDb::getUser( const AbstractDb::Key& key ) const
    
    if (result==0)
    {
-      ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+      ErrLog( << "MySQL query returned no result set");
       return ret;
    }
 
@@ -376,26 +551,53 @@ MySqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
 { 
    std::vector<Data> ret;
 
-   Data command;
+   Data user;
+   Data domain;
+   UserStore::getUserAndDomainFromKey(key, user, domain);
+
+   // Note: domain is empty when querying for HTTP admin user - for this special user, 
+   // we will only check the repro db, by not adding the UNION statement below
+   bool custom = !mCustomUserAuthQuery.empty() && !domain.empty();
+   int rc;
+   if(!custom || mCustomUserAuthPrepared)
    {
-      DataStream ds(command);
-      Data user;
-      Data domain;
-      UserStore::getUserAndDomainFromKey(key, user, domain);
-      ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE user = '" << user << "' AND domain = '" << domain << "' ";
-   
-      // Note: domain is empty when querying for HTTP admin user - for this special user, 
-      // we will only check the repro db, by not adding the UNION statement below
-      if(!mCustomUserAuthQuery.empty() && !domain.empty())  
+      Data statement;
+      std::vector<Data> params;
+      params.push_back(user);
+      params.push_back(domain);
       {
+         DataStream ds(statement);
+         ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE user = ? AND domain = ?";
+         if(custom)
+         {
+            ds << " UNION " << mCustomUserAuthStatement;
+            for(std::vector<Data>::const_iterator it = mCustomUserAuthTags.begin(); it != mCustomUserAuthTags.end(); ++it)
+            {
+               params.push_back(*it == "user" ? user : domain);
+            }
+         }
+      }
+      rc = execute(statement, params, &ret);
+   }
+   else
+   {
+      Data command;
+      {
+         DataStream ds(command);
+         Data escapedUser;
+         Data escapedDomain;
+         escapeString(user, escapedUser);
+         escapeString(domain, escapedDomain);
+         ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE user = '" << escapedUser << "' AND domain = '" << escapedDomain << "' ";
          ds << " UNION " << mCustomUserAuthQuery;
          ds.flush();
-         command.replace("$user", user);
-         command.replace("$domain", domain);
+         command.replace("$user", escapedUser);
+         command.replace("$domain", escapedDomain);
       }
+      rc = singleResultQuery(command, ret);
    }
 
-   if(singleResultQuery(command, ret) != 0 || ret.size() == 0)
+   if(rc != 0 || ret.size() == 0)
    {
       return Data::Empty;
    }
@@ -429,7 +631,7 @@ MySqlDb::firstUserKey()
 
    if(mResult[UserTable] == 0)
    {
-      ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+      ErrLog( << "MySQL query returned no result set");
       return Data::Empty;
    }
    
@@ -498,7 +700,7 @@ MySqlDb::getTlsPeerIdentity( const AbstractDb::Key& key ) const
 
    if (result==0)
    {
-      ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+      ErrLog( << "MySQL query returned no result set");
       return ret;
    }
 
@@ -539,7 +741,7 @@ MySqlDb::firstTlsPeerIdentityKey()
 
    if(mResult[TlsPeerIdentityTable] == 0)
    {
-      ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+      ErrLog( << "MySQL query returned no result set");
       return Data::Empty;
    }
 
@@ -574,33 +776,29 @@ MySqlDb::dbWriteRecord(const Table table,
                        const resip::Data& pKey, 
                        const resip::Data& pData)
 {
-   Data command;
+   Data statement;
+   std::vector<Data> params;
+   params.push_back(pKey);
 
    // Check if there is a secondary key or not and get it's value
    char* secondaryKey;
    unsigned int secondaryKeyLen;
-   Data escapedKey;
    if(AbstractDb::getSecondaryKey(table, pKey, pData, (void**)&secondaryKey, &secondaryKeyLen) == 0)
    {
-      Data escapedSKey;
-      Data sKey(Data::Share, secondaryKey, secondaryKeyLen);
-      DataStream ds(command);
+      params.push_back(Data(secondaryKey, secondaryKeyLen));
+      DataStream ds(statement);
       ds << "REPLACE INTO " << tableName(table)
-         << " SET attr='" << escapeString(pKey, escapedKey)
-         << "', attr2='" << escapeString(sKey, escapedSKey)
-         << "', value='"  << pData.base64encode()
-         << "'";
+         << " SET attr=?, attr2=?, value=?";
    }
    else
    {
-      DataStream ds(command);
+      DataStream ds(statement);
       ds << "REPLACE INTO " << tableName(table) 
-         << " SET attr='" << escapeString(pKey, escapedKey)
-         << "', value='"  << pData.base64encode()
-         << "'";
+         << " SET attr=?, value=?";
    }
+   params.push_back(pData.base64encode());
 
-   return query(command, 0) == 0;
+   return execute(statement, params, 0) == 0;
 }
 
 bool 
@@ -608,38 +806,22 @@ MySqlDb::dbReadRecord(const Table table,
                       const resip::Data& pKey, 
                       resip::Data& pData) const
 { 
-   Data command;
-   Data escapedKey;
+   Data statement;
    {
-      DataStream ds(command);
+      DataStream ds(statement);
       ds << "SELECT value FROM " << tableName(table) 
-         << " WHERE attr='" << escapeString(pKey, escapedKey)
-         << "'";
+         << " WHERE attr=?";
    }
+   std::vector<Data> params;
+   params.push_back(pKey);
 
-   MYSQL_RES* result = 0;
-   if(query(command, &result) != 0)
+   std::vector<Data> fields;
+   if(execute(statement, params, &fields) != 0 || fields.empty())
    {
       return false;
    }
-
-   if (result == 0)
-   {
-      ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
-      return false;
-   }
-   else
-   {
-      bool success = false;
-      MYSQL_ROW row=mysql_fetch_row(result);
-      if(row)
-      {
-         pData = Data(Data::Share, row[0], (Data::size_type)strlen(row[0])).base64decode();
-         success = true;
-      }
-      mysql_free_result(result);
-      return success;
-   }
+   pData = fields.front().base64decode();
+   return true;
 }
 
 
@@ -668,7 +850,7 @@ MySqlDb::dbNextKey(const Table table, bool first)
 
       if (mResult[table] == 0)
       {
-         ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+         ErrLog( << "MySQL query returned no result set");
          return Data::Empty;
       }
    }
@@ -732,7 +914,7 @@ MySqlDb::dbNextRecord(const Table table,
 
       if (mResult[table] == 0)
       {
-         ErrLog( << "MySQL store result failed: error=" << mysql_errno(mConn) << ": " << mysql_error(mConn));
+         ErrLog( << "MySQL query returned no result set");
          return false;
       }
    }
@@ -758,12 +940,18 @@ MySqlDb::dbNextRecord(const Table table,
 bool 
 MySqlDb::dbBeginTransaction(const Table table)
 {
+   // the rest of the transaction must run on the same connection
+   pinConnection();
    Data command("SET SESSION TRANSACTION ISOLATION LEVEL REPEATABLE READ");
    if(query(command, 0) == 0)
    {
       command = "START TRANSACTION";
-      return query(command, 0) == 0;
+      if(query(command, 0) == 0)
+      {
+         return true;
+      }
    }
+   unpinConnection();
    return false;
 }
 
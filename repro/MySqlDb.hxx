@@ -7,7 +7,10 @@
 #include <mysql/mysql.h>
 #endif
 
+#include <vector>
+
 #include "rutil/Data.hxx"
+#include "rutil/HashMap.hxx"
 #include "repro/SqlDb.hxx"
 
 namespace resip
@@ -62,11 +65,31 @@ class MySqlDb: public SqlDb
                                 bool first=false);  // return false if no more
       virtual bool dbBeginTransaction(const Table table);
 
+      // A connection, and the statements prepared on it, by SQL text.
+      class Connection
+      {
+         public:
+            Connection() : mConn(0) {}
+            MYSQL* mConn;
+            typedef HashMap<resip::Data, MYSQL_STMT*> StatementMap;
+            StatementMap mStatements;
+      };
+
       void initialize() const;
-      void disconnectFromDatabase() const;
-      int connectToDatabase() const;
+      void disconnectFromDatabase(unsigned int connection) const;
+      int connectToDatabase(unsigned int connection) const;
       int query(const resip::Data& queryCommand, MYSQL_RES** result) const;
       virtual int query(const resip::Data& queryCommand) const;
+      // Runs a statement with a ? placeholder for each of params, preparing
+      // it on first use on each connection.  If fields is given, it gets the
+      // columns of the first row returned, if any.
+      int execute(const resip::Data& statement,
+                  const std::vector<resip::Data>& params,
+                  std::vector<resip::Data>* fields) const;
+      int executeOnConnection(Connection& conn,
+                              const resip::Data& statement,
+                              const std::vector<resip::Data>& params,
+                              std::vector<resip::Data>* fields) const;
       resip::Data& escapeString(const resip::Data& str, resip::Data& escapedStr) const;
 
       resip::Data mDBServer;
@@ -75,8 +98,12 @@ class MySqlDb: public SqlDb
       resip::Data mDBName;
       unsigned int mDBPort;
       resip::Data mCustomUserAuthQuery;
+      // mCustomUserAuthQuery with its tags as placeholders, if possible
+      resip::Data mCustomUserAuthStatement;
+      std::vector<resip::Data> mCustomUserAuthTags;
+      bool mCustomUserAuthPrepared;
 
-      mutable MYSQL* mConn;
+      mutable std::vector<Connection> mConnections;
       mutable MYSQL_RES* mResult[MaxTable];
 
       void userWhereClauseToDataStream(const Key& key, resip::DataStream& ds) const;
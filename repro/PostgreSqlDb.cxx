@@ -10,6 +10,7 @@
 #include "rutil/ResipAssert.h"
 #include "rutil/Data.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 
@@ -77,9 +78,20 @@ PostgreSqlDb::PostgreSqlDb(const resip::ConfigParse& config,
    mDBName(databaseName),
    mDBPort(port),
    mCustomUserAuthQuery(customUserAuthQuery),
-   mConn(0)
+   mCustomUserAuthPrepared(false),
+   mConnections(connectionCount())
 { 
-   InfoLog( << "Using PostgreSQL DB with server=" << server << ", user=" << user << ", dbName=" << databaseName << ", port=" << port);
+   InfoLog( << "Using PostgreSQL DB with server=" << server << ", user=" << user << ", dbName=" << databaseName << ", port=" << port
+            << ", connections=" << connectionCount());
+
+   if(!mCustomUserAuthQuery.empty())
+   {
+      mCustomUserAuthPrepared = parameterizeQuery(mCustomUserAuthQuery, "$%d", 3, mCustomUserAuthStatement, mCustomUserAuthTags);
+      if(!mCustomUserAuthPrepared)
+      {
+         WarningLog( << "CustomUserAuthQuery uses $user or $domain outside of single quotes, it cannot be run as a prepared statement");
+      }
+   }
 
    for (int i=0;i<MaxTable;i++)
    {
@@ -93,14 +105,27 @@ PostgreSqlDb::PostgreSqlDb(const resip::ConfigParse& config,
    }
    else
    {
-      connectToDatabase();
+      // the other connections are opened when first needed
+      connectToDatabase(0);
    }
 }
 
 
 PostgreSqlDb::~PostgreSqlDb()
 {
-   disconnectFromDatabase();
+   for (int i=0;i<MaxTable;i++)
+   {
+      if (mResult[i])
+      {  
+         PQclear(mResult[i]); 
+         mResult[i]=0;
+         mRow[i]=0;
+      }
+   }
+   for (unsigned int i=0;i<mConnections.size();i++)
+   {
+      disconnectFromDatabase(i);
+   }
 }
 
 void
@@ -114,35 +139,27 @@ PostgreSqlDb::initialize() const
 }
 
 void
-PostgreSqlDb::disconnectFromDatabase() const
+PostgreSqlDb::disconnectFromDatabase(unsigned int connection) const
 {
-   if(mConn)
+   Connection& conn = mConnections[connection];
+   // prepared statements go with the connection
+   conn.mStatements.clear();
+   if(conn.mConn)
    {
-      for (int i=0;i<MaxTable;i++)
-      {
-         if (mResult[i])
-         {  
-            PQclear(mResult[i]); 
-            mResult[i]=0;
-            mRow[i]=0;
-         }
-      }
-   
-      PQfinish(mConn);
-      mConn = 0;
-      setConnected(false);
+      PQfinish(conn.mConn);
+      conn.mConn = 0;
    }
 }
 
 int 
-PostgreSqlDb::connectToDatabase() const
+PostgreSqlDb::connectToDatabase(unsigned int connection) const
 {
    // Disconnect from database first (if required)
-   disconnectFromDatabase();
+   disconnectFromDatabase(connection);
 
    // Now try to connect
-   resip_assert(mConn == 0);
-   resip_assert(isConnected() == false);
+   PGconn*& conn = mConnections[connection].mConn;
+   resip_assert(conn == 0);
 
    Data connInfo(mDBConnInfo);
    if(!mDBServer.empty())
@@ -169,19 +186,20 @@ PostgreSqlDb::connectToDatabase() const
    }
 
    DebugLog(<<"Trying to connect to PostgreSQL server with conninfo string: " << connInfoLogString);
-   mConn = PQconnectdb(connInfo.c_str());
+   conn = PQconnectdb(connInfo.c_str());
 
-   int rc = PQstatus(mConn);
+   int rc = PQstatus(conn);
    if (rc != CONNECTION_OK)
    { 
-      ErrLog( << "PostgreSQL connect failed: " << PQerrorMessage(mConn));
-      mConn = 0;
-      setConnected(false);
+      ErrLog( << "PostgreSQL connect failed: " << PQerrorMessage(conn));
+      PQfinish(conn);
+      conn = 0;
+      setConnected(connection, false);
       return -1;
    }
    else
    {
-      setConnected(true);
+      setConnected(connection, true);
       return 0;
    }
 }
@@ -202,38 +220,41 @@ PostgreSqlDb::query(const Data& queryCommand, PGresult** result) const
 
    DebugLog( << "PostgreSqlDb::query: executing query: " << queryCommand);
 
-   Lock lock(mMutex);
-   if(mConn == 0 || !isConnected())
+   ConnectionGuard guard(*this);
+   PGconn*& conn = mConnections[guard.connection()].mConn;
+   if(conn == 0)
    {
-      rc = connectToDatabase();
+      rc = connectToDatabase(guard.connection());
    }
    if(rc == 0)
    {
-      resip_assert(mConn!=0);
-      resip_assert(isConnected());
-      _result = PQexec(mConn, queryCommand.c_str());
+      resip_assert(conn!=0);
+      _result = PQexec(conn, queryCommand.c_str());
       rc = pqOK(_result);
       if(rc != 0)
       {
          PQclear(_result);
-         if(rc == PGRES_FATAL_ERROR)
+         _result = 0;
+         if(PQstatus(conn) == CONNECTION_BAD)
          {
-            // First failure may be a connection error - try to re-connect and then try again
-            rc = connectToDatabase();
+            // First failure is a connection error - try to re-connect and then try again
+            rc = connectToDatabase(guard.connection());
             if(rc == 0)
             {
                // OK - we reconnected - try query again
-               _result = PQexec(mConn,queryCommand.c_str());
+               _result = PQexec(conn,queryCommand.c_str());
                rc = pqOK(_result);
                if( rc != 0)
                {
-                  ErrLog( << "PostgreSQL query failed (twice): " << PQerrorMessage(mConn));
+                  ErrLog( << "PostgreSQL query failed (twice): " << PQerrorMessage(conn));
+                  PQclear(_result);
+                  _result = 0;
                }
             }
          }
          else
          {
-            ErrLog( << "PostgreSQL query failed: " << PQerrorMessage(mConn));
+            ErrLog( << "PostgreSQL query failed: " << PQerrorMessage(conn));
          }
       }
    }
@@ -243,6 +264,10 @@ PostgreSqlDb::query(const Data& queryCommand, PGresult** result) const
    {
       *result = _result;
    }
+   else if(rc == 0)
+   {
+      PQclear(_result);
+   }
 
    if(rc != 0)
    {
@@ -257,6 +282,102 @@ PostgreSqlDb::query(const Data& queryCommand) const
    return query(queryCommand, 0);
 }
 
+int
+PostgreSqlDb::execute(const Data& statement,
+                      const std::vector<Data>& params,
+                      std::vector<Data>* fields) const
+{
+   int rc = 0;
+
+   initialize();
+
+   DebugLog( << "PostgreSqlDb::execute: executing statement: " << statement);
+
+   ConnectionGuard guard(*this);
+   Connection& conn = mConnections[guard.connection()];
+   for(int attempt = 0; attempt < 2; attempt++)
+   {
+      if(conn.mConn == 0)
+      {
+         rc = connectToDatabase(guard.connection());
+         if(rc != 0)
+         {
+            break;
+         }
+      }
+      rc = executeOnConnection(conn, statement, params, fields);
+      if(rc == 0 || PQstatus(conn.mConn) != CONNECTION_BAD)
+      {
+         break;
+      }
+      // A connection error - re-connect (preparing the statement again) and try again
+      disconnectFromDatabase(guard.connection());
+   }
+
+   if(rc != 0)
+   {
+      ErrLog( << " SQL statement was: " << statement);
+   }
+   return rc;
+}
+
+int
+PostgreSqlDb::executeOnConnection(Connection& conn,
+                                  const Data& statement,
+                                  const std::vector<Data>& params,
+                                  std::vector<Data>* fields) const
+{
+   Data name;
+   Connection::StatementMap::iterator it = conn.mStatements.find(statement);
+   if(it != conn.mStatements.end())
+   {
+      name = it->second;
+   }
+   else
+   {
+      name = "repro" + Data((UInt32)conn.mStatements.size());
+      PGresult* result = PQprepare(conn.mConn, name.c_str(), statement.c_str(), (int)params.size(), 0);
+      int rc = pqOK(result);
+      PQclear(result);
+      if(rc != 0)
+      {
+         ErrLog( << "PostgreSQL prepare failed: " << PQerrorMessage(conn.mConn));
+         return rc;
+      }
+      conn.mStatements[statement] = name;
+   }
+
+   // all parameters are passed as text
+   std::vector<const char*> values;
+   for(size_t i = 0; i < params.size(); i++)
+   {
+      values.push_back(params[i].c_str());
+   }
+   PGresult* result = PQexecPrepared(conn.mConn, name.c_str(), (int)values.size(),
+                                     values.empty() ? 0 : &values[0], 0, 0, 0);
+   int rc = pqOK(result);
+   if(rc != 0)
+   {
+      ErrLog( << "PostgreSQL statement failed: " << PQerrorMessage(conn.mConn));
+   }
+   else if(fields)
+   {
+      if(PQntuples(result) > 0)
+      {
+         for(int i = 0; i < PQnfields(result); i++)
+         {
+            fields->push_back(Data(PQgetvalue(result, 0, i)));
+         }
+      }
+      else
+      {
+         DebugLog(<<"execute: no rows returned by statement");
+      }
+   }
+   PQclear(result);
+   return rc;
+}
+
 int
 PostgreSqlDb::singleResultQuery(const Data& queryCommand, std::vector<Data>& fields) const
 {
@@ -291,11 +412,24 @@ PostgreSqlDb::singleResultQuery(const Data& queryCommand, std::vector<Data>& fie
 resip::Data& 
 PostgreSqlDb::escapeString(const resip::Data& str, resip::Data& escapedStr) const
 {
+   // escaping depends on the connection's settings
+   ConnectionGuard guard(*this);
+   PGconn* conn = mConnections[guard.connection()].mConn;
+   if(conn == 0 && connectToDatabase(guard.connection()) == 0)
+   {
+      conn = mConnections[guard.connection()].mConn;
+   }
+   if(conn == 0)
+   {
+      escapedStr.truncate2(PQescapeString((char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size()));
+      return escapedStr;
+   }
+
    int rc = 0;
-   escapedStr.truncate2(PQescapeStringConn(mConn, (char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size(), &rc));
+   escapedStr.truncate2(PQescapeStringConn(conn, (char*)escapedStr.getBuf(str.size()*2+1), str.c_str(), str.size(), &rc));
    if(rc != 0)
    {
-      ErrLog(<< "PostgreSQL string escaping failed: " << PQerrorMessage(mConn));
+      ErrLog(<< "PostgreSQL string escaping failed: " << PQerrorMessage(conn));
       // FIXME - should probably throw here.  According to the docs, there is a value in
       // the output buffer even after failure so we'll try to use it and fail later.
    }
@@ -357,7 +491,7 @@ PostgreSqlDb::getUser( const AbstractDb::Key& key ) const
    
    if (result==0)
    {
-      ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+      ErrLog( << "PostgreSQL query returned no result");
       return ret;
    }
 
@@ -385,26 +519,53 @@ PostgreSqlDb::getUserAuthInfo(  const AbstractDb::Key& key ) const
 { 
    std::vector<Data> ret;
 
-   Data command;
+   Data user;
+   Data domain;
+   UserStore::getUserAndDomainFromKey(key, user, domain);
+
+   // Note: domain is empty when querying for HTTP admin user - for this special user, 
+   // we will only check the repro db, by not adding the UNION statement below
+   bool custom = !mCustomUserAuthQuery.empty() && !domain.empty();
+   int rc;
+   if(!custom || mCustomUserAuthPrepared)
    {
-      DataStream ds(command);
-      Data user;
-      Data domain;
-      UserStore::getUserAndDomainFromKey(key, user, domain);
-      ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE username = '" << user << "' AND domain = '" << domain << "' ";
-   
-      // Note: domain is empty when querying for HTTP admin user - for this special user, 
-      // we will only check the repro db, by not adding the UNION statement below
-      if(!mCustomUserAuthQuery.empty() && !domain.empty())  
+      Data statement;
+      std::vector<Data> params;
+      params.push_back(user);
+      params.push_back(domain);
       {
+         DataStream ds(statement);
+         ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE username = $1 AND domain = $2";
+         if(custom)
+         {
+            ds << " UNION " << mCustomUserAuthStatement;
+            for(std::vector<Data>::const_iterator it = mCustomUserAuthTags.begin(); it != mCustomUserAuthTags.end(); ++it)
+            {
+               params.push_back(*it == "user" ? user : domain);
+            }
+         }
+      }
+      rc = execute(statement, params, &ret);
+   }
+   else
+   {
+      Data command;
+      {
+         DataStream ds(command);
+         Data escapedUser;
+         Data escapedDomain;
+         escapeString(user, escapedUser);
+         escapeString(domain, escapedDomain);
+         ds << "SELECT passwordHash FROM " << tableName(UserTable) << " WHERE username = '" << escapedUser << "' AND domain = '" << escapedDomain << "' ";
          ds << " UNION " << mCustomUserAuthQuery;
          ds.flush();
-         command.replace("$user", user);
-         command.replace("$domain", domain);
+         command.replace("$user", escapedUser);
+         command.replace("$domain", escapedDomain);
       }
+      rc = singleResultQuery(command, ret);
    }
 
-   if(singleResultQuery(command, ret) != 0 || ret.size() == 0)
+   if(rc != 0 || ret.size() == 0)
    {
       return Data::Empty;
    }
@@ -439,7 +600,7 @@ PostgreSqlDb::firstUserKey()
 
    if(mResult[UserTable] == 0)
    {
-      ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+      ErrLog( << "PostgreSQL query returned no result");
       return Data::Empty;
    }
    
@@ -514,7 +675,7 @@ PostgreSqlDb::getTlsPeerIdentity( const AbstractDb::Key& key ) const
  
    if (result==0)
    {
-      ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+      ErrLog( << "PostgreSQL query returned no result");
       return ret;
    }
 
@@ -555,7 +716,7 @@ PostgreSqlDb::firstTlsPeerIdentityKey()
 
    if(mResult[TlsPeerIdentityTable] == 0)
    {
-      ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+      ErrLog( << "PostgreSQL query returned no result");
       return Data::Empty;
    }
 
@@ -634,39 +795,23 @@ PostgreSqlDb::dbReadRecord(const Table table,
                       const resip::Data& pKey, 
                       resip::Data& pData) const
 { 
-   Data command;
-   Data escapedKey;
+   Data statement;
    {
-      DataStream ds(command);
+      DataStream ds(statement);
       ds << "SELECT value FROM " << tableName(table) 
-         << " WHERE attr='" << escapeString(pKey, escapedKey)
-         << "'";
-   }
-
-   PGresult* result = 0;
-   if(query(command, &result) != 0)
-   {
-      return false;
+         << " WHERE attr=$1";
    }
+   std::vector<Data> params;
+   params.push_back(pKey);
 
-   if (result == 0)
-   {
-      ErrLog( << "PostgreSQL result failed: " << PQerrorMessage(mConn));
-      return false;
-   }
-   else
+   std::vector<Data> fields;
+   bool success = execute(statement, params, &fields) == 0 && !fields.empty();
+   if(success)
    {
-      bool success = false;
-      if(PQntuples(result) > 0)
-      {
-         char *value = PQgetvalue(result, 0, 0);
-         pData = Data(Data::Share, value, (Data::size_type)strlen(value)).base64decode();
-         success = true;
-      }
-      PQclear(result);
-      StackLog(<<"query result: " << success);
-      return success;
+      pData = fields.front().base64decode();
    }
+   StackLog(<<"query result: " << success);
+   return success;
 }
 
 
@@ -696,7 +841,7 @@ PostgreSqlDb::dbNextKey(const Table table, bool first)
 
       if (mResult[table] == 0)
       {
-         ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+         ErrLog( << "PostgreSQL query returned no result");
          return Data::Empty;
       }
    }
@@ -761,7 +906,7 @@ PostgreSqlDb::dbNextRecord(const Table table,
 
       if (mResult[table] == 0)
       {
-         ErrLog( << "PostgreSQL failed: " << PQerrorMessage(mConn));
+         ErrLog( << "PostgreSQL query returned no result");
          return false;
       }
    }
@@ -788,12 +933,18 @@ PostgreSqlDb::dbNextRecord(const Table table,
 bool 
 PostgreSqlDb::dbBeginTransaction(const Table table)
 {
+   // the rest of the transaction must run on the same connection
+   pinConnection();
    Data command("SET SESSION CHARACTERISTICS AS TRANSACTION ISOLATION LEVEL REPEATABLE READ");
-   if(query(command, 0))
+   if(query(command, 0) == 0)
    {
       command = "BEGIN";
-      return query(command, 0);
+      if(query(command, 0) == 0)
+      {
+         return true;
+      }
    }
+   unpinConnection();
    return false;
 }
 
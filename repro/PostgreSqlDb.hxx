@@ -3,7 +3,10 @@
 
 #include <libpq-fe.h>
 
+#include <vector>
+
 #include "rutil/Data.hxx"
+#include "rutil/HashMap.hxx"
 #include "repro/SqlDb.hxx"
 
 namespace resip
@@ -59,11 +62,32 @@ class PostgreSqlDb: public SqlDb
                                 bool first=false);  // return false if no more
       virtual bool dbBeginTransaction(const Table table);
 
+      // A connection, and the names of the statements prepared on it, by
+      // SQL text.
+      class Connection
+      {
+         public:
+            Connection() : mConn(0) {}
+            PGconn* mConn;
+            typedef HashMap<resip::Data, resip::Data> StatementMap;
+            StatementMap mStatements;
+      };
+
       void initialize() const;
-      void disconnectFromDatabase() const;
-      int connectToDatabase() const;
+      void disconnectFromDatabase(unsigned int connection) const;
+      int connectToDatabase(unsigned int connection) const;
       int query(const resip::Data& queryCommand, PGresult** result) const;
       virtual int query(const resip::Data& queryCommand) const;
+      // Runs a statement with placeholders $1, $2... for params, preparing
+      // it on first use on each connection.  If fields is given, it gets the
+      // columns of the first row returned, if any.
+      int execute(const resip::Data& statement,
+                  const std::vector<resip::Data>& params,
+                  std::vector<resip::Data>* fields) const;
+      int executeOnConnection(Connection& conn,
+                              const resip::Data& statement,
+                              const std::vector<resip::Data>& params,
+                              std::vector<resip::Data>* fields) const;
       resip::Data& escapeString(const resip::Data& str, resip::Data& escapedStr) const;
 
       resip::Data mDBConnInfo;
@@ -73,8 +97,12 @@ class PostgreSqlDb: public SqlDb
       resip::Data mDBName;
       unsigned int mDBPort;
       resip::Data mCustomUserAuthQuery;
+      // mCustomUserAuthQuery with its tags as placeholders, if possible
+      resip::Data mCustomUserAuthStatement;
+      std::vector<resip::Data> mCustomUserAuthTags;
+      bool mCustomUserAuthPrepared;
 
-      mutable PGconn* mConn;
+      mutable std::vector<Connection> mConnections;
       mutable PGresult* mResult[MaxTable];
       mutable int mRow[MaxTable];
 
@@ -14,6 +14,7 @@
 
 #include "repro/RegSyncClient.hxx"
 #include "repro/RegSyncServer.hxx"
+#include "repro/RegSyncCodec.hxx"
 
 using namespace repro;
 using namespace resip;
@@ -24,11 +25,16 @@ using namespace std;
 RegSyncClient::RegSyncClient(InMemorySyncRegDb* regDb,
                              Data address,
                              unsigned short port,
-                             InMemorySyncPubDb* pubDb) :
+                             InMemorySyncPubDb* pubDb,
+                             bool binary) :
    mRegDb(regDb),
    mPubDb(pubDb),
    mAddress(address),
    mPort(port),
+   mBinary(binary),
+   mSequence(0),
+   mSynced(false),
+   mRxError(false),
    mSocketDesc(0)
 {
     resip_assert(mRegDb);
@@ -124,9 +130,23 @@ RegSyncClient::thread()
       Data request(
          "<InitialSync>\r\n"
          "  <Request>\r\n"
-         "     <Version>" + Data(REGSYNC_VERSION) + "</Version>\r\n"   // For use in detecting if client/server are a compatible version
+         "     <Version>" + Data(REGSYNC_VERSION) + "</Version>\r\n");   // For use in detecting if client/server are a compatible version
+      if(mBinary)
+      {
+         // Servers that don't know these elements send XML and a full sync
+         request += "     <Format>binary</Format>\r\n";
+         if(!mSession.empty())
+         {
+            request += "     <Session>" + mSession + "</Session>\r\n"
+                       "     <Sequence>" + Data(mSequence) + "</Sequence>\r\n";
+         }
+      }
+      request +=
          "  </Request>\r\n"
-         "</InitialSync>\r\n");   
+         "</InitialSync>\r\n";
+      mSynced = false;
+      mRxError = false;
+      mRxDataBuffer.clear();
       rc = ::send(mSocketDesc, request.c_str(), (int)request.size(), 0);
       if(rc < 0) 
       {
@@ -173,11 +193,17 @@ RegSyncClient::thread()
             {
                mRxDataBuffer += Data(Data::Borrow, (const char*)&mRxBuffer, rc);   
                while(tryParse());
+               if(mRxError)
+               {
+                  closeSocket(mSocketDesc);
+                  mSocketDesc = 0;
+                  break;
+               }
             }
          }
          else if(rc == 0) // timeout - send keepalive
          {
-            rc = ::send(mSocketDesc, Symbols::CRLFCRLF, (int)request.size(), 0);
+            rc = ::send(mSocketDesc, Symbols::CRLFCRLF, (int)strlen(Symbols::CRLFCRLF), 0);
             if(rc < 0) 
             {
                int e = getErrno();
@@ -212,6 +238,36 @@ RegSyncClient::thread()
 bool 
 RegSyncClient::tryParse()
 {
+   const char* pos = mRxDataBuffer.data();
+   const char* end = pos + mRxDataBuffer.size();
+   while(pos < end && isspace((unsigned char)*pos))
+   {
+      pos++;
+   }
+   if(pos < end && *pos == RegSyncCodec::FrameMarker)
+   {
+      size_t frameSize = 0;
+      if(!RegSyncCodec::frameSize(pos, end - pos, frameSize))
+      {
+         WarningLog(<< "RegSyncClient::tryParse: frame length over " << RegSyncCodec::MaxPayloadSize << " bytes, dropping connection");
+         mRxError = true;
+         mRxDataBuffer.clear();
+         return false;
+      }
+      if(frameSize == 0)
+      {
+         return false;  // wait for the rest of the frame
+      }
+      if(!handleFrame(pos, frameSize))
+      {
+         mRxError = true;
+         mRxDataBuffer.clear();
+         return false;
+      }
+      mRxDataBuffer = Data(pos + frameSize, (Data::size_type)(end - pos - frameSize));
+      return !mRxDataBuffer.empty();
+   }
+
    ParseBuffer pb(mRxDataBuffer);
    Data initialTag;
    const char* start = pb.position();
@@ -264,7 +320,7 @@ RegSyncClient::handleXml(const Data& xmlData)
       if(isEqualNoCase(xml.getTag(), "InitialSync"))
       {
          // Must be an InitialSync response
-         InfoLog(<< "RegSyncClient::handleXml: InitialSync complete.");
+         handleInitialSyncResponse(xml);
       }
       else if(isEqualNoCase(xml.getTag(), "reginfo"))
       {
@@ -299,6 +355,76 @@ RegSyncClient::handleXml(const Data& xmlData)
    }
 }
 
+bool
+RegSyncClient::handleFrame(const char* frame, size_t size)
+{
+   UInt64 sequence = 0;
+   RegSyncCodec::AorList aors;
+   if(!RegSyncCodec::decodeFrame(frame, size, Timer::getTimeSecs(), sequence, aors))
+   {
+      // We can't tell what was lost - start over with a full sync
+      ErrLog(<< "RegSyncClient::handleFrame: malformed frame, reconnecting");
+      mSession.clear();
+      return false;
+   }
+   DebugLog(<< "RegSyncClient::handleFrame: sequence=" << sequence << ", aors=" << aors.size());
+
+   for(RegSyncCodec::AorList::iterator it = aors.begin(); it != aors.end(); it++)
+   {
+      processModify(it->first, it->second);
+   }
+
+   // Changes sent after the sync completed arrive in sequence order
+   if(mSynced && sequence > mSequence)
+   {
+      mSequence = sequence;
+   }
+   return true;
+}
+
+void
+RegSyncClient::handleInitialSyncResponse(resip::XMLCursor& xml)
+{
+   Data session;
+   UInt64 sequence = 0;
+   if(xml.firstChild())
+   {
+      do
+      {
+         if(isEqualNoCase(xml.getTag(), "response") && xml.firstChild())
+         {
+            do
+            {
+               Data tag = xml.getTag();
+               if(xml.firstChild())
+               {
+                  if(isEqualNoCase(tag, "session"))
+                  {
+                     session = xml.getValue();
+                  }
+                  else if(isEqualNoCase(tag, "sequence"))
+                  {
+                     sequence = xml.getValue().convertUInt64();
+                  }
+                  xml.parent();
+               }
+            } while(xml.nextSibling());
+            xml.parent();
+         }
+      } while(xml.nextSibling());
+      xml.parent();
+   }
+
+   // Only servers sending binary events have a session
+   if(!session.empty())
+   {
+      mSession = session;
+      mSequence = sequence;
+      mSynced = true;
+   }
+   InfoLog(<< "RegSyncClient::handleXml: InitialSync complete." << (mSynced ? " session=" + mSession + " sequence=" + Data(mSequence) : Data::Empty));
+}
+
 void 
 RegSyncClient::handleRegInfoEvent(resip::XMLCursor& xml)
 {
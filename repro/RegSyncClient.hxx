@@ -16,7 +16,8 @@ public:
    RegSyncClient(resip::InMemorySyncRegDb* regDb,
                  resip::Data address,
                  unsigned short port,
-                 resip::InMemorySyncPubDb* pubDb = 0);
+                 resip::InMemorySyncPubDb* pubDb = 0,
+                 bool binary = true);
 
    virtual void thread();
    virtual void shutdown();
@@ -24,7 +25,9 @@ public:
 private: 
    void delaySeconds(unsigned int seconds);
    bool tryParse();  // returns true if we processed something and there is more data in the buffer
+   bool handleFrame(const char* frame, size_t size);
    void handleXml(const resip::Data& xmlData);
+   void handleInitialSyncResponse(resip::XMLCursor& xml);
    void handleRegInfoEvent(resip::XMLCursor& xml);
    void handlePubInfoEvent(resip::XMLCursor& xml);
    void processModify(const resip::Uri& aor, resip::ContactList& syncContacts);
@@ -33,6 +36,13 @@ private:
    resip::InMemorySyncPubDb* mPubDb;
    resip::Data mAddress;
    unsigned short mPort;
+   // Ask for binary events, and on reconnecting only for what changed
+   // since the session and sequence of the last completed sync
+   bool mBinary;
+   resip::Data mSession;
+   UInt64 mSequence;
+   bool mSynced;
+   bool mRxError;
    char mRxBuffer[8000];
    resip::Data mRxDataBuffer;
    int mSocketDesc;
@@ -0,0 +1,283 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <resip/stack/NameAddr.hxx>
+#include <resip/stack/Tuple.hxx>
+#include <rutil/BaseException.hxx>
+#include <rutil/ResipAssert.h>
+#include <rutil/Logger.hxx>
+
+#include "repro/RegSyncCodec.hxx"
+
+using namespace repro;
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
+
+static void
+put32(Data& out, UInt32 value)
+{
+   char buf[4];
+   buf[0] = (char)(value >> 24);
+   buf[1] = (char)(value >> 16);
+   buf[2] = (char)(value >> 8);
+   buf[3] = (char)value;
+   out.append(buf, sizeof(buf));
+}
+
+static void
+put64(Data& out, UInt64 value)
+{
+   put32(out, (UInt32)(value >> 32));
+   put32(out, (UInt32)value);
+}
+
+static void
+putData(Data& out, const Data& value)
+{
+   put32(out, (UInt32)value.size());
+   out.append(value.data(), value.size());
+}
+
+static UInt32
+get32(const char* p)
+{
+   const unsigned char* u = (const unsigned char*)p;
+   return ((UInt32)u[0] << 24) | ((UInt32)u[1] << 16) | ((UInt32)u[2] << 8) | (UInt32)u[3];
+}
+
+namespace
+{
+// Reads the fields of a frame payload; any read past the end leaves the
+// reader failed, and returns zero or empty values from then on.
+class Reader
+{
+public:
+   Reader(const char* p, size_t size) : mPos(p), mEnd(p + size), mOk(true) {}
+
+   bool ok() const { return mOk; }
+   bool atEnd() const { return mPos == mEnd; }
+
+   UInt32 get32()
+   {
+      if (!need(4))
+      {
+         return 0;
+      }
+      UInt32 value = ::get32(mPos);
+      mPos += 4;
+      return value;
+   }
+   UInt64 get64()
+   {
+      UInt64 high = get32();
+      return (high << 32) | get32();
+   }
+   Data getData()
+   {
+      UInt32 size = get32();
+      if (!need(size))
+      {
+         return Data::Empty;
+      }
+      Data value(mPos, size);
+      mPos += size;
+      return value;
+   }
+
+private:
+   bool need(size_t size)
+   {
+      if (mOk && (size_t)(mEnd - mPos) < size)
+      {
+         mOk = false;
+      }
+      return mOk;
+   }
+
+   const char* mPos;
+   const char* mEnd;
+   bool mOk;
+};
+}
+
+void
+RegSyncCodec::encodeAor(Data& payload, const Uri& aor, const ContactList& contacts, UInt64 now)
+{
+   putData(payload, Data::from(aor));
+   put32(payload, (UInt32)contacts.size());
+   for (ContactList::const_iterator it = contacts.begin(); it != contacts.end(); it++)
+   {
+      const ContactInstanceRecord& rec = *it;
+      putData(payload, Data::from(rec.mContact));
+      // If contact is expired or removed, then pass expires time as 0, otherwise send number of seconds until expirey
+      put64(payload, rec.mRegExpires <= now ? 0 : rec.mRegExpires - now);
+      put64(payload, now - rec.mLastUpdated);
+      Data receivedFrom;
+      if (rec.mReceivedFrom.getPort() != 0)
+      {
+         Tuple::writeBinaryToken(rec.mReceivedFrom, receivedFrom);
+      }
+      putData(payload, receivedFrom);
+      Data publicAddress;
+      if (rec.mPublicAddress.getType() != UNKNOWN_TRANSPORT)
+      {
+         Tuple::writeBinaryToken(rec.mPublicAddress, publicAddress);
+      }
+      putData(payload, publicAddress);
+      put32(payload, (UInt32)rec.mSipPath.size());
+      for (NameAddrs::const_iterator naIt = rec.mSipPath.begin(); naIt != rec.mSipPath.end(); naIt++)
+      {
+         putData(payload, Data::from(naIt->uri()));
+      }
+      putData(payload, rec.mInstance);
+      put32(payload, rec.mRegId);
+      putData(payload, rec.mUserAgent);
+   }
+}
+
+Data
+RegSyncCodec::encodeFrame(UInt64 sequence, UInt32 count, const Data& payload)
+{
+   Data frame((Data::size_type)(HeaderSize + 12 + payload.size()), Data::Preallocate);
+   frame += FrameMarker;
+   put32(frame, (UInt32)(12 + payload.size()));
+   put64(frame, sequence);
+   put32(frame, count);
+   frame += payload;
+   return frame;
+}
+
+bool
+RegSyncCodec::frameSize(const char* buffer, size_t size, size_t& frame)
+{
+   resip_assert(size > 0 && buffer[0] == FrameMarker);
+   frame = 0;
+   if (size < HeaderSize)
+   {
+      return true;
+   }
+   UInt32 payload = get32(buffer + 1);
+   if (payload > MaxPayloadSize)
+   {
+      return false;
+   }
+   if (HeaderSize + payload <= size)
+   {
+      frame = HeaderSize + payload;
+   }
+   return true;
+}
+
+bool
+RegSyncCodec::decodeFrame(const char* frame, size_t size, UInt64 now, UInt64& sequence, AorList& aors)
+{
+   Reader reader(frame + HeaderSize, size - HeaderSize);
+   sequence = reader.get64();
+   UInt32 count = reader.get32();
+   try
+   {
+      for (UInt32 i = 0; i < count && reader.ok(); i++)
+      {
+         Data aor = reader.getData();
+         if (!reader.ok())
+         {
+            break;
+         }
+         aors.push_back(std::make_pair(Uri(aor), ContactList()));
+         ContactList& contacts = aors.back().second;
+         UInt32 contactCount = reader.get32();
+         for (UInt32 c = 0; c < contactCount && reader.ok(); c++)
+         {
+            Data contact = reader.getData();
+            if (!reader.ok())
+            {
+               break;
+            }
+            ContactInstanceRecord rec;
+            rec.mContact = NameAddr(contact);
+            UInt64 expires = reader.get64();
+            rec.mRegExpires = (expires == 0 ? 0 : now + expires);
+            rec.mLastUpdated = now - reader.get64();
+            Data receivedFrom = reader.getData();
+            if (!receivedFrom.empty())
+            {
+               rec.mReceivedFrom = Tuple::makeTupleFromBinaryToken(receivedFrom);
+            }
+            Data publicAddress = reader.getData();
+            if (!publicAddress.empty())
+            {
+               rec.mPublicAddress = Tuple::makeTupleFromBinaryToken(publicAddress);
+            }
+            UInt32 pathCount = reader.get32();
+            for (UInt32 p = 0; p < pathCount && reader.ok(); p++)
+            {
+               rec.mSipPath.push_back(NameAddr(reader.getData()));
+            }
+            rec.mInstance = reader.getData();
+            rec.mRegId = reader.get32();
+            rec.mUserAgent = reader.getData();
+            rec.mSyncContact = true;  // This ContactInstanceRecord came from registration sync process
+            contacts.push_back(rec);
+         }
+      }
+   }
+   catch (BaseException& e)
+   {
+      WarningLog(<< "RegSyncCodec::decodeFrame: bad contact: " << e);
+      return false;
+   }
+   return reader.ok() && reader.atEnd();
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,103 @@
+#if !defined(RegSyncCodec_hxx)
+#define RegSyncCodec_hxx 
+
+#include <utility>
+#include <vector>
+
+#include <rutil/Data.hxx>
+#include <resip/stack/Uri.hxx>
+#include <resip/dum/ContactInstanceRecord.hxx>
+
+namespace repro
+{
+
+/**
+   Binary encoding of registration bindings for RegSync, used instead of
+   the <reginfo> XML events once both ends have agreed on it in the
+   InitialSync request.
+
+   Each frame is a marker byte (which can never start an XML message),
+   a 32 bit payload length, then the payload: the sequence number of the
+   change (0 for frames sent as part of an initial sync), the number of
+   AORs, and for each AOR its URI and bindings.  Integers are in network
+   byte order and strings are length prefixed.  As in the XML events,
+   expiry and update times are sent relative to the sender's clock.
+*/
+class RegSyncCodec
+{
+public:
+   static const char FrameMarker = '\x01';
+   static const size_t HeaderSize = 5;
+   // far more than the server ever puts in one frame; a longer frame
+   // length means the stream is corrupt
+   static const size_t MaxPayloadSize = 16 * 1024 * 1024;
+
+   typedef std::vector<std::pair<resip::Uri, resip::ContactList> > AorList;
+
+   // appends an AOR and its bindings to a frame payload being built
+   static void encodeAor(resip::Data& payload, const resip::Uri& aor, const resip::ContactList& contacts, UInt64 now);
+   // returns the frame for a payload holding count AORs
+   static resip::Data encodeFrame(UInt64 sequence, UInt32 count, const resip::Data& payload);
+
+   // sets frame to the size of the frame at the start of buffer, or 0 if
+   // it has not all arrived yet; returns false if the frame claims to be
+   // longer than MaxPayloadSize.  buffer must start with FrameMarker.
+   static bool frameSize(const char* buffer, size_t size, size_t& frame);
+   // decodes a whole frame; returns false if it is malformed.  The
+   // decoded bindings are marked as having come from a sync.
+   static bool decodeFrame(const char* frame, size_t size, UInt64 now, UInt64& sequence, AorList& aors);
+};
+
+}
+
+#endif  
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
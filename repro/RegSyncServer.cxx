@@ -11,6 +11,7 @@
 #include <rutil/DnsUtil.hxx>
 #include <rutil/Logger.hxx>
 #include <rutil/ParseBuffer.hxx>
+#include <rutil/Random.hxx>
 #include <rutil/Socket.hxx>
 #include <rutil/TransportType.hxx>
 #include <rutil/Timer.hxx>
@@ -18,6 +19,7 @@
 #include "repro/XmlRpcServerBase.hxx"
 #include "repro/XmlRpcConnection.hxx"
 #include "repro/RegSyncServer.hxx"
+#include "repro/RegSyncCodec.hxx"
 
 using namespace repro;
 using namespace resip;
@@ -32,7 +34,12 @@ RegSyncServer::RegSyncServer(resip::InMemorySyncRegDb* regDb,
                              resip::InMemorySyncPubDb* pubDb) :
    XmlRpcServerBase(port, version),
    mRegDb(regDb),
-   mPubDb(pubDb)
+   mPubDb(pubDb),
+   mSession(Random::getRandomHex(8)),
+   mSequence(0),
+   mForgottenSequence(0),
+   mBatchConnectionId(0),
+   mBatchCount(0)
 {
    if (mRegDb)
    {
@@ -49,7 +56,12 @@ RegSyncServer::RegSyncServer(resip::InMemorySyncRegDb* regDb,
                              resip::InMemorySyncPubDb* pubDb) :
    XmlRpcServerBase(brokerQueue),
    mRegDb(regDb),
-   mPubDb(pubDb)
+   mPubDb(pubDb),
+   mSession(Random::getRandomHex(8)),
+   mSequence(0),
+   mForgottenSequence(0),
+   mBatchConnectionId(0),
+   mBatchCount(0)
 {
    if (mRegDb)
    {
@@ -97,6 +109,16 @@ RegSyncServer::sendRegistrationModifiedEvent(unsigned int connectionId, const re
 
 void 
 RegSyncServer::sendRegistrationModifiedEvent(unsigned int connectionId, const resip::Uri& aor, const ContactList& contacts)
+{
+   Data regInfo = buildRegInfo(aor, contacts);
+   if(!regInfo.empty())
+   {
+      sendEvent(connectionId, regInfo);
+   }
+}
+
+Data
+RegSyncServer::buildRegInfo(const resip::Uri& aor, const ContactList& contacts)
 {
    std::stringstream ss;
    bool infoFound = false;
@@ -107,8 +129,7 @@ RegSyncServer::sendRegistrationModifiedEvent(unsigned int connectionId, const re
    for(; cit != contacts.end(); cit++)
    {
       const ContactInstanceRecord& rec = *cit;
-      if(!rec.mReceivedFrom.onlyUseExistingConnection &&
-          rec.mRegExpires != NeverExpire)  // Don't sync over static registrations
+      if(isSynced(rec))
       {
           streamContactInstanceRecord(ss, rec);
           infoFound = true;
@@ -116,10 +137,14 @@ RegSyncServer::sendRegistrationModifiedEvent(unsigned int connectionId, const re
    }
    ss << "</reginfo>" << Symbols::CRLF;
 
-   if(infoFound)
-   {
-      sendEvent(connectionId, ss.str().c_str());
-   }
+   return infoFound ? Data(ss.str().c_str()) : Data::Empty;
+}
+
+bool
+RegSyncServer::isSynced(const ContactInstanceRecord& rec)
+{
+   return !rec.mReceivedFrom.onlyUseExistingConnection &&
+          rec.mRegExpires != NeverExpire;  // Don't sync over static registrations
 }
 
 void 
@@ -251,22 +276,42 @@ RegSyncServer::handleInitialSyncRequest(unsigned int connectionId, unsigned int
 {
    InfoLog(<< "RegSyncServer::handleInitialSyncRequest");
 
-   // Check for correct Version
+   // Check for correct Version.  Peers that can take binary events say
+   // so after the version, which older versions of this server ignore.
    unsigned int version = 0;
+   bool binary = false;
+   Data session;
+   UInt64 sequence = 0;
    if(xml.firstChild())
    {
       if(isEqualNoCase(xml.getTag(), "request"))
       {
          if(xml.firstChild())
          {
-            if(isEqualNoCase(xml.getTag(), "version"))
+            do
             {
+               Data tag = xml.getTag();
                if(xml.firstChild())
                {
-                  version = xml.getValue().convertUnsignedLong();
+                  if(isEqualNoCase(tag, "version"))
+                  {
+                     version = xml.getValue().convertUnsignedLong();
+                  }
+                  else if(isEqualNoCase(tag, "format"))
+                  {
+                     binary = isEqualNoCase(xml.getValue(), "binary");
+                  }
+                  else if(isEqualNoCase(tag, "session"))
+                  {
+                     session = xml.getValue();
+                  }
+                  else if(isEqualNoCase(tag, "sequence"))
+                  {
+                     sequence = xml.getValue().convertUInt64();
+                  }
                   xml.parent();
                }
-            }
+            } while(xml.nextSibling());
             xml.parent();
          }
       }
@@ -275,15 +320,29 @@ RegSyncServer::handleInitialSyncRequest(unsigned int connectionId, unsigned int
 
    if(version == REGSYNC_VERSION)
    {
+      Data responseData;
       if (mRegDb)
       {
-         mRegDb->initialSync(connectionId);
+         if (binary)
+         {
+            UInt64 synced = binarySync(connectionId, session, sequence);
+            responseData = "    <Session>" + mSession + "</Session>" + Symbols::CRLF +
+                           "    <Sequence>" + Data(synced) + "</Sequence>" + Symbols::CRLF;
+         }
+         else
+         {
+            {
+               Lock lock(mSyncMutex);
+               mXmlConnections.insert(connectionId);
+            }
+            mRegDb->initialSync(connectionId);
+         }
       }
       if (mPubDb)
       {
          mPubDb->initialSync(connectionId);
       }
-      sendResponse(connectionId, requestId, Data::Empty, 200, "Initial Sync Completed.");
+      sendResponse(connectionId, requestId, responseData, 200, "Initial Sync Completed.");
    }
    else
    {
@@ -333,16 +392,227 @@ RegSyncServer::streamContactInstanceRecord(std::stringstream& ss, const ContactI
     ss << "   </contactinfo>" << Symbols::CRLF;
 }
 
+UInt64
+RegSyncServer::binarySync(unsigned int connectionId, const Data& session, UInt64 sequence)
+{
+   UInt64 synced;
+   bool incremental;
+   std::vector<Data> changed;
+   {
+      Lock lock(mSyncMutex);
+      mSyncingConnections.insert(connectionId);
+      synced = mSequence;
+      incremental = (session == mSession && sequence <= mSequence && sequence >= mForgottenSequence);
+      if (incremental)
+      {
+         changedSince(sequence, changed);
+      }
+   }
+
+   mBatchConnectionId = connectionId;
+   if (incremental)
+   {
+      InfoLog(<< "RegSyncServer::binarySync: sending " << changed.size() << " AORs changed since sequence " << sequence);
+      batchChanged(changed, synced);
+   }
+   else
+   {
+      InfoLog(<< "RegSyncServer::binarySync: sending all AORs");
+      mRegDb->initialSync(connectionId);  // each AOR comes back through onInitialSyncAor
+   }
+   flushBatch();
+
+   // The peer is only sent live changes once everything batched for it is
+   // queued, or a live change could overtake an older copy of the same AOR.
+   // Changes made while the batch was built are sent again, read afresh,
+   // until none come in between; from then on they are sent as they happen.
+   for (;;)
+   {
+      changed.clear();
+      {
+         Lock lock(mSyncMutex);
+         changedSince(synced, changed);
+         if (changed.empty())
+         {
+            mSyncingConnections.erase(connectionId);
+            mBinaryConnections.insert(connectionId);
+            synced = mSequence;
+            break;
+         }
+         synced = mSequence;
+      }
+      InfoLog(<< "RegSyncServer::binarySync: resending " << changed.size() << " AORs changed during the sync");
+      batchChanged(changed, synced);
+      flushBatch();
+   }
+   mBatchConnectionId = 0;
+   return synced;
+}
+
+void
+RegSyncServer::batchChanged(const std::vector<Data>& changed, UInt64 listed)
+{
+   for (std::vector<Data>::const_iterator it = changed.begin(); it != changed.end(); it++)
+   {
+      Uri aor(*it);
+      ContactList contacts;
+      mRegDb->getContactsFull(aor, contacts);
+      if (contacts.empty())
+      {
+         // The AOR is gone, lingering bindings and all; nothing to remember it for
+         Lock lock(mSyncMutex);
+         AorSequenceMap::iterator seq = mAorSequences.find(*it);
+         if (seq != mAorSequences.end() && seq->second <= listed)
+         {
+            mSequenceAors.erase(seq->second);
+            mAorSequences.erase(seq);
+         }
+         continue;
+      }
+      batchAor(aor, contacts);
+   }
+}
+
+void
+RegSyncServer::recordChange(const Data& aor, UInt64 sequence)
+{
+   AorSequenceMap::iterator it = mAorSequences.find(aor);
+   if (it != mAorSequences.end())
+   {
+      mSequenceAors.erase(it->second);
+      it->second = sequence;
+   }
+   else
+   {
+      mAorSequences[aor] = sequence;
+   }
+   mSequenceAors[sequence] = aor;
+
+   while (mSequenceAors.size() > MaxAorSequences)
+   {
+      SequenceAorMap::iterator oldest = mSequenceAors.begin();
+      mForgottenSequence = oldest->first;
+      mAorSequences.erase(oldest->second);
+      mSequenceAors.erase(oldest);
+   }
+}
+
+void
+RegSyncServer::changedSince(UInt64 sequence, std::vector<Data>& changed) const
+{
+   for (SequenceAorMap::const_iterator it = mSequenceAors.upper_bound(sequence); it != mSequenceAors.end(); it++)
+   {
+      changed.push_back(it->second);
+   }
+}
+
+void
+RegSyncServer::batchAor(const resip::Uri& aor, const ContactList& contacts)
+{
+   UInt64 now = Timer::getTimeSecs();
+   ContactList synced;
+   for (ContactList::const_iterator it = contacts.begin(); it != contacts.end(); it++)
+   {
+      if (isSynced(*it))
+      {
+         synced.push_back(*it);
+      }
+   }
+   if (synced.empty())
+   {
+      return;
+   }
+
+   RegSyncCodec::encodeAor(mBatch, aor, synced, now);
+   mBatchCount++;
+   if (mBatch.size() >= BatchSize)
+   {
+      flushBatch();
+   }
+}
+
+void
+RegSyncServer::flushBatch()
+{
+   if (mBatchCount > 0)
+   {
+      sendEvent(mBatchConnectionId, RegSyncCodec::encodeFrame(0, mBatchCount, mBatch));
+      mBatch.clear();
+      mBatchCount = 0;
+   }
+}
+
+void 
+RegSyncServer::onConnectionClosed(unsigned int connectionId)
+{
+   Lock lock(mSyncMutex);
+   mXmlConnections.erase(connectionId);
+   mBinaryConnections.erase(connectionId);
+   mSyncingConnections.erase(connectionId);
+}
+
 void 
 RegSyncServer::onAorModified(const resip::Uri& aor, const ContactList& contacts)
 {
-   sendRegistrationModifiedEvent(0, aor, contacts);
+   Data aorData = Data::from(aor);
+   std::set<unsigned int> xmlConnections;
+   {
+      Lock lock(mSyncMutex);
+      UInt64 sequence = ++mSequence;
+      recordChange(aorData, sequence);
+      if (mBinaryConnections.empty() && mSyncingConnections.empty())
+      {
+         xmlConnections.insert(0);  // send to all connections, as before there were binary ones
+      }
+      else
+      {
+         ContactList synced;
+         for (ContactList::const_iterator it = contacts.begin(); it != contacts.end(); it++)
+         {
+            if (isSynced(*it))
+            {
+               synced.push_back(*it);
+            }
+         }
+         if (!synced.empty())
+         {
+            Data payload;
+            RegSyncCodec::encodeAor(payload, aor, synced, Timer::getTimeSecs());
+            // queued under the lock, so that each peer gets changes in sequence order
+            Data frame = RegSyncCodec::encodeFrame(sequence, 1, payload);
+            for (std::set<unsigned int>::const_iterator it = mBinaryConnections.begin(); it != mBinaryConnections.end(); it++)
+            {
+               sendEvent(*it, frame);
+            }
+         }
+         xmlConnections = mXmlConnections;
+      }
+   }
+
+   if (!xmlConnections.empty())
+   {
+      Data regInfo = buildRegInfo(aor, contacts);
+      if (!regInfo.empty())
+      {
+         for (std::set<unsigned int>::const_iterator it = xmlConnections.begin(); it != xmlConnections.end(); it++)
+         {
+            sendEvent(*it, regInfo);
+         }
+      }
+   }
 }
 
 void 
 RegSyncServer::onInitialSyncAor(unsigned int connectionId, const resip::Uri& aor, const ContactList& contacts)
 {
-   sendRegistrationModifiedEvent(connectionId, aor, contacts);
+   if (connectionId == mBatchConnectionId)
+   {
+      batchAor(aor, contacts);
+   }
+   else
+   {
+      sendRegistrationModifiedEvent(connectionId, aor, contacts);
+   }
 }
 
 void 
@@ -1,7 +1,13 @@
 #if !defined(RegSyncServer_hxx)
 #define RegSyncServer_hxx 
 
+#include <map>
+#include <set>
+#include <vector>
+
 #include <rutil/Data.hxx>
+#include <rutil/HashMap.hxx>
+#include <rutil/Mutex.hxx>
 #include <rutil/TransportType.hxx>
 #include <rutil/XMLCursor.hxx>
 #include <resip/dum/InMemorySyncRegDb.hxx>
@@ -43,6 +49,7 @@ public:
 
 protected:
    virtual void handleRequest(unsigned int connectionId, unsigned int requestId, const resip::Data& request); 
+   virtual void onConnectionClosed(unsigned int connectionId);
 
    // InMemorySyncRegDbHandler methods
    virtual void onAorModified(const resip::Uri& aor, const resip::ContactList& contacts);
@@ -55,10 +62,49 @@ protected:
 
 private: 
    void handleInitialSyncRequest(unsigned int connectionId, unsigned int requestId, resip::XMLCursor& xml);
+   // returns the <reginfo> event for an AOR, or empty if nothing in it is synced
+   resip::Data buildRegInfo(const resip::Uri& aor, const resip::ContactList& contacts);
    void streamContactInstanceRecord(std::stringstream& ss, const resip::ContactInstanceRecord& rec);
+   static bool isSynced(const resip::ContactInstanceRecord& rec);
+
+   // Binary syncs (see RegSyncCodec): returns the sequence number the peer
+   // is up to date with once the frames queued for it are sent
+   UInt64 binarySync(unsigned int connectionId, const resip::Data& session, UInt64 sequence);
+   // reads and batches the AORs listed as changed up to sequence listed
+   void batchChanged(const std::vector<resip::Data>& changed, UInt64 listed);
+   void batchAor(const resip::Uri& aor, const resip::ContactList& contacts);
+   void flushBatch();
+   // must hold mSyncMutex
+   void recordChange(const resip::Data& aor, UInt64 sequence);
+   void changedSince(UInt64 sequence, std::vector<resip::Data>& changed) const;
 
    resip::InMemorySyncRegDb* mRegDb;
    resip::InMemorySyncPubDb* mPubDb;
+
+   // Every change to an AOR that is synced is given the next sequence
+   // number.  A peer reconnecting with the session and sequence of its last
+   // completed sync is only sent the AORs changed since.  Only the last
+   // MaxAorSequences changed AORs are remembered; a peer that is further
+   // behind than that gets a full sync.
+   resip::Mutex mSyncMutex;
+   resip::Data mSession;
+   UInt64 mSequence;
+   typedef HashMap<resip::Data, UInt64> AorSequenceMap;
+   AorSequenceMap mAorSequences;  // last change to each AOR
+   typedef std::map<UInt64, resip::Data> SequenceAorMap;
+   SequenceAorMap mSequenceAors;  // the same, by sequence
+   UInt64 mForgottenSequence;     // changes up to here may have been dropped
+   static const size_t MaxAorSequences = 100000;
+   std::set<unsigned int> mXmlConnections;
+   std::set<unsigned int> mBinaryConnections;
+   std::set<unsigned int> mSyncingConnections;  // binary, not yet sent live changes
+
+   // AORs for the binary sync in progress, sent in frames of about
+   // BatchSize bytes; only used from the server thread
+   static const size_t BatchSize = 64 * 1024;
+   unsigned int mBatchConnectionId;
+   resip::Data mBatch;
+   UInt32 mBatchCount;
 };
 
 }
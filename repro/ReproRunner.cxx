@@ -335,6 +335,14 @@ ReproRunner::run(int argc, char** argv)
                    mProxyConfig->getConfigData("LogFilename", "repro.log", true).c_str(),
                    isEqualNoCase(loggingType, "file") ? &g_ReproLogger : 0, // if logging to file then write WARNINGS, and Errors to console still
                    syslogFacilityName, loggingMessageStructure, loggingInstanceName);
+   if(mProxyConfig->getConfigBool("AsyncLogging", false))
+   {
+      Log::startAsyncWriter(mProxyConfig->getConfigUnsignedLong("AsyncLoggingBufferSize", 262144));
+   }
+   else
+   {
+      Log::stopAsyncWriter();  // may have been turned off for a restart
+   }
 
    InfoLog( << "Starting repro version " << VersionUtils::instance().releaseVersion() << "...");
 
@@ -515,6 +523,11 @@ ReproRunner::shutdown()
    mSipStack->setCongestionManager(0);
 
    cleanupObjects();
+   if(!mRestarting)
+   {
+      // writes out whatever is still queued
+      Log::stopAsyncWriter();
+   }
    mRunning = false;
 }
 
@@ -812,6 +825,11 @@ ReproRunner::createSipStack()
       mSipStack->setEnumDomains(enumDomains);
    }
 
+   // Refresh busy DNS cache entries before they expire, and optionally keep
+   // serving expired ones while they are being refreshed
+   mSipStack->getDnsStub().setDnsCachePrefetch(mProxyConfig->getConfigInt("DNSCachePrefetch", 0));
+   mSipStack->getDnsStub().setDnsCacheServeStale(mProxyConfig->getConfigInt("DNSCacheServeStale", 0));
+
    // Add External Stats handler
    mSipStack->setExternalStatsHandler(this);
 
@@ -910,6 +928,7 @@ ReproRunner::createSipStack()
    {
       mSipStack->statisticsManagerEnabled() = false;
    }
+   mSipStack->setTransactionShards(mProxyConfig->getConfigUnsignedLong("TransactionShards", 1));
 
    // Create Congestion Manager, if required
    resip_assert(!mCongestionManager);
@@ -1023,6 +1042,10 @@ ReproRunner::createDatastore()
       return false;
    }
    mProxyConfig->createDataStore(mAbstractDb, mRuntimeAbstractDb);
+   mProxyConfig->getDataStore()->mUserStore.setAuthCacheLimits(
+      mProxyConfig->getConfigUnsignedLong("AuthCacheSize", 0),
+      mProxyConfig->getConfigUnsignedLong("AuthCacheTTL", 60),
+      mProxyConfig->getConfigUnsignedLong("AuthCacheNegativeTTL", 10));
 
    // Create ImMemory Registration Database
    mRegSyncPort = mProxyConfig->getConfigInt("RegSyncPort", 0);
@@ -1460,7 +1483,8 @@ ReproRunner::createRegSync()
          }
          mRegSyncClient = new RegSyncClient(dynamic_cast<InMemorySyncRegDb*>(mRegistrationPersistenceManager),
                                             regSyncPeerAddress, remoteRegSyncPort,
-                                            enablePublicationReplication ? dynamic_cast<InMemorySyncPubDb*>(mPublicationPersistenceManager) : 0);
+                                            enablePublicationReplication ? dynamic_cast<InMemorySyncPubDb*>(mPublicationPersistenceManager) : 0,
+                                            mProxyConfig->getConfigBool("RegSyncBinary", true));
       }
    }
    Data regSyncBrokerTopic = mProxyConfig->getConfigData("RegSyncBrokerTopic", Data::Empty);
@@ -1670,6 +1694,7 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
          // Transport1TlsClientVerification = None
          // Transport1RecordRouteUri = sip:sipdomain.com;transport=TLS
          // Transport1RcvBufLen = 2000
+         // Transport1Shards = 4
 
          allTransportsSpecifyRecordRoute = true;
 
@@ -1753,7 +1778,9 @@ ReproRunner::addTransports(bool& allTransportsSpecifyRecordRoute)
                                  tlsCertificate, tlsPrivateKey,
                                  cvm,          // tls client verification mode
                                  useEmailAsSIP,
-                                 basicWsConnectionValidator, wsCookieContextFactory);
+                                 basicWsConnectionValidator, wsCookieContextFactory,
+                                 Data::Empty,  // netNs
+                                 tc.getConfigUnsignedShort("Shards", 1));
 
                if (t)
                {
@@ -0,0 +1,414 @@
+#include <algorithm>
+
+#include "rutil/DataStream.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ParseBuffer.hxx"
+#include "resip/stack/Uri.hxx"
+
+#include "repro/RouteMatcher.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
+
+// Characters with a special meaning in a POSIX extended regular expression.
+static bool
+isSpecial(char c)
+{
+   return strchr(".[]()*+?{}|^$\\", c) != 0;
+}
+
+static bool
+isQuantifier(char c)
+{
+   return c == '*' || c == '+' || c == '?' || c == '{';
+}
+
+RouteMatcher::Route::Route(const AbstractDb::RouteRecord& record) :
+   mRecord(record),
+   mRegex(0),
+   mSubstitute(record.mRewriteExpression.find("$") != Data::npos)
+{
+   if (mRecord.mMatchingPattern.empty())
+   {
+      return;
+   }
+
+   int flags = REG_EXTENDED;
+   if (!mSubstitute)
+   {
+      flags |= REG_NOSUB;
+   }
+   mRegex = new regex_t;
+   int ret = regcomp(mRegex, mRecord.mMatchingPattern.c_str(), flags);
+   if (ret != 0)
+   {
+      delete mRegex;
+      mRegex = 0;
+      ErrLog(<< "Routing rule has invalid match expression: "
+             << mRecord.mMatchingPattern);
+      return;
+   }
+
+   mPrefix = literalPrefix(mRecord.mMatchingPattern);
+   mSuffix = literalSuffix(mRecord.mMatchingPattern);
+}
+
+RouteMatcher::Route::~Route()
+{
+   if (mRegex)
+   {
+      regfree(mRegex);
+      delete mRegex;
+   }
+}
+
+// The literal text a match must start with: whatever follows a leading '^'
+// up to the first special character. A character followed by a quantifier
+// is optional (or repeated) and ends the literal before it. Patterns with
+// an alternation anywhere are left alone, since "^a|b" need not start
+// with "a".
+Data
+RouteMatcher::Route::literalPrefix(const Data& pattern)
+{
+   if (pattern.empty() || pattern[0] != '^' || pattern.find("|") != Data::npos)
+   {
+      return Data::Empty;
+   }
+
+   Data literal;
+   Data::size_type i = 1;
+   while (i < pattern.size())
+   {
+      char c = pattern[i];
+      Data::size_type next = i + 1;
+      if (c == '\\')
+      {
+         // only an escaped special character is certain to be a literal;
+         // GNU regex gives others, such as \w or \<, a meaning of their own
+         if (next >= pattern.size() || !isSpecial(pattern[next]))
+         {
+            break;
+         }
+         c = pattern[next];
+         ++next;
+      }
+      else if (isSpecial(c))
+      {
+         break;
+      }
+
+      if (next < pattern.size() && isQuantifier(pattern[next]))
+      {
+         if (pattern[next] == '+')
+         {
+            literal += c;
+         }
+         break;
+      }
+      literal += c;
+      i = next;
+   }
+   return literal;
+}
+
+// The literal text a match must end with: whatever precedes a trailing
+// '$' back to the nearest special character.
+Data
+RouteMatcher::Route::literalSuffix(const Data& pattern)
+{
+   Data::size_type size = pattern.size();
+   if (size < 2 || pattern[size - 1] != '$' || pattern[size - 2] == '\\' ||
+       pattern.find("|") != Data::npos)
+   {
+      return Data::Empty;
+   }
+
+   Data::size_type start = size - 1;
+   while (start > 0)
+   {
+      char c = pattern[start - 1];
+      if (start >= 2 && pattern[start - 2] == '\\')
+      {
+         // an escaped character; give up on anything unclear, such as an
+         // escaped backslash, a class like \w or a word boundary like \>
+         if (c == '\\' || !isSpecial(c) ||
+             (start >= 3 && pattern[start - 3] == '\\'))
+         {
+            break;
+         }
+         start -= 2;
+         continue;
+      }
+      if (isSpecial(c))
+      {
+         break;
+      }
+      --start;
+   }
+
+   Data literal;
+   for (Data::size_type i = start; i < size - 1; ++i)
+   {
+      if (pattern[i] == '\\')
+      {
+         ++i;
+      }
+      literal += pattern[i];
+   }
+   return literal;
+}
+
+void
+RouteMatcher::Route::process(const Data& uri, UriList& targets) const
+{
+   const Data& rewrite = mRecord.mRewriteExpression;
+   const Data& match = mRecord.mMatchingPattern;
+
+   const int nmatch=10;
+   regmatch_t pmatch[nmatch];
+
+   int ret = regexec(mRegex, uri.c_str(), nmatch, pmatch, 0/*eflags*/);
+   if ( ret != 0 )
+   {
+      // did not match
+      DebugLog( << "  Skipped - request URI "<< uri << " did not match " << match );
+      return;
+   }
+
+   DebugLog( << "  Route matched" );
+   Data target = rewrite;
+
+   if ( mSubstitute )
+   {
+      for ( int i=1; i<nmatch; i++)
+      {
+         if ( pmatch[i].rm_so != -1 )
+         {
+            Data subExp(uri.substr(pmatch[i].rm_so,
+                                   pmatch[i].rm_eo-pmatch[i].rm_so));
+            DebugLog( << "  subExpression[" <<i <<"]="<< subExp );
+
+            Data result;
+            {
+               DataStream s(result);
+
+               ParseBuffer pb(target);
+
+               while (true)
+               {
+                  const char* a = pb.position();
+                  pb.skipToChars( Data("$") + char('0'+i) );
+                  if ( pb.eof() )
+                  {
+                     s << pb.data(a);
+                     break;
+                  }
+                  else
+                  {
+                     s << pb.data(a);
+                     pb.skipN(2);
+                     s <<  subExp;
+                  }
+               }
+               s.flush();
+            }
+            target = result;
+         }
+      }
+   }
+
+   Uri targetUri;
+   try
+   {
+      targetUri = Uri(target);
+   }
+   catch( BaseException& )
+   {
+      ErrLog( << "Routing rule transform " << rewrite << " gave invalid URI " << target );
+      try
+      {
+         targetUri = Uri( Data("sip:")+target);
+      }
+      catch( BaseException& )
+      {
+         ErrLog( << "Routing rule transform " << rewrite << " gave invalid URI sip:" << target );
+         return;
+      }
+   }
+   targets.push_back( targetUri );
+}
+
+RouteMatcher::RouteMatcher(const RouteList& routes) :
+   mRoutes(routes)
+{
+   for (size_t i = 0; i < mRoutes.size(); ++i)
+   {
+      const Route& route = *mRoutes[i];
+      if (!route.valid())
+      {
+         continue;
+      }
+
+      // file the route under the longer of its literals
+      if (!route.prefix().empty() && route.prefix().size() >= route.suffix().size())
+      {
+         mPrefixes[route.prefix()].push_back(i);
+      }
+      else if (!route.suffix().empty())
+      {
+         mSuffixes[route.suffix()].push_back(i);
+      }
+      else
+      {
+         mUnindexed.push_back(i);
+      }
+   }
+
+   for (LiteralIndex::const_iterator it = mPrefixes.begin(); it != mPrefixes.end(); ++it)
+   {
+      mPrefixLengths.push_back(it->first.size());
+   }
+   sort(mPrefixLengths.begin(), mPrefixLengths.end());
+   mPrefixLengths.erase(unique(mPrefixLengths.begin(), mPrefixLengths.end()), mPrefixLengths.end());
+
+   for (LiteralIndex::const_iterator it = mSuffixes.begin(); it != mSuffixes.end(); ++it)
+   {
+      mSuffixLengths.push_back(it->first.size());
+   }
+   sort(mSuffixLengths.begin(), mSuffixLengths.end());
+   mSuffixLengths.erase(unique(mSuffixLengths.begin(), mSuffixLengths.end()), mSuffixLengths.end());
+
+   DebugLog(<< "Compiled " << mRoutes.size() << " routes: " << mPrefixes.size()
+            << " prefixes, " << mSuffixes.size() << " suffixes, "
+            << mUnindexed.size() << " unindexed");
+}
+
+void
+RouteMatcher::lookup(const LiteralIndex& index,
+                     const vector<Data::size_type>& lengths,
+                     const Data& uri,
+                     bool prefix,
+                     Positions& candidates)
+{
+   for (vector<Data::size_type>::const_iterator length = lengths.begin();
+        length != lengths.end() && *length <= uri.size(); ++length)
+   {
+      const char* start = prefix ? uri.data() : uri.data() + uri.size() - *length;
+      LiteralIndex::const_iterator it = index.find(Data(Data::Share, start, *length));
+      if (it != index.end())
+      {
+         candidates.insert(candidates.end(), it->second.begin(), it->second.end());
+      }
+   }
+}
+
+RouteMatcher::UriList
+RouteMatcher::process(const Uri& ruri,
+                      const Data& method,
+                      const Data& event) const
+{
+   UriList targetSet;
+   if (mRoutes.empty())
+   {
+      return targetSet;
+   }
+
+   Data uri;
+   {
+      DataStream s(uri);
+      s << ruri;
+      s.flush();
+   }
+
+   Positions candidates(mUnindexed);
+   lookup(mPrefixes, mPrefixLengths, uri, true, candidates);
+   lookup(mSuffixes, mSuffixLengths, uri, false, candidates);
+   // every route is in one list only; restore the route order
+   sort(candidates.begin(), candidates.end());
+
+   for (Positions::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+   {
+      const Route& route = *mRoutes[*it];
+      const AbstractDb::RouteRecord& rec = route.record();
+
+      DebugLog( << "Consider route " << rec.mMatchingPattern
+                << " reqUri=" << ruri
+                << " method=" << method
+                << " event=" << event );
+
+      if(!rec.mMethod.empty())
+      {
+         if(!isEqualNoCase(rec.mMethod,method))
+         {
+            DebugLog( << "  Skipped - method did not match" );
+            continue;
+         }
+      }
+      if(!rec.mEvent.empty())
+      {
+         if(!isEqualNoCase(rec.mEvent, event))
+         {
+            DebugLog( << "  Skipped - event did not match" );
+            continue;
+         }
+      }
+
+      route.process(uri, targetSet);
+   }
+
+   return targetSet;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
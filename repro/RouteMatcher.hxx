@@ -0,0 +1,162 @@
+#if !defined(REPRO_ROUTEMATCHER_HXX)
+#define REPRO_ROUTEMATCHER_HXX
+
+#ifdef WIN32
+#include <pcreposix.h>
+#else
+#include <regex.h>
+#endif
+
+#include <memory>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/HashMap.hxx"
+#include "resip/stack/Uri.hxx"
+
+#include "repro/AbstractDb.hxx"
+
+namespace repro
+{
+
+/**
+   @brief An immutable, compiled form of the static route table.
+
+   Each route's matching pattern is compiled once. Where the pattern
+   starts with a literal after '^', or ends with a literal before '$',
+   the route is indexed under that literal. process() then only has to
+   run the regular expressions of the routes whose literal occurs at the
+   start or end of the request URI, plus those that could not be indexed.
+   The result is the same as trying every route in order.
+
+   Since a RouteMatcher never changes once built, any number of threads
+   may call process() concurrently without locking; RouteStore builds a
+   new one whenever the routes change.
+*/
+class RouteMatcher
+{
+   public:
+      typedef std::vector<resip::Uri> UriList;
+
+      class Route
+      {
+         public:
+            explicit Route(const AbstractDb::RouteRecord& record);
+            ~Route();
+
+            const AbstractDb::RouteRecord& record() const { return mRecord; }
+            // false if the route has no (valid) matching pattern, and so
+            // never matches
+            bool valid() const { return mRegex != 0; }
+
+            /// the literal every matching request URI starts with
+            const resip::Data& prefix() const { return mPrefix; }
+            /// the literal every matching request URI ends with
+            const resip::Data& suffix() const { return mSuffix; }
+
+            /// appends the rewritten target if the route matches uri
+            void process(const resip::Data& uri, UriList& targets) const;
+
+            static resip::Data literalPrefix(const resip::Data& pattern);
+            static resip::Data literalSuffix(const resip::Data& pattern);
+
+         private:
+            AbstractDb::RouteRecord mRecord;
+            regex_t* mRegex;
+            bool mSubstitute;
+            resip::Data mPrefix;
+            resip::Data mSuffix;
+
+            // no value semantics
+            Route(const Route&);
+            Route& operator=(const Route&);
+      };
+
+      /// routes in the order they are to be tried
+      typedef std::vector<std::shared_ptr<const Route> > RouteList;
+
+      explicit RouteMatcher(const RouteList& routes);
+
+      UriList process(const resip::Uri& ruri,
+                      const resip::Data& method,
+                      const resip::Data& event) const;
+
+      /// the number of routes whose pattern must always be tried
+      size_t unindexedCount() const { return mUnindexed.size(); }
+
+   private:
+      typedef std::vector<size_t> Positions;
+      typedef HashMap<resip::Data, Positions> LiteralIndex;
+
+      // adds the positions of the routes filed under the literals that uri
+      // starts (or ends) with
+      static void lookup(const LiteralIndex& index,
+                         const std::vector<resip::Data::size_type>& lengths,
+                         const resip::Data& uri,
+                         bool prefix,
+                         Positions& candidates);
+
+      RouteList mRoutes;
+      LiteralIndex mPrefixes;
+      std::vector<resip::Data::size_type> mPrefixLengths;
+      LiteralIndex mSuffixes;
+      std::vector<resip::Data::size_type> mSuffixLengths;
+      Positions mUnindexed;
+
+      // no value semantics
+      RouteMatcher(const RouteMatcher&);
+      RouteMatcher& operator=(const RouteMatcher&);
+};
+
+}
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -1,6 +1,5 @@
 
 #include "rutil/Logger.hxx"
-#include "rutil/ParseBuffer.hxx"
 #include "rutil/Lock.hxx"
 #include "resip/stack/Uri.hxx"
 
@@ -31,25 +30,7 @@ RouteStore::RouteStore(AbstractDb& db):
       route.routeRecord = mDb.getRoute(key);
 
       route.key = key;
-      route.preq = 0;
-      
-      if(!route.routeRecord.mMatchingPattern.empty())
-      {
-         int flags = REG_EXTENDED;
-         if(route.routeRecord.mRewriteExpression.find("$") == Data::npos)
-         {
-            flags |= REG_NOSUB;
-         }
-         route.preq = new regex_t;
-         int ret = regcomp(route.preq, route.routeRecord.mMatchingPattern.c_str(), flags);
-         if(ret != 0)
-         {
-            delete route.preq;
-            ErrLog(<< "Routing rule has invalid match expression: "
-                   << route.routeRecord.mMatchingPattern);
-            route.preq = 0;
-         }
-      }
+      route.route.reset(new RouteMatcher::Route(route.routeRecord));
 
       mRouteOperators.insert( route );
 
@@ -75,23 +56,14 @@ RouteStore::RouteStore(AbstractDb& db):
 
    // Initialize cursor to the start
    mCursor = mRouteOperators.begin();
+
+   WriteLock lock(mMutex);
+   compile();
 }
 
 
 RouteStore::~RouteStore()
 {
-   for(RouteOpList::iterator i = mRouteOperators.begin(); i != mRouteOperators.end(); i++)
-   {
-      if ( i->preq )
-      {
-         regfree ( i->preq );
-         delete i->preq;
-
-         // !abr! Can't modify elements in a set
-         // i->preq = 0;
-
-      }
-   }
    mRouteOperators.clear();
 }
 
@@ -123,26 +95,12 @@ RouteStore::addRoute(const resip::Data& method,
    }
 
    route.key = key;
-   route.preq = 0;
-   if( !route.routeRecord.mMatchingPattern.empty() )
-   {
-     int flags = REG_EXTENDED;
-     if( route.routeRecord.mRewriteExpression.find("$") == Data::npos )
-     {
-       flags |= REG_NOSUB;
-     }
-     route.preq = new regex_t;
-     int ret = regcomp( route.preq, route.routeRecord.mMatchingPattern.c_str(), flags );
-     if( ret != 0 )
-     {
-       delete route.preq;
-       route.preq = 0;
-     }
-   }
+   route.route.reset(new RouteMatcher::Route(route.routeRecord));
 
    {
       WriteLock lock(mMutex);
       mRouteOperators.insert( route );
+      compile();
    }
    mCursor = mRouteOperators.begin(); 
 
@@ -193,15 +151,6 @@ RouteStore::eraseRoute(const resip::Data& key )
          {
             RouteOpList::iterator i = it;
             it++;
-            if ( i->preq )
-            {
-               regfree ( i->preq );
-               delete i->preq;
-
-               // !abr! Can't modify elements in a set
-               //i->preq = 0;
-
-            }
             mRouteOperators.erase(i);
          }
          else
@@ -209,6 +158,7 @@ RouteStore::eraseRoute(const resip::Data& key )
             it++;
          }
       }
+      compile();
    }
    mCursor = mRouteOperators.begin();  // reset the cursor since it may have been on deleted route
 }
@@ -305,128 +255,22 @@ RouteStore::process(const resip::Uri& ruri,
                     const resip::Data& method, 
                     const resip::Data& event)
 {
-   RouteStore::UriList targetSet;
-   if(mRouteOperators.empty()) return targetSet;  // If there are no routes bail early to save a few cycles (size check is atomic enough, we don't need a lock)
+   std::shared_ptr<const RouteMatcher> matcher = std::atomic_load(&mMatcher);
+   return matcher->process(ruri, method, event);
+}
 
-   ReadLock lock(mMutex);
 
-   for (RouteOpList::iterator it = mRouteOperators.begin();
-        it != mRouteOperators.end(); it++)
+void
+RouteStore::compile()
+{
+   RouteMatcher::RouteList routes;
+   routes.reserve(mRouteOperators.size());
+   for (RouteOpList::const_iterator it = mRouteOperators.begin(); it != mRouteOperators.end(); ++it)
    {
-      DebugLog( << "Consider route " // << *it
-                << " reqUri=" << ruri
-                << " method=" << method 
-                << " event=" << event );
-
-      const AbstractDb::RouteRecord& rec = it->routeRecord;
-      
-      if(!rec.mMethod.empty())
-      {
-         if(!isEqualNoCase(rec.mMethod,method))
-         {
-            DebugLog( << "  Skipped - method did not match" );
-            continue;
-         }
-         
-      }
-      if(!rec.mEvent.empty())
-      {
-         if(!isEqualNoCase(rec.mEvent, event))
-         {
-            DebugLog( << "  Skipped - event did not match" );
-            continue;
-         }
-      }
-      const Data& rewrite = rec.mRewriteExpression;
-      const Data& match = rec.mMatchingPattern;
-      if ( it->preq ) 
-      {
-         int ret;
-         // TODO - !cj! www.pcre.org looks like it has better performance
-         // !mbg! is this true now that the compiled regexp is used?
-         Data uri;
-         {
-            DataStream s(uri);
-            s << ruri;
-            s.flush();
-         }
-         
-         const int nmatch=10;
-         regmatch_t pmatch[nmatch];
-         
-         ret = regexec(it->preq, uri.c_str(), nmatch, pmatch, 0/*eflags*/);
-         if ( ret != 0 )
-         {
-            // did not match 
-            DebugLog( << "  Skipped - request URI "<< uri << " did not match " << match );
-            continue;
-         }
-
-         DebugLog( << "  Route matched" );
-         Data target = rewrite;
-         
-         if ( rewrite.find("$") != Data::npos )
-         {
-            for ( int i=1; i<nmatch; i++)
-            {
-               if ( pmatch[i].rm_so != -1 )
-               {
-                  Data subExp(uri.substr(pmatch[i].rm_so,
-                                         pmatch[i].rm_eo-pmatch[i].rm_so));
-                  DebugLog( << "  subExpression[" <<i <<"]="<< subExp );
-
-                  Data result;
-                  {
-                     DataStream s(result);
-
-                     ParseBuffer pb(target);
-                     
-                     while (true)
-                     {
-                        const char* a = pb.position();
-                        pb.skipToChars( Data("$") + char('0'+i) );
-                        if ( pb.eof() )
-                        {
-                           s << pb.data(a);
-                           break;
-                        }
-                        else
-                        {
-                           s << pb.data(a);
-                           pb.skipN(2);
-                           s <<  subExp;
-                        }
-                     }
-                     s.flush();
-                  }
-                  target = result;
-               }
-            }
-         }
-         
-         Uri targetUri;
-         try
-         {
-            targetUri = Uri(target);
-         }
-         catch( BaseException& )
-         {
-            ErrLog( << "Routing rule transform " << rewrite << " gave invalid URI " << target );
-            try
-            {
-               targetUri = Uri( Data("sip:")+target);
-            }
-            catch( BaseException& )
-            {
-               ErrLog( << "Routing rule transform " << rewrite << " gave invalid URI sip:" << target );
-               continue;
-            }
-         }
-         targetSet.push_back( targetUri );
-      }
+      routes.push_back(it->route);
    }
-
-   return targetSet;
+   std::shared_ptr<const RouteMatcher> matcher(new RouteMatcher(routes));
+   std::atomic_store(&mMatcher, matcher);
 }
   
 
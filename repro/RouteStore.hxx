@@ -1,12 +1,7 @@
 #if !defined(REPRO_ROUTESTORE_HXX)
 #define REPRO_ROUTESTORE_HXX
 
-#ifdef WIN32
-#include <pcreposix.h>
-#else
-#include <regex.h>
-#endif
-
+#include <memory>
 #include <set>
 
 #include "rutil/Data.hxx"
@@ -14,6 +9,7 @@
 #include "resip/stack/Uri.hxx"
 
 #include "repro/AbstractDb.hxx"
+#include "repro/RouteMatcher.hxx"
 
 
 namespace repro
@@ -53,6 +49,8 @@ class RouteStore
       Key getFirstKey();// return empty if no more
       Key getNextKey(Key& key); // return empty if no more 
       
+      // Matches against a snapshot of the routes, without taking the
+      // lock, so routing is never held up by changes to the routes.
       UriList process(const resip::Uri& ruri, 
                       const resip::Data& method, 
                       const resip::Data& event );
@@ -71,7 +69,7 @@ class RouteStore
       {
          public:
             Key key;
-            regex_t *preq;
+            std::shared_ptr<const RouteMatcher::Route> route;
             AbstractDb::RouteRecord routeRecord;
             bool operator<(const RouteOp&) const;
       };
@@ -80,6 +78,11 @@ class RouteStore
       typedef std::multiset<RouteOp> RouteOpList;
       RouteOpList mRouteOperators; 
       RouteOpList::iterator mCursor;
+
+      // publishes a RouteMatcher for the current routes; called with
+      // mMutex write locked
+      void compile();
+      std::shared_ptr<const RouteMatcher> mMatcher;
 };
 
  }
@@ -1,6 +1,7 @@
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 #include "rutil/Lock.hxx"
+#include "rutil/ResipAssert.h"
 
 #include "resip/stack/SipMessage.hxx"
 
@@ -16,12 +17,48 @@ using namespace std;
 
 
 SiloStore::SiloStore(AbstractDb& db):
-   mDb(db)
+   mDb(db),
+   mWriter(0)
 {
 }
 
 SiloStore::~SiloStore()
 {
+   stopWriteBehind();
+}
+
+void
+SiloStore::startWriteBehind(unsigned int maxQueueSize,
+                            unsigned int batchSize,
+                            CongestionManager* congestionManager)
+{
+   WriteLock lock(mWriterMutex);
+   resip_assert(!mWriter);
+   mWriter = new SiloWriter(mDb, maxQueueSize, batchSize);
+   mWriter->setCongestionManager(congestionManager);
+   mWriter->run();
+}
+
+void
+SiloStore::stopWriteBehind()
+{
+   WriteLock lock(mWriterMutex);
+   delete mWriter;
+   mWriter = 0;
+}
+
+bool
+SiloStore::isAcceptingMessages() const
+{
+   ReadLock lock(mWriterMutex);
+   return !mWriter || mWriter->wouldAccept();
+}
+
+SiloWriter::Stats
+SiloStore::getWriteBehindStats() const
+{
+   ReadLock lock(mWriterMutex);
+   return mWriter ? mWriter->getStats() : SiloWriter::Stats();
 }
 
 bool
@@ -41,6 +78,13 @@ SiloStore::addMessage(const resip::Data& destUri,
    rec.mMessageBody = messageBody;
 
    Key key = buildKey(originalSendTime, tid);
+   {
+      ReadLock lock(mWriterMutex);
+      if(mWriter && mWriter->add(key, rec))
+      {
+         return true;
+      }
+   }
    return mDb.addToSilo(key, rec);
 }
 
@@ -50,6 +94,13 @@ SiloStore::getSiloRecords(const Data& uri, AbstractDb::SiloRecordList& recordLis
    // Note:  This fn uses the secondary cursor, and cleanupExpiredSiloRecords uses the
    // primary cursor, so there should be no need to provide locking at this level (at
    // least that's the theory - assuming the db performs it's own locking properly)
+   {
+      ReadLock lock(mWriterMutex);
+      if(mWriter)
+      {
+         mWriter->flush();
+      }
+   }
    return mDb.getSiloRecords(uri, recordList);
 }
 
@@ -57,6 +108,13 @@ void
 SiloStore::deleteSiloRecord(time_t originalSendTime, const resip::Data& tid)
 {
    Key key = buildKey(originalSendTime, tid);
+   {
+      ReadLock lock(mWriterMutex);
+      if(mWriter && mWriter->erase(key))
+      {
+         return;
+      }
+   }
    mDb.eraseSiloRecord(key);
 }
 
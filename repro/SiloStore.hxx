@@ -5,9 +5,11 @@
 #include "rutil/Data.hxx"
 #include "rutil/RWMutex.hxx"
 #include "repro/AbstractDb.hxx"
+#include "repro/SiloWriter.hxx"
 
 namespace resip
 {
+   class CongestionManager;
    class SipMessage;
 }
 
@@ -33,10 +35,26 @@ class SiloStore
       void deleteSiloRecord(time_t originalSendTime, const resip::Data& tid);
       void cleanupExpiredSiloRecords(UInt64 now, unsigned long expirationTime);
 
+      // From now on, additions and erasures are queued and written in
+      // batches by a SiloWriter thread (see SiloWriter).  They are only
+      // written directly if its queue is full.  getSiloRecords() waits for
+      // the queued writes first, so it always sees them.
+      void startWriteBehind(unsigned int maxQueueSize,
+                            unsigned int batchSize,
+                            resip::CongestionManager* congestionManager);
+      void stopWriteBehind();  // writes anything still queued
+
+      // false while the write-behind queue is too full (or congested) to
+      // take new messages
+      bool isAcceptingMessages() const;
+      SiloWriter::Stats getWriteBehindStats() const;
+
    private:
       Key buildKey(time_t originalSendTime, const resip::Data& tid) const;
 
       AbstractDb& mDb;
+      mutable resip::RWMutex mWriterMutex;
+      SiloWriter* mWriter;
 };
 
  }
@@ -0,0 +1,251 @@
+#include "rutil/BaseException.hxx"
+#include "rutil/CongestionManager.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Timer.hxx"
+
+#include "repro/SiloWriter.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
+
+SiloWriter::SiloWriter(AbstractDb& db, unsigned int maxQueueSize, unsigned int batchSize) :
+   mDb(db),
+   mBatchSize(batchSize ? batchSize : 1),
+   mFifo(0, maxQueueSize),
+   mCongestionManager(0),
+   mWrittenCount(0)
+{
+   mFifo.setDescription("SiloWriter::mFifo");
+}
+
+SiloWriter::~SiloWriter()
+{
+   // Shutdown thread and wait for it to drain the queue
+   shutdown();
+   join();
+   setCongestionManager(0);
+}
+
+void
+SiloWriter::setCongestionManager(CongestionManager* manager)
+{
+   if(mCongestionManager)
+   {
+      mCongestionManager->unregisterFifo(&mFifo);
+   }
+   mCongestionManager = manager;
+   if(mCongestionManager)
+   {
+      mCongestionManager->registerFifo(&mFifo);
+   }
+}
+
+bool
+SiloWriter::wouldAccept() const
+{
+   if(!mFifo.wouldAccept(OperationFifo::IgnoreTimeDepth))
+   {
+      return false;
+   }
+   return !mCongestionManager ||
+          mCongestionManager->getRejectionBehavior(&mFifo) == CongestionManager::NORMAL;
+}
+
+bool
+SiloWriter::add(const AbstractDb::Key& key, const AbstractDb::SiloRecord& rec)
+{
+   Operation* op = new Operation;
+   op->mKey = key;
+   op->mRecord = rec;
+   op->mErase = false;
+   return queue(op, OperationFifo::InternalElement);
+}
+
+bool
+SiloWriter::erase(const AbstractDb::Key& key)
+{
+   Operation* op = new Operation;
+   op->mKey = key;
+   op->mErase = true;
+   return queue(op, OperationFifo::InternalElement);
+}
+
+bool
+SiloWriter::queue(Operation* op, OperationFifo::DepthUsage usage)
+{
+   Lock lock(mMutex);
+   if(!mFifo.add(op, usage))
+   {
+      delete op;
+      mStats.mRejected++;
+      return false;
+   }
+   mStats.mQueued++;
+   size_t depth = mFifo.size();
+   if(depth > mStats.mMaxQueueDepth)
+   {
+      mStats.mMaxQueueDepth = depth;
+   }
+   return true;
+}
+
+void
+SiloWriter::flush()
+{
+   Lock lock(mMutex);
+   UInt64 target = mStats.mQueued;
+   while(mWrittenCount < target && !isShutdown())
+   {
+      mWritten.wait(mMutex, 1000);
+   }
+}
+
+SiloWriter::Stats
+SiloWriter::getStats() const
+{
+   Lock lock(mMutex);
+   Stats stats(mStats);
+   stats.mQueueDepth = mFifo.size();
+   return stats;
+}
+
+void
+SiloWriter::thread()
+{
+   while(!isShutdown() || !mFifo.empty())  // Ensure we drain the queue before shutting down
+   {
+      Operation* op = mFifo.getNext(1000);  // Only need to wake up to see if we are shutdown
+      if(op)
+      {
+         // take whatever else has been queued meanwhile, up to a batch
+         Operations ops(1, op);
+         while(ops.size() < mBatchSize && mFifo.messageAvailable())
+         {
+            ops.push_back(mFifo.getNext());
+         }
+         write(ops);
+      }
+   }
+
+   // release anyone still waiting in flush()
+   Lock lock(mMutex);
+   mWritten.broadcast();
+}
+
+void
+SiloWriter::write(const Operations& ops)
+{
+   // Store before erasing: a record is only ever erased after being read
+   // back, and reads flush() first, so its addition cannot be in the same
+   // batch after the erasure.
+   AbstractDb::SiloBatch batch;
+   for(Operations::const_iterator it = ops.begin(); it != ops.end(); ++it)
+   {
+      Operation* op = *it;
+      if(op->mErase)
+      {
+         batch.mErasedKeys.push_back(op->mKey);
+      }
+      else
+      {
+         batch.mRecords.push_back(std::make_pair(op->mKey, op->mRecord));
+      }
+      delete op;
+   }
+
+   UInt64 start = Timer::getTimeMs();
+   bool ok = true;
+   try
+   {
+      ok = mDb.writeSiloBatch(batch);
+   }
+   catch(BaseException& e)
+   {
+      WarningLog(<< "Unhandled exception writing silo records: " << e);
+      ok = false;
+   }
+   UInt64 elapsed = Timer::getTimeMs() - start;
+
+   if(!ok)
+   {
+      ErrLog(<< "Failed to write " << batch.mRecords.size() << " silo records and erase "
+             << batch.mErasedKeys.size() << " to the database");
+   }
+   DebugLog(<< "Wrote " << batch.mRecords.size() << " silo records and erased "
+            << batch.mErasedKeys.size() << " in " << elapsed << "ms");
+
+   Lock lock(mMutex);
+   mWrittenCount += ops.size();
+   mStats.mBatches++;
+   if(ok)
+   {
+      mStats.mRecordsWritten += batch.mRecords.size();
+      mStats.mRecordsErased += batch.mErasedKeys.size();
+   }
+   else
+   {
+      mStats.mFailedBatches++;
+   }
+   mStats.mLastFlushMs = elapsed;
+   mStats.mTotalFlushMs += elapsed;
+   if(elapsed > mStats.mMaxFlushMs)
+   {
+      mStats.mMaxFlushMs = elapsed;
+   }
+   mWritten.broadcast();
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,153 @@
+#if !defined(REPRO_SILOWRITER_HXX)
+#define REPRO_SILOWRITER_HXX
+
+#include <vector>
+
+#include "rutil/Condition.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/TimeLimitFifo.hxx"
+#include "repro/AbstractDb.hxx"
+
+namespace resip
+{
+   class CongestionManager;
+}
+
+namespace repro
+{
+
+/**
+   @brief Write-behind thread for the message silo.
+
+   SiloStore queues its record additions and erasures here instead of
+   writing them itself.  The thread takes whatever has been queued, up to
+   batchSize operations at a time, and writes it with a single
+   AbstractDb::writeSiloBatch() call - one transaction for the SQL
+   databases.
+
+   The queue holds at most maxQueueSize operations.  wouldAccept() turns
+   false once it is 80% full, or while the congestion manager (if any)
+   reports it as congested; callers are expected to refuse new messages
+   then.  The rest of the queue is kept for the erasures that follow
+   delivery, so add() and erase() only fail once it is completely full.
+*/
+class SiloWriter : public resip::ThreadIf
+{
+   public:
+      class Stats
+      {
+         public:
+            Stats() : mQueueDepth(0), mMaxQueueDepth(0), mQueued(0), mRejected(0),
+                      mBatches(0), mRecordsWritten(0), mRecordsErased(0), mFailedBatches(0),
+                      mLastFlushMs(0), mMaxFlushMs(0), mTotalFlushMs(0) {}
+            size_t mQueueDepth;
+            size_t mMaxQueueDepth;
+            UInt64 mQueued;
+            UInt64 mRejected;
+            UInt64 mBatches;
+            UInt64 mRecordsWritten;
+            UInt64 mRecordsErased;
+            UInt64 mFailedBatches;
+            UInt64 mLastFlushMs;   // time taken to write the last batch
+            UInt64 mMaxFlushMs;
+            UInt64 mTotalFlushMs;
+      };
+
+      SiloWriter(AbstractDb& db, unsigned int maxQueueSize, unsigned int batchSize);
+      virtual ~SiloWriter();  // writes anything still queued
+
+      void setCongestionManager(resip::CongestionManager* manager);
+
+      // false if a new message would be refused now
+      bool wouldAccept() const;
+
+      // returns false (and counts a rejection) if the queue is full
+      bool add(const AbstractDb::Key& key, const AbstractDb::SiloRecord& rec);
+      bool erase(const AbstractDb::Key& key);
+
+      // Waits until everything queued before the call has been written
+      void flush();
+
+      Stats getStats() const;
+
+   private:
+      class Operation
+      {
+         public:
+            AbstractDb::Key mKey;
+            AbstractDb::SiloRecord mRecord;
+            bool mErase;
+      };
+      typedef resip::TimeLimitFifo<Operation> OperationFifo;
+      typedef std::vector<Operation*> Operations;
+
+      virtual void thread();
+      bool queue(Operation* op, OperationFifo::DepthUsage usage);
+      void write(const Operations& ops);
+
+      AbstractDb& mDb;
+      unsigned int mBatchSize;
+      OperationFifo mFifo;
+      resip::CongestionManager* mCongestionManager;
+
+      // mStats.mQueued and mWrittenCount count operations, so that flush()
+      // knows when the ones queued before it have been written
+      mutable resip::Mutex mMutex;
+      resip::Condition mWritten;
+      UInt64 mWrittenCount;
+      Stats mStats;
+};
+
+}
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
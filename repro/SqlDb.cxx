@@ -8,6 +8,7 @@
 #include "rutil/ResipAssert.h"
 #include "rutil/Data.hxx"
 #include "rutil/DataStream.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
 
@@ -21,10 +22,102 @@ using namespace std;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::REPRO
 
-SqlDb::SqlDb(const resip::ConfigParse& config) : mConnected(false)
+SqlDb::SqlDb(const resip::ConfigParse& config)
 {
    mTlsPeerAuthorizationQuery = config.getConfigData("CustomTlsAuthQuery", "");
    mTableNamePrefix = config.getConfigData("TableNamePrefix", "");
+   mConnectionCount = config.getConfigData("ConnectionPoolSize", "1", true).convertUnsignedLong();
+   if(mConnectionCount == 0)
+   {
+      mConnectionCount = 1;
+   }
+   mConnected.resize(mConnectionCount, false);
+   // handed out from the back, so connection 0 is used first
+   for(unsigned int i = mConnectionCount; i > 0; --i)
+   {
+      mFreeConnections.push_back(i - 1);
+   }
+}
+
+bool
+SqlDb::isSane()
+{
+   Lock lock(mPoolMutex);
+   for(unsigned int i = 0; i < mConnectionCount; ++i)
+   {
+      if(mConnected[i])
+      {
+         return true;
+      }
+   }
+   return false;
+}
+
+void
+SqlDb::setConnected(unsigned int connection, bool connected) const
+{
+   Lock lock(mPoolMutex);
+   mConnected[connection] = connected;
+}
+
+bool
+SqlDb::isConnected(unsigned int connection) const
+{
+   Lock lock(mPoolMutex);
+   return mConnected[connection];
+}
+
+unsigned int
+SqlDb::acquireConnection() const
+{
+   Lock lock(mPoolMutex);
+   PinnedConnections::const_iterator it = mPinnedConnections.find(ThreadIf::selfId());
+   if(it != mPinnedConnections.end())
+   {
+      return it->second;
+   }
+   while(mFreeConnections.empty())
+   {
+      mConnectionFreed.wait(mPoolMutex);
+   }
+   unsigned int connection = mFreeConnections.back();
+   mFreeConnections.pop_back();
+   return connection;
+}
+
+void
+SqlDb::releaseConnection(unsigned int connection) const
+{
+   Lock lock(mPoolMutex);
+   PinnedConnections::const_iterator it = mPinnedConnections.find(ThreadIf::selfId());
+   if(it != mPinnedConnections.end() && it->second == connection)
+   {
+      // still in use by the transaction
+      return;
+   }
+   mFreeConnections.push_back(connection);
+   mConnectionFreed.signal();
+}
+
+void
+SqlDb::pinConnection() const
+{
+   unsigned int connection = acquireConnection();
+   Lock lock(mPoolMutex);
+   mPinnedConnections[ThreadIf::selfId()] = connection;
+}
+
+void
+SqlDb::unpinConnection() const
+{
+   Lock lock(mPoolMutex);
+   PinnedConnections::iterator it = mPinnedConnections.find(ThreadIf::selfId());
+   if(it != mPinnedConnections.end())
+   {
+      mFreeConnections.push_back(it->second);
+      mPinnedConnections.erase(it);
+      mConnectionFreed.signal();
+   }
 }
 
 void 
@@ -134,18 +227,166 @@ SqlDb::dbEraseRecord(const Table table,
    query(command);
 }
 
+bool
+SqlDb::writeSiloBatch(const SiloBatch& batch)
+{
+   if(!dbBeginTransaction(SiloTable))
+   {
+      return false;
+   }
+
+   bool ok = true;
+   if(!batch.mRecords.empty())
+   {
+      // dbWriteRecord replaces any record with the same key, so do the same
+      Data keys;
+      Data rows;
+      {
+         DataStream ks(keys);
+         DataStream rs(rows);
+         Data escapedKey;
+         Data escapedSKey;
+         Data data;
+         for(std::vector<std::pair<Key, SiloRecord> >::const_iterator it = batch.mRecords.begin();
+             it != batch.mRecords.end(); ++it)
+         {
+            if(it != batch.mRecords.begin())
+            {
+               ks << ", ";
+               rs << ", ";
+            }
+            data.clear();
+            encodeSiloRecord(it->second, data);
+            escapeString(it->first, escapedKey);
+            escapeString(it->second.mDestUri, escapedSKey);
+            ks << "'" << escapedKey << "'";
+            rs << "('" << escapedKey << "', '" << escapedSKey << "', '" << data.base64encode() << "')";
+         }
+      }
+      Data command;
+      {
+         DataStream ds(command);
+         ds << "DELETE FROM " << tableName(SiloTable) << " WHERE attr IN (" << keys << ")";
+      }
+      ok = query(command) == 0;
+      if(ok)
+      {
+         command.clear();
+         {
+            DataStream ds(command);
+            ds << "INSERT INTO " << tableName(SiloTable) << " (attr, attr2, value) VALUES " << rows;
+         }
+         ok = query(command) == 0;
+      }
+   }
+
+   if(ok && !batch.mErasedKeys.empty())
+   {
+      Data command;
+      {
+         DataStream ds(command);
+         ds << "DELETE FROM " << tableName(SiloTable) << " WHERE attr IN (";
+         Data escapedKey;
+         for(std::vector<Key>::const_iterator it = batch.mErasedKeys.begin();
+             it != batch.mErasedKeys.end(); ++it)
+         {
+            if(it != batch.mErasedKeys.begin())
+            {
+               ds << ", ";
+            }
+            escapeString(*it, escapedKey);
+            ds << "'" << escapedKey << "'";
+         }
+         ds << ")";
+      }
+      ok = query(command) == 0;
+   }
+
+   if(ok)
+   {
+      return dbCommitTransaction(SiloTable);
+   }
+   dbRollbackTransaction(SiloTable);
+   return false;
+}
+
 bool 
 SqlDb::dbCommitTransaction(const Table table)
 {
    Data command("COMMIT");
-   return query(command) == 0;
+   bool ret = query(command) == 0;
+   unpinConnection();
+   return ret;
 }
 
 bool 
 SqlDb::dbRollbackTransaction(const Table table)
 {
    Data command("ROLLBACK");
-   return query(command) == 0;
+   bool ret = query(command) == 0;
+   unpinConnection();
+   return ret;
+}
+
+bool
+SqlDb::parameterizeQuery(const Data& query,
+                         const char* placeholder,
+                         unsigned int firstParam,
+                         Data& statement,
+                         std::vector<Data>& tags)
+{
+   statement.clear();
+   tags.clear();
+   ParseBuffer pb(query);
+   while(!pb.eof())
+   {
+      const char* start = pb.position();
+      pb.skipToOneOf("'\"");
+      statement += pb.data(start);
+      if(pb.eof())
+      {
+         break;
+      }
+
+      // Take the whole quoted literal or identifier, so that a quote or tag
+      // inside it is not mistaken for one outside; a doubled quote stands
+      // for one quote inside it
+      const char quote = *pb.position();
+      start = pb.position();
+      pb.skipChar();
+      while(!pb.eof())
+      {
+         pb.skipToChar(quote);
+         if(!pb.eof())
+         {
+            pb.skipChar();
+            if(pb.eof() || *pb.position() != quote)
+            {
+               break;
+            }
+            pb.skipChar();
+         }
+      }
+      Data quoted(pb.data(start));
+      if(quote == '\'' && (quoted == "'$user'" || quoted == "'$domain'"))
+      {
+         tags.push_back(quoted.substr(2, quoted.size() - 3));
+         Data param(placeholder);
+         param.replace("%d", Data((UInt32)(firstParam + tags.size() - 1)));
+         statement += param;
+      }
+      else if(quote == '\'' && quoted.find("\\") != Data::npos)
+      {
+         // MySQL reads a backslash in a literal as an escape, PostgreSQL (with
+         // standard_conforming_strings) doesn't, so where it ends is unsure
+         return false;
+      }
+      else
+      {
+         statement += quoted;
+      }
+   }
+   return statement.find("$user") == Data::npos && statement.find("$domain") == Data::npos;
 }
 
 static const char userTable[] = "users";
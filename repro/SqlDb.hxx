@@ -1,8 +1,14 @@
 #if !defined(RESIP_SQLDB_HXX)
 #define RESIP_SQLDB_HXX 
 
+#include <map>
+#include <vector>
+
+#include "rutil/Condition.hxx"
 #include "rutil/ConfigParse.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
 #include "repro/AbstractDb.hxx"
 
 namespace resip
@@ -18,29 +24,72 @@ class SqlDb: public AbstractDb
    public:
       SqlDb(const resip::ConfigParse& config);
       
-      virtual bool isSane() {return mConnected;}
+      // true while any of the connections is up
+      virtual bool isSane();
 
       virtual void eraseUser( const Key& key );
       virtual void eraseTlsPeerIdentity( const Key& key );
 
+      // Stores the batch with one DELETE and one multi-row INSERT, and erases
+      // with a single DELETE, all in one transaction
+      virtual bool writeSiloBatch(const SiloBatch& batch);
+
       virtual bool isAuthorized(const std::set<resip::Data>& peerNames, const std::set<resip::Data>& identities) const;
 
       // Perform a query that expects a single result/row - returns all column/field data in a vector
       virtual int singleResultQuery(const resip::Data& queryCommand, std::vector<resip::Data>& fields) const = 0;
 
    protected:
-      virtual void setConnected(bool connected) const { mConnected = connected; }
-      virtual bool isConnected() const { return mConnected; }
+      // Whether each connection of the pool is up
+      virtual void setConnected(unsigned int connection, bool connected) const;
+      virtual bool isConnected(unsigned int connection) const;
 
       void setToData(const std::set<resip::Data>& items, resip::Data& result, const resip::Data& sep = ",", const char quote = '\'') const;
 
-      // when multiple threads are in use with the same connection, you need to
-      // mutex calls to mysql_query and mysql_store_result:
-      // http://dev.mysql.com/doc/refman/5.1/en/threaded-clients.html
-      mutable resip::Mutex mMutex;
-
       resip::Data tableName( Table table ) const;
 
+      // Turns a CustomUserAuthQuery into the text of a prepared statement:
+      // each '$user' or '$domain' literal becomes placeholder (with any "%d"
+      // in it replaced by the parameter number, counting from firstParam),
+      // and the tags are appended to tags in order.  Other literals and
+      // quoted identifiers are copied as they are.  Returns false if a tag is
+      // used in any other way, or a literal holds a backslash, in which case
+      // the query can only be run with the tags substituted in its text.
+      static bool parameterizeQuery(const resip::Data& query,
+                                    const char* placeholder,
+                                    unsigned int firstParam,
+                                    resip::Data& statement,
+                                    std::vector<resip::Data>& tags);
+
+      // The number of connections to the database server (ConnectionPoolSize,
+      // 1 by default).  Subclasses keep one client library connection per
+      // index, 0 to connectionCount()-1.  A connection may only be used by
+      // one thread at a time, so each query runs on a connection obtained
+      // from acquireConnection() - or more simply a ConnectionGuard.
+      unsigned int connectionCount() const { return mConnectionCount; }
+
+      // Waits until a connection is free and reserves it for the calling
+      // thread.  Inside a transaction, returns the transaction's connection.
+      unsigned int acquireConnection() const;
+      void releaseConnection(unsigned int connection) const;
+
+      class ConnectionGuard
+      {
+         public:
+            ConnectionGuard(const SqlDb& db) : mDb(db), mConnection(db.acquireConnection()) {}
+            ~ConnectionGuard() { mDb.releaseConnection(mConnection); }
+            unsigned int connection() const { return mConnection; }
+         private:
+            const SqlDb& mDb;
+            unsigned int mConnection;
+      };
+
+      // A transaction's statements must all run on one connection: between
+      // pinConnection() (in dbBeginTransaction) and unpinConnection() (once
+      // committed or rolled back) the calling thread keeps the same one.
+      void pinConnection() const;
+      void unpinConnection() const;
+
    private:
       // Db manipulation routines
       virtual void dbEraseRecord(const Table table, 
@@ -53,7 +102,15 @@ class SqlDb: public AbstractDb
       virtual int query(const resip::Data& queryCommand) const = 0;
       virtual resip::Data& escapeString(const resip::Data& str, resip::Data& escapedStr) const = 0;
 
-      mutable volatile bool mConnected;
+      unsigned int mConnectionCount;
+      // protects the members below
+      mutable resip::Mutex mPoolMutex;
+      mutable std::vector<bool> mConnected;
+      mutable resip::Condition mConnectionFreed;
+      mutable std::vector<unsigned int> mFreeConnections;
+      typedef std::map<resip::ThreadIf::Id, unsigned int> PinnedConnections;
+      mutable PinnedConnections mPinnedConnections;
+
       resip::Data mTlsPeerAuthorizationQuery;
       resip::Data mTableNamePrefix;
 
@@ -7,6 +7,8 @@
 #include "rutil/DataStream.hxx"
 #include "resip/stack/Symbols.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Timer.hxx"
 #include "resip/stack/TransactionUser.hxx"
 #include "resip/dum/UserAuthInfo.hxx"
 
@@ -23,7 +25,12 @@ using namespace std;
 
 const resip::Data UserStore::SEPARATOR("@");
 
-UserStore::UserStore(AbstractDb& db ) : mDb(db)
+UserStore::UserStore(AbstractDb& db ) : 
+   mDb(db),
+   mAuthCacheMaxEntries(0),
+   mAuthCacheTtl(0),
+   mAuthCacheNegativeTtl(0),
+   mAuthCacheGeneration(0)
 { 
 }
 
@@ -42,7 +49,136 @@ UserStore::getUserAuthInfo(  const resip::Data& user,
                              const resip::Data& realm ) const
 {
    Key key =  buildKey(user, realm);
-   return mDb.getUserAuthInfo( key );
+
+   UInt64 generation;
+   {
+      Lock lock(mAuthCacheMutex);
+      AuthCache::iterator it = mAuthCache.find(key);
+      if(it != mAuthCache.end())
+      {
+         if(it->second.mExpires > Timer::getTimeMs())
+         {
+            mAuthCacheLru.splice(mAuthCacheLru.begin(), mAuthCacheLru, it->second.mLru);
+            if(it->second.mA1.empty())
+            {
+               ++mAuthCacheStats.mNegativeHits;
+            }
+            else
+            {
+               ++mAuthCacheStats.mHits;
+            }
+            return it->second.mA1;
+         }
+         mAuthCacheLru.erase(it->second.mLru);
+         mAuthCache.erase(it);
+      }
+      if(mAuthCacheMaxEntries != 0)
+      {
+         ++mAuthCacheStats.mMisses;
+      }
+      generation = mAuthCacheGeneration;
+   }
+
+   // don't hold the lock over the database query
+   Data a1 = mDb.getUserAuthInfo( key );
+
+   Lock lock(mAuthCacheMutex);
+   UInt64 ttl = a1.empty() ? mAuthCacheNegativeTtl : mAuthCacheTtl;
+   if(ttl == 0 || mAuthCacheMaxEntries == 0 || generation != mAuthCacheGeneration)
+   {
+      return a1;
+   }
+
+   // another thread may have cached the same key in the meantime
+   AuthCache::iterator it = mAuthCache.find(key);
+   if(it == mAuthCache.end())
+   {
+      mAuthCacheLru.push_front(key);
+      it = mAuthCache.insert(AuthCache::value_type(key, CachedAuthInfo())).first;
+      it->second.mLru = mAuthCacheLru.begin();
+   }
+   else
+   {
+      mAuthCacheLru.splice(mAuthCacheLru.begin(), mAuthCacheLru, it->second.mLru);
+   }
+   it->second.mA1 = a1;
+   it->second.mExpires = Timer::getTimeMs() + ttl;
+
+   while(mAuthCache.size() > mAuthCacheMaxEntries)
+   {
+      mAuthCache.erase(mAuthCacheLru.back());
+      mAuthCacheLru.pop_back();
+      ++mAuthCacheStats.mEvictions;
+   }
+   return a1;
+}
+
+void
+UserStore::setAuthCacheLimits(unsigned int maxEntries,
+                              unsigned int ttlSecs,
+                              unsigned int negativeTtlSecs)
+{
+   Lock lock(mAuthCacheMutex);
+   mAuthCacheMaxEntries = maxEntries;
+   mAuthCacheTtl = ttlSecs * 1000;
+   mAuthCacheNegativeTtl = negativeTtlSecs * 1000;
+   mAuthCache.clear();
+   mAuthCacheLru.clear();
+   ++mAuthCacheGeneration;
+   InfoLog(<< "Auth cache: maxEntries=" << maxEntries << " ttl=" << ttlSecs
+           << "s negativeTtl=" << negativeTtlSecs << "s");
+}
+
+void
+UserStore::invalidateAuthInfo(const resip::Data& user, const resip::Data& realm)
+{
+   invalidateAuthInfo(buildKey(user, realm));
+}
+
+void
+UserStore::invalidateRealmAuthInfo(const Key& key, const AbstractDb::UserRecord& rec)
+{
+   // the cache has the user's credentials as user@realm; when the realm
+   // isn't the domain, that is another entry from the one for key
+   if(!rec.user.empty())
+   {
+      Key realmKey = buildKey(rec.user, rec.realm);
+      if(realmKey != key)
+      {
+         invalidateAuthInfo(realmKey);
+      }
+   }
+}
+
+void
+UserStore::invalidateAuthInfo(const Key& key)
+{
+   Lock lock(mAuthCacheMutex);
+   ++mAuthCacheGeneration;
+   AuthCache::iterator it = mAuthCache.find(key);
+   if(it != mAuthCache.end())
+   {
+      mAuthCacheLru.erase(it->second.mLru);
+      mAuthCache.erase(it);
+   }
+}
+
+void
+UserStore::clearAuthCache()
+{
+   Lock lock(mAuthCacheMutex);
+   ++mAuthCacheGeneration;
+   mAuthCache.clear();
+   mAuthCacheLru.clear();
+}
+
+UserStore::AuthCacheStats
+UserStore::getAuthCacheStats() const
+{
+   Lock lock(mAuthCacheMutex);
+   AuthCacheStats stats(mAuthCacheStats);
+   stats.mEntries = mAuthCache.size();
+   return stats;
 }
 
 bool 
@@ -91,13 +227,25 @@ UserStore::addUser( const Data& username,
    rec.email = emailAddress;
    rec.forwardAddress = Data::Empty;
 
-   return mDb.addUser( buildKey(username,domain), rec);
+   Key key = buildKey(username,domain);
+   bool ret = mDb.addUser( key, rec);
+   // drop the old hash (or a cached "no such user") from the auth cache;
+   // credentials are looked up as user@realm, usually the same key
+   invalidateAuthInfo(key);
+   if(realm != domain)
+   {
+      invalidateAuthInfo(username, realm);
+   }
+   return ret;
 }
 
 void 
 UserStore::eraseUser( const Key& key )
 { 
+   AbstractDb::UserRecord rec = mDb.getUser(key);
    mDb.eraseUser( key );
+   invalidateAuthInfo(key);
+   invalidateRealmAuthInfo(key, rec);
 }
 
 bool
@@ -112,12 +260,17 @@ UserStore::updateUser( const Key& originalKey,
                        const resip::Data& passwordHashAlt)
 {
    Key newkey = buildKey(user, domain);
+   AbstractDb::UserRecord original = mDb.getUser(originalKey);
    
    bool ret = addUser(user, domain, realm, password, applyA1HashToPassword, fullName, emailAddress, passwordHashAlt);
    if ( newkey != originalKey )
    {
       eraseUser(originalKey);
    }
+   else
+   {
+      invalidateRealmAuthInfo(originalKey, original);
+   }
    return ret;
 }
 
@@ -1,8 +1,12 @@
 #if !defined(REPRO_USERSTORE_HXX)
 #define REPRO_USERSTORE_HXX
 
+#include <list>
+
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/HashMap.hxx"
+#include "rutil/Mutex.hxx"
 #include "resip/stack/Message.hxx"
 
 #include "repro/AbstractDb.hxx"
@@ -17,10 +21,31 @@ namespace repro
 
 typedef resip::Fifo<resip::Message> MessageFifo;
 
+/**
+   Looks up and maintains the users table.
+
+   getUserAuthInfo() is called for every digest challenge response, so its
+   results can be cached: see setAuthCacheLimits(). Entries are dropped
+   when the user is changed through this UserStore, and otherwise expire
+   after their time to live - changes made to the database by anything
+   else (another repro instance, userAdmin, a custom auth query) are seen
+   once that time is up.
+*/
 class UserStore
 {
    public:
       typedef resip::Data Key;
+
+      class AuthCacheStats
+      {
+         public:
+            AuthCacheStats() : mHits(0), mNegativeHits(0), mMisses(0), mEvictions(0), mEntries(0) {}
+            UInt64 mHits;         // found a password hash
+            UInt64 mNegativeHits; // found a cached "no such user"
+            UInt64 mMisses;       // went to the database
+            UInt64 mEvictions;    // dropped to stay within the size limit
+            size_t mEntries;
+      };
       
       UserStore(AbstractDb& db);
       
@@ -58,10 +83,44 @@ class UserStore
       static Key buildKey(const resip::Data& user, const resip::Data& domain);
       static void getUserAndDomainFromKey(const AbstractDb::Key& key, resip::Data& user, resip::Data& domain);
 
+      // Caches up to maxEntries results of getUserAuthInfo(), least recently
+      // used first out. Unknown users are cached for negativeTtlSecs, others
+      // for ttlSecs; a ttl of 0 disables that kind of caching and maxEntries
+      // of 0 (the default) disables the cache altogether.
+      void setAuthCacheLimits(unsigned int maxEntries,
+                              unsigned int ttlSecs,
+                              unsigned int negativeTtlSecs);
+      void invalidateAuthInfo(const resip::Data& user, const resip::Data& realm);
+      void clearAuthCache();
+      AuthCacheStats getAuthCacheStats() const;
+
    private:
+      void invalidateAuthInfo(const Key& key);
+      void invalidateRealmAuthInfo(const Key& key, const AbstractDb::UserRecord& rec);
 
       AbstractDb& mDb;
       static const resip::Data SEPARATOR;
+
+      typedef std::list<Key> AuthCacheLru; // most recently used first
+      class CachedAuthInfo
+      {
+         public:
+            resip::Data mA1;
+            UInt64 mExpires; // ms
+            AuthCacheLru::iterator mLru;
+      };
+      typedef HashMap<Key, CachedAuthInfo> AuthCache;
+
+      mutable resip::Mutex mAuthCacheMutex;
+      mutable AuthCache mAuthCache;
+      mutable AuthCacheLru mAuthCacheLru;
+      unsigned int mAuthCacheMaxEntries;
+      UInt64 mAuthCacheTtl;         // ms
+      UInt64 mAuthCacheNegativeTtl; // ms
+      // bumped by every invalidation, so that a database read which raced
+      // with one is not cached
+      UInt64 mAuthCacheGeneration;
+      mutable AuthCacheStats mAuthCacheStats;
 };
 
  }
@@ -263,6 +263,7 @@ XmlRpcServerBase::process(FdSet& fdset)
       bool ok = it->second->process(fdset);
       if (!ok)
       {
+         onConnectionClosed(it->first);
          delete it->second;
          mConnections.erase(it++);
       }
@@ -324,7 +325,7 @@ XmlRpcServerBase::closeOldestConnection()
    if(mConnections.empty()) return;
 
    // Oldest Connection is the one with the lowest Id
-   ConnectionMap::iterator lowestConnectionIdIt = mConnections.end();
+   ConnectionMap::iterator lowestConnectionIdIt = mConnections.begin();
    ConnectionMap::iterator it = mConnections.begin();
    for(; it != mConnections.end(); it++)
    {
@@ -333,6 +334,7 @@ XmlRpcServerBase::closeOldestConnection()
          lowestConnectionIdIt = it;
       }
    }
+   onConnectionClosed(lowestConnectionIdIt->first);
    delete lowestConnectionIdIt->second;
    mConnections.erase(lowestConnectionIdIt);
 }
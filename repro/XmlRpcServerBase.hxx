@@ -79,6 +79,8 @@ protected:
    virtual void handleRequest(unsigned int connectionId, 
                               unsigned int requestId, 
                               const resip::Data& request) = 0; 
+   // called from process() as a connection is closed
+   virtual void onConnectionClosed(unsigned int connectionId) {}
       
 private:
    static const unsigned int MaxConnections = 60;   // Note:  use caution if making this any bigger, default fd_set size in windows is 64
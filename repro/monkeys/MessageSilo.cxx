@@ -97,10 +97,21 @@ MessageSilo::MessageSilo(ProxyConfig& config, Dispatcher* asyncDispatcher) :
          mMimeTypeFilterRegex = 0;
       }
    }
+
+   // Queue database writes for a writer thread, which batches them
+   unsigned long writeQueueSize = config.getConfigUnsignedLong("MessageSiloWriteQueueSize", 1000);
+   if(writeQueueSize > 0)
+   {
+      mSiloStore.startWriteBehind(writeQueueSize,
+                                  config.getConfigUnsignedLong("MessageSiloWriteBatchSize", 50),
+                                  mAsyncDispatcher->mStack ? mAsyncDispatcher->mStack->getCongestionManager() : 0);
+   }
 }
 
 MessageSilo::~MessageSilo()
 {
+   mSiloStore.stopWriteBehind();
+
    // Clean up pcre memory
    if(mDestFilterRegex)
    {
@@ -194,6 +205,16 @@ MessageSilo::process(RequestContext& context)
          async->mSourceUri = Data::from(from);
          time(&async->mOriginalSendTime);  // Get now timestamp
 
+         // Refuse the message while the database can't keep up
+         if(!mSiloStore.isAcceptingMessages())
+         {
+            WarningLog( << " MESSAGE not silo'd due to silo write queue congestion");
+            SipMessage response;
+            Helper::makeResponse(response, originalRequest, mFailureStatusCode);
+            context.sendResponse(response);
+            return SkipThisChain;
+         }
+
          // Dispatch async request to worker thread pool
          mAsyncDispatcher->post(async_ptr);
 
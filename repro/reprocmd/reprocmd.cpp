@@ -60,6 +60,10 @@ main (int argc, char** argv)
       cerr << "                [tlscvm=<NONE|OPT|MAN>] [tlsuseemail=<YES|NO>]" << endl;
       cerr << "                - adds a new transport to the stack." << endl;
       cerr << "  /RemoveTransport key=<transportKey> - removes the requested transport" << endl; 
+      cerr << "  /GetAuthCacheStats - retrieves the size and hit rate of the user credential cache" << endl;
+      cerr << "  /ClearAuthCache [user=<user> realm=<realm>] - empties the user credential cache," << endl;
+      cerr << "                  or drops a single user from it" << endl;
+      cerr << "  /GetSiloStats - retrieves the message silo write queue depth and write latency" << endl;
       exit(1);
    }
 
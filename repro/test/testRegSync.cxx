@@ -0,0 +1,400 @@
+#include <iostream>
+#include <list>
+#include <unistd.h>
+
+#include "resip/dum/InMemorySyncRegDb.hxx"
+#include "resip/stack/NameAddr.hxx"
+#include "resip/stack/Tuple.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/Socket.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+
+#include "repro/RegSyncClient.hxx"
+#include "repro/RegSyncCodec.hxx"
+#include "repro/RegSyncServer.hxx"
+#include "repro/RegSyncServerThread.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+static Uri
+aorUri(int n)
+{
+   return Uri("sip:user" + Data(n) + "@example.com");
+}
+
+static ContactInstanceRecord
+contact(int n, UInt64 now)
+{
+   ContactInstanceRecord rec;
+   rec.mContact = NameAddr("<sip:user" + Data(n) + "@192.0.2.1:5060;transport=tcp>;+sip.instance=\"<urn:uuid:" + Data(n) + ">\"");
+   rec.mRegExpires = now + 3600;
+   rec.mLastUpdated = now - 10;
+   rec.mReceivedFrom = Tuple("192.0.2.1", 5060, TCP);
+   rec.mPublicAddress = Tuple("198.51.100.1", 5060, UDP);
+   rec.mSipPath.push_back(NameAddr("<sip:edge1.example.com;lr>"));
+   rec.mSipPath.push_back(NameAddr("<sip:edge2.example.com;lr>"));
+   rec.mInstance = "<urn:uuid:" + Data(n) + ">";
+   rec.mRegId = n;
+   rec.mUserAgent = "testRegSync/" + Data(n);
+   return rec;
+}
+
+static void
+testCodec()
+{
+   UInt64 now = Timer::getTimeSecs();
+   ContactList contacts;
+   contacts.push_back(contact(1, now));
+   ContactInstanceRecord removed;
+   removed.mContact = NameAddr("<sip:gone@192.0.2.9>");
+   removed.mRegExpires = 0;
+   removed.mLastUpdated = now - 100;
+   contacts.push_back(removed);
+
+   Data payload;
+   RegSyncCodec::encodeAor(payload, aorUri(1), contacts, now);
+   RegSyncCodec::encodeAor(payload, aorUri(2), ContactList(), now);
+   Data frame = RegSyncCodec::encodeFrame(7, 2, payload);
+
+   // nothing is decoded until the whole frame is there
+   size_t frameSize = 1;
+   for (size_t size = 1; size < frame.size(); size++)
+   {
+      assert(RegSyncCodec::frameSize(frame.data(), size, frameSize) && frameSize == 0);
+   }
+   Data twoFrames = frame + frame;
+   assert(RegSyncCodec::frameSize(twoFrames.data(), twoFrames.size(), frameSize) && frameSize == frame.size());
+
+   UInt64 sequence = 0;
+   RegSyncCodec::AorList aors;
+   assert(RegSyncCodec::decodeFrame(frame.data(), frame.size(), now, sequence, aors));
+   assert(sequence == 7);
+   assert(aors.size() == 2);
+   assert(aors[0].first == aorUri(1));
+   assert(aors[1].first == aorUri(2) && aors[1].second.empty());
+   assert(aors[0].second.size() == 2);
+
+   const ContactInstanceRecord& orig = contacts.front();
+   const ContactInstanceRecord& rec = aors[0].second.front();
+   assert(rec.mContact.uri() == orig.mContact.uri());
+   assert(rec.mContact.param(p_Instance) == orig.mContact.param(p_Instance));
+   assert(rec.mRegExpires == orig.mRegExpires);
+   assert(rec.mLastUpdated == orig.mLastUpdated);
+   assert(rec.mReceivedFrom == orig.mReceivedFrom);
+   assert(rec.mPublicAddress == orig.mPublicAddress);
+   assert(rec.mSipPath.size() == 2 && rec.mSipPath.back().uri() == orig.mSipPath.back().uri());
+   assert(rec.mInstance == orig.mInstance);
+   assert(rec.mRegId == orig.mRegId);
+   assert(rec.mUserAgent == orig.mUserAgent);
+   assert(rec.mSyncContact);
+   const ContactInstanceRecord& gone = aors[0].second.back();
+   assert(gone.mRegExpires == 0);
+   assert(gone.mReceivedFrom.getPort() == 0);
+   assert(gone.mPublicAddress.getType() == UNKNOWN_TRANSPORT);
+
+   // a frame whose contents don't add up is rejected
+   Data truncated = RegSyncCodec::encodeFrame(7, 3, payload);
+   aors.clear();
+   assert(!RegSyncCodec::decodeFrame(truncated.data(), truncated.size(), now, sequence, aors));
+   Data padded = RegSyncCodec::encodeFrame(7, 2, payload + "x");
+   aors.clear();
+   assert(!RegSyncCodec::decodeFrame(padded.data(), padded.size(), now, sequence, aors));
+
+   // so is one claiming a length no server sends, before it has arrived
+   Data huge = frame.substr(0, RegSyncCodec::HeaderSize);
+   huge[1] = (char)0x7f;
+   size_t size = 1;
+   assert(!RegSyncCodec::frameSize(huge.data(), huge.size(), size));
+   assert(RegSyncCodec::frameSize(huge.data(), 3, size) && size == 0);
+
+   cerr << "testCodec OK" << endl;
+}
+
+static void
+benchmark(int count)
+{
+   UInt64 now = Timer::getTimeSecs();
+   ContactList contacts;
+   contacts.push_back(contact(1, now));
+
+   UInt64 start = Timer::getTimeMicroSec();
+   Data payload;
+   for (int i = 0; i < count; i++)
+   {
+      RegSyncCodec::encodeAor(payload, aorUri(i), contacts, now);
+   }
+   Data frame = RegSyncCodec::encodeFrame(0, count, payload);
+   UInt64 encoded = Timer::getTimeMicroSec();
+
+   UInt64 sequence;
+   RegSyncCodec::AorList aors;
+   assert(RegSyncCodec::decodeFrame(frame.data(), frame.size(), now, sequence, aors));
+   assert((int)aors.size() == count);
+   UInt64 decoded = Timer::getTimeMicroSec();
+
+   cerr << count << " AORs: " << frame.size() / count << " bytes each, encoded in "
+        << (encoded - start) / 1000 << " ms, decoded in " << (decoded - encoded) / 1000 << " ms" << endl;
+}
+
+// Keeps what the RegSync server logs about the syncs it does
+class SyncLog : public ExternalLogger
+{
+   public:
+      virtual bool operator()(Log::Level level, const Subsystem& subsystem, const Data& appName,
+                              const char* file, int line, const Data& message,
+                              const Data& messageWithHeaders, const Data& instanceName)
+      {
+         if (message.prefix("RegSyncServer::binarySync"))
+         {
+            Lock lock(mMutex);
+            mMessages.push_back(message);
+         }
+         return level <= Log::Warning;
+      }
+      bool contains(const Data& text)
+      {
+         Lock lock(mMutex);
+         for (list<Data>::const_iterator it = mMessages.begin(); it != mMessages.end(); it++)
+         {
+            if (it->find(text) != Data::npos)
+            {
+               return true;
+            }
+         }
+         return false;
+      }
+      Mutex mMutex;
+      list<Data> mMessages;
+};
+
+static bool
+waitForContact(InMemorySyncRegDb& db, const Uri& aor, const Data& userAgent)
+{
+   for (int i = 0; i < 500; i++)
+   {
+      ContactList contacts;
+      db.getContacts(aor, contacts);
+      if (contacts.size() == 1 && contacts.front().mUserAgent == userAgent)
+      {
+         return true;
+      }
+      sleepMs(20);
+   }
+   return false;
+}
+
+static void
+testReplication(SyncLog& log)
+{
+   int port = 30000 + getpid() % 20000;
+   InMemorySyncRegDb master;
+   InMemorySyncRegDb replica;
+   InMemorySyncRegDb xmlReplica;
+
+   RegSyncServer server(&master, port, V4);
+   assert(server.isSane());
+   list<RegSyncServer*> servers;
+   servers.push_back(&server);
+   RegSyncServerThread serverThread(servers);
+   serverThread.run();
+
+   UInt64 now = Timer::getTimeSecs();
+   for (int i = 1; i <= 50; i++)
+   {
+      master.updateContact(aorUri(i), contact(i, now));
+   }
+
+   // a full sync, then changes as they happen
+   RegSyncClient client(&replica, "127.0.0.1", port);
+   client.run();
+   assert(waitForContact(replica, aorUri(50), "testRegSync/50"));
+   assert(log.contains("sending all AORs"));
+   ContactInstanceRecord changed = contact(1, now);
+   changed.mUserAgent = "testRegSync/1001";
+   changed.mLastUpdated = now - 5;
+   master.updateContact(aorUri(1), changed);
+   assert(waitForContact(replica, aorUri(1), "testRegSync/1001"));
+
+   // an older peer, asking for XML, gets the same
+   RegSyncClient xmlClient(&xmlReplica, "127.0.0.1", port, 0, false);
+   xmlClient.run();
+   assert(waitForContact(xmlReplica, aorUri(50), "testRegSync/50"));
+   assert(waitForContact(xmlReplica, aorUri(1), "testRegSync/1001"));
+   changed.mUserAgent = "testRegSync/1002";
+   changed.mLastUpdated = now - 4;
+   master.updateContact(aorUri(1), changed);
+   assert(waitForContact(replica, aorUri(1), "testRegSync/1002"));
+   assert(waitForContact(xmlReplica, aorUri(1), "testRegSync/1002"));
+   sleepMs(200);
+
+   // Crowd out the binary peer: the server drops its oldest connection
+   // once it has 60.  The peer reconnects, and is only sent what changed
+   // since the sequence it had got to.
+   list<Socket> crowd;
+   for (int i = 0; i < 60; i++)
+   {
+      Socket s = ::socket(PF_INET, SOCK_STREAM, 0);
+      Tuple addr("127.0.0.1", port, V4, TCP);
+      assert(::connect(s, &addr.getMutableSockaddr(), addr.length()) == 0);
+      crowd.push_back(s);
+      sleepMs(10);
+   }
+   for (int i = 0; i < 500 && !log.contains("sending 0 AORs changed since sequence 52"); i++)
+   {
+      sleepMs(20);
+   }
+   assert(log.contains("sending 0 AORs changed since sequence 52"));
+   changed = contact(2, now);
+   changed.mUserAgent = "testRegSync/1003";
+   changed.mLastUpdated = now - 3;
+   master.updateContact(aorUri(2), changed);
+   assert(waitForContact(replica, aorUri(2), "testRegSync/1003"));
+
+   for (list<Socket>::iterator it = crowd.begin(); it != crowd.end(); it++)
+   {
+      closeSocket(*it);
+   }
+   client.shutdown();
+   xmlClient.shutdown();
+   client.join();
+   xmlClient.join();
+   serverThread.shutdown();
+   serverThread.join();
+
+   cerr << "testReplication OK" << endl;
+}
+
+// Keeps changing one AOR, as a registrar would while a peer is synced
+class Changer : public ThreadIf
+{
+   public:
+      Changer(InMemorySyncRegDb& db, const Uri& aor, int changes) :
+         mDb(db), mAor(aor), mChanges(changes)
+      {
+      }
+      virtual void thread()
+      {
+         UInt64 now = Timer::getTimeSecs();
+         for (int i = 1; i <= mChanges && !isShutdown(); i++)
+         {
+            ContactInstanceRecord rec = contact(1, now);
+            rec.mUserAgent = "testRegSync/" + Data(10000 + i);
+            rec.mLastUpdated = now - 10 * (mChanges + 1 - i);  // replicas only take newer bindings
+            mDb.updateContact(mAor, rec);
+            sleepMs(1);
+         }
+      }
+      InMemorySyncRegDb& mDb;
+      Uri mAor;
+      int mChanges;
+};
+
+static void
+testChangesDuringSync()
+{
+   int port = 30000 + getpid() % 20000;  // free again, the last server bound it for reuse
+   InMemorySyncRegDb master;
+   InMemorySyncRegDb replica;
+
+   UInt64 now = Timer::getTimeSecs();
+   for (int i = 1; i <= 20000; i++)
+   {
+      master.updateContact(aorUri(i), contact(i, now));
+   }
+
+   RegSyncServer server(&master, port, V4);
+   assert(server.isSane());
+   list<RegSyncServer*> servers;
+   servers.push_back(&server);
+   RegSyncServerThread serverThread(servers);
+   serverThread.run();
+
+   // the last change must win over the copy sent in the full sync
+   Changer changer(master, aorUri(1), 200);
+   RegSyncClient client(&replica, "127.0.0.1", port);
+   changer.run();
+   client.run();
+   changer.join();
+   assert(waitForContact(replica, aorUri(1), "testRegSync/10200"));
+   assert(waitForContact(replica, aorUri(20000), "testRegSync/20000"));
+
+   client.shutdown();
+   client.join();
+   serverThread.shutdown();
+   serverThread.join();
+
+   cerr << "testChangesDuringSync OK" << endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+   SyncLog log;
+   Log::initialize(Log::Cout, Log::Info, argv[0], log);
+   initNetwork();
+
+   testCodec();
+   testReplication(log);
+   testChangesDuringSync();
+   benchmark(100000);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
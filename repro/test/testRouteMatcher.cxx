@@ -0,0 +1,288 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+#include "resip/stack/Uri.hxx"
+
+#include "repro/RouteMatcher.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks that RouteMatcher finds the same targets as trying every route in
+// turn (the way RouteStore used to), and compares the speed of the two on
+// a synthetic route table.
+//
+// usage: testRouteMatcher [routes] [lookups]
+
+static std::shared_ptr<const RouteMatcher::Route>
+makeRoute(const Data& pattern, const Data& rewrite,
+          const Data& method = Data::Empty, const Data& event = Data::Empty)
+{
+   AbstractDb::RouteRecord record;
+   record.mMethod = method;
+   record.mEvent = event;
+   record.mMatchingPattern = pattern;
+   record.mRewriteExpression = rewrite;
+   record.mOrder = 0;
+   return std::shared_ptr<const RouteMatcher::Route>(new RouteMatcher::Route(record));
+}
+
+// Every route, in order.
+static RouteMatcher::UriList
+linear(const RouteMatcher::RouteList& routes, const Uri& ruri,
+       const Data& method, const Data& event)
+{
+   RouteMatcher::UriList targets;
+   Data uri(Data::from(ruri));
+   for (size_t i = 0; i < routes.size(); ++i)
+   {
+      const AbstractDb::RouteRecord& rec = routes[i]->record();
+      if (!routes[i]->valid() ||
+          (!rec.mMethod.empty() && !isEqualNoCase(rec.mMethod, method)) ||
+          (!rec.mEvent.empty() && !isEqualNoCase(rec.mEvent, event)))
+      {
+         continue;
+      }
+      routes[i]->process(uri, targets);
+   }
+   return targets;
+}
+
+static void
+checkSame(const RouteMatcher& matcher, const RouteMatcher::RouteList& routes,
+          const Uri& ruri, const Data& method, const Data& event = Data::Empty)
+{
+   RouteMatcher::UriList expected = linear(routes, ruri, method, event);
+   RouteMatcher::UriList actual = matcher.process(ruri, method, event);
+   if (expected.size() != actual.size())
+   {
+      cerr << ruri << ": expected " << expected.size() << " targets, got " << actual.size() << endl;
+      resip_assert(0);
+   }
+   for (size_t i = 0; i < expected.size(); ++i)
+   {
+      resip_assert(Data::from(expected[i]) == Data::from(actual[i]));
+   }
+}
+
+static void
+testLiterals()
+{
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:1555([0-9]*)@") == "sip:1555");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:\\+1555") == "sip:+1555");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sips?:") == "sip");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:a*") == "sip:");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:a+") == "sip:a");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:a{2}") == "sip:");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:\\w") == "sip:");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:\\<alice") == "sip:");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:bob\\>@") == "sip:bob");
+   resip_assert(RouteMatcher::Route::literalPrefix("sip:1555") == "");
+   resip_assert(RouteMatcher::Route::literalPrefix("^sip:1|^tel:1") == "");
+
+   resip_assert(RouteMatcher::Route::literalSuffix("^sip:.*@example\\.com$") == "@example.com");
+   resip_assert(RouteMatcher::Route::literalSuffix("@example\\.com$") == "@example.com");
+   resip_assert(RouteMatcher::Route::literalSuffix("^sip:1.*;user=phone$") == ";user=phone");
+   resip_assert(RouteMatcher::Route::literalSuffix("a*$") == "");
+   resip_assert(RouteMatcher::Route::literalSuffix("(com)$") == "");
+   resip_assert(RouteMatcher::Route::literalSuffix("\\.com\\$") == "");
+   resip_assert(RouteMatcher::Route::literalSuffix("x\\\\$") == "");
+   resip_assert(RouteMatcher::Route::literalSuffix("x\\w$") == "");
+   resip_assert(RouteMatcher::Route::literalSuffix("@\\<example\\.com$") == "example.com");
+   resip_assert(RouteMatcher::Route::literalSuffix("example.com") == "");
+}
+
+static void
+testMatching()
+{
+   RouteMatcher::RouteList routes;
+   routes.push_back(makeRoute("^sip:1555([0-9]*)@", "sip:$1@gw1.example.com"));
+   routes.push_back(makeRoute("^sip:.*@carrier\\.example\\.com$", "sip:proxy.example.com"));
+   routes.push_back(makeRoute("^sip:1([0-9]*)@", "sip:$1@gw2.example.com", "INVITE"));
+   routes.push_back(makeRoute("user=phone", "sip:phones.example.com"));
+   routes.push_back(makeRoute("^sip:presence@", "sip:pa.example.com", "SUBSCRIBE", "presence"));
+   routes.push_back(makeRoute("([", "sip:broken.example.com"));
+   routes.push_back(makeRoute("", "sip:empty.example.com"));
+   routes.push_back(makeRoute("^sips?:15", "sip:any15.example.com"));
+
+   RouteMatcher matcher(routes);
+   resip_assert(matcher.unindexedCount() == 1);
+
+   RouteMatcher::UriList targets = matcher.process(Uri("sip:15551234@carrier.example.com"), "INVITE", Data::Empty);
+   resip_assert(targets.size() == 4);
+   resip_assert(Data::from(targets[0]) == "sip:1234@gw1.example.com");
+   resip_assert(Data::from(targets[1]) == "sip:proxy.example.com");
+   resip_assert(Data::from(targets[2]) == "sip:5551234@gw2.example.com");
+   resip_assert(Data::from(targets[3]) == "sip:any15.example.com");
+
+   checkSame(matcher, routes, Uri("sip:15551234@carrier.example.com"), "INVITE");
+   checkSame(matcher, routes, Uri("sip:15551234@carrier.example.com"), "MESSAGE");
+   checkSame(matcher, routes, Uri("sip:15551234@example.com;user=phone"), "INVITE");
+   checkSame(matcher, routes, Uri("sips:15551234@example.com"), "INVITE");
+   checkSame(matcher, routes, Uri("sip:presence@example.com"), "SUBSCRIBE", "presence");
+   checkSame(matcher, routes, Uri("sip:presence@example.com"), "SUBSCRIBE", "dialog");
+   checkSame(matcher, routes, Uri("sip:alice@example.com"), "INVITE");
+
+   // GNU word boundaries must not end up in the literal index
+   RouteMatcher::RouteList words;
+   words.push_back(makeRoute("^sip:\\<alice@", "sip:alice.example.com"));
+   words.push_back(makeRoute("@\\<example\\.com$", "sip:domain.example.com"));
+   RouteMatcher wordMatcher(words);
+   resip_assert(wordMatcher.process(Uri("sip:alice@example.com"), "INVITE", Data::Empty).size() == 2);
+   checkSame(wordMatcher, words, Uri("sip:alice@example.com"), "INVITE");
+
+   RouteMatcher empty((RouteMatcher::RouteList()));
+   resip_assert(empty.process(Uri("sip:alice@example.com"), "INVITE", Data::Empty).empty());
+}
+
+// A carrier style table: number prefixes, per domain routes and a few
+// patterns that cannot be indexed.
+static void
+buildTable(int count, RouteMatcher::RouteList& routes, std::vector<Uri>& uris)
+{
+   int unindexed = resipMax(count / 100, 1);
+   for (int i = 0; i < count; ++i)
+   {
+      Data n(10000 + i);
+      if (i < unindexed)
+      {
+         routes.push_back(makeRoute("(^sip:|;tgrp=)" + n + "[0-9]", "sip:trunk" + n + ".example.com"));
+      }
+      else if (i % 2)
+      {
+         routes.push_back(makeRoute("^sip:1" + n + "([0-9]*)@", "sip:$1@gw" + Data(i % 16) + ".example.com", "INVITE"));
+         uris.push_back(Uri("sip:1" + n + "4567@example.com"));
+      }
+      else
+      {
+         routes.push_back(makeRoute("^sip:.*@domain" + n + "\\.example\\.com$", "sip:edge" + Data(i % 16) + ".example.com"));
+         uris.push_back(Uri("sip:alice@domain" + n + ".example.com"));
+      }
+   }
+   uris.push_back(Uri("sip:nobody@example.com"));
+   uris.push_back(Uri("sip:1999999@example.com;user=phone"));
+}
+
+static void
+benchmark(int count, int lookups)
+{
+   RouteMatcher::RouteList routes;
+   std::vector<Uri> uris;
+   buildTable(count, routes, uris);
+
+   UInt64 start = Timer::getTimeMicroSec();
+   RouteMatcher matcher(routes);
+   UInt64 compile = Timer::getTimeMicroSec() - start;
+
+   std::vector<Uri> sample;
+   for (int i = 0; i < lookups; ++i)
+   {
+      sample.push_back(uris[Random::getRandom() % uris.size()]);
+   }
+   for (size_t i = 0; i < uris.size(); i += resipMax(uris.size() / 50, (size_t)1))
+   {
+      checkSame(matcher, routes, uris[i], "INVITE");
+   }
+
+   size_t matched = 0;
+   start = Timer::getTimeMicroSec();
+   for (size_t i = 0; i < sample.size(); ++i)
+   {
+      matched += matcher.process(sample[i], "INVITE", Data::Empty).size();
+   }
+   UInt64 indexed = resipMax(Timer::getTimeMicroSec() - start, (UInt64)1);
+
+   // trying every route is slow; time a fraction of the lookups
+   size_t linearLookups = resipMax(sample.size() / 50, (size_t)1);
+   start = Timer::getTimeMicroSec();
+   for (size_t i = 0; i < linearLookups; ++i)
+   {
+      linear(routes, sample[i], "INVITE", Data::Empty);
+   }
+   UInt64 scanned = resipMax(Timer::getTimeMicroSec() - start, (UInt64)1);
+
+   cerr << routes.size() << " routes (" << matcher.unindexedCount() << " unindexed), compiled in "
+        << compile / 1000 << " ms" << endl
+        << "   every route:  " << scanned / linearLookups << " us/lookup" << endl
+        << "   RouteMatcher: " << (double)indexed / sample.size() << " us/lookup ("
+        << matched << " targets for " << sample.size() << " lookups)" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   int routes = argc > 1 ? atoi(argv[1]) : 10000;
+   int lookups = argc > 2 ? atoi(argv[2]) : 20000;
+
+   testLiterals();
+   testMatching();
+   benchmark(routes, lookups);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,336 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <map>
+
+#include "rutil/Data.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+
+#include "repro/AbstractDb.hxx"
+#include "repro/SiloStore.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks the SiloStore write-behind queue against an in-memory silo table
+// that counts its writes, and times the callers of addMessage() with and
+// without the queue when each database call takes a millisecond.
+
+class SiloDb : public AbstractDb
+{
+   public:
+      SiloDb() : mWrites(0), mBatches(0), mWriteDelayMs(0), mBlocked(false) {}
+
+      virtual bool isSane() { return true; }
+
+      virtual bool addToSilo(const Key& key, const SiloRecord& rec)
+      {
+         delay();
+         Lock lock(mMutex);
+         ++mWrites;
+         mRecords[key] = rec;
+         return true;
+      }
+
+      virtual bool getSiloRecords(const Key& skey, SiloRecordList& recordList)
+      {
+         Lock lock(mMutex);
+         for(map<Key, SiloRecord>::const_iterator it = mRecords.begin(); it != mRecords.end(); ++it)
+         {
+            if(it->second.mDestUri == skey)
+            {
+               recordList.push_back(it->second);
+            }
+         }
+         return true;
+      }
+
+      virtual void eraseSiloRecord(const Key& key)
+      {
+         delay();
+         Lock lock(mMutex);
+         ++mWrites;
+         mRecords.erase(key);
+      }
+
+      // one round trip for the whole batch, as for the SQL databases
+      virtual bool writeSiloBatch(const SiloBatch& batch)
+      {
+         while(mBlocked)
+         {
+            sleepMs(1);
+         }
+         delay();
+         Lock lock(mMutex);
+         ++mBatches;
+         for(vector<pair<Key, SiloRecord> >::const_iterator it = batch.mRecords.begin();
+             it != batch.mRecords.end(); ++it)
+         {
+            mRecords[it->first] = it->second;
+         }
+         for(vector<Key>::const_iterator it = batch.mErasedKeys.begin();
+             it != batch.mErasedKeys.end(); ++it)
+         {
+            mRecords.erase(*it);
+         }
+         return true;
+      }
+
+      size_t size()
+      {
+         Lock lock(mMutex);
+         return mRecords.size();
+      }
+
+      unsigned int mWrites;   // made directly, rather than in a batch
+      unsigned int mBatches;
+      unsigned int mWriteDelayMs;
+      std::atomic<bool> mBlocked;  // stalls the batches
+
+   protected:
+      // only the silo table is used, and that is overridden above
+      virtual bool dbWriteRecord(const Table table, const Data& key, const Data& data) { return false; }
+      virtual bool dbReadRecord(const Table table, const Data& key, Data& data) const { return false; }
+      virtual void dbEraseRecord(const Table table, const Data& key, bool isSecondaryKey=false) {}
+      virtual Data dbNextKey(const Table table, bool first=false) { return Data::Empty; }
+      virtual bool dbNextRecord(const Table table, const Data& key, Data& data, bool forUpdate, bool first=false) { return false; }
+      virtual bool dbBeginTransaction(const Table table) { return true; }
+      virtual bool dbCommitTransaction(const Table table) { return true; }
+      virtual bool dbRollbackTransaction(const Table table) { return true; }
+
+   private:
+      void delay()
+      {
+         if(mWriteDelayMs)
+         {
+            sleepMs(mWriteDelayMs);
+         }
+      }
+
+      Mutex mMutex;
+      map<Key, SiloRecord> mRecords;
+};
+
+static void
+addMessages(SiloStore& store, const Data& dest, unsigned int first, unsigned int count)
+{
+   for(unsigned int i = first; i < first + count; ++i)
+   {
+      resip_assert(store.addMessage(dest, "sip:bob@example.com", 1000 + i, "tid" + Data(i),
+                                    "text/plain", "message " + Data(i)));
+   }
+}
+
+static void
+deleteAll(SiloStore& store, const Data& dest)
+{
+   AbstractDb::SiloRecordList records;
+   resip_assert(store.getSiloRecords(dest, records));
+   for(AbstractDb::SiloRecordList::const_iterator it = records.begin(); it != records.end(); ++it)
+   {
+      store.deleteSiloRecord((time_t)it->mOriginalSentTime, it->mTid);
+   }
+}
+
+static void
+testDirect()
+{
+   SiloDb db;
+   SiloStore store(db);
+
+   addMessages(store, "sip:alice@example.com", 0, 3);
+   addMessages(store, "sip:carol@example.com", 3, 1);
+   resip_assert(db.mWrites == 4 && db.mBatches == 0);
+   AbstractDb::SiloRecordList records;
+   resip_assert(store.getSiloRecords("sip:alice@example.com", records));
+   resip_assert(records.size() == 3);
+   resip_assert(records[1].mMessageBody == "message 1");
+   deleteAll(store, "sip:alice@example.com");
+   resip_assert(db.size() == 1);
+   resip_assert(store.isAcceptingMessages());
+   resip_assert(store.getWriteBehindStats().mQueued == 0);
+   cerr << "testDirect OK" << endl;
+}
+
+static void
+testWriteBehind()
+{
+   SiloDb db;
+   db.mWriteDelayMs = 5;
+   SiloStore store(db);
+   store.startWriteBehind(100, 10, 0);
+
+   // reads see the queued writes, and the writes are batched
+   addMessages(store, "sip:alice@example.com", 0, 25);
+   addMessages(store, "sip:carol@example.com", 25, 5);
+   AbstractDb::SiloRecordList records;
+   resip_assert(store.getSiloRecords("sip:alice@example.com", records));
+   resip_assert(records.size() == 25);
+   resip_assert(db.mWrites == 0);
+   resip_assert(db.mBatches >= 3 && db.mBatches < 25);
+
+   deleteAll(store, "sip:alice@example.com");
+   records.clear();
+   resip_assert(store.getSiloRecords("sip:alice@example.com", records));
+   resip_assert(records.empty());
+   resip_assert(db.size() == 5);
+
+   SiloWriter::Stats stats = store.getWriteBehindStats();
+   resip_assert(stats.mQueued == 55);
+   resip_assert(stats.mRecordsWritten == 30);
+   resip_assert(stats.mRecordsErased == 25);
+   resip_assert(stats.mQueueDepth == 0);
+   resip_assert(stats.mRejected == 0 && stats.mFailedBatches == 0);
+   resip_assert(stats.mBatches == db.mBatches);
+   resip_assert(stats.mMaxFlushMs >= 5);
+
+   // anything still queued is written on shutdown
+   addMessages(store, "sip:dave@example.com", 30, 5);
+   store.stopWriteBehind();
+   resip_assert(db.size() == 10);
+   resip_assert(db.mWrites == 0);
+   cerr << "testWriteBehind OK" << endl;
+}
+
+static void
+testBackpressure()
+{
+   SiloDb db;
+   SiloStore store(db);
+   store.startWriteBehind(10, 5, 0);
+
+   // stall the writer on its first batch
+   db.mBlocked = true;
+   addMessages(store, "sip:alice@example.com", 0, 1);
+   while(store.getWriteBehindStats().mQueueDepth > 0)
+   {
+      sleepMs(1);
+   }
+
+   // new messages are refused once the queue is 80% full...
+   unsigned int accepted = 0;
+   while(store.isAcceptingMessages())
+   {
+      addMessages(store, "sip:alice@example.com", 1 + accepted, 1);
+      ++accepted;
+   }
+   resip_assert(accepted == 8);
+
+   // ...while anything that must be stored still is, the last of it
+   // directly once the queue is completely full
+   addMessages(store, "sip:alice@example.com", 9, 3);
+   SiloWriter::Stats stats = store.getWriteBehindStats();
+   resip_assert(stats.mQueueDepth == 10);
+   resip_assert(stats.mRejected == 1);
+   db.mBlocked = false;
+
+   AbstractDb::SiloRecordList records;
+   resip_assert(store.getSiloRecords("sip:alice@example.com", records));
+   resip_assert(records.size() == 12);
+   resip_assert(db.mWrites == 1);
+   resip_assert(store.isAcceptingMessages());
+   cerr << "testBackpressure OK" << endl;
+}
+
+static void
+benchmark(unsigned int messages)
+{
+   for(int queued = 0; queued < 2; ++queued)
+   {
+      SiloDb db;
+      db.mWriteDelayMs = 1;
+      SiloStore store(db);
+      if(queued)
+      {
+         store.startWriteBehind(messages, 50, 0);
+      }
+
+      UInt64 start = Timer::getTimeMicroSec();
+      addMessages(store, "sip:alice@example.com", 0, messages);
+      UInt64 elapsed = Timer::getTimeMicroSec() - start;
+      AbstractDb::SiloRecordList records;
+      store.getSiloRecords("sip:alice@example.com", records);
+      UInt64 total = Timer::getTimeMicroSec() - start;
+      resip_assert(records.size() == messages);
+
+      cerr << messages << " messages " << (queued ? "with" : "without")
+           << " the write queue: " << elapsed << " us to add, "
+           << total << " us until stored, "
+           << (queued ? db.mBatches : db.mWrites) << " database writes" << endl;
+   }
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   testDirect();
+   testWriteBehind();
+   testBackpressure();
+   benchmark(500);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,266 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <atomic>
+#include <iostream>
+
+#include "rutil/ConfigParse.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Time.hxx"
+
+#include "repro/SqlDb.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks the database independent parts of SqlDb: the rewriting of a
+// CustomUserAuthQuery into a prepared statement, and the connection pool.
+
+class TestConfig : public ConfigParse
+{
+   public:
+      virtual void printHelpText(int argc, char **argv) {}
+};
+
+// An SqlDb without a database behind it, that notes the connection each
+// query runs on
+class TestSqlDb : public SqlDb
+{
+   public:
+      TestSqlDb(const ConfigParse& config) : SqlDb(config), mLastConnection(0) {}
+
+      using SqlDb::parameterizeQuery;
+      using SqlDb::connectionCount;
+      using SqlDb::acquireConnection;
+      using SqlDb::releaseConnection;
+      using SqlDb::ConnectionGuard;
+      using SqlDb::pinConnection;
+      using SqlDb::unpinConnection;
+      using SqlDb::setConnected;
+      using SqlDb::isConnected;
+
+      virtual int singleResultQuery(const Data& queryCommand, std::vector<Data>& fields) const { return query(queryCommand); }
+      virtual int query(const Data& queryCommand) const
+      {
+         ConnectionGuard guard(*this);
+         mLastConnection = guard.connection();
+         return 0;
+      }
+
+      mutable unsigned int mLastConnection;
+
+   private:
+      virtual bool dbWriteRecord(const Table table, const Data& key, const Data& data) { return false; }
+      virtual bool dbReadRecord(const Table table, const Data& key, Data& data) const { return false; }
+      virtual Data dbNextKey(const Table table, bool first) { return Data::Empty; }
+      virtual bool dbNextRecord(const Table table, const Data& key, Data& data, bool forUpdate, bool first) { return false; }
+      virtual bool dbBeginTransaction(const Table table) { pinConnection(); return true; }
+      virtual Data& escapeString(const Data& str, Data& escapedStr) const { escapedStr = str; return escapedStr; }
+      virtual void userWhereClauseToDataStream(const Key& key, DataStream& ds) const {}
+      virtual void tlsPeerIdentityWhereClauseToDataStream(const Key& key, DataStream& ds) const {}
+};
+
+// Takes a connection from another thread, and gives it back
+class Acquirer : public ThreadIf
+{
+   public:
+      Acquirer(TestSqlDb& db) : mDb(db), mConnection(0), mAcquired(false) {}
+
+      virtual void thread()
+      {
+         mConnection = mDb.acquireConnection();
+         mAcquired = true;
+         mDb.releaseConnection(mConnection);
+      }
+
+      TestSqlDb& mDb;
+      unsigned int mConnection;
+      std::atomic<bool> mAcquired;
+};
+
+static bool
+parameterize(const Data& query, const char* placeholder, Data& statement, std::vector<Data>& tags)
+{
+   return TestSqlDb::parameterizeQuery(query, placeholder, 3, statement, tags);
+}
+
+static void
+testParameterize()
+{
+   Data statement;
+   std::vector<Data> tags;
+
+   // each tag becomes the next parameter, as often as it is used
+   resip_assert(parameterize("SELECT a1 FROM u WHERE user = '$user' AND domain = '$domain'", "$%d", statement, tags));
+   resip_assert(statement == "SELECT a1 FROM u WHERE user = $3 AND domain = $4");
+   resip_assert(tags.size() == 2 && tags[0] == "user" && tags[1] == "domain");
+
+   resip_assert(parameterize("SELECT a1 FROM u WHERE (user = '$user' OR alias = '$user') AND domain = '$domain'", "?", statement, tags));
+   resip_assert(statement == "SELECT a1 FROM u WHERE (user = ? OR alias = ?) AND domain = ?");
+   resip_assert(tags.size() == 3 && tags[0] == "user" && tags[1] == "user" && tags[2] == "domain");
+
+   resip_assert(parameterize("SELECT a1 FROM u", "?", statement, tags));
+   resip_assert(statement == "SELECT a1 FROM u" && tags.empty());
+
+   // other literals and quoted identifiers are left as they are, quotes,
+   // doubled quotes and question marks included
+   resip_assert(parameterize("SELECT a1 FROM u WHERE \"us'er\" = '$user' AND note <> 'it''s ''?''' AND domain = '$domain'", "?", statement, tags));
+   resip_assert(statement == "SELECT a1 FROM u WHERE \"us'er\" = ? AND note <> 'it''s ''?''' AND domain = ?");
+   resip_assert(tags.size() == 2 && tags[0] == "user" && tags[1] == "domain");
+
+   resip_assert(parameterize("SELECT '?', \"?\" FROM u WHERE user = '$user'", "?", statement, tags));
+   resip_assert(statement == "SELECT '?', \"?\" FROM u WHERE user = ?");
+   resip_assert(tags.size() == 1);
+
+   // tags used in any other way can only be substituted, or the number of
+   // parameters would not match the tags
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE user = $user AND domain = '$domain'", "?", statement, tags));
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE user = '$user@$domain'", "?", statement, tags));
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE note = 'x''$user'''", "?", statement, tags));
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE user = '$user' AND domain = \"$domain\"", "?", statement, tags));
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE user = 'x\\' OR user = '$user'", "?", statement, tags));
+   resip_assert(!parameterize("SELECT a1 FROM u WHERE user = '$user", "?", statement, tags));
+   cerr << "testParameterize OK" << endl;
+}
+
+static void
+testPool()
+{
+   TestConfig config;
+   config.insertConfigValue("ConnectionPoolSize", "2");
+   TestSqlDb db(config);
+   resip_assert(db.connectionCount() == 2);
+
+   // connection 0 first, and a thread waits while none is free
+   unsigned int first = db.acquireConnection();
+   unsigned int second = db.acquireConnection();
+   resip_assert(first == 0 && second == 1);
+   Acquirer waiting(db);
+   waiting.run();
+   sleepMs(50);
+   resip_assert(!waiting.mAcquired);
+   db.releaseConnection(second);
+   waiting.join();
+   resip_assert(waiting.mAcquired && waiting.mConnection == 1);
+   db.releaseConnection(first);
+
+   // a guard holds its connection for its lifetime
+   {
+      TestSqlDb::ConnectionGuard guard(db);
+      resip_assert(guard.connection() == 0);
+      resip_assert(db.query("SELECT 1") == 0 && db.mLastConnection == 1);
+   }
+   resip_assert(db.query("SELECT 1") == 0 && db.mLastConnection == 0);
+
+   // a pinned connection serves every query of its thread, and only those
+   db.pinConnection();
+   unsigned int pinned = db.acquireConnection();
+   db.releaseConnection(pinned);
+   resip_assert(db.query("SELECT 1") == 0 && db.mLastConnection == pinned);
+   Acquirer other(db);
+   other.run();
+   other.join();
+   resip_assert(other.mConnection != pinned);
+   resip_assert(db.acquireConnection() == pinned);
+   db.releaseConnection(pinned);
+   db.unpinConnection();
+
+   // both are free again
+   first = db.acquireConnection();
+   second = db.acquireConnection();
+   resip_assert(first != second);
+   db.releaseConnection(second);
+   db.releaseConnection(first);
+   cerr << "testPool OK" << endl;
+}
+
+static void
+testConnected()
+{
+   TestConfig config;
+   config.insertConfigValue("ConnectionPoolSize", "2");
+   TestSqlDb db(config);
+   resip_assert(!db.isSane());
+
+   // sane while any connection is up
+   db.setConnected(0, true);
+   resip_assert(db.isSane());
+   db.setConnected(1, false);
+   resip_assert(db.isSane() && db.isConnected(0) && !db.isConnected(1));
+   db.setConnected(1, true);
+   db.setConnected(0, false);
+   resip_assert(db.isSane() && !db.isConnected(0));
+   db.setConnected(1, false);
+   resip_assert(!db.isSane());
+   cerr << "testConnected OK" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   testParameterize();
+   testPool();
+   testConnected();
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,304 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <iostream>
+#include <map>
+
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+
+#include "repro/AbstractDb.hxx"
+#include "repro/UserStore.hxx"
+
+using namespace resip;
+using namespace repro;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks the UserStore credential cache against an in-memory users table
+// that counts its queries, and times cached against uncached lookups when
+// each query takes a millisecond.
+
+class CountingDb : public AbstractDb
+{
+   public:
+      CountingDb() : mQueries(0), mQueryDelayMs(0) {}
+
+      virtual bool isSane() { return true; }
+
+      virtual bool addUser(const Key& key, const UserRecord& rec)
+      {
+         eraseUser(key);
+         mUsers[key] = rec;
+         mAuth[UserStore::buildKey(rec.user, rec.realm)] = rec.passwordHash;
+         return true;
+      }
+
+      virtual void eraseUser(const Key& key)
+      {
+         map<Key, UserRecord>::iterator it = mUsers.find(key);
+         if(it != mUsers.end())
+         {
+            mAuth.erase(UserStore::buildKey(it->second.user, it->second.realm));
+            mUsers.erase(it);
+         }
+      }
+
+      virtual UserRecord getUser(const Key& key) const
+      {
+         map<Key, UserRecord>::const_iterator it = mUsers.find(key);
+         return it == mUsers.end() ? UserRecord() : it->second;
+      }
+
+      // credentials are looked up as user@realm
+      virtual Data getUserAuthInfo(const Key& key) const
+      {
+         ++mQueries;
+         if(mQueryDelayMs)
+         {
+            sleepMs(mQueryDelayMs);
+         }
+         map<Key, Data>::const_iterator it = mAuth.find(key);
+         return it == mAuth.end() ? Data::Empty : it->second;
+      }
+
+      mutable unsigned int mQueries;
+      unsigned int mQueryDelayMs;
+
+   protected:
+      // only the users table is used, and that is overridden above
+      virtual bool dbWriteRecord(const Table table, const Data& key, const Data& data) { return false; }
+      virtual bool dbReadRecord(const Table table, const Data& key, Data& data) const { return false; }
+      virtual void dbEraseRecord(const Table table, const Data& key, bool isSecondaryKey=false) {}
+      virtual Data dbNextKey(const Table table, bool first=false) { return Data::Empty; }
+      virtual bool dbNextRecord(const Table table, const Data& key, Data& data, bool forUpdate, bool first=false) { return false; }
+      virtual bool dbBeginTransaction(const Table table) { return true; }
+      virtual bool dbCommitTransaction(const Table table) { return true; }
+      virtual bool dbRollbackTransaction(const Table table) { return true; }
+
+   private:
+      map<Key, UserRecord> mUsers;
+      map<Key, Data> mAuth;
+};
+
+static void
+testDisabled()
+{
+   CountingDb db;
+   UserStore store(db);
+   store.addUser("alice", "example.com", "example.com", "hash1", false, "Alice", "");
+
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(db.mQueries == 2);
+   UserStore::AuthCacheStats stats = store.getAuthCacheStats();
+   resip_assert(stats.mMisses == 0 && stats.mEntries == 0);
+   cerr << "testDisabled OK" << endl;
+}
+
+static void
+testCaching()
+{
+   CountingDb db;
+   UserStore store(db);
+   store.setAuthCacheLimits(2, 60, 60);
+   store.addUser("alice", "example.com", "example.com", "hash1", false, "Alice", "");
+
+   // positive entries
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(db.mQueries == 1);
+
+   // negative entries, replaced once the user is added
+   resip_assert(store.getUserAuthInfo("bob", "example.com").empty());
+   resip_assert(store.getUserAuthInfo("bob", "example.com").empty());
+   resip_assert(db.mQueries == 2);
+   store.addUser("bob", "example.com", "example.com", "hash2", false, "Bob", "");
+   resip_assert(store.getUserAuthInfo("bob", "example.com") == "hash2");
+   resip_assert(db.mQueries == 3);
+
+   // a changed password is seen at once
+   store.updateUser(UserStore::buildKey("alice", "example.com"),
+                    "alice", "example.com", "example.com", "hash3", false, "Alice", "");
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash3");
+   resip_assert(db.mQueries == 4);
+
+   // so is a renamed or erased user
+   store.updateUser(UserStore::buildKey("alice", "example.com"),
+                    "carol", "example.com", "example.com", "hash4", false, "Carol", "");
+   resip_assert(store.getUserAuthInfo("alice", "example.com").empty());
+   resip_assert(store.getUserAuthInfo("carol", "example.com") == "hash4");
+   store.eraseUser(UserStore::buildKey("bob", "example.com"));
+   resip_assert(store.getUserAuthInfo("bob", "example.com").empty());
+   resip_assert(db.mQueries == 7);
+
+   // two entries at most: carol pushed out bob, then bob pushed out alice,
+   // each the least recently used at the time
+   UserStore::AuthCacheStats stats = store.getAuthCacheStats();
+   resip_assert(stats.mEntries == 2);
+   resip_assert(stats.mEvictions == 2);
+   resip_assert(stats.mHits == 1);
+   resip_assert(stats.mNegativeHits == 1);
+   resip_assert(stats.mMisses == 7);
+   resip_assert(store.getUserAuthInfo("carol", "example.com") == "hash4");
+   resip_assert(store.getUserAuthInfo("alice", "example.com").empty());
+   resip_assert(db.mQueries == 8);
+
+   // explicit invalidation, as used by the command server
+   store.invalidateAuthInfo("carol", "example.com");
+   resip_assert(store.getUserAuthInfo("carol", "example.com") == "hash4");
+   resip_assert(db.mQueries == 9);
+   store.clearAuthCache();
+   resip_assert(store.getAuthCacheStats().mEntries == 0);
+   resip_assert(store.getUserAuthInfo("carol", "example.com") == "hash4");
+   resip_assert(db.mQueries == 10);
+   cerr << "testCaching OK" << endl;
+}
+
+static void
+testRealmChange()
+{
+   CountingDb db;
+   UserStore store(db);
+   store.setAuthCacheLimits(10, 60, 60);
+   store.addUser("alice", "example.com", "old.example.com", "hash1", false, "Alice", "");
+   store.addUser("bob", "example.com", "old.example.com", "hash2", false, "Bob", "");
+   resip_assert(store.getUserAuthInfo("alice", "old.example.com") == "hash1");
+   resip_assert(store.getUserAuthInfo("bob", "old.example.com") == "hash2");
+
+   // the entry for the old realm goes, whether or not the user is renamed
+   store.updateUser(UserStore::buildKey("alice", "example.com"),
+                    "alice", "example.com", "new.example.com", "hash3", false, "Alice", "");
+   resip_assert(store.getUserAuthInfo("alice", "old.example.com").empty());
+   resip_assert(store.getUserAuthInfo("alice", "new.example.com") == "hash3");
+   store.updateUser(UserStore::buildKey("bob", "example.com"),
+                    "carol", "example.com", "new.example.com", "hash4", false, "Carol", "");
+   resip_assert(store.getUserAuthInfo("bob", "old.example.com").empty());
+   resip_assert(store.getUserAuthInfo("carol", "new.example.com") == "hash4");
+
+   // and so does that of an erased user
+   store.eraseUser(UserStore::buildKey("alice", "example.com"));
+   resip_assert(store.getUserAuthInfo("alice", "new.example.com").empty());
+   resip_assert(db.mQueries == 7);
+   cerr << "testRealmChange OK" << endl;
+}
+
+static void
+testExpiry()
+{
+   CountingDb db;
+   UserStore store(db);
+   store.setAuthCacheLimits(10, 1, 0);
+   store.addUser("alice", "example.com", "example.com", "hash1", false, "Alice", "");
+
+   // unknown users are not cached with a negative ttl of 0
+   resip_assert(store.getUserAuthInfo("bob", "example.com").empty());
+   resip_assert(store.getUserAuthInfo("bob", "example.com").empty());
+   resip_assert(db.mQueries == 2);
+
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(db.mQueries == 3);
+   sleepMs(1100);
+   resip_assert(store.getUserAuthInfo("alice", "example.com") == "hash1");
+   resip_assert(db.mQueries == 4);
+   resip_assert(store.getAuthCacheStats().mEntries == 1);
+   cerr << "testExpiry OK" << endl;
+}
+
+static void
+benchmark(unsigned int users, unsigned int lookups)
+{
+   CountingDb db;
+   db.mQueryDelayMs = 1;
+   UserStore store(db);
+   for(unsigned int i = 0; i < users; ++i)
+   {
+      store.addUser("user" + Data(i), "example.com", "example.com", "hash" + Data(i), false, Data::Empty, Data::Empty);
+   }
+
+   for(int cached = 0; cached < 2; ++cached)
+   {
+      store.setAuthCacheLimits(cached ? users : 0, 60, 10);
+      unsigned int queries = db.mQueries;
+      UInt64 start = Timer::getTimeMicroSec();
+      for(unsigned int i = 0; i < lookups; ++i)
+      {
+         resip_assert(!store.getUserAuthInfo("user" + Data(i % users), "example.com").empty());
+      }
+      UInt64 elapsed = Timer::getTimeMicroSec() - start;
+      cerr << lookups << " lookups of " << users << " users " << (cached ? "with" : "without")
+           << " the cache: " << elapsed / lookups << " us each, "
+           << db.mQueries - queries << " queries" << endl;
+   }
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   testDisabled();
+   testCaching();
+   testRealmChange();
+   testExpiry();
+   benchmark(100, 2000);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
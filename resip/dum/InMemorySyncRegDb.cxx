@@ -1,6 +1,9 @@
+#include <algorithm>
+
 #include "resip/dum/InMemorySyncRegDb.hxx"
 #include "rutil/Timer.hxx"
 #include "rutil/Logger.hxx"
+#include "rutil/DnsUtil.hxx"
 #include "rutil/WinLeakCheck.hxx"
 
 using namespace resip;
@@ -20,9 +23,13 @@ public:
     {
        return mustRemove(rec);
     }
+    bool lingerOver(const ContactInstanceRecord& rec) const
+    {
+       return (rec.mRegExpires <= mNow) && ((mNow - rec.mLastUpdated) > mRemoveLingerSecs);
+    }
     bool mustRemove(const ContactInstanceRecord& rec)
     {
-       if((rec.mRegExpires <= mNow) && ((mNow - rec.mLastUpdated) > mRemoveLingerSecs)) 
+       if(lingerOver(rec)) 
        {
           DebugLog(<< "ContactInstanceRecord removed after linger: " << rec.mContact);
           return true;
@@ -60,12 +67,85 @@ InMemorySyncRegDb::InMemorySyncRegDb(unsigned int removeLingerSecs) :
 
 InMemorySyncRegDb::~InMemorySyncRegDb()
 {
-   for( database_map_t::const_iterator it = mDatabase.begin();
-        it != mDatabase.end(); it++)
+}
+
+ContactList&
+InMemorySyncRegDb::Record::modify()
+{
+   // New references are only taken under the shard lock, so a list no one
+   // else refers to can safely be changed in place.
+   if (!mContacts)
+   {
+      mContacts = std::make_shared<ContactList>();
+   }
+   else if (mContacts.use_count() > 1)
    {
-      delete it->second;
+      mContacts = std::make_shared<ContactList>(*mContacts);
    }
-   mDatabase.clear();
+   return *mContacts;
+}
+
+InMemorySyncRegDb::Shard&
+InMemorySyncRegDb::shardFor(const Uri& aor)
+{
+   // Only hash what Uri::operator< compares the same way for AORs that are
+   // equal: the user exactly, and the host ignoring case.  IPv6 hosts are
+   // canonicalized before they are compared, so they are left out.
+   size_t hash = aor.user().hash();
+   if (!DnsUtil::isIpV6Address(aor.host()))
+   {
+      hash ^= aor.host().caseInsensitivehash();
+   }
+   return mShards[hash % ShardCount];
+}
+
+std::shared_ptr<ContactList>
+InMemorySyncRegDb::prune(const std::shared_ptr<ContactList>& contacts, UInt64 now) const
+{
+   RemoveIfRequired rei(now, mRemoveLingerSecs);
+   for (ContactList::const_iterator it = contacts->begin(); it != contacts->end(); it++)
+   {
+      if (rei.lingerOver(*it))
+      {
+         std::shared_ptr<ContactList> pruned = std::make_shared<ContactList>(*contacts);
+         contactsRemoveIfRequired(*pruned, now, mRemoveLingerSecs);
+         return pruned;
+      }
+   }
+   return contacts;
+}
+
+InMemorySyncRegDb::ContactListPtr
+InMemorySyncRegDb::getSnapshot(const Uri& aor)
+{
+   Shard& shard = shardFor(aor);
+   std::shared_ptr<ContactList> contacts;
+   {
+      Lock g(shard.mMutex);
+      database_map_t::iterator i = shard.mDatabase.find(aor);
+      if (i == shard.mDatabase.end() || !i->second.mContacts)
+      {
+         return contacts;
+      }
+      contacts = i->second.mContacts;
+   }
+
+   if (mRemoveLingerSecs > 0)
+   {
+      std::shared_ptr<ContactList> pruned = prune(contacts, Timer::getTimeSecs());
+      if (pruned != contacts)
+      {
+         Lock g(shard.mMutex);
+         database_map_t::iterator i = shard.mDatabase.find(aor);
+         // don't overwrite a change made in the meantime
+         if (i != shard.mDatabase.end() && i->second.mContacts == contacts)
+         {
+            i->second.mContacts = pruned;
+         }
+         contacts = pruned;
+      }
+   }
+   return contacts;
 }
 
 void 
@@ -120,18 +200,30 @@ InMemorySyncRegDb::invokeOnInitialSyncAor(unsigned int connectionId, const resip
 void 
 InMemorySyncRegDb::initialSync(unsigned int connectionId)
 {
-   Lock g(mDatabaseMutex);
+   typedef std::vector<std::pair<Uri, ContactListPtr> > AorList;
    UInt64 now = Timer::getTimeSecs();
-   for(database_map_t::iterator it = mDatabase.begin(); it != mDatabase.end(); it++)
+   for (unsigned int s = 0; s < ShardCount; s++)
    {
-      if(it->second)
+      Shard& shard = mShards[s];
+      AorList aors;
       {
-         ContactList& contacts = *(it->second);
-         if(mRemoveLingerSecs > 0) 
+         Lock g(shard.mMutex);
+         aors.reserve(shard.mDatabase.size());
+         for(database_map_t::iterator it = shard.mDatabase.begin(); it != shard.mDatabase.end(); it++)
          {
-            contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
+            if(it->second.mContacts)
+            {
+               if(mRemoveLingerSecs > 0) 
+               {
+                  it->second.mContacts = prune(it->second.mContacts, now);
+               }
+               aors.push_back(std::make_pair(it->first, it->second.mContacts));
+            }
          }
-         invokeOnInitialSyncAor(connectionId, it->first, contacts);
+      }
+      for (AorList::const_iterator it = aors.begin(); it != aors.end(); it++)
+      {
+         invokeOnInitialSyncAor(connectionId, it->first, *it->second);
       }
    }
 }
@@ -140,22 +232,10 @@ void
 InMemorySyncRegDb::addAor(const Uri& aor,
                           const ContactList& contacts)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator it = mDatabase.find(aor);
-   if(it != mDatabase.end())
-   {
-       if(it->second)
-       {
-           *(it->second) = contacts;
-       }
-       else
-       {
-           it->second = new ContactList(contacts);
-       }
-   }
-   else
+   Shard& shard = shardFor(aor);
    {
-       mDatabase[aor] = new ContactList(contacts);
+      Lock g(shard.mMutex);
+      shard.mDatabase[aor].mContacts = std::make_shared<ContactList>(contacts);
    }
    invokeOnAorModified(true /* sync? */, aor, contacts);
 }
@@ -163,48 +243,57 @@ InMemorySyncRegDb::addAor(const Uri& aor,
 void 
 InMemorySyncRegDb::removeAor(const Uri& aor)
 {
-  database_map_t::iterator i;
-
-  Lock g(mDatabaseMutex);
-  i = mDatabase.find(aor);
-  //DebugLog (<< "Removing registration bindings " << aor);
-  if (i != mDatabase.end())
-  {
-     if (i->second)
-     {
-        if(mRemoveLingerSecs > 0)
-        {
-           ContactList& contacts = *(i->second);
-           UInt64 now = Timer::getTimeSecs();
-           for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
-           {
-              // Don't delete record - set expires to 0
-              it->mRegExpires = 0;
-              it->mLastUpdated = now;
-           }
-           invokeOnAorModified(true /* sync? */, aor, contacts);
-        }
-        else
-        {
-           delete i->second;
-           // Setting this to 0 causes it to be removed when we unlock the AOR.
-           i->second = 0;
-           ContactList emptyList;
-           invokeOnAorModified(true /* sync? */, aor, emptyList);
-        }
-     }
-  }
+   Shard& shard = shardFor(aor);
+   ContactListPtr contacts;
+   {
+      Lock g(shard.mMutex);
+      database_map_t::iterator i = shard.mDatabase.find(aor);
+      //DebugLog (<< "Removing registration bindings " << aor);
+      if (i == shard.mDatabase.end() || !i->second.mContacts)
+      {
+         return;
+      }
+
+      Record& record = i->second;
+      if(mRemoveLingerSecs > 0)
+      {
+         ContactList& removed = record.modify();
+         UInt64 now = Timer::getTimeSecs();
+         for(ContactList::iterator it = removed.begin(); it != removed.end(); it++)
+         {
+            // Don't delete record - set expires to 0
+            it->mRegExpires = 0;
+            it->mLastUpdated = now;
+         }
+         contacts = record.mContacts;
+      }
+      else
+      {
+         record.mContacts.reset();
+         // A locked record is removed from the map when the AOR is unlocked.
+         if (!record.mLocked && record.mWaiters == 0)
+         {
+            shard.mDatabase.erase(i);
+         }
+         contacts = std::make_shared<const ContactList>();
+      }
+   }
+   invokeOnAorModified(true /* sync? */, aor, *contacts);
 }
 
 void
 InMemorySyncRegDb::getAors(InMemorySyncRegDb::UriList& container)
 {
    container.clear();
-   Lock g(mDatabaseMutex);
-   for( database_map_t::const_iterator it = mDatabase.begin();
-        it != mDatabase.end(); it++)
+   for (unsigned int s = 0; s < ShardCount; s++)
    {
-      container.push_back(it->first);
+      Shard& shard = mShards[s];
+      Lock g(shard.mMutex);
+      for( database_map_t::const_iterator it = shard.mDatabase.begin();
+           it != shard.mDatabase.end(); it++)
+      {
+         container.push_back(it->first);
+      }
    }
 }
 
@@ -217,34 +306,38 @@ InMemorySyncRegDb::aorIsRegistered(const Uri& aor)
 bool 
 InMemorySyncRegDb::aorIsRegistered(const Uri& aor, UInt64* maxExpires)
 {
-   Lock g(mDatabaseMutex);
-   bool registered = false;
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i != mDatabase.end() && i->second != 0)
+   ContactListPtr contacts;
    {
-      if (mRemoveLingerSecs > 0 || maxExpires)
+      Shard& shard = shardFor(aor);
+      Lock g(shard.mMutex);
+      database_map_t::iterator i = shard.mDatabase.find(aor);
+      if (i == shard.mDatabase.end() || !i->second.mContacts)
       {
-         ContactList& contacts = *(i->second);
-         UInt64 now = Timer::getTimeSecs();
-         for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
-         {
-            if(it->mRegExpires > now)
-            {
-               registered = true;
-               if (maxExpires)
-               {
-                  *maxExpires = resipMax(*maxExpires, it->mRegExpires);
-               }
-               else
-               {
-                  break; // Not looking for maxExpires - so we can quit iterating now
-               }
-            }
-         }
+         return false;
       }
-      else
+      contacts = i->second.mContacts;
+   }
+
+   if (mRemoveLingerSecs == 0 && !maxExpires)
+   {
+      return true;
+   }
+
+   bool registered = false;
+   UInt64 now = Timer::getTimeSecs();
+   for(ContactList::const_iterator it = contacts->begin(); it != contacts->end(); it++)
+   {
+      if(it->mRegExpires > now)
       {
          registered = true;
+         if (maxExpires)
+         {
+            *maxExpires = resipMax(*maxExpires, it->mRegExpires);
+         }
+         else
+         {
+            break; // Not looking for maxExpires - so we can quit iterating now
+         }
       }
    }
    return registered;
@@ -253,170 +346,178 @@ InMemorySyncRegDb::aorIsRegistered(const Uri& aor, UInt64* maxExpires)
 void
 InMemorySyncRegDb::lockRecord(const Uri& aor)
 {
-   Lock g2(mLockedRecordsMutex);
+   Shard& shard = shardFor(aor);
+   Lock g(shard.mMutex);
 
    DebugLog(<< "InMemorySyncRegDb::lockRecord:  aor=" << aor << " threadid=" << ThreadIf::selfId());
 
+   // This forces insertion if the record does not yet exist.  The record
+   // stays put while we wait, since it is not erased while it has waiters.
+   Record& record = shard.mDatabase[aor];
+   if (record.mLocked)
    {
-      Lock g1(mDatabaseMutex);
-      // This forces insertion if the record does not yet exist.
-      mDatabase[aor];
-   }
-
-   while (mLockedRecords.count(aor))
-   {
-      mRecordUnlocked.wait(mLockedRecordsMutex);
+      if (!record.mUnlocked)
+      {
+         record.mUnlocked = new Condition;
+      }
+      record.mWaiters++;
+      while (record.mLocked)
+      {
+         record.mUnlocked->wait(shard.mMutex);
+      }
+      if (--record.mWaiters == 0)
+      {
+         delete record.mUnlocked;
+         record.mUnlocked = 0;
+      }
    }
-
-   mLockedRecords.insert(aor);
+   record.mLocked = true;
 }
 
 void
 InMemorySyncRegDb::unlockRecord(const Uri& aor)
 {
-   Lock g2(mLockedRecordsMutex);
+   Shard& shard = shardFor(aor);
+   Lock g(shard.mMutex);
 
    DebugLog(<< "InMemorySyncRegDb::unlockRecord:  aor=" << aor << " threadid=" << ThreadIf::selfId());
 
-   {
-      Lock g1(mDatabaseMutex);
-      // If the pointer is null, we remove the record from the map.
-      database_map_t::iterator i = mDatabase.find(aor);
+   database_map_t::iterator i = shard.mDatabase.find(aor);
 
-      // The record must have been inserted when we locked it in the first place
-      resip_assert (i != mDatabase.end());
+   // The record must have been inserted when we locked it in the first place
+   resip_assert (i != shard.mDatabase.end());
 
-      if (i->second == 0)
-      {
-         mDatabase.erase(i);
-      }
+   Record& record = i->second;
+   record.mLocked = false;
+   if (record.mWaiters > 0)
+   {
+      record.mUnlocked->signal();
+   }
+   else if (!record.mContacts)
+   {
+      // If the pointer is null, we remove the record from the map.
+      shard.mDatabase.erase(i);
    }
-
-   mLockedRecords.erase(aor);
-   mRecordUnlocked.broadcast();
 }
 
 RegistrationPersistenceManager::update_status_t 
 InMemorySyncRegDb::updateContact(const resip::Uri& aor, 
                                  const ContactInstanceRecord& rec) 
 {
-   ContactList *contactList = 0;
-
+   Shard& shard = shardFor(aor);
+   update_status_t status = CONTACT_CREATED;
+   ContactListPtr contacts;
    {
-      Lock g(mDatabaseMutex);
+      Lock g(shard.mMutex);
 
-      database_map_t::iterator i;
-      i = mDatabase.find(aor);
-      if (i == mDatabase.end() || i->second == 0)
-      {
-         contactList = new ContactList();
-         mDatabase[aor] = contactList;
-      }
-      else
-      {
-         contactList = i->second;
-      }
-   }
-   
-   resip_assert(contactList);
+      Record& record = shard.mDatabase[aor];
+      ContactList& contactList = record.modify();
 
-   ContactList::iterator j;
+      ContactList::iterator j;
 
-   // See if the contact is already present. We use URI matching rules here.
-   for (j = contactList->begin(); j != contactList->end(); j++)
-   {
-      if (*j == rec)
+      // See if the contact is already present. We use URI matching rules here.
+      for (j = contactList.begin(); j != contactList.end(); j++)
       {
-         update_status_t status = CONTACT_UPDATED;
-         if(mRemoveLingerSecs > 0 && j->mRegExpires == 0)
+         if (*j == rec)
          {
-            // If records linger, then check if updating a lingering record, if so
-            // modify status to CREATED so that ServerRegistration will properly generate
-            // an onAdd callback, instead of onRefresh.
-            // When contacts linger, their expires time is set to 0
-            status = CONTACT_CREATED;
+            status = CONTACT_UPDATED;
+            if(mRemoveLingerSecs > 0 && j->mRegExpires == 0)
+            {
+               // If records linger, then check if updating a lingering record, if so
+               // modify status to CREATED so that ServerRegistration will properly generate
+               // an onAdd callback, instead of onRefresh.
+               // When contacts linger, their expires time is set to 0
+               status = CONTACT_CREATED;
+            }
+            *j=rec;
+            break;
          }
-         *j=rec;
-         // Only pass sync as true if this update didn't just come from an inbound sync operation
-         invokeOnAorModified(!rec.mSyncContact /* sync? */, aor, *contactList);
-         return status;
       }
+
+      if (j == contactList.end())
+      {
+         // This is a new contact, so we add it to the list.
+         contactList.push_back(rec);
+      }
+      contacts = record.mContacts;
    }
 
-   // This is a new contact, so we add it to the list.
-   contactList->push_back(rec);
    // Only pass sync as true if this update didn't just come from an inbound sync operation
-   invokeOnAorModified(!rec.mSyncContact /* sync? */, aor, *contactList);
-   return CONTACT_CREATED;
+   invokeOnAorModified(!rec.mSyncContact /* sync? */, aor, *contacts);
+   return status;
 }
 
 void 
 InMemorySyncRegDb::removeContact(const Uri& aor, 
                                  const ContactInstanceRecord& rec)
 {
-   ContactList *contactList = 0;
-
+   Shard& shard = shardFor(aor);
+   ContactListPtr contacts;
+   bool sync = !rec.mSyncContact;
    {
-      Lock g(mDatabaseMutex);
+      Lock g(shard.mMutex);
 
-      database_map_t::iterator i;
-      i = mDatabase.find(aor);
-      if (i == mDatabase.end() || i->second == 0)
+      database_map_t::iterator i = shard.mDatabase.find(aor);
+      if (i == shard.mDatabase.end() || !i->second.mContacts)
       {
          return;
       }
-      contactList = i->second;
-   }
 
-   ContactList::iterator j;
+      // See if the contact is present. We use URI matching rules here.
+      Record& record = i->second;
+      if (std::find(record.mContacts->begin(), record.mContacts->end(), rec) == record.mContacts->end())
+      {
+         return;
+      }
 
-   // See if the contact is present. We use URI matching rules here.
-   for (j = contactList->begin(); j != contactList->end(); j++)
-   {
-      if (*j == rec)
+      ContactList& contactList = record.modify();
+      ContactList::iterator j = std::find(contactList.begin(), contactList.end(), rec);
+
+      if(mRemoveLingerSecs > 0)
+      {
+         j->mRegExpires = 0;
+         j->mLastUpdated = Timer::getTimeSecs();
+         contacts = record.mContacts;
+      }
+      else
       {
-         if(mRemoveLingerSecs > 0)
+         contactList.erase(j);
+         if (contactList.empty())
          {
-            j->mRegExpires = 0;
-            j->mLastUpdated = Timer::getTimeSecs();
-            // Only pass sync as true if this update didn't just come from an inbound sync operation
-            invokeOnAorModified(!rec.mSyncContact /* sync? */, aor, *contactList);
+            // The last binding is gone, so the AOR goes too; this is always
+            // passed on as a sync, as removeAor() does.
+            sync = true;
+            contacts = record.mContacts;
+            record.mContacts.reset();
+            if (!record.mLocked && record.mWaiters == 0)
+            {
+               shard.mDatabase.erase(i);
+            }
          }
          else
          {
-            contactList->erase(j);
-            if (contactList->empty())
-            {
-               removeAor(aor);
-            }
-            else
-            {
-               // Only pass sync as true if this update didn't just come from an inbound sync operation
-               invokeOnAorModified(!rec.mSyncContact /* sync? */, aor, *contactList);
-            }
+            contacts = record.mContacts;
          }
-         return;
       }
    }
+
+   // Only pass sync as true if this update didn't just come from an inbound sync operation
+   invokeOnAorModified(sync, aor, *contacts);
 }
 
 void
 InMemorySyncRegDb::getContacts(const Uri& aor, ContactList& container)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i == mDatabase.end() || i->second == 0)
+   ContactListPtr contacts = getSnapshot(aor);
+   container.clear();
+   if (!contacts)
    {
-      container.clear();
       return;
    }
    if(mRemoveLingerSecs > 0)
    {
-      ContactList& contacts = *(i->second);
       UInt64 now = Timer::getTimeSecs();
-      contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
-      container.clear();
-      for(ContactList::iterator it = contacts.begin(); it != contacts.end(); it++)
+      for(ContactList::const_iterator it = contacts->begin(); it != contacts->end(); it++)
       {
          if(it->mRegExpires > now)
          {
@@ -426,27 +527,20 @@ InMemorySyncRegDb::getContacts(const Uri& aor, ContactList& container)
    }
    else
    {
-      container = *(i->second);
+      container = *contacts;
    }
 }
 
 void
 InMemorySyncRegDb::getContactsFull(const Uri& aor, ContactList& container)
 {
-   Lock g(mDatabaseMutex);
-   database_map_t::iterator i = mDatabase.find(aor);
-   if (i == mDatabase.end() || i->second == 0)
+   ContactListPtr contacts = getSnapshot(aor);
+   if (!contacts)
    {
       container.clear();
       return;
    }
-   ContactList& contacts = *(i->second);
-   if(mRemoveLingerSecs > 0)
-   {
-      UInt64 now = Timer::getTimeSecs();
-      contactsRemoveIfRequired(contacts, now, mRemoveLingerSecs);
-   }
-   container = contacts;
+   container = *contacts;
 }
 
 
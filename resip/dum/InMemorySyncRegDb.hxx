@@ -2,8 +2,8 @@
 #define RESIP_INMEMORYSYNCREGDB_HXX
 
 #include <map>
-#include <set>
 #include <list>
+#include <memory>
 
 #include "resip/dum/RegistrationPersistenceManager.hxx"
 #include "rutil/Mutex.hxx"
@@ -48,6 +48,11 @@ protected:
   transport registration bindings to a remote peer for replication.
   See the RegSyncClient and RegSyncServer implementations in the repro
   project.
+
+  The AORs are split over a number of independently locked shards, and
+  a thread waiting in lockRecord() only waits for that one AOR, so
+  REGISTERs and lookups for different AORs proceed in parallel.  Handlers
+  are called without any database lock held.
 */
 class InMemorySyncRegDb : public RegistrationPersistenceManager
 {
@@ -81,13 +86,44 @@ class InMemorySyncRegDb : public RegistrationPersistenceManager
       virtual void getAors(UriList& container);
       
    protected:
-      typedef std::map<Uri,ContactList *> database_map_t;
-      database_map_t mDatabase;
-      Mutex mDatabaseMutex;
-
-      std::set<Uri> mLockedRecords;
-      Mutex mLockedRecordsMutex;
-      Condition mRecordUnlocked;
+      typedef std::shared_ptr<const ContactList> ContactListPtr;
+
+      // An AOR's bindings and the state of its record lock.  Readers take a
+      // reference to the binding list and release the shard lock at once;
+      // a list that anyone else holds a reference to is never modified,
+      // writers replace it with a modified copy instead.
+      class Record
+      {
+         public:
+            Record() : mLocked(false), mWaiters(0), mUnlocked(0) {}
+
+            // the bindings, to be changed under the shard lock
+            ContactList& modify();
+
+            std::shared_ptr<ContactList> mContacts; // null once the AOR has been removed
+            bool mLocked;
+            unsigned int mWaiters;
+            Condition* mUnlocked; // only exists while there are waiters
+      };
+      typedef std::map<Uri,Record> database_map_t;
+
+      // AORs are spread over a fixed number of shards by a hash of the
+      // AOR, so that registrations and lookups of different AORs rarely
+      // contend for the same lock.
+      class Shard
+      {
+         public:
+            database_map_t mDatabase;
+            Mutex mMutex;
+      };
+      static const unsigned int ShardCount = 64;
+      Shard mShards[ShardCount];
+
+      Shard& shardFor(const Uri& aor);
+      // returns the current bindings of aor (null if there are none),
+      // after dropping any whose linger time has passed
+      ContactListPtr getSnapshot(const Uri& aor);
+      std::shared_ptr<ContactList> prune(const std::shared_ptr<ContactList>& contacts, UInt64 now) const;
 
       void invokeOnAorModified(bool sync, const resip::Uri& aor, const ContactList& contacts);
       void invokeOnInitialSyncAor(unsigned int connectionId, const resip::Uri& aor, const ContactList& contacts);
@@ -0,0 +1,335 @@
+#include <iostream>
+
+#include "resip/dum/InMemorySyncRegDb.hxx"
+#include "resip/dum/InMemoryRegistrationDatabase.hxx"
+#include "resip/stack/NameAddr.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/ThreadIf.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+static Uri
+aorUri(int n)
+{
+   return Uri("sip:user" + Data(n) + "@example.com");
+}
+
+static ContactInstanceRecord
+contact(const Data& host, UInt64 expires, bool sync = false)
+{
+   ContactInstanceRecord rec;
+   rec.mContact = NameAddr("sip:phone@" + host);
+   rec.mRegExpires = expires;
+   rec.mLastUpdated = Timer::getTimeSecs();
+   rec.mSyncContact = sync;
+   return rec;
+}
+
+class CountingHandler : public InMemorySyncRegDbHandler
+{
+   public:
+      CountingHandler() : mModified(0), mLastSize(0) {}
+      virtual void onAorModified(const Uri& aor, const ContactList& contacts)
+      {
+         mModified++;
+         mLastAor = aor;
+         mLastSize = contacts.size();
+      }
+      int mModified;
+      Uri mLastAor;
+      size_t mLastSize;
+};
+
+static void
+testBasics()
+{
+   InMemorySyncRegDb db;
+   CountingHandler handler;
+   db.addHandler(&handler);
+   UInt64 expires = Timer::getTimeSecs() + 3600;
+   Uri aor("sip:alice@example.com");
+
+   db.lockRecord(aor);
+   assert(db.updateContact(aor, contact("10.0.0.1", expires)) == RegistrationPersistenceManager::CONTACT_CREATED);
+   assert(db.updateContact(aor, contact("10.0.0.2", expires)) == RegistrationPersistenceManager::CONTACT_CREATED);
+   assert(db.updateContact(aor, contact("10.0.0.1", expires + 10)) == RegistrationPersistenceManager::CONTACT_UPDATED);
+   db.unlockRecord(aor);
+   assert(handler.mModified == 3);
+   assert(handler.mLastSize == 2);
+
+   // the AOR matches regardless of the case of the host
+   ContactList contacts;
+   db.getContacts(Uri("sip:alice@EXAMPLE.com"), contacts);
+   assert(contacts.size() == 2);
+   assert(contacts.front().mRegExpires == expires + 10);
+   assert(db.aorIsRegistered(aor));
+   UInt64 maxExpires = 0;
+   assert(db.aorIsRegistered(aor, &maxExpires));
+   assert(maxExpires == expires + 10);
+
+   // a contact that came in by sync is not passed back to the sync handler
+   db.updateContact(aor, contact("10.0.0.3", expires, true));
+   assert(handler.mModified == 3);
+
+   db.lockRecord(aor);
+   db.removeContact(aor, contact("10.0.0.1", 0));
+   db.removeContact(aor, contact("10.0.0.2", 0));
+   db.removeContact(aor, contact("10.0.0.3", 0));
+   // the AOR stays until it is unlocked
+   RegistrationPersistenceManager::UriList aors;
+   db.getAors(aors);
+   assert(aors.size() == 1);
+   db.unlockRecord(aor);
+   assert(handler.mModified == 6);
+   assert(handler.mLastSize == 0);
+   assert(!db.aorIsRegistered(aor));
+   db.getContacts(aor, contacts);
+   assert(contacts.empty());
+   db.getAors(aors);
+   assert(aors.empty());
+
+   ContactList list;
+   list.push_back(contact("10.0.0.4", expires));
+   db.addAor(Uri("sip:bob@example.com"), list);
+   db.addAor(Uri("sip:carol@example.com"), list);
+   db.getAors(aors);
+   assert(aors.size() == 2);
+   db.removeAor(Uri("sip:bob@example.com"));
+   db.getAors(aors);
+   assert(aors.size() == 1 && aors.front() == Uri("sip:carol@example.com"));
+
+   db.removeHandler(&handler);
+   cerr << "testBasics OK" << endl;
+}
+
+static void
+testLinger()
+{
+   InMemorySyncRegDb db(3600);
+   UInt64 now = Timer::getTimeSecs();
+   Uri aor("sip:alice@example.com");
+
+   db.updateContact(aor, contact("10.0.0.1", now + 3600));
+   db.updateContact(aor, contact("10.0.0.2", now + 3600));
+   db.removeContact(aor, contact("10.0.0.1", 0));
+
+   ContactList contacts;
+   db.getContacts(aor, contacts);
+   assert(contacts.size() == 1);
+   db.getContactsFull(aor, contacts);
+   assert(contacts.size() == 2);
+
+   // refreshing a lingering contact counts as creating it
+   assert(db.updateContact(aor, contact("10.0.0.1", now + 3600)) == RegistrationPersistenceManager::CONTACT_CREATED);
+
+   db.removeAor(aor);
+   assert(!db.aorIsRegistered(aor));
+   db.getContactsFull(aor, contacts);
+   assert(contacts.size() == 2);
+
+   // once the linger time is over, the bindings are dropped
+   ContactInstanceRecord old = contact("10.0.0.5", now - 7200);
+   old.mLastUpdated = now - 7200;
+   Uri aor2("sip:bob@example.com");
+   db.updateContact(aor2, old);
+   db.getContactsFull(aor2, contacts);
+   assert(contacts.empty());
+
+   cerr << "testLinger OK" << endl;
+}
+
+class Locker : public ThreadIf
+{
+   public:
+      Locker(RegistrationPersistenceManager& db, const Uri& aor, int rounds, int& inside) :
+         mDb(db), mAor(aor), mRounds(rounds), mInside(inside), mOverlaps(0) {}
+      virtual void thread()
+      {
+         for (int i = 0; i < mRounds; i++)
+         {
+            mDb.lockRecord(mAor);
+            if (++mInside != 1)
+            {
+               mOverlaps++;
+            }
+            mDb.updateContact(mAor, contact("10.0.0." + Data(i % 4), Timer::getTimeSecs() + 3600));
+            --mInside;
+            mDb.unlockRecord(mAor);
+         }
+      }
+      RegistrationPersistenceManager& mDb;
+      Uri mAor;
+      int mRounds;
+      int& mInside;
+      int mOverlaps;
+};
+
+static void
+testLocking()
+{
+   InMemorySyncRegDb db;
+   Uri aor("sip:alice@example.com");
+   int inside = 0;
+   Locker a(db, aor, 2000, inside);
+   Locker b(db, aor, 2000, inside);
+   Locker c(db, aor, 2000, inside);
+   a.run();
+   b.run();
+   c.run();
+
+   // a record held by one thread does not hold up other AORs
+   Uri other("sip:bob@example.com");
+   db.lockRecord(other);
+   db.unlockRecord(other);
+
+   a.join();
+   b.join();
+   c.join();
+   assert(a.mOverlaps + b.mOverlaps + c.mOverlaps == 0);
+
+   ContactList contacts;
+   db.getContacts(aor, contacts);
+   assert(contacts.size() == 4);
+   RegistrationPersistenceManager::UriList aors;
+   db.getAors(aors);
+   assert(aors.size() == 1);
+
+   cerr << "testLocking OK" << endl;
+}
+
+// A worker registering and looking up its own range of AORs.
+class Registrar : public ThreadIf
+{
+   public:
+      Registrar(RegistrationPersistenceManager& db, int first, int count, int rounds) :
+         mDb(db), mFirst(first), mCount(count), mRounds(rounds) {}
+      virtual void thread()
+      {
+         UInt64 expires = Timer::getTimeSecs() + 3600;
+         ContactList contacts;
+         for (int r = 0; r < mRounds; r++)
+         {
+            for (int i = mFirst; i < mFirst + mCount; i++)
+            {
+               Uri aor = aorUri(i);
+               mDb.lockRecord(aor);
+               mDb.updateContact(aor, contact("10.0.0.1", expires));
+               mDb.unlockRecord(aor);
+               // lookups outnumber registrations
+               for (int l = 0; l < 4; l++)
+               {
+                  mDb.getContacts(aor, contacts);
+               }
+            }
+         }
+      }
+      RegistrationPersistenceManager& mDb;
+      int mFirst;
+      int mCount;
+      int mRounds;
+};
+
+static UInt64
+run(RegistrationPersistenceManager& db, int threads, int aors, int rounds)
+{
+   vector<Registrar*> registrars;
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int t = 0; t < threads; t++)
+   {
+      registrars.push_back(new Registrar(db, t * aors, aors, rounds));
+      registrars.back()->run();
+   }
+   for (int t = 0; t < threads; t++)
+   {
+      registrars[t]->join();
+      delete registrars[t];
+   }
+   return Timer::getTimeMicroSec() - start;
+}
+
+static void
+benchmark(int threads, int aors, int rounds)
+{
+   InMemoryRegistrationDatabase single;
+   InMemorySyncRegDb sharded;
+   // same population for both
+   run(single, threads, aors, 1);
+   run(sharded, threads, aors, 1);
+
+   int operations = threads * aors * rounds * 5;
+   UInt64 singleUs = run(single, threads, aors, rounds);
+   UInt64 shardedUs = run(sharded, threads, aors, rounds);
+   cerr << threads << " threads, " << threads * aors << " AORs, "
+        << operations << " operations" << endl;
+   cerr << "   InMemoryRegistrationDatabase: " << singleUs / 1000 << " ms, "
+        << (double)operations * 1000 / singleUs << " ops/ms" << endl;
+   cerr << "   InMemorySyncRegDb:            " << shardedUs / 1000 << " ms, "
+        << (double)operations * 1000 / shardedUs << " ops/ms" << endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+   Log::initialize(Log::Cout, argc > 1 ? Log::toLevel(argv[1]) : Log::Warning, argv[0]);
+
+   testBasics();
+   testLinger();
+   testLocking();
+   benchmark(8, 2000, 5);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -127,7 +127,7 @@ Auth::parseAuthParameters(ParseBuffer& pb)
          Parameter* p=createParam(type, pb, terminators, getPool());
          if (!p)
          {
-            mUnknownParameters.push_back(new UnknownParameter(keyStart, 
+            mUnknownParameters.push_back(new (getPool()) UnknownParameter(keyStart, 
                                                               int((keyEnd - keyStart)), pb, 
                                                               terminators));
          }
@@ -236,7 +236,7 @@ Auth::param(const _enum##_Param& paramType)
    _enum##_Param::Type* p = static_cast<_enum##_Param::Type*>(getParameterByEnum(paramType.getTypeNum()));      \
    if (!p)                                                                                                      \
    {                                                                                                            \
-      p = new _enum##_Param::Type(paramType.getTypeNum());                                                      \
+      p = new (getPool()) _enum##_Param::Type(paramType.getTypeNum());                                          \
       mParameters.push_back(p);                                                                                 \
    }                                                                                                            \
    return p->value();                                                                                           \
@@ -274,7 +274,7 @@ Auth::param(const qop_Param& paramType)
    DataParameter* p = static_cast<DataParameter*>(getParameterByEnum(paramType.getTypeNum()));
    if (!p)
    {
-      p = new DataParameter(ParameterTypes::qop);
+      p = new (getPool()) DataParameter(ParameterTypes::qop);
       p->setQuoted(false);
       mParameters.push_back(p);
    }
@@ -301,7 +301,7 @@ Auth::param(const qopOptions_Param& paramType)
    DataParameter* p = static_cast<DataParameter*>(getParameterByEnum(paramType.getTypeNum()));
    if (!p)
    {
-      p = new DataParameter(ParameterTypes::qopOptions);
+      p = new (getPool()) DataParameter(ParameterTypes::qopOptions);
       p->setQuoted(true);
       mParameters.push_back(p);
    }
@@ -25,6 +25,7 @@ BranchParameter::BranchParameter(ParameterTypes::Type type,
      mHasMagicCookie(false),
      mIsMyBranch(false),
      mTransactionId(),
+     mTransactionIdHash(0),
      mTransportSeq(1),
      mClientData(),
      mInteropMagicCookie(0),
@@ -90,10 +91,12 @@ BranchParameter::BranchParameter(ParameterTypes::Type type,
       }
       pb.skipToOneOf(delimiter);
       pb.data(mTransactionId, start);
+      mTransactionIdHash = mTransactionId.caseInsensitiveTokenHash();
    }
    catch(resip::ParseException& e)
    {
       mTransactionId=Random::getRandomHex(8);
+      mTransactionIdHash = mTransactionId.caseInsensitiveTokenHash();
       throw e;
    }
 }
@@ -103,6 +106,7 @@ BranchParameter::BranchParameter(ParameterTypes::Type type)
      mHasMagicCookie(true),
      mIsMyBranch(true),
      mTransactionId(Random::getRandomHex(8)),
+     mTransactionIdHash(mTransactionId.caseInsensitiveTokenHash()),
      mTransportSeq(1),
      mInteropMagicCookie(0),
      mSigcompCompartment()
@@ -114,6 +118,7 @@ BranchParameter::BranchParameter(const BranchParameter& other)
      mHasMagicCookie(other.mHasMagicCookie),
      mIsMyBranch(other.mIsMyBranch),
      mTransactionId(other.mTransactionId),
+     mTransactionIdHash(other.mTransactionIdHash),
      mTransportSeq(other.mTransportSeq),
      mClientData(other.mClientData),
      mSigcompCompartment(other.mSigcompCompartment)
@@ -141,6 +146,7 @@ BranchParameter::operator=(const BranchParameter& other)
       mHasMagicCookie = other.mHasMagicCookie;
       mIsMyBranch = other.mIsMyBranch;
       mTransactionId = other.mTransactionId;
+      mTransactionIdHash = other.mTransactionIdHash;
       mTransportSeq = other.mTransportSeq;
       mClientData = other.mClientData;
       mSigcompCompartment = other.mSigcompCompartment;
@@ -249,6 +255,7 @@ BranchParameter::reset(const Data& transactionId)
    {
       mTransactionId = Random::getRandomHex(8);
    }
+   mTransactionIdHash = mTransactionId.caseInsensitiveTokenHash();
 }
 
 Parameter* 
@@ -257,6 +264,12 @@ BranchParameter::clone() const
    return new BranchParameter(*this);
 }
 
+Parameter* 
+BranchParameter::clone(PoolBase* pool) const
+{
+   return new (pool) BranchParameter(*this);
+}
+
 EncodeStream& 
 BranchParameter::encode(EncodeStream& stream) const
 {
@@ -39,6 +39,10 @@ class BranchParameter : public Parameter
       // returns tid
       const Data& getTransactionId() const;
 
+      // returns getTransactionId().caseInsensitiveTokenHash(), computed once
+      // when the tid is parsed or set
+      size_t getTransactionIdHash() const { return mTransactionIdHash; }
+
       // increments the transport sequence component - not part of tid
       void incrementTransportSequence();
 
@@ -63,6 +67,7 @@ class BranchParameter : public Parameter
       }
       
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       virtual EncodeStream& encode(EncodeStream& stream) const;
 
       BranchParameter(const BranchParameter& other);
@@ -75,6 +80,7 @@ class BranchParameter : public Parameter
       bool mHasMagicCookie;
       bool mIsMyBranch;
       Data mTransactionId;
+      size_t mTransactionIdHash;
       unsigned int mTransportSeq;
       Data mClientData;
       //magic cookie for interop; if case is different some proxies will treat this as a different tid
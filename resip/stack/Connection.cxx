@@ -259,6 +259,13 @@ Connection::performWrite()
       }
    }
 
+   if (mSendingTransmissionFormat == Uncompressed)
+   {
+      // Everything queued up behind the front goes out with it, without
+      // being copied into one buffer first.
+      return performGatheredWrite();
+   }
+
    const Data& data = mOutstandingSends.front()->data;
    int nBytes = write(data.data() + mSendPos,int(data.size() - mSendPos));
 
@@ -290,6 +297,74 @@ Connection::performWrite()
    }
 }
 
+int
+Connection::performGatheredWrite()
+{
+   std::pair<const char*, size_t> buffers[MaxGatherCount];
+   int count = 0;
+   Data::size_type offset = mSendPos;
+   for (std::list<SendData*>::const_iterator it = mOutstandingSends.begin();
+        it != mOutstandingSends.end() && count < MaxGatherCount; ++it)
+   {
+      if ((*it)->command != SendData::NoCommand)
+      {
+         break;
+      }
+      const Data& data = (*it)->data;
+      buffers[count++] = std::make_pair(data.data() + offset, data.size() - offset);
+      offset = 0;
+   }
+   resip_assert(count > 0);
+
+   int nBytes = writev(buffers, count);
+   if (nBytes < 0)
+   {
+      InfoLog(<< "Write failed on socket: " << this->getSocket() << ", closing connection");
+      return -1;
+   }
+
+   // Retire what was written completely; mSendPos is where to pick up in
+   // the message that was written partially, if any.
+   size_t written = static_cast<size_t>(nBytes);
+   while (written > 0)
+   {
+      size_t left = mOutstandingSends.front()->data.size() - mSendPos;
+      if (written < left)
+      {
+         mSendPos += static_cast<Data::size_type>(written);
+         break;
+      }
+      written -= left;
+      mSendPos = 0;
+      removeFrontOutstandingSend();
+   }
+   return nBytes;
+}
+
+int
+Connection::writev(const std::pair<const char*, size_t>* buffers, int count)
+{
+   int total = 0;
+   for (int i = 0; i < count; ++i)
+   {
+      if (buffers[i].second == 0)
+      {
+         continue;
+      }
+      int nBytes = write(buffers[i].first, (int)buffers[i].second);
+      if (nBytes < 0)
+      {
+         // report what did get written; the error shows up again next time
+         return total > 0 ? total : nBytes;
+      }
+      total += nBytes;
+      if (nBytes < (int)buffers[i].second)
+      {
+         break;
+      }
+   }
+   return total;
+}
 
 bool 
 Connection::performWrites(unsigned int max)
@@ -2,6 +2,7 @@
 #define RESIP_Connection_hxx
 
 #include <list>
+#include <utility>
 
 #include "resip/stack/ConnectionBase.hxx"
 //#include "rutil/Fifo.hxx"
@@ -109,6 +110,14 @@ class Connection : public ConnectionBase,
       virtual int read(char* /* buffer */, const int /* count */) { return 0; }
       /// pure virtual, but need concrete Connection for book-ends of lists
       virtual int write(const char* /* buffer */, const int /* count */) { return 0; }
+      /** Writes the buffers back to back; returns what write() would return
+          for their concatenation. This default calls write() for one buffer
+          after the other; connections that can gather the buffers into a
+          single system call override it. */
+      virtual int writev(const std::pair<const char*, size_t>* buffers, int count);
+
+      /// most queued messages handed to writev() at once
+      enum { MaxGatherCount = 64 };
       virtual void onDoubleCRLF();
       virtual void onSingleCRLF();
 
@@ -120,6 +129,7 @@ class Connection : public ConnectionBase,
    private:
       ConnectionManager& getConnectionManager() const;
       void removeFrontOutstandingSend();
+      int performGatheredWrite();
       bool mInWritable;
       bool mFlowTimerEnabled;
       FdPollItemHandle mPollItemHandle;
@@ -60,6 +60,7 @@ ConnectionBase::ConnectionBase(Transport* transport, const Tuple& who, Compressi
      mSendingTransmissionFormat(Unknown),
      mReceivingTransmissionFormat(Unknown),
      mMessage(0),
+     mSlabEnd(0),
      mBuffer(0),
      mBufferPos(0),
      mBufferSize(0),
@@ -105,7 +106,6 @@ ConnectionBase::~ConnectionBase()
       delete sendData;
       mOutstandingSends.pop_front();
    }
-   delete [] mBuffer;
    delete mMessage;
 #ifdef USE_SIGCOMP
    delete mSigcompStack;
@@ -153,8 +153,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
             }
             else
             {
-               delete [] mBuffer;
-               mBuffer = 0;
+               releaseSlab();
                return true;
             }
          }
@@ -170,8 +169,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
             }
             else
             {
-               delete [] mBuffer;
-               mBuffer = 0;
+               releaseSlab();
                return true;
             }
          }
@@ -208,8 +206,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
          {
             //.jacob. Not a terribly informative warning.
             WarningLog(<< "Discarding preparse!");
-            delete [] mBuffer;
-            mBuffer = 0;
+            releaseSlab();
             delete mMessage;
             mMessage = 0;
             mConnState = NewMessage;
@@ -219,8 +216,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
          if (mMsgHeaderScanner.getHeaderCount() > 1024)
          {
             WarningLog(<< "Discarding preparse; too many headers");
-            delete [] mBuffer;
-            mBuffer = 0;
+            releaseSlab();
             delete mMessage;
             mMessage = 0;
             mConnState = NewMessage;
@@ -235,8 +231,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
          {
             WarningLog(<< "Discarding preparse; header-field-value (or "
                         "header name) too long");
-            delete [] mBuffer;
-            mBuffer = 0;
+            releaseSlab();
             delete mMessage;
             mMessage = 0;
             mConnState = NewMessage;
@@ -246,33 +241,26 @@ ConnectionBase::preparseNewBytes(int bytesRead)
          if(numUnprocessedChars==chunkLength)
          {
             // .bwc. MsgHeaderScanner wasn't able to parse anything useful;
-            // don't bother mMessage yet, but make more room in mBuffer.
-            size_t size = numUnprocessedChars*3/2;
-            if (size < ConnectionBase::ChunkSize)
-            {
-               size = ConnectionBase::ChunkSize;
-            }
-            char* newBuffer = 0;
+            // don't bother mMessage yet, but make sure there is more room
+            // in mBuffer.
             try
             {
-               newBuffer=MsgHeaderScanner::allocateBuffer((int)size);
+               keepUnparsedBytes(unprocessedCharPtr, numUnprocessedChars,
+                                 numUnprocessedChars*3/2);
             }
             catch(std::bad_alloc&)
             {
                ErrLog(<<"Failed to alloc a buffer during preparse!");
                return false;
             }
-            memcpy(newBuffer, unprocessedCharPtr, numUnprocessedChars);
-            delete [] mBuffer;
-            mBuffer = newBuffer;
             mBufferPos = numUnprocessedChars;
-            mBufferSize = size;
             mConnState = ReadingHeaders;
             return true;
          }
 
-         mMessage->addBuffer(mBuffer);
-         mBuffer=0;
+         // mMessage now refers to text in the slab, so it keeps a
+         // reference; the rest of the slab stays ours to read into.
+         mMessage->addBuffer(mSlab);
 
          if (scanChunkResult == MsgHeaderScanner::scrNextChunk)
          {
@@ -284,7 +272,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                //DebugLog(<< "Data assigned, not fragmented, not complete");
                try
                {
-                  mBuffer = MsgHeaderScanner::allocateBuffer(ChunkSize);
+                  keepUnparsedBytes(mBuffer + chunkLength, 0, ChunkSize);
                }
                catch(std::bad_alloc&)
                {
@@ -292,30 +280,21 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                   return false;
                }
                mBufferPos = 0;
-               mBufferSize = ChunkSize;
             }
             else
             {
-               // ...but some of the chunk must be shifted into the next one.
-               size_t size = numUnprocessedChars*3/2;
-               if (size < ConnectionBase::ChunkSize)
-               {
-                  size = ConnectionBase::ChunkSize;
-               }
-               char* newBuffer = 0;
+               // ...but some of the chunk must be carried into the next one.
                try
                {
-                  newBuffer = MsgHeaderScanner::allocateBuffer((int)size);
+                  keepUnparsedBytes(unprocessedCharPtr, numUnprocessedChars,
+                                    numUnprocessedChars*3/2);
                }
                catch(std::bad_alloc&)
                {
                   ErrLog(<<"Failed to alloc a buffer during preparse!");
                   return false;
                }
-               memcpy(newBuffer, unprocessedCharPtr, numUnprocessedChars);
-               mBuffer = newBuffer;
                mBufferPos = numUnprocessedChars;
-               mBufferSize = size;
             }
             mConnState = ReadingHeaders;
          }
@@ -335,9 +314,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                // .bwc. Bad Content-Length. We are hosed.
                delete mMessage;
                mMessage = 0;
-               mBuffer = 0;
-               // .bwc. mMessage just took ownership of mBuffer, so we don't
-               // delete it here. We do zero it though, for completeness.
+               releaseSlab();
                //.jacob. Shouldn't the state also be set here?
                return false;
             }
@@ -348,9 +325,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                            "transport exceeds maximum " << messageSizeMax);
                delete mMessage;
                mMessage = 0;
-               mBuffer = 0;
-               // .bwc. mMessage just took ownership of mBuffer, so we don't
-               // delete it here. We do zero it though, for completeness.
+               releaseSlab();
                //.jacob. Shouldn't the state also be set here?
                return false;
             }
@@ -362,11 +337,8 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                size_t newSize=resipMin(resipMax((size_t)numUnprocessedChars*3/2,
                                              (size_t)ConnectionBase::ChunkSize),
                                     contentLength);
-               char* newBuffer = MsgHeaderScanner::allocateBuffer((int)newSize);
-               memcpy(newBuffer, unprocessedCharPtr, numUnprocessedChars);
+               keepUnparsedBytes(unprocessedCharPtr, numUnprocessedChars, newSize);
                mBufferPos = numUnprocessedChars;
-               mBufferSize = newSize;
-               mBuffer = newBuffer;
                
                mConnState = PartialBody;
             }
@@ -378,28 +350,24 @@ ConnectionBase::preparseNewBytes(int bytesRead)
                int overHang = numUnprocessedChars - (int)contentLength;
 
                mConnState = NewMessage;
-               mBuffer = 0;
                if (overHang > 0) 
                {
-                  // The next message has been partially read.
-                  size_t size = overHang*3/2;
-                  if (size < ConnectionBase::ChunkSize)
-                  {
-                     size = ConnectionBase::ChunkSize;
-                  }
-                  char* newBuffer = MsgHeaderScanner::allocateBuffer((int)size);
-                  memcpy(newBuffer,
-                         unprocessedCharPtr + contentLength,
-                         overHang);
-                  mBuffer = newBuffer;
+                  // The next message has been partially read; it is parsed
+                  // where it is if the slab has room for it to grow.
+                  keepUnparsedBytes(unprocessedCharPtr + contentLength,
+                                    overHang,
+                                    overHang*3/2);
                   mBufferPos = 0;
-                  mBufferSize = size;
                   
                   DebugLog (<< "Extra bytes after message: " << overHang);
                   //DebugLog (<< Data(mBuffer, overHang));
                   
                   bytesRead = overHang;
                }
+               else
+               {
+                  releaseSlab();
+               }
 
                // The message body is complete.
                mMessage->setBody(unprocessedCharPtr, (UInt32)contentLength);
@@ -461,8 +429,7 @@ ConnectionBase::preparseNewBytes(int bytesRead)
             WarningLog(<<"Malformed Content-Length in connection-based transport"
                         ". Not much we can do to fix this. " << e);
             // .bwc. Bad Content-Length. We are hosed.
-            delete [] mBuffer;
-            mBuffer = 0;
+            releaseSlab();
             delete mMessage;
             mMessage = 0;
             //.jacob. Shouldn't the state also be set here?
@@ -475,30 +442,25 @@ ConnectionBase::preparseNewBytes(int bytesRead)
             int overHang = mBufferPos - (int)contentLength;
             char *overHangStart = mBuffer + contentLength;
 
-            mMessage->addBuffer(mBuffer);
+            mMessage->addBuffer(mSlab);
             mMessage->setBody(mBuffer, (UInt32)contentLength);
             mConnState = NewMessage;
-            mBuffer = 0;
 
             if (overHang > 0)
             {
                 // The next message has been partially read.
-                size_t size = overHang * 3 / 2;
-                if (size < ConnectionBase::ChunkSize)
-                {
-                    size = ConnectionBase::ChunkSize;
-                }
-                char* newBuffer = MsgHeaderScanner::allocateBuffer((int)size);
-                memcpy(newBuffer, overHangStart, overHang);
-                mBuffer = newBuffer;
+                keepUnparsedBytes(overHangStart, overHang, overHang * 3 / 2);
                 mBufferPos = 0;
-                mBufferSize = size;
 
                 DebugLog(<< "Extra bytes after message: " << overHang);
                 //DebugLog(<< Data(mBuffer, overHang));
 
                 bytesRead = overHang;
             }
+            else
+            {
+                releaseSlab();
+            }
 
             // .bwc. basicCheck takes up substantial CPU. Don't bother doing it
             // if we're overloaded.
@@ -550,20 +512,15 @@ ConnectionBase::preparseNewBytes(int bytesRead)
             // .bwc. We've filled our buffer and haven't read contentLength bytes yet; go ahead and make more room.
             resip_assert(contentLength >= mBufferSize);
             size_t newSize = resipMin(mBufferSize*3/2, contentLength);
-            char* newBuffer = 0;
             try
             {
-               newBuffer=new char[newSize];
+               keepUnparsedBytes(mBuffer, mBufferPos, newSize);
             }
             catch(std::bad_alloc&)
             {
                ErrLog(<<"Failed to alloc a buffer while receiving body!");
                return false;
             }
-            memcpy(newBuffer, mBuffer, mBufferSize);
-            mBufferSize=newSize;
-            delete [] mBuffer;
-            mBuffer = newBuffer;
          }
          break;
       }
@@ -1045,8 +1002,7 @@ ConnectionBase::getWriteBuffer()
       {
          DebugLog (<< "Creating buffer for " << *this);
 
-         mBuffer = MsgHeaderScanner::allocateBuffer(ConnectionBase::ChunkSize);
-         mBufferSize = ConnectionBase::ChunkSize;
+         allocateSlab(ConnectionBase::ChunkSize);
       }
       mBufferPos = 0;
    }
@@ -1067,11 +1023,10 @@ ConnectionBase::getWriteBufferForExtraBytes(int bytesRead, int extraBytes)
    {
       if (((size_t)currentPos + (size_t)extraBytes) > mBufferSize)
       {
-         mBufferSize = currentPos + extraBytes;
-         char* buffer = MsgHeaderScanner::allocateBuffer((int)mBufferSize);
-         memcpy(buffer, mBuffer, currentPos);
-         delete[] mBuffer;
-         mBuffer = buffer;
+         std::shared_ptr<char> oldSlab(mSlab);
+         char* oldBuffer = mBuffer;
+         allocateSlab(currentPos + extraBytes);
+         memcpy(mBuffer, oldBuffer, currentPos);
       }
       return &mBuffer[currentPos];
    }
@@ -1085,11 +1040,52 @@ ConnectionBase::getWriteBufferForExtraBytes(int bytesRead, int extraBytes)
 void 
 ConnectionBase::setBuffer(char* bytes, int count)
 {
+   mSlab.reset(bytes, std::default_delete<char[]>());
+   mSlabEnd = bytes + count;
    mBuffer = bytes;
    mBufferPos = 0;
    mBufferSize = count;
 }
 
+void
+ConnectionBase::allocateSlab(size_t size)
+{
+   mSlab.reset(MsgHeaderScanner::allocateBuffer((int)size), std::default_delete<char[]>());
+   mSlabEnd = mSlab.get() + size;
+   mBuffer = mSlab.get();
+   mBufferSize = size;
+}
+
+void
+ConnectionBase::keepUnparsedBytes(char* start, size_t count, size_t newSlabSize)
+{
+   // Messages parsed from the slab only look at the bytes before start,
+   // so we can keep reading into the rest of it while they are in use.
+   if (mSlab && start >= mSlab.get() && 
+       (size_t)(mSlabEnd - start) >= count + MinSlabRoom)
+   {
+      mBuffer = start;
+      mBufferSize = mSlabEnd - start;
+   }
+   else
+   {
+      // keeps the unparsed bytes alive until they are copied
+      std::shared_ptr<char> oldSlab(mSlab);
+      allocateSlab(resipMax(newSlabSize, (size_t)ConnectionBase::ChunkSize));
+      resip_assert(count <= mBufferSize);
+      memcpy(mBuffer, start, count);
+   }
+}
+
+void
+ConnectionBase::releaseSlab()
+{
+   mSlab.reset();
+   mSlabEnd = 0;
+   mBuffer = 0;
+   mBufferSize = 0;
+}
+
 Transport* 
 ConnectionBase::transport() const
 {
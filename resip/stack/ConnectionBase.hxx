@@ -3,6 +3,7 @@
 
 #include <deque>
 #include <list>
+#include <memory>
 
 #include "rutil/Timer.hxx"
 // #include "rutil/Fifo.hxx"
@@ -55,6 +56,12 @@ class ConnectionBase
          //      also good for the larger SDP coming in with ICE attributes,
          //      multiple media streams, etc
 
+      // Bytes that follow a complete message in a receive slab (pipelined
+      // messages) are parsed in place, and the messages share the slab, as
+      // long as at least this much of the slab is left for the next read.
+      // Otherwise they are moved to a fresh slab.
+      enum { MinSlabRoom = 2048 };
+
    protected:
       enum ConnState
       {
@@ -103,6 +110,9 @@ class ConnectionBase
       std::unique_ptr<Data> makeWsHandshakeResponse();
       bool isUsingSecWebSocketKey();
       bool isUsingDeprecatedSecWebSocketKeys();
+      void allocateSlab(size_t size);
+      void keepUnparsedBytes(char* start, size_t count, size_t newSlabSize);
+      void releaseSlab();
    protected:
       virtual void onDoubleCRLF(){}
       virtual void onSingleCRLF(){}
@@ -118,6 +128,10 @@ class ConnectionBase
 
    private:
       SipMessage* mMessage;
+      // The receive slab is shared (by reference count) with the messages
+      // parsed out of it; mBuffer is where the unparsed bytes start in it.
+      std::shared_ptr<char> mSlab;
+      char* mSlabEnd;
       char* mBuffer;
       size_t mBufferPos;
       size_t mBufferSize;
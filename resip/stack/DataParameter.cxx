@@ -73,6 +73,12 @@ DataParameter::clone() const
    return new DataParameter(*this);
 }
 
+Parameter* 
+DataParameter::clone(PoolBase* pool) const
+{
+   return new (pool) DataParameter(*this);
+}
+
 EncodeStream& 
 DataParameter::encode(EncodeStream& stream) const
 {
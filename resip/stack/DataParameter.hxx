@@ -38,6 +38,7 @@ class DataParameter : public Parameter
       }
       
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       virtual EncodeStream& encode(EncodeStream& stream) const;
       
       Type& value() {return mValue;}            // does not return a quoted string
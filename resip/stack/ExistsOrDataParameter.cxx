@@ -56,6 +56,12 @@ ExistsOrDataParameter::clone() const
    return new ExistsOrDataParameter(*this);
 }
 
+Parameter* 
+ExistsOrDataParameter::clone(PoolBase* pool) const
+{
+   return new (pool) ExistsOrDataParameter(*this);
+}
+
 EncodeStream& 
 ExistsOrDataParameter::encode(EncodeStream& stream) const
 {
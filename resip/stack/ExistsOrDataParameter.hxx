@@ -29,6 +29,7 @@ class ExistsOrDataParameter : public DataParameter
                                  PoolBase* pool);
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       
    protected:
       ExistsOrDataParameter(const ExistsOrDataParameter& other) 
@@ -42,6 +42,12 @@ ExistsParameter::clone() const
    return new ExistsParameter(*this);
 }
 
+Parameter* 
+ExistsParameter::clone(PoolBase* pool) const
+{
+   return new (pool) ExistsParameter(*this);
+}
+
 EncodeStream&
 ExistsParameter::encode(EncodeStream& stream) const
 {
@@ -33,6 +33,7 @@ class ExistsParameter : public Parameter
       }
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       virtual EncodeStream& encode(EncodeStream& stream) const;
       Type& value() {return mValue;}
 
@@ -43,6 +43,12 @@ FloatParameter::clone() const
    return new FloatParameter(*this);
 }
 
+Parameter* 
+FloatParameter::clone(PoolBase* pool) const
+{
+   return new (pool) FloatParameter(*this);
+}
+
 EncodeStream&
 FloatParameter::encode(ostream& stream) const
 {
@@ -30,6 +30,7 @@ class FloatParameter : public Parameter
       }
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       virtual EncodeStream& encode(std::ostream& stream) const;
 
    private:
@@ -134,7 +134,7 @@ GenericUri::param(const _enum##_Param& paramType)
       static_cast<_enum##_Param::Type*>(getParameterByEnum(paramType.getTypeNum()));                            \
    if (!p)                                                                                                      \
    {                                                                                                            \
-      p = new _enum##_Param::Type(paramType.getTypeNum());                                                      \
+      p = new (getPool()) _enum##_Param::Type(paramType.getTypeNum());                                          \
       mParameters.push_back(p);                                                                                 \
    }                                                                                                            \
    return p->value();                                                                                           \
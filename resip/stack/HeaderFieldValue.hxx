@@ -41,6 +41,17 @@ class HeaderFieldValue
       HeaderFieldValue(const HeaderFieldValue& hfv);
       HeaderFieldValue(const HeaderFieldValue& hfv, CopyPaddingEnum);
       HeaderFieldValue(const HeaderFieldValue& hfv, NoOwnershipEnum);
+      // Takes over orig's buffer (and its ownership), so that containers of 
+      // header field values can grow without copying the text.
+      HeaderFieldValue(HeaderFieldValue&& orig) noexcept
+         : mField(orig.mField),
+           mFieldLength(orig.mFieldLength),
+           mMine(orig.mMine)
+      {
+         orig.mField=0;
+         orig.mFieldLength=0;
+         orig.mMine=false;
+      }
       HeaderFieldValue& operator=(const HeaderFieldValue&);
       HeaderFieldValue& copyWithPadding(const HeaderFieldValue& rhs);
       HeaderFieldValue& swap(HeaderFieldValue& orig);
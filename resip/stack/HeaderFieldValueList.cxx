@@ -42,7 +42,7 @@ HeaderFieldValueList::HeaderFieldValueList(const HeaderFieldValueList& rhs, Pool
 {
    if (rhs.mParserContainer)
    {
-      mParserContainer = rhs.mParserContainer->clone();
+      mParserContainer = rhs.mParserContainer->clone(pool);
    }
    else if(rhs.mHeaders.size())
    {
@@ -61,7 +61,8 @@ HeaderFieldValueList::operator=(const HeaderFieldValueList& rhs)
 
       if (rhs.mParserContainer != 0)
       {
-         mParserContainer = rhs.mParserContainer->clone();
+         mParserContainer = mPool ? rhs.mParserContainer->clone(*mPool) : 
+                                    rhs.mParserContainer->clone();
       }
       else
       {
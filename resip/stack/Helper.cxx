@@ -701,6 +701,36 @@ Helper::makeNonce(const SipMessage& request, const Data& timestamp)
 }
 
 static Data noBody = MD5Stream().getHex();
+
+#ifndef RESIP_DIGEST_LOGGING
+// The digest response is a few MD5s over short strings; hash the pieces
+// straight into an MD5Context rather than building them up in streams.
+static void
+md5Update(MD5Context& context, const char* data, Data::size_type len)
+{
+   MD5Update(&context, reinterpret_cast<const md5byte*>(data), (unsigned)len);
+}
+
+static void
+md5Update(MD5Context& context, const Data& data)
+{
+   md5Update(context, data.data(), data.size());
+}
+
+static void
+md5FinalHex(MD5Context& context, char hex[32])
+{
+   static const char hexmap[] = "0123456789abcdef";
+   unsigned char digest[16];
+   MD5Final(digest, &context);
+   for (int i = 0; i < 16; ++i)
+   {
+      hex[2*i] = hexmap[digest[i] >> 4];
+      hex[2*i+1] = hexmap[digest[i] & 0x0f];
+   }
+}
+#endif
+
 Data 
 Helper::makeResponseMD5WithA1(const Data& a1,
                               const Data& method, const Data& digestUri, const Data& nonce,
@@ -710,9 +740,6 @@ Helper::makeResponseMD5WithA1(const Data& a1,
 #ifdef RESIP_DIGEST_LOGGING
    Data _a2;
    DataStream a2(_a2);
-#else
-   MD5Stream a2;
-#endif
    a2 << method
       << Symbols::COLON
       << digestUri;
@@ -724,25 +751,17 @@ Helper::makeResponseMD5WithA1(const Data& a1,
          MD5Stream eStream;
          eStream << *entityBody;
          a2 << Symbols::COLON << eStream.getHex();
-#ifdef RESIP_DIGEST_LOGGING
          StackLog(<<"auth-int, body length = " << eStream.bytesTaken());
-#endif
       }
       else
       {
          a2 << Symbols::COLON << noBody;
-#ifdef RESIP_DIGEST_LOGGING
          StackLog(<<"auth-int, no body");
-#endif
       }
    }
    
-#ifdef RESIP_DIGEST_LOGGING
    Data _r;
    DataStream r(_r);
-#else
-   MD5Stream r;
-#endif
    r << a1
      << Symbols::COLON
      << nonce
@@ -757,7 +776,6 @@ Helper::makeResponseMD5WithA1(const Data& a1,
         << qop
         << Symbols::COLON;
    }
-#ifdef RESIP_DIGEST_LOGGING
    a2.flush();
    StackLog(<<"A2 = " << _a2);
    MD5Stream a2md5;
@@ -769,9 +787,49 @@ Helper::makeResponseMD5WithA1(const Data& a1,
    rmd5 << _r;
    return rmd5.getHex();
 #else
-   r << a2.getHex();
+   MD5Context a2;
+   MD5Init(&a2);
+   md5Update(a2, method);
+   md5Update(a2, Symbols::COLON, 1);
+   md5Update(a2, digestUri);
+
+   if (qop == Symbols::authInt)
+   {
+      md5Update(a2, Symbols::COLON, 1);
+      if (entityBody)
+      {
+         MD5Stream eStream;
+         eStream << *entityBody;
+         md5Update(a2, eStream.getHex());
+      }
+      else
+      {
+         md5Update(a2, noBody);
+      }
+   }
+   char a2Hex[32];
+   md5FinalHex(a2, a2Hex);
+
+   MD5Context r;
+   MD5Init(&r);
+   md5Update(r, a1);
+   md5Update(r, Symbols::COLON, 1);
+   md5Update(r, nonce);
+   md5Update(r, Symbols::COLON, 1);
 
-   return r.getHex();
+   if (!qop.empty())
+   {
+      md5Update(r, cnonceCount);
+      md5Update(r, Symbols::COLON, 1);
+      md5Update(r, cnonce);
+      md5Update(r, Symbols::COLON, 1);
+      md5Update(r, qop);
+      md5Update(r, Symbols::COLON, 1);
+   }
+   md5Update(r, a2Hex, sizeof(a2Hex));
+   char response[32];
+   md5FinalHex(r, response);
+   return Data(response, sizeof(response));
 #endif
 }
 
@@ -782,6 +840,7 @@ Helper::makeResponseMD5(const Data& username, const Data& password, const Data&
                         const Data& qop, const Data& cnonce, const Data& cnonceCount,
                         const Contents *entity)
 {
+#ifdef RESIP_DIGEST_LOGGING
    MD5Stream a1;
    a1 << username
       << Symbols::COLON
@@ -791,6 +850,20 @@ Helper::makeResponseMD5(const Data& username, const Data& password, const Data&
  
    return makeResponseMD5WithA1(a1.getHex(), method, digestUri, nonce, qop, 
                                 cnonce, cnonceCount, entity);
+#else
+   MD5Context a1;
+   MD5Init(&a1);
+   md5Update(a1, username);
+   md5Update(a1, Symbols::COLON, 1);
+   md5Update(a1, realm);
+   md5Update(a1, Symbols::COLON, 1);
+   md5Update(a1, password);
+   char a1Hex[32];
+   md5FinalHex(a1, a1Hex);
+
+   return makeResponseMD5WithA1(Data(Data::Share, a1Hex, sizeof(a1Hex)), method, digestUri,
+                                nonce, qop, cnonce, cnonceCount, entity);
+#endif
 }
 
 static Data digest("digest");
@@ -876,12 +949,10 @@ Helper::advancedAuthenticateRequest(const SipMessage& request,
                }
             }
 
-            Data then(x_nonce.getCreationTime());
-            if (i->param(p_nonce) != makeNonce(request, then))
+            if (!getNonceHelper()->isValidNonce(request, i->param(p_nonce), x_nonce.getCreationTime()))
             {
-               InfoLog(<< "Not my nonce. expected=" << makeNonce(request, then) 
-                       << " received=" << i->param(p_nonce)
-                       << " then=" << then);
+               InfoLog(<< "Not my nonce. received=" << i->param(p_nonce)
+                       << " then=" << x_nonce.getCreationTime());
                
                return make_pair(BadlyFormed,username);
             }
@@ -901,6 +972,11 @@ Helper::advancedAuthenticateRequest(const SipMessage& request,
                                                                i->param(p_nc),
                                                                request.getContents()))
                      {
+                        if(getNonceHelper()->isReplay(i->param(p_nonce), x_nonce.getCreationTime(), i->param(p_nc)))
+                        {
+                           InfoLog(<< "Nonce count " << i->param(p_nc) << " already used with nonce " << i->param(p_nonce));
+                           return make_pair(Expired,username);
+                        }
                         if(i->exists(p_username))
                         {
                            username = i->param(p_username);
@@ -1032,8 +1108,7 @@ Helper::authenticateRequest(const SipMessage& request,
             }
          }
 
-         Data then(x_nonce.getCreationTime());
-         if (i->param(p_nonce) != makeNonce(request, then))
+         if (!getNonceHelper()->isValidNonce(request, i->param(p_nonce), x_nonce.getCreationTime()))
          {
             InfoLog(<< "Not my nonce.");
             return Failed;
@@ -1063,6 +1138,11 @@ Helper::authenticateRequest(const SipMessage& request,
                                                             i->param(p_nc),
                                                             request.getContents()))
                   {
+                     if (getNonceHelper()->isReplay(i->param(p_nonce), x_nonce.getCreationTime(), i->param(p_nc)))
+                     {
+                        InfoLog(<< "Nonce count " << i->param(p_nc) << " already used with nonce " << i->param(p_nonce));
+                        return Expired;
+                     }
                      return Authenticated;
                   }
                   else
@@ -1187,9 +1267,7 @@ Helper::authenticateRequestWithA1(const SipMessage& request,
             }
          }
 
-         Data then(x_nonce.getCreationTime());
-
-         if (i->param(p_nonce) != makeNonce(request, then))
+         if (!getNonceHelper()->isValidNonce(request, i->param(p_nonce), x_nonce.getCreationTime()))
          {
             InfoLog(<< "Not my nonce.");
             return Failed;
@@ -1217,6 +1295,11 @@ Helper::authenticateRequestWithA1(const SipMessage& request,
                                                                   i->param(p_nc),
                                                                   request.getContents()))
                   {
+                     if (getNonceHelper()->isReplay(i->param(p_nonce), x_nonce.getCreationTime(), i->param(p_nc)))
+                     {
+                        InfoLog(<< "Nonce count " << i->param(p_nc) << " already used with nonce " << i->param(p_nonce));
+                        return Expired;
+                     }
                      return Authenticated;
                   }
                   else
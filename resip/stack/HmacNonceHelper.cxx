@@ -0,0 +1,293 @@
+#include <string.h>
+
+#include "resip/stack/HmacNonceHelper.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::SIP
+
+static const char hexmap[] = "0123456789abcdef";
+
+static int
+hexValue(char c)
+{
+   if (c >= '0' && c <= '9')
+   {
+      return c - '0';
+   }
+   if (c >= 'a' && c <= 'f')
+   {
+      return c - 'a' + 10;
+   }
+   if (c >= 'A' && c <= 'F')
+   {
+      return c - 'A' + 10;
+   }
+   return -1;
+}
+
+HmacNonceHelper::HmacNonceHelper(unsigned int maxNonceAge, size_t maxNonces) :
+   mHmac(Random::getRandomHex(24)),
+   mSalt((UInt32)Random::getRandom()),
+   mMaxNonceAge(maxNonceAge),
+   mMaxNonces(resipMax(maxNonces, (size_t)1)),
+   mLastPrune(0),
+   mForgottenUpTo(0)
+{
+}
+
+HmacNonceHelper::~HmacNonceHelper()
+{
+}
+
+void
+HmacNonceHelper::setPrivateKey(const Data& privateKey)
+{
+   mHmac = HmacSHA256(privateKey);
+}
+
+void
+HmacNonceHelper::makeMac(const char* prefix, size_t prefixLen,
+                         const SipMessage& request, char mac[MacSize]) const
+{
+   SHA256 inner = mHmac.begin();
+   inner.update(prefix, prefixLen);
+   inner.update(request.header(h_From).uri().user());
+   unsigned char digest[SHA256::DigestSize];
+   mHmac.end(inner, digest);
+   for (int i = 0; i < MacSize / 2; ++i)
+   {
+      mac[2*i] = hexmap[digest[i] >> 4];
+      mac[2*i+1] = hexmap[digest[i] & 0x0f];
+   }
+}
+
+Data
+HmacNonceHelper::makeNonce(const SipMessage& request, const Data& timestamp)
+{
+   char nonce[MaxNonceSize];
+   size_t len = resipMin(timestamp.size(), (Data::size_type)MaxTimestampSize);
+   memcpy(nonce, timestamp.data(), len);
+   nonce[len++] = ':';
+   UInt32 salt = mSalt++;
+   for (int i = SaltSize - 1; i >= 0; --i)
+   {
+      nonce[len + i] = hexmap[salt & 0x0f];
+      salt >>= 4;
+   }
+   len += SaltSize;
+   nonce[len++] = ':';
+   makeMac(nonce, len, request, nonce + len);
+   return Data(nonce, len + MacSize);
+}
+
+NonceHelper::Nonce
+HmacNonceHelper::parseNonce(const Data& nonce)
+{
+   UInt64 creationTime = 0;
+   Data::size_type i = 0;
+   for (; i < nonce.size() && i < MaxTimestampSize && isdigit((unsigned char)nonce[i]); ++i)
+   {
+      creationTime = creationTime * 10 + (nonce[i] - '0');
+   }
+   if (i == 0 || i == nonce.size() || nonce[i] != ':')
+   {
+      DebugLog(<< "Invalid nonce; expected timestamp.");
+      return Nonce(0);
+   }
+   return Nonce(creationTime);
+}
+
+bool
+HmacNonceHelper::isValidNonce(const SipMessage& request, const Data& nonce, UInt64 creationTime)
+{
+   if (nonce.size() > MaxNonceSize || nonce.size() < 1 + 1 + SaltSize + 1 + MacSize)
+   {
+      return false;
+   }
+   const size_t prefixLen = nonce.size() - MacSize;
+   const char* data = nonce.data();
+   if (data[prefixLen - 1] != ':' || data[prefixLen - 2 - SaltSize] != ':' ||
+       parseNonce(nonce).getCreationTime() != creationTime)
+   {
+      return false;
+   }
+
+   char mac[MacSize];
+   makeMac(data, prefixLen, request, mac);
+   // compare all of it, so that the time taken does not say how much matched
+   unsigned char diff = 0;
+   for (int i = 0; i < MacSize; ++i)
+   {
+      diff |= (unsigned char)(mac[i] ^ data[prefixLen + i]);
+   }
+   return diff == 0;
+}
+
+bool
+HmacNonceHelper::isReplay(const Data& nonce, UInt64 creationTime, const Data& nc)
+{
+   if (mMaxNonceAge == 0)
+   {
+      return false;
+   }
+
+   // nc is 8 hex digits (RFC 2617 3.2.2)
+   UInt32 count = 0;
+   if (nc.empty() || nc.size() > 8)
+   {
+      return true;
+   }
+   for (Data::size_type i = 0; i < nc.size(); ++i)
+   {
+      int v = hexValue(nc[i]);
+      if (v < 0)
+      {
+         return true;
+      }
+      count = (count << 4) | v;
+   }
+   if (count == 0)
+   {
+      return true;
+   }
+
+   UInt64 now = Timer::getTimeSecs();
+   if (creationTime + mMaxNonceAge < now)
+   {
+      // too old to still be tracked, so it cannot be trusted
+      DebugLog(<< "Nonce older than " << mMaxNonceAge << "s; counts no longer tracked");
+      return true;
+   }
+
+   Lock lock(mMutex);
+   prune(now);
+
+   CountsMap::iterator it = mCounts.find(nonce);
+   if (it == mCounts.end())
+   {
+      if (creationTime <= mForgottenUpTo)
+      {
+         // may have been forgotten to make room, with its counts
+         DebugLog(<< "Nonce not tracked and no newer than one forgotten; treated as too old");
+         return true;
+      }
+      if (mCounts.size() >= mMaxNonces)
+      {
+         CountsMap::iterator oldest = mCounts.find(mOrder.front());
+         mForgottenUpTo = resipMax(mForgottenUpTo, oldest->second.mCreationTime);
+         mCounts.erase(oldest);
+         mOrder.pop_front();
+      }
+      it = mCounts.insert(CountsMap::value_type(nonce, Counts())).first;
+      it->second.mCreationTime = creationTime;
+      it->second.mOrder = mOrder.insert(mOrder.end(), nonce);
+   }
+
+   Counts& counts = it->second;
+   if (count > counts.mHighest)
+   {
+      UInt32 shift = count - counts.mHighest;
+      counts.mSeen = shift < 64 ? (counts.mSeen << shift) | 1 : 1;
+      counts.mHighest = count;
+      return false;
+   }
+
+   UInt32 offset = counts.mHighest - count;
+   if (offset >= 64)
+   {
+      return true;
+   }
+   UInt64 bit = UInt64(1) << offset;
+   if (counts.mSeen & bit)
+   {
+      return true;
+   }
+   counts.mSeen |= bit;
+   return false;
+}
+
+size_t
+HmacNonceHelper::trackedNonces() const
+{
+   Lock lock(mMutex);
+   return mCounts.size();
+}
+
+// Drops the nonces that are too old to be tracked; at most once a second.
+// mMutex must be held.
+void
+HmacNonceHelper::prune(UInt64 now)
+{
+   if (now == mLastPrune)
+   {
+      return;
+   }
+   mLastPrune = now;
+   for (CountsMap::iterator it = mCounts.begin(); it != mCounts.end(); )
+   {
+      if (it->second.mCreationTime + mMaxNonceAge < now)
+      {
+         mOrder.erase(it->second.mOrder);
+         it = mCounts.erase(it);
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,153 @@
+#if !defined(RESIP_HMACNONCEHELPER_HXX)
+#define RESIP_HMACNONCEHELPER_HXX
+
+#include <atomic>
+#include <list>
+
+#include "resip/stack/NonceHelper.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/HashMap.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/Sha256.hxx"
+
+namespace resip
+{
+
+/**
+ * @brief A NonceHelper that signs nonces with HMAC-SHA256 and can detect
+ * replayed nonce-counts.
+ *
+ * The nonce is "<timestamp>:<salt>:<mac>", where the salt is a counter that
+ * makes every challenge unique and the mac is the first 128 bits of
+ * HMAC-SHA256(privateKey, "<timestamp>:<salt>:" + From user), in hex.  Nonces
+ * are built and checked in fixed size buffers, without any Data temporaries.
+ *
+ * When maxNonceAge is not 0, isReplay() remembers the nonce-counts seen with
+ * each nonce for maxNonceAge seconds, in a 64 bit window below the highest
+ * count seen.  A nonce-count that was already used, or that is too old for
+ * the window, is a replay; so is any nonce-count for a nonce older than
+ * maxNonceAge, which Helper reports as Expired so the client is challenged
+ * again with a fresh nonce.  maxNonceAge should be no less than the
+ * expiresDelta passed to Helper::authenticateRequest.
+ *
+ * At most maxNonces nonces are tracked.  Beyond that the nonce first seen
+ * longest ago is forgotten, and from then on any untracked nonce created no
+ * later than a forgotten one is treated as too old, so that its counts
+ * cannot be replayed; the client is challenged again.
+ *
+ * As with BasicNonceHelper, a farm of proxies must have synchronized clocks
+ * and share the privateKey; nonce-counts are tracked per instance only.
+ *
+ * Install it with Helper::setNonceHelper().
+ */
+
+class HmacNonceHelper : public NonceHelper
+{
+   public:
+      HmacNonceHelper(unsigned int maxNonceAge = 300, size_t maxNonces = 100000);
+      virtual ~HmacNonceHelper();
+
+      // Not safe to call while nonces are being made or checked
+      void setPrivateKey(const Data& privateKey);
+
+      virtual Data makeNonce(const SipMessage& request, const Data& timestamp);
+      virtual Nonce parseNonce(const Data& nonce);
+      virtual bool isValidNonce(const SipMessage& request, const Data& nonce, UInt64 creationTime);
+      virtual bool isReplay(const Data& nonce, UInt64 creationTime, const Data& nc);
+
+      // The number of nonces whose nonce-counts are being remembered
+      size_t trackedNonces() const;
+
+   private:
+      enum
+      {
+         MaxTimestampSize = 20,
+         SaltSize = 8,
+         MacSize = 32,
+         MaxNonceSize = MaxTimestampSize + 1 + SaltSize + 1 + MacSize
+      };
+
+      // Nonces in the order they were first seen
+      typedef std::list<Data> NonceList;
+
+      // Window of nonce-counts seen with one nonce
+      struct Counts
+      {
+         Counts() : mCreationTime(0), mHighest(0), mSeen(0) {}
+         UInt64 mCreationTime;
+         UInt32 mHighest;
+         UInt64 mSeen;    // bit n set if mHighest - n was seen
+         NonceList::iterator mOrder;
+      };
+      typedef HashMap<Data, Counts> CountsMap;
+
+      void makeMac(const char* prefix, size_t prefixLen, const SipMessage& request, char mac[MacSize]) const;
+      void prune(UInt64 now);
+
+      HmacSHA256 mHmac;
+      std::atomic<UInt32> mSalt;
+      const unsigned int mMaxNonceAge;
+      const size_t mMaxNonces;
+
+      mutable Mutex mMutex;
+      CountsMap mCounts;
+      NonceList mOrder;
+      UInt64 mLastPrune;
+      // untracked nonces created no later than this may have been forgotten
+      UInt64 mForgottenUpTo;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
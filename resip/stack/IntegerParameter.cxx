@@ -56,6 +56,12 @@ IntegerParameter::clone() const
    return new IntegerParameter(*this);
 }
 
+Parameter* 
+IntegerParameter::clone(PoolBase* pool) const
+{
+   return new (pool) IntegerParameter(*this);
+}
+
 EncodeStream&
 IntegerParameter::encode(EncodeStream& stream) const
 {
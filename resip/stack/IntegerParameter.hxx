@@ -36,6 +36,7 @@ class IntegerParameter : public Parameter
       virtual EncodeStream& encode(EncodeStream& stream) const;
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
    private:
       friend class ParserCategory;
       friend class Uri;
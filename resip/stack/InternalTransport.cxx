@@ -33,6 +33,7 @@ InternalTransport::InternalTransport(Fifo<TransactionMessage>& rxFifo,
              socketFunc, compression, transportFlags, netNs),
    mFd(INVALID_SOCKET),
    mInterruptorHandle(0),
+   mTxFifo(0, FifoMode::SingleConsumerDefault),
    mTxFifoOutBuffer(mTxFifo),
    mPollGrp(NULL),
    mPollItemHandle(NULL)
@@ -133,6 +134,20 @@ InternalTransport::bind()
    DebugLog (<< "Binding to " << Tuple::inet_ntop(mTuple)); 
 #endif
 
+#ifdef SO_REUSEPORT
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_REUSEPORT)!=0 )
+   {
+      int on = 1;
+      if ( ::setsockopt(mFd, SOL_SOCKET, SO_REUSEPORT, (const char*)&on, sizeof(on)) )
+      {
+         int e = getErrno();
+         error(e);
+         ErrLog (<< "Couldn't set sockoptions SO_REUSEPORT on " << mTuple << ": " << strerror(e));
+         throw Transport::Exception("Failed setsockopt", __FILE__,__LINE__);
+      }
+   }
+#endif
+
    if ( ::bind( mFd, &mTuple.getMutableSockaddr(), mTuple.length()) == SOCKET_ERROR )
    {
       int e = getErrno();
@@ -5,11 +5,18 @@
 #include <ctype.h>
 #include <limits.h>
 #include <stdio.h>
+#include <string.h>
 #include "resip/stack/HeaderTypes.hxx"
 #include "resip/stack/SipMessage.hxx"
 #include "resip/stack/MsgHeaderScanner.hxx"
+#include "rutil/ResipAssert.h"
 #include "rutil/WinLeakCheck.hxx"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define RESIP_MSG_HEADER_SCANNER_SIMD
+#include <immintrin.h>
+#endif
+
 namespace resip 
 {
 
@@ -412,6 +419,197 @@ static void initStateMachine()
                   sMsgStart); // Arbitrary but possibly handy.
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//   Vector scanning.  Inside a status line or a value, most characters leave
+//   the state unchanged with no action (taNone), and only a handful of
+//   characters (the "stops": CR, LF, the sentinel, and ',' '<' '"' '>' '\\'
+//   depending on the state) need the state machine.  In those states the
+//   scanner skips ahead 16 (SSE2) or 32 (AVX2) characters at a time to the
+//   next stop, accumulating the text properties of the characters it skips.
+//   The stops of each state are derived from the state machine, so the two
+//   can not disagree.
+
+enum { maxNumStops = 6 };
+enum { maxNumPropChars = 16 };
+
+struct SkipInfo
+{
+      int numStops;          // 0: the state can not be skipped through
+      char stops[maxNumStops];
+      int numPropChars;      // characters (other than stops) with text properties
+      char propChars[maxNumPropChars];
+      MsgHeaderScanner::TextPropBitMask propMasks[maxNumPropChars];
+};
+
+static SkipInfo skipInfoArray[numStates];
+
+// Returns the first stop at or after "charPtr", or the place where there is
+// too little text left before "termCharPtr" for another vector.
+typedef char* (*SkipFunction)(char* charPtr,
+                              const char* termCharPtr,
+                              const SkipInfo& skipInfo,
+                              MsgHeaderScanner::TextPropBitMask& textPropBitMask);
+
+static SkipFunction skipFunction = 0;
+static const char* skipFunctionName = "none";
+static bool vectorScanEnabled = true;
+
+// Runs shorter than this are left to the state machine.
+enum { minSkipLength = 32 };
+
+static void initSkipInfoArray()
+{
+   for (int state = 0; state < numStates; ++state)
+   {
+      SkipInfo& info = skipInfoArray[state];
+      info.numStops = 0;
+      info.numPropChars = 0;
+      bool skippable = true;
+      for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+      {
+         const TransitionInfo& transition =
+            stateMachine[state][c2i(charInfoArray[charIndex].category)];
+         if (transition.action == taNone && transition.nextState == state)
+         {
+            continue;
+         }
+         if (info.numStops == maxNumStops)
+         {
+            skippable = false;
+            break;
+         }
+         info.stops[info.numStops++] = (char)charIndex;
+      }
+      if (!skippable)
+      {
+         info.numStops = 0;
+         continue;
+      }
+      for (unsigned int charIndex = 0; charIndex <= UCHAR_MAX; ++charIndex)
+      {
+         if (charInfoArray[charIndex].textPropBitMask == 0 ||
+             memchr(info.stops, (int)charIndex, info.numStops))
+         {
+            continue;
+         }
+         resip_assert(info.numPropChars < maxNumPropChars);
+         info.propChars[info.numPropChars] = (char)charIndex;
+         info.propMasks[info.numPropChars] = charInfoArray[charIndex].textPropBitMask;
+         ++info.numPropChars;
+      }
+   }
+}
+
+#if defined(RESIP_MSG_HEADER_SCANNER_SIMD)
+
+static inline unsigned int firstSetBit(unsigned int bits)
+{
+   return (unsigned int)__builtin_ctz(bits);
+}
+
+static char* skipPlainCharsSse2(char* charPtr,
+                                const char* termCharPtr,
+                                const SkipInfo& skipInfo,
+                                MsgHeaderScanner::TextPropBitMask& textPropBitMask)
+{
+   __m128i stops[maxNumStops];
+   for (int i = 0; i < skipInfo.numStops; ++i)
+   {
+      stops[i] = _mm_set1_epi8(skipInfo.stops[i]);
+   }
+   __m128i propChars[maxNumPropChars];
+   for (int i = 0; i < skipInfo.numPropChars; ++i)
+   {
+      propChars[i] = _mm_set1_epi8(skipInfo.propChars[i]);
+   }
+   while (termCharPtr - charPtr >= 16)
+   {
+      __m128i block = _mm_loadu_si128((const __m128i*)charPtr);
+      __m128i hits = _mm_cmpeq_epi8(block, stops[0]);
+      for (int i = 1; i < skipInfo.numStops; ++i)
+      {
+         hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, stops[i]));
+      }
+      unsigned int stopBits = (unsigned int)_mm_movemask_epi8(hits);
+      // Only the characters in front of the first stop are skipped.
+      unsigned int skippedBits = stopBits ? (stopBits & (0u - stopBits)) - 1 : 0xffffu;
+      for (int i = 0; i < skipInfo.numPropChars; ++i)
+      {
+         if ((unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, propChars[i])) & skippedBits)
+         {
+            textPropBitMask |= skipInfo.propMasks[i];
+         }
+      }
+      if (stopBits)
+      {
+         return charPtr + firstSetBit(stopBits);
+      }
+      charPtr += 16;
+   }
+   return charPtr;
+}
+
+__attribute__((target("avx2")))
+static char* skipPlainCharsAvx2(char* charPtr,
+                                const char* termCharPtr,
+                                const SkipInfo& skipInfo,
+                                MsgHeaderScanner::TextPropBitMask& textPropBitMask)
+{
+   __m256i stops[maxNumStops];
+   for (int i = 0; i < skipInfo.numStops; ++i)
+   {
+      stops[i] = _mm256_set1_epi8(skipInfo.stops[i]);
+   }
+   __m256i propChars[maxNumPropChars];
+   for (int i = 0; i < skipInfo.numPropChars; ++i)
+   {
+      propChars[i] = _mm256_set1_epi8(skipInfo.propChars[i]);
+   }
+   while (termCharPtr - charPtr >= 32)
+   {
+      __m256i block = _mm256_loadu_si256((const __m256i*)charPtr);
+      __m256i hits = _mm256_cmpeq_epi8(block, stops[0]);
+      for (int i = 1; i < skipInfo.numStops; ++i)
+      {
+         hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, stops[i]));
+      }
+      unsigned int stopBits = (unsigned int)_mm256_movemask_epi8(hits);
+      unsigned int skippedBits = stopBits ? (stopBits & (0u - stopBits)) - 1 : 0xffffffffu;
+      for (int i = 0; i < skipInfo.numPropChars; ++i)
+      {
+         if ((unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, propChars[i])) & skippedBits)
+         {
+            textPropBitMask |= skipInfo.propMasks[i];
+         }
+      }
+      if (stopBits)
+      {
+         return charPtr + firstSetBit(stopBits);
+      }
+      charPtr += 32;
+   }
+   return charPtr;
+}
+
+#endif // defined(RESIP_MSG_HEADER_SCANNER_SIMD)
+
+static void initSkipFunction()
+{
+#if defined(RESIP_MSG_HEADER_SCANNER_SIMD)
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+   {
+      skipFunction = skipPlainCharsAvx2;
+      skipFunctionName = "avx2";
+   }
+   else
+   {
+      skipFunction = skipPlainCharsSse2;
+      skipFunctionName = "sse2";
+   }
+#endif
+}
+
 // Debug follows
 #if defined(RESIP_MSG_HEADER_SCANNER_DEBUG)  
 
@@ -924,6 +1122,8 @@ MsgHeaderScanner::scanChunk(char * chunk,
    *termCharPtr = chunkTermSentinelChar;
    char *textStartCharPtr;
    MsgHeaderScanner::TextPropBitMask localTextPropBitMask = mTextPropBitMask;
+   const SkipInfo* localSkipInfoArray =
+      (vectorScanEnabled && skipFunction) ? skipInfoArray : 0;
    if (mPrevScanChunkNumSavedTextChars == 0)
    {
       textStartCharPtr = 0;
@@ -950,7 +1150,19 @@ MsgHeaderScanner::scanChunk(char * chunk,
       printStateTransition(localState, *charPtr, transitionAction);
 #endif
       localState = transitionInfo->nextState;
-      if (transitionAction == taNone) continue;
+      if (transitionAction == taNone)
+      {
+         if (localSkipInfoArray &&
+             localSkipInfoArray[(unsigned)localState].numStops &&
+             termCharPtr - charPtr > minSkipLength)
+         {
+            charPtr = skipFunction(charPtr + 1,
+                                   termCharPtr,
+                                   localSkipInfoArray[(unsigned)localState],
+                                   localTextPropBitMask) - 1;
+         }
+         continue;
+      }
       // END message header character scan block END
       // The loop remainder is executed about 4-5 times per message header line.
       switch (transitionAction)
@@ -1056,6 +1268,16 @@ MsgHeaderScanner::scanChunk(char * chunk,
             *unprocessedCharPtr = charPtr;
             goto endOfFunction;
       }//switch
+      // Values start here, so this is where most skipping begins.
+      if (localSkipInfoArray &&
+          localSkipInfoArray[(unsigned)localState].numStops &&
+          termCharPtr - charPtr > minSkipLength)
+      {
+         charPtr = skipFunction(charPtr + 1,
+                                termCharPtr,
+                                localSkipInfoArray[(unsigned)localState],
+                                localTextPropBitMask) - 1;
+      }
    }//for
   endOfFunction:
    *termCharPtr = saveChunkTermChar;
@@ -1067,9 +1289,27 @@ MsgHeaderScanner::initialize()
 {
    initCharInfoArray();
    initStateMachine();
+   initSkipInfoArray();
+   initSkipFunction();
    return true;
 }
 
+void
+MsgHeaderScanner::useVectorScan(bool enabled)
+{
+   vectorScanEnabled = enabled;
+}
+
+const char*
+MsgHeaderScanner::vectorScanName()
+{
+   if (!mInitialized)
+   {
+      MsgHeaderScanner initializer;
+   }
+   return (vectorScanEnabled && skipFunction) ? skipFunctionName : "none";
+}
+
 
 } //namespace resip
 
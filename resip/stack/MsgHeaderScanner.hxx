@@ -117,6 +117,13 @@ class MsgHeaderScanner
                                                   unsigned int chunkLength,
                                                   char **unprocessedCharPtr); 
     
+      /// @brief Selects between the vector (SSE2 or AVX2, whichever the CPU
+      /// supports) scanning of values, which is the default, and the plain
+      /// byte-at-a-time scanning. Meant for benchmarks and tests.
+      static void useVectorScan(bool enabled);
+      /// @brief "avx2", "sse2" or "none"
+      static const char* vectorScanName();
+
       // !ah! DEBUG only, write to fd.
       // !ah! for documentation generation
       static int dumpStateMachine(int fd); 
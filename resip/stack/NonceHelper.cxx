@@ -15,6 +15,18 @@ NonceHelper::~NonceHelper()
 {
 }
 
+bool
+NonceHelper::isValidNonce(const SipMessage& request, const Data& nonce, UInt64 creationTime)
+{
+   return nonce == makeNonce(request, Data(creationTime));
+}
+
+bool
+NonceHelper::isReplay(const Data& nonce, UInt64 creationTime, const Data& nc)
+{
+   return false;
+}
+
 /* ====================================================================
  *
  * Copyright 2012 Daniel Pocock.  All rights reserved.
@@ -30,6 +30,15 @@ class NonceHelper
       // Read a nonce string into a Nonce instance, so that we can inspect
       // the un-encrypted time stamp
       virtual NonceHelper::Nonce parseNonce(const Data& nonce) = 0;
+
+      // Check that nonce is one we issued for this request at creationTime.
+      // By default the nonce is rebuilt with makeNonce and compared.
+      virtual bool isValidNonce(const SipMessage& request, const Data& nonce, UInt64 creationTime);
+
+      // Called once a response with a nonce-count has been verified; true if
+      // the nonce-count nc was already used with this nonce.  By default
+      // nonce-counts are not tracked.
+      virtual bool isReplay(const Data& nonce, UInt64 creationTime, const Data& nc);
 };
 
 }
@@ -2,6 +2,7 @@
 #define RESIP_PARAMETER_HXX 
 
 #include "rutil/Data.hxx"
+#include "rutil/PoolBase.hxx"
 #include <iosfwd>
 #include "resip/stack/ParameterTypeEnums.hxx"
 
@@ -20,6 +21,8 @@ class Parameter
       virtual const Data& getName() const;
 
       virtual Parameter* clone() const = 0;
+      /// @brief clones into pool (or the heap if pool is 0)
+      virtual Parameter* clone(PoolBase* pool) const = 0;
 
       virtual EncodeStream& encode(EncodeStream& stream) const = 0;
 
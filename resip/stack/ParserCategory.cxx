@@ -116,12 +116,12 @@ ParserCategory::copyParametersFrom(const ParserCategory& other)
    for (ParameterList::const_iterator it = other.mParameters.begin();
         it != other.mParameters.end(); it++)
    {
-      mParameters.push_back((*it)->clone());
+      mParameters.push_back((*it)->clone(mPool));
    }
    for (ParameterList::const_iterator it = other.mUnknownParameters.begin();
         it != other.mUnknownParameters.end(); it++)
    {
-      mUnknownParameters.push_back((*it)->clone());
+      mUnknownParameters.push_back((*it)->clone(mPool));
    }
 }
 
@@ -150,7 +150,7 @@ ParserCategory::param(const ExtensionParameter& param)
    Parameter* p = getParameterByData(param.getName());
    if (!p)
    {
-      p = new UnknownParameter(param.getName());
+      p = new (getPool()) UnknownParameter(param.getName());
       mUnknownParameters.push_back(p);
    } 
    return static_cast<UnknownParameter*>(p)->value();
@@ -357,14 +357,14 @@ ParserCategory::setParameter(const Parameter* parameter)
       {
          freeParameter(*it);
          mParameters.erase(it);
-         mParameters.push_back(parameter->clone());
+         mParameters.push_back(parameter->clone(mPool));
          return;
       }
    }
 
    // !dlb! kinda hacky -- what is the correct semantics here?
    // should be quietly add, quietly do nothing, throw?
-   mParameters.push_back(parameter->clone());
+   mParameters.push_back(parameter->clone(mPool));
 }
 
 void 
@@ -307,6 +307,15 @@ class ParserContainer : public ParserContainerBase
          return new ParserContainer(*this);
       }
 
+      /**
+         @brief Clones this container into pool, along with all contained 
+            header field values.
+      */
+      virtual ParserContainerBase* clone(PoolBase& pool) const
+      {
+         return new (&pool) ParserContainer(*this, pool);
+      }
+
    private:
       friend class ParserContainer<T>::iterator;
       friend class ParserContainer<T>::const_iterator;
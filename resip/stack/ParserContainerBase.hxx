@@ -66,6 +66,11 @@ class ParserContainerBase
         */
       virtual ParserContainerBase* clone() const = 0;
 
+      /**
+        @brief as clone(), but allocates the copy and its contents from pool
+        */
+      virtual ParserContainerBase* clone(PoolBase& pool) const = 0;
+
       /**
         @brief return the size of the mParsers vector
         */
@@ -144,6 +149,12 @@ class ParserContainerBase
                hfv.swap(nc_orig.hfv);
             }
  
+            HeaderKit(HeaderKit&& orig) noexcept
+            : pc(orig.pc)
+            {
+               hfv.swap(orig.hfv);
+            }
+
             // Poor man's move semantics, watch out!
             HeaderKit& operator=(const HeaderKit& rhs)
             {
@@ -44,6 +44,12 @@ QValueParameter::clone() const
    return new QValueParameter(*this);
 }
 
+Parameter* 
+QValueParameter::clone(PoolBase* pool) const
+{
+   return new (pool) QValueParameter(*this);
+}
+
 EncodeStream&
 QValueParameter::encode(EncodeStream& stream) const
 {
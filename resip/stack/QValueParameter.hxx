@@ -101,6 +101,7 @@ namespace resip
         @return a new QValueParameter object that is a copy of this one.
         */
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
 
       /**
         @brief returns "q=3" or equivalent in the stream it receives
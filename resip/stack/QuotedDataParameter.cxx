@@ -40,6 +40,12 @@ QuotedDataParameter::clone() const
    return new QuotedDataParameter(*this);
 }
 
+Parameter* 
+QuotedDataParameter::clone(PoolBase* pool) const
+{
+   return new (pool) QuotedDataParameter(*this);
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
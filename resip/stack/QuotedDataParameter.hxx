@@ -33,6 +33,7 @@ class QuotedDataParameter : public DataParameter
       }
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       
    protected:
       QuotedDataParameter(const QuotedDataParameter& other) 
@@ -62,6 +62,12 @@ RportParameter::clone() const
    return new RportParameter(*this);
 }
 
+Parameter* 
+RportParameter::clone(PoolBase* pool) const
+{
+   return new (pool) RportParameter(*this);
+}
+
 EncodeStream&
 RportParameter::encode(EncodeStream& stream) const
 {
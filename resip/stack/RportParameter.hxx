@@ -43,6 +43,7 @@ class RportParameter : public Parameter
       virtual EncodeStream& encode(EncodeStream& stream) const;
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       
       Type& value() { return *this; }
    private:
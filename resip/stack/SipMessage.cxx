@@ -86,9 +86,9 @@ SipMessage::~SipMessage()
 {
 //#define DINKYPOOL_PROFILING
 #ifdef DINKYPOOL_PROFILING
-   if (mPool.getHeapBytes() > 0)
+   if (mPool.getChunkBytes() > 0 || mPool.getHeapBytes() > 0)
    {
-       InfoLog(<< "SipMessage mPool filled up and used " << mPool.getHeapBytes() << " bytes on the heap, consider increasing the mPool size (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
+       InfoLog(<< "SipMessage mPool filled up and used " << mPool.getChunkBytes() << " bytes of overflow chunks and " << mPool.getHeapBytes() << " bytes on the heap, consider increasing the mPool size (sizeof SipMessage is " << sizeof(SipMessage) << " bytes): msg="
            << std::endl << *this);
    }
    else
@@ -111,6 +111,7 @@ SipMessage::clear(bool leaveResponseStuff)
       // !bwc! The "invalid" 0 index.
       mHeaders.push_back(getEmptyHfvl());
       mBufferList.clear();
+      mSharedBufferList.clear();
    }
 
    mUnknownHeaders.clear();
@@ -238,6 +239,7 @@ SipMessage::freeMem(bool leaveResponseStuff)
       {
          delete [] *i;
       }
+      mSharedBufferList.clear();
    }
 
    if(mStartLine)
@@ -382,6 +384,18 @@ SipMessage::getTransactionId() const
    }
 }
 
+size_t
+SipMessage::getTransactionIdHash() const
+{
+   const Data& tid = getTransactionId();
+   if (tid.data() != mRFC2543TransactionId.data())
+   {
+      // tid came from the branch
+      return header(h_Vias).front().param(p_branch).getTransactionIdHash();
+   }
+   return tid.caseInsensitiveTokenHash();
+}
+
 void
 SipMessage::compute2543TransactionHash() const
 {
@@ -866,6 +880,15 @@ SipMessage::addBuffer(char* buf)
    mBufferList.push_back(buf);
 }
 
+void
+SipMessage::addBuffer(const std::shared_ptr<char>& buf)
+{
+   if (mSharedBufferList.empty() || mSharedBufferList.back() != buf)
+   {
+      mSharedBufferList.push_back(buf);
+   }
+}
+
 void 
 SipMessage::setStartLine(const char* st, int len)
 {
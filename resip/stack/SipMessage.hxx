@@ -172,6 +172,10 @@ class SipMessage : public TransactionMessage
       /// Returns the transaction id from the branch or if 2543, the computed hash.
       virtual const Data& getTransactionId() const;
 
+      /// Returns getTransactionId().caseInsensitiveTokenHash(); for RFC 3261
+      /// branches this was computed when the branch was parsed.
+      size_t getTransactionIdHash() const;
+
       /**
          @brief Calculates an MD5 hash over the Request-URI, To tag (for
          non-INVITE transactions), From tag, Call-ID, CSeq (including
@@ -534,6 +538,9 @@ class SipMessage : public TransactionMessage
       Tuple& getDestination() { return mDestination; }
 
       void addBuffer(char* buf);
+      /// @brief keeps a reference to a buffer that other messages may share,
+      /// e.g. the receive slab of a stream connection
+      void addBuffer(const std::shared_ptr<char>& buf);
 
       UInt64 getCreatedTimeMicroSec() const {return mCreatedTime;}
 
@@ -666,6 +673,10 @@ class SipMessage : public TransactionMessage
       // To profile current sizing, enable DINKYPOOL_PROFILING in SipMessage.cxx 
       // and look for DebugLog message in SipMessage destructor to know when heap
       // allocations are occuring and how much of the pool is used.
+      // Larger messages continue in 4KB chunks, each released once nothing
+      // in it is in use, or else along with the message. Everything parsed
+      // out of the message (header lists, parser containers, parser
+      // categories and their parameters) is allocated from here.
       DinkyPool<3732> mPool;
 
       typedef std::vector<HeaderFieldValueList*, 
@@ -694,6 +705,9 @@ class SipMessage : public TransactionMessage
       // Raw buffers coming from the Transport. message manages the memory
       std::vector<char*> mBufferList;
 
+      // Receive slabs shared with the Connection that read this message
+      std::vector<std::shared_ptr<char> > mSharedBufferList;
+
       // special case for the first line of message
       StartLine* mStartLine;
       char mStartLineMem[sizeof(RequestLine) > sizeof(StatusLine) ? sizeof(RequestLine) : sizeof(StatusLine)];
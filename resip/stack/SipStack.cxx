@@ -30,6 +30,7 @@
 #include "rutil/AsyncProcessHandler.hxx"
 #include "resip/stack/TcpTransport.hxx"
 #include "resip/stack/UdpTransport.hxx"
+#include "resip/stack/UdpShardedTransport.hxx"
 #include "resip/stack/WsTransport.hxx"
 #include "resip/stack/TransactionUser.hxx"
 #include "resip/stack/TransactionUserMessage.hxx"
@@ -230,6 +231,12 @@ SipStack::~SipStack()
    mDnsThread=0;
    delete mTransactionControllerThread;
    mTransactionControllerThread=0;
+   for(std::vector<TransactionControllerThread*>::iterator i=mTransactionShardThreads.begin();
+       i!=mTransactionShardThreads.end(); ++i)
+   {
+      delete *i;
+   }
+   mTransactionShardThreads.clear();
    delete mTransportSelectorThread;
    mTransportSelectorThread=0;
 
@@ -271,6 +278,19 @@ SipStack::run()
    mTransactionControllerThread=new TransactionControllerThread(*mTransactionController);
    mTransactionControllerThread->run();
 
+   for(std::vector<TransactionControllerThread*>::iterator i=mTransactionShardThreads.begin();
+       i!=mTransactionShardThreads.end(); ++i)
+   {
+      delete *i;
+   }
+   mTransactionShardThreads.clear();
+   const std::vector<TransactionController*>& shards = mTransactionController->getShards();
+   for(std::vector<TransactionController*>::const_iterator i=shards.begin(); i!=shards.end(); ++i)
+   {
+      mTransactionShardThreads.push_back(new TransactionControllerThread(**i));
+      mTransactionShardThreads.back()->run();
+   }
+
    delete mTransportSelectorThread;
    mTransportSelectorThread=new TransportSelectorThread(mTransactionController->transportSelector());
    mTransportSelectorThread->run();
@@ -305,6 +325,13 @@ SipStack::shutdownAndJoinThreads()
       mTransactionControllerThread->join();
    }
 
+   for(std::vector<TransactionControllerThread*>::iterator i=mTransactionShardThreads.begin();
+       i!=mTransactionShardThreads.end(); ++i)
+   {
+      (*i)->shutdown();
+      (*i)->join();
+   }
+
    if(mTransportSelectorThread)
    {
       mTransportSelectorThread->shutdown();
@@ -313,6 +340,17 @@ SipStack::shutdownAndJoinThreads()
    mInternalThreadsRunning=false;
 }
 
+void
+SipStack::setTransactionShards(unsigned int numShards)
+{
+   resip_assert(!mInternalThreadsRunning && !mProcessingHasStarted);
+   mTransactionController->setNumShards(numShards, mAsyncProcessHandler);
+   if(numShards > 1)
+   {
+      mStatsManager.enableCounterLocking();
+   }
+}
+
 void
 SipStack::onReload()
 {
@@ -343,7 +381,8 @@ SipStack::addTransport( TransportType protocol,
                         bool useEmailAsSIP,
                         std::shared_ptr<WsConnectionValidator> wsConnectionValidator,
                         std::shared_ptr<WsCookieContextFactory> wsCookieContextFactory,
-                        const Data& netNs)
+                        const Data& netNs,
+                        unsigned int numShards)
 {
    resip_assert(!mShuttingDown);
 
@@ -387,7 +426,14 @@ SipStack::addTransport( TransportType protocol,
       switch (protocol)
       {
          case UDP:
-            transport = new UdpTransport(stateMacFifo, port, version, stun, ipInterface, mSocketFunc, *mCompression, transportFlags);
+            if (numShards > 1)
+            {
+               transport = new UdpShardedTransport(stateMacFifo, port, version, stun, ipInterface, numShards, mSocketFunc, *mCompression, transportFlags);
+            }
+            else
+            {
+               transport = new UdpTransport(stateMacFifo, port, version, stun, ipInterface, mSocketFunc, *mCompression, transportFlags);
+            }
             break;
          case TCP:
             transport = 
@@ -1069,6 +1115,11 @@ SipStack::processTimers()
    if(!mTransactionControllerThread)
    {
       mTransactionController->process();
+      const std::vector<TransactionController*>& shards = mTransactionController->getShards();
+      for(std::vector<TransactionController*>::const_iterator i=shards.begin(); i!=shards.end(); ++i)
+      {
+         (*i)->process();
+      }
    }
 
    if(!mDnsThread)
@@ -1258,13 +1309,13 @@ SipStack::dump(EncodeStream& strm)  const
       strm << "domains: " << Inserter(this->mDomains) << std::endl;
    }
    strm << " TUFifo size=" << this->mTUFifo.size() << std::endl
-        << " Timers size=" << this->mTransactionController->mTimers.size() << std::endl;
+        << " Timers size=" << this->mTransactionController->getTimerQueueSize() << std::endl;
    {
       Lock lock(mAppTimerMutex);
       strm << " AppTimers size=" << this->mAppTimers.size() << std::endl;
    }
-   strm << " ServerTransactionMap size=" << this->mTransactionController->mServerTransactionMap.size() << std::endl
-        << " ClientTransactionMap size=" << this->mTransactionController->mClientTransactionMap.size() << std::endl
+   strm << " ServerTransactionMap size=" << this->mTransactionController->getNumServerTransactions() << std::endl
+        << " ClientTransactionMap size=" << this->mTransactionController->getNumClientTransactions() << std::endl
         // !slg! TODO - There is technically a threading concern with the following three lines and the runtime addTransport or removeTransport call
         << " Exact interface / Specific port=" << Inserter(this->mTransactionController->mTransportSelector.mExactTransports) << std::endl
         << " Any interface / Specific port=" << Inserter(this->mTransactionController->mTransportSelector.mAnyInterfaceTransports) << std::endl
@@ -353,6 +353,10 @@ class SipStack : public FdSetIOObserver
          @param netNs                 Set the network namespace (netns) in which the Transport is
                                       to bind the the given address and port.
 
+         @param numShards             UDP only. If greater than 1, open this many sockets on the
+                                      port with SO_REUSEPORT, each serviced by its own thread
+                                      (see UdpShardedTransport).
+
       */
       Transport* addTransport(TransportType protocol,
                               int port,
@@ -368,7 +372,8 @@ class SipStack : public FdSetIOObserver
                               bool useEmailAsSIP = false,
                               std::shared_ptr<WsConnectionValidator> = nullptr,
                               std::shared_ptr<WsCookieContextFactory> = nullptr,
-                              const Data& netNs = Data::Empty
+                              const Data& netNs = Data::Empty,
+                              unsigned int numShards = 1
                              );
 
       /**
@@ -965,7 +970,7 @@ class SipStack : public FdSetIOObserver
       */
       void setFixBadDialogIdentifiers(bool pFixBadDialogIdentifiers) 
       {
-         mTransactionController->mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         mTransactionController->setFixBadDialogIdentifiers(pFixBadDialogIdentifiers);
       }
 
       inline bool getFixBadCSeqNumbers() const
@@ -978,6 +983,23 @@ class SipStack : public FdSetIOObserver
          mTransactionController->setFixBadCSeqNumbers(pFixBadCSeqNumbers);
       }
 
+      /**
+         Split transaction processing across numShards threads. Transactions
+         are assigned to a shard by a hash of their transaction id, and each
+         shard has its own transaction maps, timer queue and fifo, so the
+         transaction state machines of a busy stack can use several cores.
+         The shards get their own threads when run() is called; otherwise
+         they are serviced by process().
+
+         @param numShards The number of shards; 1 (the default) disables
+            sharding.
+         @note Must be called before run() or process(). While sharded,
+            transports should not be added or removed once the stack is
+            running.
+         @ingroup resip_config
+      */
+      void setTransactionShards(unsigned int numShards);
+
       bool setUdpOnlyOnNumeric(bool value)
       {
          return mTransactionController->transportSelector().setUdpOnlyOnNumeric(value);
@@ -1158,6 +1180,7 @@ class SipStack : public FdSetIOObserver
       TransactionController* mTransactionController;
 
       TransactionControllerThread* mTransactionControllerThread;
+      std::vector<TransactionControllerThread*> mTransactionShardThreads;
       TransportSelectorThread* mTransportSelectorThread;
       bool mInternalThreadsRunning;
       bool mProcessingHasStarted; 
@@ -2,6 +2,7 @@
 #include "config.h"
 #endif
 
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "resip/stack/StatisticsManager.hxx"
 #include "resip/stack/SipMessage.hxx"
@@ -45,6 +46,8 @@ StatisticsManager::poll()
    activeClientTransactions = mStack.mTransactionController->getNumClientTransactions();
    activeServerTransactions = mStack.mTransactionController->getNumServerTransactions();
 
+   PtrLock lock(mCountersMutex.get());
+
    // .kw. At last check payload was > 146kB, which seems too large
    // to alloc on stack. Also, the post'd message has reference
    // to the appStats, so not safe queue as ref to stack element.
@@ -80,6 +83,22 @@ StatisticsManager::poll()
    }
 }
 
+void
+StatisticsManager::enableCounterLocking()
+{
+   if(!mCountersMutex.get())
+   {
+      mCountersMutex.reset(new Mutex);
+   }
+}
+
+void
+StatisticsManager::zeroOut()
+{
+   PtrLock lock(mCountersMutex.get());
+   StatisticsMessage::Payload::zeroOut();
+}
+
 void 
 StatisticsManager::process()
 {
@@ -95,6 +114,7 @@ StatisticsManager::sent(SipMessage* msg)
 {
    MethodTypes met = msg->method();
 
+   PtrLock lock(mCountersMutex.get());
    if (msg->isRequest())
    {
       ++requestsSent;
@@ -121,6 +141,7 @@ StatisticsManager::retransmitted(MethodTypes met,
                                  bool request, 
                                  unsigned int code)
 {
+   PtrLock lock(mCountersMutex.get());
    if(request)
    {
       ++requestsRetransmitted;
@@ -140,6 +161,7 @@ StatisticsManager::received(SipMessage* msg)
 {
    MethodTypes met = msg->header(h_CSeq).method();
 
+   PtrLock lock(mCountersMutex.get());
    if (msg->isRequest())
    {
       ++requestsReceived;
@@ -1,8 +1,11 @@
 #ifndef RESIP_StatisticsManager_hxx
 #define RESIP_StatisticsManager_hxx
 
+#include <memory>
+
 #include "rutil/Timer.hxx"
 #include "rutil/Data.hxx"
+#include "rutil/Mutex.hxx"
 #include "resip/stack/StatisticsMessage.hxx"
 #include "resip/stack/StatisticsHandler.hxx"
 
@@ -50,6 +53,10 @@ class StatisticsManager : public StatisticsMessage::Payload
          mExternalHandler = handler;
       }
 
+      // Called before processing starts when transaction processing is
+      // sharded, as the counters are then updated from every shard.
+      void enableCounterLocking();
+
    private:
       friend class TransactionState;
       bool sent(SipMessage* msg);
@@ -57,8 +64,12 @@ class StatisticsManager : public StatisticsMessage::Payload
       bool received(SipMessage* msg);
 
       void poll(); // force an update
+      void zeroOut();
 
       SipStack& mStack;
+      // Only set once enableCounterLocking() is called, so that an
+      // unsharded stack counts without locking.
+      std::unique_ptr<Mutex> mCountersMutex;
       UInt64 mInterval;
       UInt64 mNextPoll;
 
@@ -7,6 +7,10 @@
 #include "resip/stack/TcpConnection.hxx"
 #include "resip/stack/Tuple.hxx"
 
+#if !defined(WIN32)
+#include <sys/uio.h>
+#endif
+
 using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
@@ -108,6 +112,37 @@ TcpConnection::write( const char* buf, const int count )
    return bytesWritten;
 }
 
+#if !defined(WIN32)
+int
+TcpConnection::writev(const std::pair<const char*, size_t>* buffers, int count)
+{
+   resip_assert(count > 0 && count <= MaxGatherCount);
+
+   struct iovec iovs[MaxGatherCount];
+   for (int i = 0; i < count; ++i)
+   {
+      iovs[i].iov_base = const_cast<char*>(buffers[i].first);
+      iovs[i].iov_len = buffers[i].second;
+   }
+
+   int bytesWritten = (int)::writev(getSocket(), iovs, count);
+   if (bytesWritten == INVALID_SOCKET)
+   {
+      int e = getErrno();
+      if (e == EAGAIN || e == EWOULDBLOCK)
+      {
+          // TCP buffers are backed up - we couldn't write anything
+          return 0;
+      }
+      InfoLog (<< "Failed writev on " << getSocket() << " " << strerror(e));
+      Transport::error(e);
+      return -1;
+   }
+   
+   return bytesWritten;
+}
+#endif
+
 bool 
 TcpConnection::hasDataToRead()
 {
@@ -15,6 +15,9 @@ class TcpConnection : public Connection
       
       int read( char* buf, const int count );
       int write( const char* buf, const int count );
+#if !defined(WIN32)
+      int writev(const std::pair<const char*, size_t>* buffers, int count);
+#endif
       virtual bool hasDataToRead(); // has data that can be read 
       virtual bool isGood(); // has valid connection
       virtual bool isWritable();
@@ -19,6 +19,8 @@ using namespace std;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
+TimerQueueStorage::Type TimerQueueStorage::Default = TimerQueueStorage::Heap;
+
 TransactionTimerQueue::TransactionTimerQueue(Fifo<TimerMessage>& fifo)
    : mFifo(fifo)
 {
@@ -33,10 +35,11 @@ DtlsTimerQueue::DtlsTimerQueue( Fifo<DtlsMessage>& fifo )
 
 DtlsTimerQueue::~DtlsTimerQueue()
 {
-   while(!mTimers.empty())
+   std::vector<TimerWithPayload> timers;
+   clear(timers);
+   for(std::vector<TimerWithPayload>::iterator it = timers.begin(); it != timers.end(); ++it)
    {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
+      delete it->getMessage();
    }
 }
 
@@ -46,9 +49,8 @@ UInt64
 TransactionTimerQueue::add(Timer::Type type, const Data& transactionId, unsigned long msOffset)
 {
    TransactionTimer t(msOffset, type, transactionId);
-   mTimers.push(t);
    DebugLog (<< "Adding timer: " << Timer::toData(type) << " tid=" << transactionId << " ms=" << msOffset);
-   return mTimers.top().getWhen();
+   return push(t);
 }
 
 #ifdef USE_DTLS
@@ -57,18 +59,18 @@ UInt64
 DtlsTimerQueue::add( SSL *ssl, unsigned long msOffset )
 {
    TimerWithPayload t( msOffset, new DtlsMessage( ssl ) ) ;
-   mTimers.push( t ) ;
-   return mTimers.top().getWhen();
+   return push( t ) ;
 }
 
 #endif
 
 BaseTimeLimitTimerQueue::~BaseTimeLimitTimerQueue()
 {
-   while(!mTimers.empty())
+   std::vector<TimerWithPayload> timers;
+   clear(timers);
+   for(std::vector<TimerWithPayload>::iterator it = timers.begin(); it != timers.end(); ++it)
    {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
+      delete it->getMessage();
    }
 }
 
@@ -77,8 +79,7 @@ BaseTimeLimitTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   return push(TimerWithPayload(timeMs,payload));
 }
 
 void
@@ -110,10 +111,11 @@ TuSelectorTimerQueue::TuSelectorTimerQueue(TuSelector& sel) : mFifoSelector(sel)
 
 TuSelectorTimerQueue::~TuSelectorTimerQueue()
 {
-   while(!mTimers.empty())
+   std::vector<TimerWithPayload> timers;
+   clear(timers);
+   for(std::vector<TimerWithPayload>::iterator it = timers.begin(); it != timers.end(); ++it)
    {
-      delete mTimers.top().getMessage();
-      mTimers.pop();
+      delete it->getMessage();
    }
 }
 
@@ -122,8 +124,7 @@ TuSelectorTimerQueue::add(unsigned int timeMs,Message* payload)
 {
    resip_assert(payload);
    DebugLog(<< "Adding application timer: " << payload->brief() << " ms=" << timeMs);
-   mTimers.push(TimerWithPayload(timeMs,payload));
-   return mTimers.top().getWhen();
+   return push(TimerWithPayload(timeMs,payload));
 }
 
 void
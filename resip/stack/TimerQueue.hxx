@@ -6,18 +6,17 @@
 #endif
 
 #include <functional>
+#include <memory>
 #include <queue>
 #include <set>
+#include <vector>
 #include <iosfwd>
 #include "resip/stack/TimerMessage.hxx"
 #include "resip/stack/DtlsMessage.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
 #include "rutil/Timer.hxx"
-
-// .dlb. 
-// to do: timer wheel for transaction-bound timers and a heap for
-// everything longer.
+#include "rutil/TimerWheel.hxx"
 
 namespace resip
 {
@@ -26,19 +25,47 @@ class Message;
 class TransactionMessage;
 class TuSelector;
 
+/**
+  * @internal
+  * @brief Selects how TimerQueues store their timers.
+  *
+  * Heap is a binary heap (O(log n) add and expire). Wheel is a hierarchical
+  * TimerWheel (O(1) add and expire), which pays off when many timers are
+  * outstanding, e.g. the transaction timers of a busy proxy. The choice is
+  * made when a TimerQueue is constructed, so set Default before creating
+  * the SipStack.
+  */
+class TimerQueueStorage
+{
+   public:
+      typedef enum
+      {
+         Heap,
+         Wheel
+      } Type;
+
+      static Type Default;
+};
+
 /**
   * @internal
   * @brief This class takes a fifo as a place to where you can write your stuff.
   * When using this in the main loop, call process() on this.
   * During Transaction processing, TimerMessages and SIP messages are generated.
-  * 
-    @todo .dlb. timer wheel for transaction-bound timers and a heap for 
-      everything longer.
+  * Timers are kept in a heap or a TimerWheel, see TimerQueueStorage.
   */
 template <class T>
 class TimerQueue
 {
    public:
+      TimerQueue()
+      {
+         if (TimerQueueStorage::Default == TimerQueueStorage::Wheel)
+         {
+            mWheel.reset(new TimerWheel<T>);
+         }
+      }
+
       // This is the logic that runs when a timer goes off. This is the only
       // thing subclasses must implement.
       virtual void processTimer(const T& timer)=0;
@@ -61,9 +88,9 @@ class TimerQueue
       ///
       unsigned int msTillNextTimer()
       {
-         if (!mTimers.empty())
+         if (!empty())
          {
-            UInt64 next = mTimers.top().getWhen();
+            UInt64 next = nextWhen();
             UInt64 now = Timer::getTimeMs();
             if (now > next) 
             {
@@ -93,6 +120,24 @@ class TimerQueue
       /// machine fifo and application messages into the TU fifo
       virtual UInt64 process()
       {
+         if (mWheel.get())
+         {
+            if (!mWheel->empty())
+            {
+               std::vector<T> expired;
+               mWheel->expire(Timer::getTimeMs(), expired);
+               for (typename std::vector<T>::const_iterator it = expired.begin(); it != expired.end(); ++it)
+               {
+                  processTimer(*it);
+               }
+               if (!mWheel->empty())
+               {
+                  return mWheel->nextWhen();
+               }
+            }
+            return 0;
+         }
+
          if (!mTimers.empty())
          {
             UInt64 now=Timer::getTimeMs();
@@ -112,20 +157,20 @@ class TimerQueue
 
       int size() const
       {
-         return (int)mTimers.size();
+         return mWheel.get() ? (int)mWheel->size() : (int)mTimers.size();
       }
 
       bool empty() const
       {
-         return mTimers.empty();
+         return mWheel.get() ? mWheel->empty() : mTimers.empty();
       }
 
       std::ostream& encode(std::ostream& str) const
       {
-         if(mTimers.size() > 0)
+         if(size() > 0)
          {
-            return str << "TimerQueue[ size =" << mTimers.size() 
-                       << " top=" << mTimers.top() << "]" ;
+            return str << "TimerQueue[ size =" << size() 
+                       << " top=" << top() << "]" ;
          }
          else
          {
@@ -136,10 +181,10 @@ class TimerQueue
 #ifndef RESIP_USE_STL_STREAMS
       EncodeStream& encode(EncodeStream& str) const
       {
-         if(mTimers.size() > 0)
+         if(size() > 0)
          {
-            return str << "TimerQueue[ size =" << mTimers.size() 
-                       << " top=" << mTimers.top() << "]" ;
+            return str << "TimerQueue[ size =" << size() 
+                       << " top=" << top() << "]" ;
          }
          else
          {
@@ -149,8 +194,47 @@ class TimerQueue
 #endif
 
    protected:
+      /// @brief adds a timer; returns the time the next timer will fire
+      UInt64 push(const T& timer)
+      {
+         if (mWheel.get())
+         {
+            mWheel->push(timer);
+         }
+         else
+         {
+            mTimers.push(timer);
+         }
+         return nextWhen();
+      }
+
+      /// @brief removes all timers, handing them back in no particular order
+      void clear(std::vector<T>& timers)
+      {
+         if (mWheel.get())
+         {
+            mWheel->clear(timers);
+         }
+         while (!mTimers.empty())
+         {
+            timers.push_back(mTimers.top());
+            mTimers.pop();
+         }
+      }
+
+      UInt64 nextWhen() const
+      {
+         return mWheel.get() ? mWheel->nextWhen() : mTimers.top().getWhen();
+      }
+
+      const T& top() const
+      {
+         return mWheel.get() ? mWheel->top() : mTimers.top();
+      }
+
       typedef std::vector<T, std::allocator<T> > TimerVector;
       std::priority_queue<T, TimerVector, std::greater<T> > mTimers;
+      std::unique_ptr<TimerWheel<T> > mWheel;
 };
 
 /**
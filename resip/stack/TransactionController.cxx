@@ -5,11 +5,15 @@
 #include "resip/stack/AbandonServerTransaction.hxx"
 #include "resip/stack/ApplicationMessage.hxx"
 #include "resip/stack/CancelClientInviteTransaction.hxx"
+#include "resip/stack/DnsResultMessage.hxx"
 #include "resip/stack/Helper.hxx"
 #include "resip/stack/AddTransport.hxx"
 #include "resip/stack/RemoveTransport.hxx"
 #include "resip/stack/TerminateFlow.hxx"
 #include "resip/stack/EnableFlowTimer.hxx"
+#include "resip/stack/KeepAliveMessage.hxx"
+#include "resip/stack/TcpConnectState.hxx"
+#include "resip/stack/TransportFailure.hxx"
 #include "resip/stack/InvokeAfterSocketCreationFunc.hxx"
 #include "resip/stack/ZeroOutStatistics.hxx"
 #include "resip/stack/PollStatistics.hxx"
@@ -44,15 +48,17 @@ TransactionController::TransactionController(SipStack& stack,
    mDiscardStrayResponses(true),
    mFixBadDialogIdentifiers(true),
    mFixBadCSeqNumbers(true),
-   mStateMacFifo(handler),
+   mStateMacFifo(handler, FifoMode::SingleConsumerDefault),
    mStateMacFifoOutBuffer(mStateMacFifo),
+   mDispatchBuffer(mStateMacFifo, 16),
    mCongestionManager(0),
    mTuSelector(stack.mTuSelector),
-   mTransportSelector(mStateMacFifo,
-                      stack.getSecurity(),
-                      stack.getDnsStub(),
-                      stack.getCompression(),
-                      useDnsVip),
+   mOwnTransportSelector(new TransportSelector(mStateMacFifo,
+                                               stack.getSecurity(),
+                                               stack.getDnsStub(),
+                                               stack.getCompression(),
+                                               useDnsVip)),
+   mTransportSelector(*mOwnTransportSelector),
    mTimers(mTimerFifo),
    mShuttingDown(false),
    mStatsManager(stack.mStatsManager),
@@ -61,12 +67,39 @@ TransactionController::TransactionController(SipStack& stack,
    mStateMacFifo.setDescription("TransactionController::mStateMacFifo");
 }
 
+TransactionController::TransactionController(TransactionController& primary,
+                                             AsyncProcessHandler* handler,
+                                             unsigned int index) :
+   mStack(primary.mStack),
+   mDiscardStrayResponses(primary.mDiscardStrayResponses),
+   mFixBadDialogIdentifiers(primary.mFixBadDialogIdentifiers),
+   mFixBadCSeqNumbers(primary.mFixBadCSeqNumbers),
+   mStateMacFifo(handler, FifoMode::SingleConsumerDefault),
+   mStateMacFifoOutBuffer(mStateMacFifo),
+   mDispatchBuffer(mStateMacFifo, 16),
+   mCongestionManager(0),
+   mTuSelector(primary.mTuSelector),
+   mTransportSelector(primary.mTransportSelector),
+   mTimers(mTimerFifo),
+   mShuttingDown(false),
+   mStatsManager(primary.mStatsManager),
+   mHostname(primary.mHostname)
+{
+   mStateMacFifo.setDescription(Data("TransactionController::mStateMacFifo[") + Data(index) + "]");
+   setCongestionManager(primary.mCongestionManager);
+}
+
 #if defined(WIN32) && !defined(__GNUC__)
 #pragma warning( default : 4355 )
 #endif
 
 TransactionController::~TransactionController()
 {
+   for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      delete *i;
+   }
+
    if(mClientTransactionMap.size())
    {
       WarningLog(<< "On shutdown, there are Client TransactionStates remaining!");
@@ -79,6 +112,79 @@ TransactionController::~TransactionController()
 }
 
 
+void
+TransactionController::setNumShards(unsigned int numShards, AsyncProcessHandler* handler)
+{
+   resip_assert(mShards.empty());
+   resip_assert(mOwnTransportSelector.get());
+   if(numShards < 2)
+   {
+      return;
+   }
+   InfoLog(<< "Splitting transaction processing into " << numShards << " shards");
+   for(unsigned int i=0; i<numShards; ++i)
+   {
+      mShards.push_back(new TransactionController(*this, handler, i));
+   }
+}
+
+TransactionController&
+TransactionController::shardFor(TransactionMessage* message)
+{
+   if(mShards.empty())
+   {
+      return *this;
+   }
+
+   // Only messages that belong to a transaction are dispatched; transport
+   // management, keepalives, statistics and the like are handled here.
+   const Data* tid = 0;
+   SipMessage* sip = dynamic_cast<SipMessage*>(message);
+   try
+   {
+      if(sip)
+      {
+         if(!dynamic_cast<KeepAliveMessage*>(sip))
+         {
+            tid = &sip->getTransactionId();
+         }
+      }
+      else if(dynamic_cast<TransportFailure*>(message) ||
+              dynamic_cast<TcpConnectState*>(message) ||
+              dynamic_cast<AbandonServerTransaction*>(message) ||
+              dynamic_cast<CancelClientInviteTransaction*>(message) ||
+              dynamic_cast<DnsResultMessage*>(message))
+      {
+         tid = &message->getTransactionId();
+      }
+   }
+   catch(resip::BaseException&)
+   {
+      // TransactionState::process() will drop it
+   }
+   if(!tid || tid->empty())
+   {
+      return *this;
+   }
+
+   // A CANCEL forms its own transaction, with "cancel" appended to the tid
+   // of the INVITE, but must be processed by the shard that has the INVITE.
+   static const Data cancelSuffix("cancel");
+   Data::size_type len = tid->size();
+   while(len >= cancelSuffix.size() &&
+         isEqualNoCase(Data(Data::Share, tid->data() + len - cancelSuffix.size(), cancelSuffix.size()), cancelSuffix))
+   {
+      len -= cancelSuffix.size();
+   }
+   size_t hash = (sip && len == tid->size()) ? sip->getTransactionIdHash() : 
+                                                Data(Data::Share, tid->data(), len).caseInsensitiveTokenHash();
+
+   // TransactionMap indexes its table with the low bits of the same hash,
+   // so mix it before picking a shard.
+   UInt32 mixed = (UInt32)(hash ^ (hash >> 16)) * 0x9E3779B1U;
+   return *mShards[(mixed >> 16) % mShards.size()];
+}
+
 bool 
 TransactionController::isTUOverloaded() const
 {
@@ -92,12 +198,26 @@ TransactionController::shutdown()
    mTransportSelector.shutdown();
 }
 
+static bool
+shardsIdle(const std::vector<TransactionController*>& shards)
+{
+   for(std::vector<TransactionController*>::const_iterator i=shards.begin(); i!=shards.end(); ++i)
+   {
+      if((*i)->getTransactionFifoSize())
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
 void
 TransactionController::process(int timeout)
 {
    if (mShuttingDown && 
        //mTimers.empty() && 
        !mStateMacFifoOutBuffer.messageAvailable() && // !dcm! -- see below 
+       shardsIdle(mShards) &&
        !mStack.mTUFifo.messageAvailable() &&
        mTransportSelector.isFinished())
 // !dcm! -- why would one wait for the Tu's fifo to be empty before delivering a
@@ -117,8 +237,10 @@ TransactionController::process(int timeout)
       }
 
       // Check if Statistics Manager needs to be polled - note:  all statistic manager polls should happen from the 
-      // TransactionController thread / process loop
-      if(mStack.mStatisticsManagerEnabled)
+      // TransactionController thread / process loop.  Shards share the
+      // primary's StatisticsManager, so only the primary (the one that owns
+      // the TransportSelector) polls it.
+      if(mStack.mStatisticsManagerEnabled && mOwnTransportSelector.get())
       {
          mStatsManager.process();
       }
@@ -150,7 +272,15 @@ TransactionController::process(int timeout)
          int runs=16;
          while(message)
          {
-            TransactionState::process(*this, message);
+            TransactionController& shard = shardFor(message);
+            if(&shard == this)
+            {
+               TransactionState::process(*this, message);
+            }
+            else
+            {
+               shard.mDispatchBuffer.add(message);
+            }
             if(--runs==0)
             {
                break;
@@ -158,6 +288,11 @@ TransactionController::process(int timeout)
             message = mStateMacFifoOutBuffer.getNext(-1);
          }
 
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->mDispatchBuffer.flush();
+         }
+
          mTransportSelector.poke();
       }
    }
@@ -170,25 +305,31 @@ TransactionController::getTimeTillNextProcessMS()
    {
       return 0;
    }
-   return mTimers.msTillNextTimer();
+   unsigned int next = mTimers.msTillNextTimer();
+   for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      next = resipMin(next, (*i)->getTimeTillNextProcessMS());
+   }
+   return next;
 } 
 
 void
 TransactionController::send(SipMessage* msg)
 {
+   TransactionController& shard = shardFor(msg);
    if(msg->isRequest() && 
       msg->method() != ACK && 
-      getRejectionBehavior()!=CongestionManager::NORMAL)
+      shard.getRejectionBehavior()!=CongestionManager::NORMAL)
    {
       // Need to 503 this.
       SipMessage* resp(Helper::makeResponse(*msg, 503));
-      resp->header(h_RetryAfter).value()=(UInt32)mStateMacFifo.expectedWaitTimeMilliSec()/1000;
+      resp->header(h_RetryAfter).value()=(UInt32)shard.mStateMacFifo.expectedWaitTimeMilliSec()/1000;
       resp->setTransactionUser(msg->getTransactionUser());
       mTuSelector.add(resp, TimeLimitFifo<Message>::InternalElement);
       delete msg;
       return;
    }
-   mStateMacFifo.add(msg);
+   shard.mStateMacFifo.add(msg);
 }
 
 
@@ -209,25 +350,47 @@ TransactionController::getTransactionFifoSize() const
 {
    // Should we include the stuff in mStateMacFifoOutBuffer here too? This is
    // likely to be called from other threads...
-   return mStateMacFifo.size();
+   unsigned int size = mStateMacFifo.size();
+   // The shard totals below are read from other threads, so they are only
+   // approximate.
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getTransactionFifoSize();
+   }
+   return size;
 }
 
 unsigned int 
 TransactionController::getNumClientTransactions() const
 {
-   return mClientTransactionMap.size();
+   unsigned int num = mClientTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      num += (*i)->getNumClientTransactions();
+   }
+   return num;
 }
 
 unsigned int 
 TransactionController::getNumServerTransactions() const
 {
-   return mServerTransactionMap.size();
+   unsigned int num = mServerTransactionMap.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      num += (*i)->getNumServerTransactions();
+   }
+   return num;
 }
 
 unsigned int 
 TransactionController::getTimerQueueSize() const
 {
-   return mTimers.size();
+   unsigned int size = mTimers.size();
+   for(std::vector<TransactionController*>::const_iterator i=mShards.begin(); i!=mShards.end(); ++i)
+   {
+      size += (*i)->getTimerQueueSize();
+   }
+   return size;
 }
 
 void 
@@ -256,13 +419,15 @@ void TransactionController::unregisterMarkListener(MarkListener* listener)
 void 
 TransactionController::abandonServerTransaction(const Data& tid)
 {
-   mStateMacFifo.add(new AbandonServerTransaction(tid));
+   TransactionMessage* msg = new AbandonServerTransaction(tid);
+   shardFor(msg).mStateMacFifo.add(msg);
 }
 
 void 
 TransactionController::cancelClientInviteTransaction(const Data& tid, const resip::Tokens* reasons)
 {
-   mStateMacFifo.add(new CancelClientInviteTransaction(tid, reasons));
+   TransactionMessage* msg = new CancelClientInviteTransaction(tid, reasons);
+   shardFor(msg).mStateMacFifo.add(msg);
 }
 
 void 
@@ -8,6 +8,10 @@
 #include "rutil/CongestionManager.hxx"
 
 #include "rutil/ConsumerFifoBuffer.hxx"
+#include "rutil/ProducerFifoBuffer.hxx"
+
+#include <memory>
+#include <vector>
 
 namespace resip
 {
@@ -30,6 +34,23 @@ class TransactionController
       TransactionController(SipStack& stack, AsyncProcessHandler* handler, bool useDnsVip);
       ~TransactionController();
 
+      /**
+         @brief Splits transaction processing across numShards shard
+         controllers, each with its own transaction maps, timer queue and
+         fifo, selected by a hash of the transaction id. Must be called
+         before any messages are processed; numShards < 2 leaves the
+         controller unsharded.
+
+         Once sharded, this controller only dispatches: messages arriving
+         from the transports are handed to the right shard by process(),
+         and messages from the TU are routed directly by send(). Transport
+         management, keepalives and statistics stay here. The shards share
+         this controller's TransportSelector, so transports should be added
+         before processing starts.
+      */
+      void setNumShards(unsigned int numShards, AsyncProcessHandler* handler);
+      const std::vector<TransactionController*>& getShards() const { return mShards; }
+
       void process(int timeout=0);
       unsigned int getTimeTillNextProcessMS();
 
@@ -54,7 +75,10 @@ class TransactionController
       
       void setCongestionManager( CongestionManager *manager ) 
       { 
-         mTransportSelector.setCongestionManager(manager);
+         if(mOwnTransportSelector.get())
+         {
+            mTransportSelector.setCongestionManager(manager);
+         }
          if(mCongestionManager)
          {
             mCongestionManager->unregisterFifo(&mStateMacFifo);
@@ -64,6 +88,10 @@ class TransactionController
          {
             mCongestionManager->registerFifo(&mStateMacFifo);
          }
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->setCongestionManager(manager);
+         }
       }
 
       CongestionManager::RejectionBehavior getRejectionBehavior() const
@@ -86,12 +114,20 @@ class TransactionController
       inline void setFixBadDialogIdentifiers(bool pFixBadDialogIdentifiers) 
       {
          mFixBadDialogIdentifiers = pFixBadDialogIdentifiers;
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->setFixBadDialogIdentifiers(pFixBadDialogIdentifiers);
+         }
       }
 
       inline bool getFixBadCSeqNumbers() const { return mFixBadCSeqNumbers;} 
       inline void setFixBadCSeqNumbers(bool pFixBadCSeqNumbers)
       {
          mFixBadCSeqNumbers = pFixBadCSeqNumbers;
+         for(std::vector<TransactionController*>::iterator i=mShards.begin(); i!=mShards.end(); ++i)
+         {
+            (*i)->setFixBadCSeqNumbers(pFixBadCSeqNumbers);
+         }
       }
 
       void abandonServerTransaction(const Data& tid);
@@ -108,6 +144,14 @@ class TransactionController
    private:
       TransactionController(const TransactionController& rhs);
       TransactionController& operator=(const TransactionController& rhs);
+
+      // creates a shard of primary; see setNumShards()
+      TransactionController(TransactionController& primary, AsyncProcessHandler* handler, unsigned int index);
+
+      // the shard that owns the transaction message belongs to, or this
+      // if the message is not tied to a transaction
+      TransactionController& shardFor(TransactionMessage* message);
+
       SipStack& mStack;
       
       // If true, indicate to the Transaction to ignore responses for which
@@ -125,6 +169,8 @@ class TransactionController
       // transports, etc. 
       Fifo<TransactionMessage> mStateMacFifo;
       ConsumerFifoBuffer<TransactionMessage> mStateMacFifoOutBuffer;
+      // Used by the primary controller to hand messages to this shard.
+      ProducerFifoBuffer<TransactionMessage> mDispatchBuffer;
       CongestionManager* mCongestionManager;
 
       //This needs to be separate from mStateMacFifo, because timer messages
@@ -139,8 +185,10 @@ class TransactionController
       // from the sipstack (for convenience)
       TuSelector& mTuSelector;
 
-      // Used to decide which transport to send a sip message on. 
-      TransportSelector mTransportSelector;
+      // Used to decide which transport to send a sip message on. Shards use
+      // the TransportSelector of the controller they were created by.
+      std::unique_ptr<TransportSelector> mOwnTransportSelector;
+      TransportSelector& mTransportSelector;
 
       // stores all of the transactions that are currently active in this stack 
       TransactionMap mClientTransactionMap;
@@ -155,6 +203,9 @@ class TransactionController
       StatisticsManager& mStatsManager;
       
       Data mHostname;
+
+      // owned; empty unless setNumShards() was called
+      std::vector<TransactionController*> mShards;
       
       friend class SipStack; // for debug only
       friend class StatelessHandler;
@@ -10,61 +10,176 @@ using namespace resip;
 
 #define RESIPROCATE_SUBSYSTEM Subsystem::TRANSACTION
 
-TransactionMap::~TransactionMap()
+static const size_t InitialSlots = 256;
+
+TransactionMap::TransactionMap()
+   : mSlots(InitialSlots),
+     mTids(InitialSlots),
+     mMask(InitialSlots - 1),
+     mSize(0)
 {
-   //DebugLog (<< "Deleting TransactionMap: " << this << " " << mMap.size() << " entries");
-   while (!mMap.empty())
+   for (size_t i = 0; i < mSlots.size(); ++i)
    {
-      DebugLog (<< mMap.begin()->first << " -> " << mMap.begin()->second << ": " << *mMap.begin()->second);
-      delete mMap.begin()->second;
+      mSlots[i].hash = 0;
+      mSlots[i].state = 0;
    }
 }
 
-TransactionState* 
-TransactionMap::find( const Data& tid ) const
+TransactionMap::~TransactionMap()
 {
-   MapConstIterator i = mMap.find(tid);
-   if (i != mMap.end())
+   //DebugLog (<< "Deleting TransactionMap: " << this << " " << mSize << " entries");
+   // ~TransactionState erases itself, which may shift other entries back
+   // (into this slot, or around the end of the table), so keep sweeping.
+   while (mSize)
    {
-      return i->second;
+      for (size_t i = 0; mSize && i < mSlots.size(); )
+      {
+         if (mSlots[i].state)
+         {
+            DebugLog (<< mTids[i] << " -> " << mSlots[i].state << ": " << *mSlots[i].state);
+            delete mSlots[i].state;
+         }
+         else
+         {
+            ++i;
+         }
+      }
    }
-   else
+}
+
+size_t
+TransactionMap::findSlot(const Data& tid, size_t hash) const
+{
+   size_t i = hash & mMask;
+   while (mSlots[i].state && 
+          !(mSlots[i].hash == hash && isEqualNoCase(mTids[i], tid)))
    {
-      return 0;
+      i = (i + 1) & mMask;
    }
+   return i;
+}
+
+TransactionState* 
+TransactionMap::find( const Data& tid ) const
+{
+   return find(tid, tid.caseInsensitiveTokenHash());
+}
+
+TransactionState* 
+TransactionMap::find( const Data& tid, size_t hash ) const
+{
+   return mSlots[findSlot(tid, hash)].state;
 }
  
 void 
 TransactionMap::add(const Data& tid, TransactionState* state  )
 {
-   MapIterator i = mMap.find(tid);
-   if (i != mMap.end())
+   add(tid, tid.caseInsensitiveTokenHash(), state);
+}
+
+void 
+TransactionMap::add(const Data& tid, size_t hash, TransactionState* state  )
+{
+   size_t i = findSlot(tid, hash);
+   if (mSlots[i].state)
    {
-      if (i->second != state)
+      if (mSlots[i].state != state)
       {
          // .bwc. ~TransactionState will remove itself from the map.
-         delete i->second;
+         delete mSlots[i].state;
          //DebugLog (<< "Replacing TMAP[" << tid << "] = " << state << " : " << *state);
-         mMap[tid] = state;
+         insert(tid, hash, state);
       }
    }
    else
    {
       //DebugLog (<< "Inserting TMAP[" << tid << "] = " << state << " : " << *state);
-      mMap[tid] = state;
+      insert(tid, hash, state);
+   }
+}
+
+void
+TransactionMap::insert(const Data& tid, size_t hash, TransactionState* state)
+{
+   // keep the table at most half full, so probe sequences stay short
+   if ((mSize + 1) * 2 > mSlots.size())
+   {
+      grow();
+   }
+   size_t i = findSlot(tid, hash);
+   resip_assert(!mSlots[i].state);
+   mSlots[i].hash = hash;
+   mSlots[i].state = state;
+   mTids[i] = tid;
+   ++mSize;
+}
+
+void
+TransactionMap::grow()
+{
+   std::vector<Slot> slots(mSlots.size() * 2);
+   std::vector<Data> tids(slots.size());
+   for (size_t i = 0; i < slots.size(); ++i)
+   {
+      slots[i].hash = 0;
+      slots[i].state = 0;
+   }
+   slots.swap(mSlots);
+   tids.swap(mTids);
+   mMask = mSlots.size() - 1;
+   for (size_t i = 0; i < slots.size(); ++i)
+   {
+      if (slots[i].state)
+      {
+         size_t j = slots[i].hash & mMask;
+         while (mSlots[j].state)
+         {
+            j = (j + 1) & mMask;
+         }
+         mSlots[j] = slots[i];
+         mTids[j] = tids[i];
+      }
    }
 }
  
 void 
 TransactionMap::erase(const Data& tid )
 {
-   MapIterator i = mMap.find(tid);
-   if (i != mMap.end())
+   erase(tid, tid.caseInsensitiveTokenHash());
+}
+
+void 
+TransactionMap::erase(const Data& tid, size_t hash )
+{
+   size_t i = findSlot(tid, hash);
+   if (mSlots[i].state)
    {
       // don't delete it here, the TransactionState deletes itself and removes
       // itself from the map
-      //DebugLog (<< "Erasing " << tid << "(" << i->second << ")");
-      mMap.erase(i);
+      //DebugLog (<< "Erasing " << tid << "(" << mSlots[i].state << ")");
+
+      // Shift back any following entries of the cluster that would no
+      // longer be reachable through the freed slot.
+      size_t j = i;
+      for (;;)
+      {
+         j = (j + 1) & mMask;
+         if (!mSlots[j].state)
+         {
+            break;
+         }
+         size_t home = mSlots[j].hash & mMask;
+         // move j to i unless its home lies cyclically in (i, j]
+         if (((j - home) & mMask) >= ((j - i) & mMask))
+         {
+            mSlots[i] = mSlots[j];
+            mTids[i] = mTids[j];
+            i = j;
+         }
+      }
+      mSlots[i].state = 0;
+      mTids[i].clear();
+      --mSize;
    }
    else
    {
@@ -76,7 +191,7 @@ TransactionMap::erase(const Data& tid )
 int
 TransactionMap::size() const
 {
-   return (int)mMap.size();
+   return (int)mSize;
 }
 
 
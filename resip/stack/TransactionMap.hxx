@@ -1,8 +1,8 @@
 #if !defined(RESIP_TRANSACTIONMAP_HXX)
 #define RESIP_TRANSACTIONMAP_HXX
 
+#include <vector>
 #include "rutil/Data.hxx"
-#include "rutil/HashMap.hxx"
 
 namespace resip
 {
@@ -10,19 +10,34 @@ namespace resip
 
 /**
    @internal
+
+   Maps transaction ids to TransactionStates.
+
+   This is a flat open-addressing table with linear probing. Each slot holds
+   the full hash of the tid and the state, so probing touches only a
+   contiguous array and compares tids only when the hashes match. Erasing
+   shifts the following entries of the probe sequence back, so there are no
+   tombstones and lookups never slow down as transactions come and go.
+
+   The hash is Data::caseInsensitiveTokenHash() of the tid. Callers that
+   already have it (see SipMessage::getTransactionIdHash()) can pass it in
+   rather than have it recomputed.
 */
 class TransactionMap 
 {
   public:
+     TransactionMap();
      ~TransactionMap();
      
      TransactionState* find( const Data& transactionId ) const;
+     TransactionState* find( const Data& transactionId, size_t hash ) const;
      void add( const Data& transactionId, TransactionState* state  );
+     void add( const Data& transactionId, size_t hash, TransactionState* state );
      void erase( const Data& transactionId );
+     void erase( const Data& transactionId, size_t hash );
      int size() const;
      
   private:
-
      // We treat branch parameters as case insensitive (RFC3261):
      // 7.3.1 Header Field Format
      // ....
@@ -32,77 +47,21 @@ class TransactionMap
      //    values are case-insensitive.Tokens are always case-insensitive.
      //    Unless specified otherwise, values expressed as quoted strings are
      //    case-sensitive.
-#if  defined(__INTEL_COMPILER ) || (defined(WIN32) && defined(_MSC_VER) && (_MSC_VER >= 1310) && (_MSC_VER < 1900))  // !slg! not sure if this works on __INTEL_COMPILER 
-      /**
-         @internal
-      */
-      class BranchCompare
-      {
-         public:
-            enum { bucket_size = 4, min_buckets = 8 };
-
-            inline size_t operator()(const Data& branch) const
-            {
-               return branch.caseInsensitiveTokenHash();
-            }
+     struct Slot
+     {
+        size_t hash;
+        TransactionState* state; // 0 if the slot is free
+     };
 
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isLessThanNoCase(branch1,branch2);
-            }
-      };
-#elif defined(HASH_MAP_NAMESPACE)
-      /**
-         @internal
-      */
-      class BranchHasher
-      {
-         public:
-            inline size_t operator()(const Data& branch) const
-            {
-               return branch.caseInsensitiveTokenHash();
-            }
-      };
-
-      /**
-         @internal
-      */
-      class BranchEqual
-      {
-         public:
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isEqualNoCase(branch1,branch2);
-            }
-      };
-#else
-      /**
-         @internal
-      */
-      class BranchCompare
-      {
-         public:
-            inline bool operator()(const Data& branch1, const Data& branch2) const
-            {
-               return isLessThanNoCase(branch1,branch2);
-            }
-      };
-#endif
-
-      // .bwc. If rutil/HashMap.hxx fails to find a hash_map impl for the 
-      // platform we're using, it will #define HashMap to a std::map, which
-      // takes different template args. We try to compensate for this here.
-#if  defined(__INTEL_COMPILER ) || (defined(WIN32) && defined(_MSC_VER) && (_MSC_VER >= 1310) && (_MSC_VER < 1900))
-     typedef HashMap<Data, TransactionState*, BranchCompare> Map;
-#elif defined(HASH_MAP_NAMESPACE)
-     typedef HashMap<Data, TransactionState*, BranchHasher, BranchEqual> Map;
-#else
-     typedef std::map<Data, TransactionState*, BranchCompare> Map;
-#endif
+     size_t findSlot(const Data& tid, size_t hash) const;
+     void insert(const Data& tid, size_t hash, TransactionState* state);
+     void grow();
 
-     Map mMap;
-     typedef Map::iterator MapIterator;
-     typedef Map::const_iterator MapConstIterator;
+     std::vector<Slot> mSlots;
+     // tids, indexed like mSlots; only looked at when the hashes match
+     std::vector<Data> mTids;
+     size_t mMask;
+     size_t mSize;
 };
 }
 
@@ -599,15 +599,18 @@ TransactionState::process(TransactionController& controller,
          tid += "cancel";
       }
    }
+
+   // The hash of the branch was computed when the Via was parsed.
+   size_t tidHash = (sip && method != CANCEL) ? sip->getTransactionIdHash() : tid.caseInsensitiveTokenHash();
       
    TransactionState* state = 0;
    if (message->isClientTransaction()) 
    {
-      state = controller.mClientTransactionMap.find(tid);
+      state = controller.mClientTransactionMap.find(tid, tidHash);
    }
    else 
    {
-      state = controller.mServerTransactionMap.find(tid);
+      state = controller.mServerTransactionMap.find(tid, tidHash);
    }
    
    if (state && sip && sip->isExternal())
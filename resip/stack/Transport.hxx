@@ -55,6 +55,19 @@ class FdPollGrp;
  *    Specifies whether this Transport object has its own thread (ie; if
  *    set, the TransportSelector should not run the select/poll loop for
  *    this transport, since that is another thread's job)
+ * RXBATCH:
+ *    On transports that support it (UDP on platforms with recvmmsg()),
+ *    receive up to a batch of datagrams per system call into a ring of
+ *    pre-allocated buffers. Combine with RXALL to keep draining the socket
+ *    while batches come back full.
+ * TXBATCH:
+ *    On transports that support it (UDP on platforms with sendmmsg()),
+ *    flush up to a batch of queued messages per system call. Combine
+ *    with TXALL to drain the whole transmit queue.
+ * REUSEPORT:
+ *    Set SO_REUSEPORT on the socket before binding, so several sockets
+ *    can share one address and port (see UdpShardedTransport). Ignored
+ *    on platforms without SO_REUSEPORT.
  */
 #define RESIP_TRANSPORT_FLAG_NOBIND      (1<<0)
 #define RESIP_TRANSPORT_FLAG_RXALL       (1<<1)
@@ -62,6 +75,9 @@ class FdPollGrp;
 #define RESIP_TRANSPORT_FLAG_KEEP_BUFFER (1<<3)
 #define RESIP_TRANSPORT_FLAG_TXNOW       (1<<4)
 #define RESIP_TRANSPORT_FLAG_OWNTHREAD   (1<<5)
+#define RESIP_TRANSPORT_FLAG_RXBATCH     (1<<6)
+#define RESIP_TRANSPORT_FLAG_TXBATCH     (1<<7)
+#define RESIP_TRANSPORT_FLAG_REUSEPORT   (1<<8)
 
 /**
    @brief The base class for Transport classes.
@@ -402,6 +418,7 @@ class Transport : public FdSetIOObserver
       bool mShuttingDown;
 
       void setTlsDomain(const Data& domain) { mTlsDomain = domain; }
+      const std::shared_ptr<SipMessageLoggingHandler>& sharedSipMessageLoggingHandler() const { return mSipMessageLoggingHandler; }
    private:
       static const Data transportNames[MAX_TRANSPORT];
       friend EncodeStream& operator<<(EncodeStream& strm, const Transport& rhs);
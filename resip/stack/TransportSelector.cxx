@@ -32,6 +32,7 @@
 #include "rutil/DataStream.hxx"
 #include "rutil/DnsUtil.hxx"
 #include "rutil/Inserter.hxx"
+#include "rutil/Lock.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Socket.hxx"
 #include "rutil/FdPoll.hxx"
@@ -41,7 +42,6 @@
 #   include "rutil/NetNs.hxx"
 #endif
 #ifdef USE_SIGCOMP
-#include <osc/Stack.h>
 #include <osc/SigcompMessage.h>
 #endif
 
@@ -72,7 +72,6 @@ TransportSelector::TransportSelector(Fifo<TransactionMessage>& fifo, Security* s
    mStateMacFifo(fifo),
    mSecurity(security),
    mCompression(compression),
-   mSigcompStack (0),
    mPollGrp(0),
    mAvgBufferSize(1024),
    mInterruptorHandle(0)
@@ -86,16 +85,7 @@ TransportSelector::TransportSelector(Fifo<TransactionMessage>& fifo, Security* s
 #endif
 
 #ifdef USE_SIGCOMP
-   if (mCompression.isEnabled())
-   {
-      DebugLog (<< "Compression enabled for Transport Selector");
-      mSigcompStack = new osc::Stack(mCompression.getStateHandler());
-      mCompression.addCompressorsToStack(mSigcompStack);
-   }
-   else
-   {
-      DebugLog (<< "Compression disabled for Transport Selector");
-   }
+   DebugLog (<< "Compression " << (mCompression.isEnabled() ? "enabled" : "disabled") << " for Transport Selector");
 #else
    DebugLog (<< "No compression library available");
 #endif
@@ -115,10 +105,6 @@ TransportSelector::~TransportSelector()
    {
       delete it->second;
    }
-#ifdef USE_SIGCOMP
-   delete mSigcompStack;
-#endif
-
    for(HashMap<Data, Socket>::iterator socketIterator = mSockets.begin();
        socketIterator != mSockets.end(); socketIterator++)
    {
@@ -788,6 +774,7 @@ TransportSelector::determineSourceInterface(SipMessage* msg, const Tuple& target
 
       // this process will determine which interface the kernel would use to
       // send a packet to the target by making a connect call on a udp socket.
+      Lock lock(mSocketsMutex);
       Socket tmp = INVALID_SOCKET;
       Data netNs = target.getNetNs();
       // One IPV4 and IPV6 socket per namespace.  Even if we do not support netns,
@@ -1317,7 +1304,8 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
                                                    msg->getTransactionId(),
                                                    remoteSigcompId));
 
-         send->data.reserve(mAvgBufferSize + mAvgBufferSize/4);
+         const int avgBufferSize = mAvgBufferSize.load(std::memory_order_relaxed);
+         send->data.reserve(avgBufferSize + avgBufferSize/4);
 
          DataStream str(send->data);
          msg->encode(str);
@@ -1326,7 +1314,7 @@ TransportSelector::transmit(SipMessage* msg, Tuple& target, SendData* sendData)
          // !bwc! Moving average of message size. (Used to intelligently
          // predict how much space to reserve in the buffer, to minimize
          // dynamic resizing.)
-         mAvgBufferSize = (255*mAvgBufferSize + send->data.size()+128)/256;
+         mAvgBufferSize.store((int)((255*avgBufferSize + send->data.size()+128)/256), std::memory_order_relaxed);
 
          resip_assert(!send->data.empty());
          DebugLog (<< "Transmitting to " << target
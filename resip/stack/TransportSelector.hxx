@@ -5,12 +5,14 @@
 #include <sys/select.h>
 #endif
 
+#include <atomic>
 #include <map>
 #include <vector>
 #include <list>
 
 #include "rutil/Data.hxx"
 #include "rutil/Fifo.hxx"
+#include "rutil/Mutex.hxx"
 #include "rutil/GenericIPAddress.hxx"
 #include "resip/stack/Transport.hxx"
 #include "resip/stack/DnsInterface.hxx"
@@ -20,11 +22,6 @@
 #include "resip/stack/SecurityTypes.hxx"
 class TestTransportSelector;
 
-namespace osc
-{
-  class Stack;
-}
-
 namespace resip
 {
 
@@ -240,19 +237,23 @@ class TransportSelector
       // fake socket(s) one for each netns, for connect() and route table lookups
       mutable HashMap<Data, Socket> mSockets;
       mutable HashMap<Data, Socket> mSocket6s;
+      // the fake sockets are shared when transaction processing is sharded
+      mutable Mutex mSocketsMutex;
 
       // An AF_UNSPEC addr_in for rapid unconnect
       GenericIPAddress mUnspecified;
       GenericIPAddress mUnspecified6;
 
-      /// SigComp configuration object
+      /// SigComp configuration object; the transports compress with stacks
+      /// of their own
       Compression &mCompression;
-      osc::Stack  *mSigcompStack;
 
       // epoll support, for sharedprocess transports
       FdPollGrp* mPollGrp;
 
-      int mAvgBufferSize;
+      // Only a hint, so the transaction shards read and write it without
+      // ordering and the odd lost update does not matter.
+      std::atomic<int> mAvgBufferSize;
       Fifo<Transport> mTransportsToAddRemove;
       std::unique_ptr<SelectInterruptor> mSelectInterruptor;
       FdPollItemHandle mInterruptorHandle;
@@ -52,6 +52,12 @@ UInt32Parameter::clone() const
    return new UInt32Parameter(*this);
 }
 
+Parameter* 
+UInt32Parameter::clone(PoolBase* pool) const
+{
+   return new (pool) UInt32Parameter(*this);
+}
+
 EncodeStream&
 UInt32Parameter::encode(EncodeStream& stream) const
 {
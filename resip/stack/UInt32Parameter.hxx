@@ -38,6 +38,7 @@ class UInt32Parameter : public Parameter
       virtual EncodeStream& encode(EncodeStream& stream) const;
 
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
       Type& value() {return mValue;}
 
    private:
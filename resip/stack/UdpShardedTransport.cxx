@@ -0,0 +1,229 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include "resip/stack/UdpShardedTransport.hxx"
+#include "resip/stack/TransportThread.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/WinLeakCheck.hxx"
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TRANSPORT
+
+using namespace std;
+using namespace resip;
+
+UdpShardedTransport::UdpShardedTransport(Fifo<TransactionMessage>& fifo,
+                                         int portNum,
+                                         IpVersion version,
+                                         StunSetting stun,
+                                         const Data& pinterface,
+                                         unsigned int numShards,
+                                         AfterSocketCreationFuncPtr socketFunc,
+                                         Compression &compression,
+                                         unsigned transportFlags)
+   : UdpTransport(fifo, portNum, version, stun, pinterface, socketFunc, compression,
+                  transportFlags | RESIP_TRANSPORT_FLAG_OWNTHREAD | RESIP_TRANSPORT_FLAG_REUSEPORT)
+{
+   // If we were asked for port 0, the shards must join the port the OS
+   // picked for us.
+   try
+   {
+      for (unsigned int i = 1; i < numShards; ++i)
+      {
+         mShards.push_back(new UdpTransport(fifo, port(), version, stun, pinterface,
+                                            socketFunc, compression, mTransportFlags));
+      }
+   }
+   catch (BaseException&)
+   {
+      for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+      {
+         delete *it;
+      }
+      throw;
+   }
+
+   InfoLog (<< "Creating sharded UDP transport host=" << pinterface
+            << " port=" << mTuple.getPort()
+            << " shards=" << numShards);
+}
+
+UdpShardedTransport::~UdpShardedTransport()
+{
+   for (std::vector<TransportThread*>::iterator it = mThreads.begin(); it != mThreads.end(); ++it)
+   {
+      (*it)->shutdown();
+   }
+   for (std::vector<TransportThread*>::iterator it = mThreads.begin(); it != mThreads.end(); ++it)
+   {
+      (*it)->join();
+      delete *it;
+   }
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      delete *it;
+   }
+}
+
+void
+UdpShardedTransport::startOwnProcessing()
+{
+   resip_assert(mThreads.empty());
+
+   // The key and logging handler are assigned after construction, so hand
+   // them to the shards now, before any of them can receive a message.
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->setKey(getKey());
+      (*it)->setSipMessageLoggingHandler(sharedSipMessageLoggingHandler());
+   }
+
+   mThreads.push_back(new TransportThread(*this));
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      mThreads.push_back(new TransportThread(**it));
+   }
+   for (std::vector<TransportThread*>::iterator it = mThreads.begin(); it != mThreads.end(); ++it)
+   {
+      (*it)->run();
+   }
+}
+
+void
+UdpShardedTransport::shutdown()
+{
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->shutdown();
+   }
+   UdpTransport::shutdown();
+}
+
+bool
+UdpShardedTransport::isFinished() const
+{
+   for (std::vector<UdpTransport*>::const_iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      if (!(*it)->isFinished())
+      {
+         return false;
+      }
+   }
+   return UdpTransport::isFinished();
+}
+
+unsigned int
+UdpShardedTransport::getFifoSize() const
+{
+   unsigned int size = UdpTransport::getFifoSize();
+   for (std::vector<UdpTransport*>::const_iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      size += (*it)->getFifoSize();
+   }
+   return size;
+}
+
+void
+UdpShardedTransport::send(std::unique_ptr<SendData> data)
+{
+   size_t shard = data->destination.hash() % numShards();
+   if (shard == 0)
+   {
+      UdpTransport::send(std::move(data));
+   }
+   else
+   {
+      mShards[shard-1]->send(std::move(data));
+   }
+}
+
+void
+UdpShardedTransport::poke()
+{
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->poke();
+   }
+   UdpTransport::poke();
+}
+
+void
+UdpShardedTransport::setCongestionManager(CongestionManager* manager)
+{
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->setCongestionManager(manager);
+   }
+   UdpTransport::setCongestionManager(manager);
+}
+
+void
+UdpShardedTransport::setRcvBufLen(int buflen)
+{
+   for (std::vector<UdpTransport*>::iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->setRcvBufLen(buflen);
+   }
+   UdpTransport::setRcvBufLen(buflen);
+}
+
+void
+UdpShardedTransport::invokeAfterSocketCreationFunc() const
+{
+   for (std::vector<UdpTransport*>::const_iterator it = mShards.begin(); it != mShards.end(); ++it)
+   {
+      (*it)->invokeAfterSocketCreationFunc();
+   }
+   UdpTransport::invokeAfterSocketCreationFunc();
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ * vi: set shiftwidth=3 expandtab:
+ */
@@ -0,0 +1,122 @@
+#if !defined(RESIP_UDPSHARDEDTRANSPORT_HXX)
+#define RESIP_UDPSHARDEDTRANSPORT_HXX
+
+#include <vector>
+#include "resip/stack/UdpTransport.hxx"
+
+namespace resip
+{
+class TransportThread;
+
+/**
+   @ingroup transports
+
+   @brief A UDP Transport that spreads one port over several sockets.
+
+   Opens numShards sockets bound to the same address and port with
+   SO_REUSEPORT, so the kernel distributes incoming datagrams across them.
+   Each socket is serviced by its own TransportThread (and FdPollGrp),
+   started from startOwnProcessing(); do not create a TransportThread for
+   this transport yourself.
+
+   TransportSelector only sees this object. Outgoing messages are handed to
+   a shard chosen by hashing the destination, so messages to one peer stay
+   in order and are all sent from the same thread. Messages received on any
+   shard carry this transport's key.
+
+   @internal Created by SipStack::addTransport() when more than one shard
+   is requested for a UDP transport.
+*/
+class UdpShardedTransport : public UdpTransport
+{
+public:
+   RESIP_HeapCount(UdpShardedTransport);
+   /**
+      @param numShards total number of sockets/threads, including this
+      object's own socket. Values below 1 are treated as 1.
+      @see UdpTransport::UdpTransport for the other parameters.
+   */
+   UdpShardedTransport(Fifo<TransactionMessage>& fifo,
+                       int portNum,
+                       IpVersion version,
+                       StunSetting stun,
+                       const Data& interfaceObj,
+                       unsigned int numShards,
+                       AfterSocketCreationFuncPtr socketFunc = 0,
+                       Compression &compression = Compression::Disabled,
+                       unsigned transportFlags = 0);
+   virtual ~UdpShardedTransport();
+
+   virtual void startOwnProcessing();
+   virtual void shutdown();
+   virtual bool isFinished() const;
+   virtual unsigned int getFifoSize() const;
+   virtual void send(std::unique_ptr<SendData> data);
+   virtual void poke();
+   virtual void setCongestionManager(CongestionManager* manager);
+   virtual void setRcvBufLen(int buflen);
+   virtual void invokeAfterSocketCreationFunc() const;
+
+   unsigned int numShards() const { return (unsigned int)mShards.size() + 1; }
+
+private:
+   // shards other than this object; owned
+   std::vector<UdpTransport*> mShards;
+   // one per socket, including this object's; owned
+   std::vector<TransportThread*> mThreads;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ * vi: set shiftwidth=3 expandtab:
+ */
@@ -41,11 +41,14 @@ UdpTransport::UdpTransport(Fifo<TransactionMessage>& fifo,
      mRxBuffer(0),
      mStunSetting(stun),
      mExternalUnknownDatagramHandler(0),
-     mInWritable(false)
+     mInWritable(false),
+     mRxBatchSize(DefaultBatchSize),
+     mTxBatchSize(DefaultBatchSize)
 {
    mPollEventCnt = 0;
    mTxTryCnt = mTxMsgCnt = mTxFailCnt = 0;
    mRxTryCnt = mRxMsgCnt = mRxKeepaliveCnt = mRxTransactionCnt = 0;
+   mRxBatchCnt = mRxBatchFullCnt = mTxBatchCnt = mTxBatchFullCnt = 0;
    mTuple.setType(UDP);
    mFd = InternalTransport::socket(transport(), version);
    mTuple.mFlowKey=(FlowKey)mFd;
@@ -85,6 +88,8 @@ UdpTransport::~UdpTransport()
            <<" rxmsg="<<mRxMsgCnt
            <<" rxka="<<mRxKeepaliveCnt
            <<" rxtr="<<mRxTransactionCnt
+           <<" rxbatch="<<mRxBatchCnt<<"/"<<mRxBatchFullCnt
+           <<" txbatch="<<mTxBatchCnt<<"/"<<mTxBatchFullCnt
            );
 #ifdef USE_SIGCOMP
    delete mSigcompStack;
@@ -93,9 +98,21 @@ UdpTransport::~UdpTransport()
    {
       delete[] mRxBuffer;
    }
+   for (std::vector<char*>::iterator it = mRxBatchBuffers.begin(); it != mRxBatchBuffers.end(); ++it)
+   {
+      delete[] *it;
+   }
    setPollGrp(0);
 }
 
+void
+UdpTransport::setBatchSize(int rxBatchSize, int txBatchSize)
+{
+   resip_assert(mRxBatchBuffers.empty());
+   mRxBatchSize = resipMax(1, resipMin(rxBatchSize, (int)MaxBatchSize));
+   mTxBatchSize = resipMax(1, resipMin(txBatchSize, (int)MaxBatchSize));
+}
+
 void
 UdpTransport::setPollGrp(FdPollGrp *grp)
 {
@@ -226,6 +243,13 @@ UdpTransport::process(FdSet& fdset)
 void
 UdpTransport::processTxAll()
 {
+#ifdef HAVE_SENDMMSG
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_TXBATCH)!=0 )
+   {
+      processTxBatch();
+      return;
+   }
+#endif
    SendData *msg;
    ++mTxTryCnt;
    while ( (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL )
@@ -310,6 +334,98 @@ UdpTransport::processTxOne(SendData *data)
    }
 }
 
+#ifdef HAVE_SENDMMSG
+/**
+ * Flush up to mTxBatchSize messages from the tx fifo with one sendmmsg()
+ * call. Messages needing SigComp compression, and commands, go through
+ * processTxOne() as usual. With TXALL, keep going while batches are full.
+ */
+void
+UdpTransport::processTxBatch()
+{
+   ++mTxTryCnt;
+   for (;;)
+   {
+      SendData* batch[MaxBatchSize];
+      struct mmsghdr msgs[MaxBatchSize];
+      struct iovec iovs[MaxBatchSize];
+      int count = 0;
+      SendData* msg;
+      while ( count < mTxBatchSize &&
+              (msg=mTxFifoOutBuffer.getNext(RESIP_FIFO_NOWAIT)) != NULL )
+      {
+         if (msg->command != SendData::NoCommand
+#ifdef USE_SIGCOMP
+             || (mSigcompStack && msg->sigcompId.size() > 0 && !msg->isAlreadyCompressed)
+#endif
+            )
+         {
+            processTxOne(msg);
+            continue;
+         }
+         resip_assert( msg->destination.getPort() != 0 );
+
+         iovs[count].iov_base = const_cast<char*>(msg->data.data());
+         iovs[count].iov_len = msg->data.size();
+         memset(&msgs[count], 0, sizeof(msgs[count]));
+         msgs[count].msg_hdr.msg_name = const_cast<sockaddr*>(&msg->destination.getSockaddr());
+         msgs[count].msg_hdr.msg_namelen = msg->destination.length();
+         msgs[count].msg_hdr.msg_iov = &iovs[count];
+         msgs[count].msg_hdr.msg_iovlen = 1;
+         batch[count++] = msg;
+      }
+      if ( count == 0 )
+      {
+         break;
+      }
+
+      mTxMsgCnt += count;
+      ++mTxBatchCnt;
+      if ( count == mTxBatchSize )
+      {
+         ++mTxBatchFullCnt;
+      }
+
+      int done = 0;
+      while ( done < count )
+      {
+         int sent = sendmmsg(mFd, &msgs[done], count - done, 0);
+         if ( sent == SOCKET_ERROR )
+         {
+            // sendmmsg() only reports an error for the first message of
+            // the vector; fail that one and carry on with the rest.
+            int e = getErrno();
+            error(e);
+            InfoLog (<< "Failed (" << e << ") sending to " << batch[done]->destination);
+            fail(batch[done]->transactionId);
+            ++mTxFailCnt;
+            ++done;
+            continue;
+         }
+         for (int i = done; i < done + sent; ++i)
+         {
+            if ( msgs[i].msg_len != iovs[i].iov_len )
+            {
+               ErrLog (<< "UDPTransport - send buffer full" );
+               fail(batch[i]->transactionId);
+            }
+         }
+         done += sent;
+      }
+
+      for (int i = 0; i < count; ++i)
+      {
+         delete batch[i];
+      }
+
+      if ( count < mTxBatchSize || (mTransportFlags & RESIP_TRANSPORT_FLAG_TXALL)==0 )
+      {
+         break;
+      }
+   }
+}
+#endif
+
 /**
  * Add options RXALL (to try receive all readable data) and KEEP_BUFFER.
  * While each can be specified independently, generally should do both
@@ -321,6 +437,13 @@ UdpTransport::processTxOne(SendData *data)
 void
 UdpTransport::processRxAll()
 {
+#ifdef HAVE_RECVMMSG
+   if ( (mTransportFlags & RESIP_TRANSPORT_FLAG_RXBATCH)!=0 )
+   {
+      processRxBatch();
+      return;
+   }
+#endif
    char *buffer = mRxBuffer;
    mRxBuffer = NULL;
    ++mRxTryCnt;
@@ -355,6 +478,86 @@ UdpTransport::processRxAll()
    }
 }
 
+#ifdef HAVE_RECVMMSG
+/**
+ * Receive up to mRxBatchSize datagrams with one recvmmsg() call into the
+ * buffer ring. The ring stays allocated between calls (KEEP_BUFFER is
+ * implied); only slots whose buffer was absorbed by a SipMessage are
+ * re-allocated. With RXALL, keep going while batches come back full.
+ */
+void
+UdpTransport::processRxBatch()
+{
+   if ( mRxBatchBuffers.empty() )
+   {
+      mRxBatchBuffers.resize(mRxBatchSize, (char*)0);
+      mRxBatchSenders.resize(mRxBatchSize, mTuple);
+   }
+
+   ++mRxTryCnt;
+   for (;;)
+   {
+      struct mmsghdr msgs[MaxBatchSize];
+      struct iovec iovs[MaxBatchSize];
+      for (int i = 0; i < mRxBatchSize; ++i)
+      {
+         if ( mRxBatchBuffers[i] == NULL )
+         {
+            mRxBatchBuffers[i] = MsgHeaderScanner::allocateBuffer(MaxBufferSize);
+         }
+         iovs[i].iov_base = mRxBatchBuffers[i];
+         iovs[i].iov_len = MaxBufferSize;
+         memset(&msgs[i], 0, sizeof(msgs[i]));
+         msgs[i].msg_hdr.msg_name = &mRxBatchSenders[i].getMutableSockaddr();
+         msgs[i].msg_hdr.msg_namelen = mRxBatchSenders[i].length();
+         msgs[i].msg_hdr.msg_iov = &iovs[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      int count = recvmmsg(mFd, msgs, mRxBatchSize, 0, 0);
+      if ( count == SOCKET_ERROR )
+      {
+         int err = getErrno();
+         if ( err != EAGAIN && err != EWOULDBLOCK )
+         {
+            error( err );
+         }
+         break;
+      }
+
+      ++mRxBatchCnt;
+      if ( count == mRxBatchSize )
+      {
+         ++mRxBatchFullCnt;
+      }
+
+      for (int i = 0; i < count; ++i)
+      {
+         int len = (int)msgs[i].msg_len;
+         if ( len+1 >= MaxBufferSize || (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) )
+         {
+            InfoLog(<<"Datagram exceeded max length "<<MaxBufferSize);
+            continue;
+         }
+         if ( len <= 0 )
+         {
+            continue;
+         }
+         ++mRxMsgCnt;
+         if ( processRxParse(mRxBatchBuffers[i], len, mRxBatchSenders[i]) )
+         {
+            mRxBatchBuffers[i] = NULL;
+         }
+      }
+
+      if ( count < mRxBatchSize || (mTransportFlags & RESIP_TRANSPORT_FLAG_RXALL) == 0 )
+      {
+         break;
+      }
+   }
+}
+#endif
+
 /*
  * Receive from socket and store results into {buffer}. Updates
  * {buffer} with actual buffer (in case allocation required),
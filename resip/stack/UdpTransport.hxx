@@ -2,6 +2,7 @@
 #define RESIP_UDPTRANSPORT_HXX
 
 #include <memory>
+#include <vector>
 #include "resip/stack/InternalTransport.hxx"
 #include "resip/stack/MsgHeaderScanner.hxx"
 #include "rutil/HeapInstanceCounter.hxx"
@@ -81,6 +82,13 @@ public:
    virtual void processPollEvent(FdPollEventMask mask);
 
    static const int MaxBufferSize = 8192;
+   static const int DefaultBatchSize = 32;
+   static const int MaxBatchSize = 64;
+
+   /** Sets the maximum number of datagrams moved per recvmmsg()/sendmmsg()
+       call when RESIP_TRANSPORT_FLAG_RXBATCH / RESIP_TRANSPORT_FLAG_TXBATCH
+       are set. Must be called before the transport starts processing. */
+   void setBatchSize(int rxBatchSize, int txBatchSize);
 
    // STUN client functionality
    enum StunResult
@@ -105,6 +113,12 @@ protected:
    void processTxAll();
    void processTxOne(SendData *data);
    void updateEvents();
+#ifdef HAVE_RECVMMSG
+   void processRxBatch();
+#endif
+#ifdef HAVE_SENDMMSG
+   void processTxBatch();
+#endif
 
    osc::Stack *mSigcompStack;
 
@@ -117,6 +131,11 @@ protected:
    unsigned mRxMsgCnt;
    unsigned mRxKeepaliveCnt;
    unsigned mRxTransactionCnt;
+   // batch statistics; "full" counts calls that moved a whole batch
+   unsigned mRxBatchCnt;
+   unsigned mRxBatchFullCnt;
+   unsigned mTxBatchCnt;
+   unsigned mTxBatchFullCnt;
 private:
    char* mRxBuffer;
    MsgHeaderScanner mMsgHeaderScanner;
@@ -128,6 +147,13 @@ private:
 
    ExternalUnknownDatagramHandler* mExternalUnknownDatagramHandler;
    bool mInWritable;
+
+   int mRxBatchSize;
+   int mTxBatchSize;
+   // Ring of receive buffers for RXBATCH. A slot is refilled only when
+   // its buffer was absorbed into a SipMessage.
+   std::vector<char*> mRxBatchBuffers;
+   std::vector<Tuple> mRxBatchSenders;
 };
 
 }
@@ -67,6 +67,12 @@ UnknownParameter::clone() const
    return new UnknownParameter(*this);
 }
 
+Parameter* 
+UnknownParameter::clone(PoolBase* pool) const
+{
+   return new (pool) UnknownParameter(*this);
+}
+
 EncodeStream&
 UnknownParameter::encode(EncodeStream& stream) const
 {
@@ -38,6 +38,7 @@ class UnknownParameter : public Parameter
          
       virtual const Data& getName() const;
       virtual Parameter* clone() const;
+      virtual Parameter* clone(PoolBase* pool) const;
 
    private:
       Data mName;
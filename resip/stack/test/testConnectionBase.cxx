@@ -99,9 +99,10 @@ class TestConnection : public ConnectionBase
       bool read(unsigned int minChunkSize, unsigned int maxChunkSize)
       {
 
+         std::pair<char*, size_t> writePair = getWriteBuffer();
          unsigned int chunk = chooseChunkSize(minChunkSize, maxChunkSize);
+         chunk = resipMin(chunk, (unsigned int)writePair.second);
          assert(chunk > 0);
-         std::pair<char*, size_t> writePair = getWriteBuffer();
          memcpy(writePair.first, mTestStream.data() + mStreamPos, chunk);
          mStreamPos += chunk;
          assert(mStreamPos <= mTestStream.size());
@@ -184,6 +185,60 @@ testTCPConnection()
    fake.flush();
    return testRxFifo.size() == runs * 3;
 }
+// Many small messages arriving back to back, so that most reads end in the
+// middle of a message; the messages are checked after the connection (and
+// its receive buffer) is gone.
+bool
+testPipelinedTCPConnection()
+{
+   const unsigned int numMessages = 200;
+   Data bytes;
+   {
+      DataStream ds(bytes);
+      for (unsigned int i = 0; i < numMessages; ++i)
+      {
+         Data body("message body " + Data(i) + CRLF);
+         ds << "MESSAGE sip:bob@biloxi.example.com SIP/2.0" CRLF
+            << "Via: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf" << i << CRLF
+            << "Max-Forwards: 70" CRLF
+            << "From: Alice <sip:alice@atlanta.example.com>;tag=9fxced76sl" CRLF
+            << "To: Bob <sip:bob@biloxi.example.com>" CRLF
+            << "Call-ID: pipelined-" << i << CRLF
+            << "CSeq: 1 MESSAGE" CRLF
+            << "Content-Type: text/plain" CRLF
+            << "Content-Length: " << body.size() << CRLF
+            << CRLF
+            << body;
+      }
+   }
+
+   Fifo<TransactionMessage> testRxFifo;
+   FakeTCPTransport fake(testRxFifo, 5060, V4, Data::Empty);
+   Tuple who(fake.getTuple());
+
+   {
+      TestConnection cBase(&fake, who, bytes);
+      while(cBase.read(1000, ConnectionBase::ChunkSize));
+   }
+   fake.flush();
+
+   // the messages, then the ConnectionTerminated
+   if (testRxFifo.size() != numMessages + 1)
+   {
+      return false;
+   }
+   for (unsigned int i = 0; i < numMessages; ++i)
+   {
+      std::unique_ptr<TransactionMessage> msg(testRxFifo.getNext());
+      SipMessage* sip = dynamic_cast<SipMessage*>(msg.get());
+      assert(sip);
+      assert(sip->header(h_CallId).value() == "pipelined-" + Data(i));
+      assert(sip->header(h_Vias).front().param(p_branch).getTransactionId() == "74bf" + Data(i));
+      assert(sip->getContents()->getBodyData() == "message body " + Data(i) + CRLF);
+   }
+   return true;
+}
+
 int
 main(int argc, char** argv)
 {
@@ -192,6 +247,9 @@ main(int argc, char** argv)
    assert(testTCPConnection());
    cerr << "testTCPConnection OK" << endl; 
 
+   assert(testPipelinedTCPConnection());
+   cerr << "testPipelinedTCPConnection OK" << endl; 
+
    cerr << "ALL OK" << endl;
    return 0;
 }
@@ -18,6 +18,7 @@
 #include "resip/stack/ParserCategories.hxx"
 #include "resip/stack/Uri.hxx"
 #include "resip/stack/Helper.hxx"
+#include "resip/stack/HmacNonceHelper.hxx"
 #include "resip/stack/test/TestSupport.hxx"
 #include "rutil/Timer.hxx"
 #include "rutil/DataStream.hxx"
@@ -28,6 +29,52 @@
 using namespace std;
 using namespace resip;
 
+static const char* registerText =
+   "REGISTER sip:biloxi.com SIP/2.0\r\n"
+   "Via: SIP/2.0/UDP bobspc.biloxi.com:5060;branch=z9hG4bKnashds7\r\n"
+   "Max-Forwards: 70\r\n"
+   "To: Bob <sip:bob@biloxi.com>\r\n"
+   "From: Bob <sip:bob@biloxi.com>;tag=456248\r\n"
+   "Call-ID: 843817637684230@998sdasdh09\r\n"
+   "CSeq: 1826 REGISTER\r\n"
+   "Contact: <sip:bob@192.0.2.4>\r\n"
+   "Content-Length: 0\r\n"
+   "\r\n";
+
+// Times makeNonce and authenticateRequest with the current NonceHelper;
+// each authentication uses the next nonce-count, as a client would.
+static void
+timeNonceHelper(const char* name, int runs)
+{
+   unique_ptr<SipMessage> request(TestSupport::makeMessage(registerText));
+   Data realm = "localhost";
+   Data password = "secret";
+
+   Data now(Timer::getTimeSecs());
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int i = 0; i < runs; ++i)
+   {
+      Helper::makeNonce(*request, now);
+   }
+   UInt64 nonceUs = Timer::getTimeMicroSec() - start;
+
+   unique_ptr<SipMessage> challenge(Helper::makeProxyChallenge(*request, realm, true));
+   unsigned int nc = 0;
+   UInt64 authUs = 0;
+   for (int i = 0; i < runs; ++i)
+   {
+      request->remove(h_ProxyAuthorizations);
+      Helper::addAuthorization(*request, *challenge, "bob", password, "0a4f113b", nc);
+      start = Timer::getTimeMicroSec();
+      Helper::AuthResult res = Helper::authenticateRequest(*request, realm, password, 60);
+      authUs += Timer::getTimeMicroSec() - start;
+      assert(res == Helper::Authenticated);
+   }
+
+   cerr << name << ": " << runs << " nonces in " << nonceUs << " us, "
+        << runs << " authentications in " << authUs << " us" << endl;
+}
+
 int
 main(int arc, char** argv)
 {
@@ -508,6 +555,88 @@ Calculated digest == 575a9ecd3a6f1989a978748217b24a25
       assert(res == Helper::Expired);
       
    }
+   {
+      timeNonceHelper("BasicNonceHelper", 20000);
+
+      HmacNonceHelper* hmac = new HmacNonceHelper(60);
+      hmac->setPrivateKey("not so secret");
+      Helper::setNonceHelper(hmac);
+      timeNonceHelper("HmacNonceHelper", 20000);
+
+      unique_ptr<SipMessage> request(TestSupport::makeMessage(registerText));
+      UInt64 then = Timer::getTimeSecs();
+      Data nonce = Helper::makeNonce(*request, Data(then));
+      cerr << "HmacNonceHelper nonce: " << nonce << endl;
+
+      // every nonce is different, even within the same second
+      assert(nonce != Helper::makeNonce(*request, Data(then)));
+      assert(hmac->parseNonce(nonce).getCreationTime() == then);
+      assert(hmac->isValidNonce(*request, nonce, then));
+      assert(!hmac->isValidNonce(*request, nonce, then + 1));
+
+      Data tampered(nonce);
+      tampered[tampered.size() - 1] = tampered[tampered.size() - 1] == '0' ? '1' : '0';
+      assert(!hmac->isValidNonce(*request, tampered, then));
+
+      unique_ptr<SipMessage> alice(TestSupport::makeMessage(registerText));
+      alice->header(h_From).uri().user() = "alice";
+      assert(!hmac->isValidNonce(*alice, nonce, then));
+
+      assert(hmac->parseNonce("garbage").getCreationTime() == 0);
+      assert(hmac->parseNonce("12345").getCreationTime() == 0);
+      assert(!hmac->isValidNonce(*request, "12345:0000:abcd", 12345));
+
+      // nonce-counts may arrive out of order, but only once each, and only
+      // within 64 of the highest seen
+      assert(!hmac->isReplay(nonce, then, "00000001"));
+      assert(hmac->isReplay(nonce, then, "00000001"));
+      assert(!hmac->isReplay(nonce, then, "00000003"));
+      assert(!hmac->isReplay(nonce, then, "00000002"));
+      assert(hmac->isReplay(nonce, then, "00000002"));
+      assert(!hmac->isReplay(nonce, then, "00000050"));
+      assert(hmac->isReplay(nonce, then, "00000003"));
+      assert(!hmac->isReplay(nonce, then, "00000040"));
+      assert(hmac->isReplay(nonce, then, "00000040"));
+      assert(hmac->isReplay(nonce, then, "00000000"));
+      assert(hmac->isReplay(nonce, then, "0000000g"));
+      assert(hmac->isReplay(nonce, then - 120, "00000001"));
+
+      // past maxNonces the nonce seen first is forgotten, and treated as
+      // too old from then on, as is any other untracked nonce no newer
+      {
+         HmacNonceHelper capped(60, 3);
+         Data first = Helper::makeNonce(*request, Data(then - 1));
+         assert(!capped.isReplay(first, then - 1, "00000001"));
+         for (int i = 0; i < 3; ++i)
+         {
+            assert(!capped.isReplay(Helper::makeNonce(*request, Data(then)), then, "00000001"));
+         }
+         assert(capped.trackedNonces() == 3);
+         assert(capped.isReplay(first, then - 1, "00000002"));
+         assert(capped.isReplay(Helper::makeNonce(*request, Data(then - 1)), then - 1, "00000001"));
+         assert(!capped.isReplay(Helper::makeNonce(*request, Data(then)), then, "00000001"));
+         assert(capped.trackedNonces() == 3);
+      }
+
+      // a replayed request is reported as expired, so that the client is
+      // challenged again
+      Data realm = "localhost";
+      unique_ptr<SipMessage> challenge(Helper::makeProxyChallenge(*request, realm, true));
+      unsigned int nc = 0;
+      Helper::addAuthorization(*request, *challenge, "bob", "secret", "0a4f113b", nc);
+      assert(Helper::authenticateRequest(*request, realm, "secret") == Helper::Authenticated);
+      assert(Helper::authenticateRequest(*request, realm, "secret") == Helper::Expired);
+      assert(Helper::authenticateRequest(*request, realm, "wrong") == Helper::Failed);
+
+      request->remove(h_ProxyAuthorizations);
+      Helper::addAuthorization(*request, *challenge, "bob", "secret", "0a4f113b", nc);
+      assert(Helper::authenticateRequest(*request, realm, "secret") == Helper::Authenticated);
+
+      request->remove(h_ProxyAuthorizations);
+      Helper::addAuthorization(*request, *challenge, "bob", "secret", "0a4f113b", nc);
+      request->header(h_ProxyAuthorizations).front().param(p_nonce) = tampered;
+      assert(Helper::authenticateRequest(*request, realm, "secret") == Helper::Failed);
+   }
    cerr << "ALL OK" << endl;
    return 0;
 }
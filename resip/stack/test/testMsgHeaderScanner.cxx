@@ -0,0 +1,269 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "resip/stack/MsgHeaderScanner.hxx"
+#include "resip/stack/SipMessage.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/DataStream.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/Random.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks that the vector scanning of MsgHeaderScanner finds exactly what the
+// byte-at-a-time scanning finds, for the RFC 4475 torture messages in this
+// directory, whole and split into random chunks, and measures the throughput
+// of both.
+//
+// usage: testMsgHeaderScanner [passes] [directory]
+
+static const char* corpus[] =
+{
+   "badaspec.dat", "badbranch.dat", "baddate.dat", "baddn.dat", "badinv01.dat",
+   "badvers.dat", "bcast.dat", "bext01.dat", "bigcode.dat", "clerr.dat",
+   "cparam01.dat", "cparam02.dat", "dblreq.dat", "esc01.dat", "esc02.dat",
+   "escnull.dat", "escruri.dat", "insuf.dat", "intmeth.dat", "inv2543.dat",
+   "invut.dat", "longreq.dat", "ltgtruri.dat", "lwsdisp.dat", "lwsruri.dat",
+   "lwsstart.dat", "mcl01.dat", "mismatch01.dat", "mismatch02.dat",
+   "mpart01.dat", "multi01.dat", "ncl.dat", "noreason.dat", "novelsc.dat",
+   "quotbal.dat", "regaut01.dat", "regbadct.dat", "regescrt.dat",
+   "scalar02.dat", "scalarlg.dat", "sdp01.dat", "semiuri.dat", "test.dat",
+   "transports.dat", "trws.dat", "unkscm.dat", "unksm2.dat", "unreason.dat",
+   "wsinv.dat", "zeromf.dat"
+};
+
+struct ScanOutcome
+{
+      MsgHeaderScanner::ScanChunkResult result;
+      size_t unprocessed;
+      unsigned int headerCount;
+      Data encoded;
+};
+
+// Scans text (in chunks of at most maxChunk bytes) the way ConnectionBase
+// does, carrying unprocessed text over into the next chunk.
+static ScanOutcome
+scan(const Data& text, size_t maxChunk)
+{
+   ScanOutcome outcome;
+   std::unique_ptr<SipMessage> msg(new SipMessage);
+   char* buffer = MsgHeaderScanner::allocateBuffer((int)text.size());
+   msg->addBuffer(buffer);
+   memcpy(buffer, text.data(), text.size());
+
+   MsgHeaderScanner scanner;
+   scanner.prepareForMessage(msg.get());
+   char* chunk = buffer;
+   size_t available = resipMin(maxChunk, (size_t)text.size());
+   char* unprocessed = 0;
+   for (;;)
+   {
+      outcome.result = scanner.scanChunk(chunk, (unsigned int)available, &unprocessed);
+      if (outcome.result != MsgHeaderScanner::scrNextChunk ||
+          chunk + available == buffer + text.size())
+      {
+         break;
+      }
+      size_t end = (chunk - buffer) + available;
+      chunk = unprocessed;
+      available = resipMin(end + maxChunk, (size_t)text.size()) - (chunk - buffer);
+   }
+   outcome.unprocessed = unprocessed - buffer;
+   outcome.headerCount = scanner.getHeaderCount();
+   if (outcome.result == MsgHeaderScanner::scrEnd)
+   {
+      DataStream str(outcome.encoded);
+      msg->encode(str);
+   }
+   return outcome;
+}
+
+static bool
+sameOutcome(const ScanOutcome& lhs, const ScanOutcome& rhs)
+{
+   return lhs.result == rhs.result &&
+      lhs.unprocessed == rhs.unprocessed &&
+      lhs.headerCount == rhs.headerCount &&
+      lhs.encoded == rhs.encoded;
+}
+
+static bool
+loadCorpus(const Data& directory, std::vector<Data>& messages)
+{
+   for (size_t i = 0; i < sizeof(corpus)/sizeof(*corpus); ++i)
+   {
+      ifstream file((directory + "/" + corpus[i]).c_str(), ios::binary);
+      if (!file)
+      {
+         cerr << "could not open " << directory << "/" << corpus[i] << endl;
+         return false;
+      }
+      ostringstream contents;
+      contents << file.rdbuf();
+      messages.push_back(Data(contents.str()));
+   }
+   return true;
+}
+
+static void
+testAgreement(const std::vector<Data>& messages)
+{
+   for (size_t i = 0; i < messages.size(); ++i)
+   {
+      MsgHeaderScanner::useVectorScan(false);
+      ScanOutcome expected = scan(messages[i], messages[i].size());
+      MsgHeaderScanner::useVectorScan(true);
+      ScanOutcome whole = scan(messages[i], messages[i].size());
+      if (!sameOutcome(expected, whole))
+      {
+         cerr << corpus[i] << ": vector scan differs" << endl;
+         resip_assert(0);
+      }
+
+      for (int run = 0; run < 20; ++run)
+      {
+         size_t maxChunk = 1 + Random::getRandom() % messages[i].size();
+         MsgHeaderScanner::useVectorScan(false);
+         ScanOutcome chunkedExpected = scan(messages[i], maxChunk);
+         MsgHeaderScanner::useVectorScan(true);
+         ScanOutcome chunked = scan(messages[i], maxChunk);
+         if (!sameOutcome(chunkedExpected, chunked))
+         {
+            cerr << corpus[i] << ": vector scan differs with chunks of "
+                 << maxChunk << endl;
+            resip_assert(0);
+         }
+      }
+   }
+}
+
+// Scanning only: the messages are scanned in place, over and over, into one
+// SipMessage per pass and file.
+static double
+megabytesPerSecond(const std::vector<Data>& messages, int passes)
+{
+   size_t bytes = 0;
+   std::vector<char*> buffers;
+   for (size_t i = 0; i < messages.size(); ++i)
+   {
+      buffers.push_back(MsgHeaderScanner::allocateBuffer((int)messages[i].size()));
+      memcpy(buffers.back(), messages[i].data(), messages[i].size());
+   }
+
+   MsgHeaderScanner scanner;
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int pass = 0; pass < passes; ++pass)
+   {
+      for (size_t i = 0; i < messages.size(); ++i)
+      {
+         SipMessage msg;
+         scanner.prepareForMessage(&msg);
+         char* unprocessed;
+         scanner.scanChunk(buffers[i], (unsigned int)messages[i].size(), &unprocessed);
+         bytes += unprocessed - buffers[i];
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+
+   for (size_t i = 0; i < buffers.size(); ++i)
+   {
+      delete [] buffers[i];
+   }
+   return (double)bytes / (double)resipMax(elapsed, (UInt64)1);
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   int passes = argc > 1 ? atoi(argv[1]) : 2000;
+   // "make check" runs tests in the build directory
+   const char* srcdir = getenv("srcdir");
+   Data directory(argc > 2 ? argv[2] : (srcdir ? srcdir : "."));
+
+   std::vector<Data> messages;
+   if (!loadCorpus(directory, messages))
+   {
+      return 1;
+   }
+
+   testAgreement(messages);
+   cerr << "vector and byte-at-a-time scanning agree (" 
+        << MsgHeaderScanner::vectorScanName() << ")" << endl;
+
+   MsgHeaderScanner::useVectorScan(false);
+   double scalar = megabytesPerSecond(messages, passes);
+   MsgHeaderScanner::useVectorScan(true);
+   double vector = megabytesPerSecond(messages, passes);
+   cerr << "header scanning, " << passes << " passes over " << messages.size()
+        << " messages:" << endl
+        << "   byte-at-a-time: " << scalar << " MB/s" << endl
+        << "   " << MsgHeaderScanner::vectorScanName() << ":           " 
+        << vector << " MB/s" << endl;
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
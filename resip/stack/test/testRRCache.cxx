@@ -0,0 +1,399 @@
+#if defined(HAVE_CONFIG_H)
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <iostream>
+#include <vector>
+
+#include "rutil/Data.hxx"
+#include "rutil/Logger.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Time.hxx"
+#include "rutil/Timer.hxx"
+#include "rutil/dns/DnsHostRecord.hxx"
+#include "rutil/dns/DnsNaptrRecord.hxx"
+#include "rutil/dns/DnsSrvRecord.hxx"
+#include "rutil/dns/QueryTypes.hxx"
+#include "rutil/dns/RRCache.hxx"
+#include "rutil/dns/RROverlay.hxx"
+
+using namespace resip;
+using namespace std;
+
+#define RESIPROCATE_SUBSYSTEM Subsystem::TEST
+
+// Checks the lookup, case folding, LRU eviction, prefetch and serve-stale
+// behaviour of RRCache, then fills
+// it with SRV, NAPTR and A entries the way DnsStub does (from DNS answers)
+// and measures cache hits per second. testDnsCache needs a live resolver;
+// this one does not.
+//
+// usage: testRRCache [entries] [passes]
+
+static void
+append16(Data& msg, unsigned int value)
+{
+   msg += (char)((value >> 8) & 0xff);
+   msg += (char)(value & 0xff);
+}
+
+static void
+append32(Data& msg, unsigned int value)
+{
+   append16(msg, value >> 16);
+   append16(msg, value & 0xffff);
+}
+
+static void
+appendName(Data& msg, const Data& name)
+{
+   Data::size_type start = 0;
+   while (start < name.size())
+   {
+      Data::size_type dot = name.find(".", start);
+      if (dot == Data::npos)
+      {
+         dot = name.size();
+      }
+      msg += (char)(dot - start);
+      msg += name.substr(start, dot - start);
+      start = dot + 1;
+   }
+   msg += (char)0;
+}
+
+static void
+appendString(Data& msg, const Data& text)
+{
+   msg += (char)text.size();
+   msg += text;
+}
+
+// A response carrying the single answer record (name, type, rdata).
+static Data
+makeAnswer(const Data& name, int type, const Data& rdata, unsigned int ttl = 3600)
+{
+   Data msg;
+   append16(msg, 0);       // id
+   append16(msg, 0x8180);  // response, recursion desired and available
+   append16(msg, 0);       // questions
+   append16(msg, 1);       // answers
+   append16(msg, 0);       // authority
+   append16(msg, 0);       // additional
+   appendName(msg, name);
+   append16(msg, type);
+   append16(msg, 1);       // class IN
+   append32(msg, ttl);
+   append16(msg, (unsigned int)rdata.size());
+   msg += rdata;
+   return msg;
+}
+
+static Data
+srvAnswer(const Data& name, const Data& target)
+{
+   Data rdata;
+   append16(rdata, 10);    // priority
+   append16(rdata, 50);    // weight
+   append16(rdata, 5060);
+   appendName(rdata, target);
+   return makeAnswer(name, RR_SRV::getRRType(), rdata);
+}
+
+static Data
+naptrAnswer(const Data& name, const Data& replacement)
+{
+   Data rdata;
+   append16(rdata, 10);    // order
+   append16(rdata, 100);   // preference
+   appendString(rdata, "s");
+   appendString(rdata, "SIP+D2U");
+   appendString(rdata, "");
+   appendName(rdata, replacement);
+   return makeAnswer(name, RR_NAPTR::getRRType(), rdata);
+}
+
+static Data
+aAnswer(const Data& name, unsigned int address, unsigned int ttl = 3600)
+{
+   Data rdata;
+   append32(rdata, address);
+   return makeAnswer(name, RR_A::getRRType(), rdata, ttl);
+}
+
+static void
+add(RRCache& cache, const Data& name, const Data& answer)
+{
+   const unsigned char* msg = (const unsigned char*)answer.data();
+   std::vector<RROverlay> overlays;
+   overlays.push_back(RROverlay(msg + 12, msg, (int)answer.size()));
+   cache.updateCache(name, overlays[0].type(), overlays.begin(), overlays.end());
+}
+
+static bool
+has(RRCache& cache, const Data& name, int type)
+{
+   RRCache::Result records;
+   int status;
+   return cache.lookup(name, type, RRCache::Protocol::Sip, records, status) && !records.empty();
+}
+
+static void
+testLookup()
+{
+   RRCache cache;
+   add(cache, "_sip._udp.example.com", srvAnswer("_sip._udp.example.com", "sip1.example.com"));
+   add(cache, "example.com", naptrAnswer("example.com", "_sip._udp.example.com"));
+   add(cache, "sip1.example.com", aAnswer("sip1.example.com", 0x0a000001));
+
+   RRCache::Result records;
+   int status = -1;
+   resip_assert(cache.lookup("_SIP._UDP.Example.COM", RR_SRV::getRRType(), RRCache::Protocol::Sip, records, status));
+   resip_assert(status == 0);
+   resip_assert(records.size() == 1);
+   resip_assert(dynamic_cast<DnsSrvRecord*>(records[0])->target() == "sip1.example.com");
+   resip_assert(dynamic_cast<DnsSrvRecord*>(records[0])->port() == 5060);
+
+   resip_assert(cache.lookup("EXAMPLE.com", RR_NAPTR::getRRType(), RRCache::Protocol::Sip, records, status));
+   resip_assert(records.size() == 1);
+   resip_assert(dynamic_cast<DnsNaptrRecord*>(records[0])->replacement() == "_sip._udp.example.com");
+
+   resip_assert(has(cache, "Sip1.Example.Com", RR_A::getRRType()));
+
+   // same name, other type; other name, same type
+   resip_assert(!has(cache, "example.com", RR_SRV::getRRType()));
+   resip_assert(!has(cache, "sip2.example.com", RR_A::getRRType()));
+
+   // an update replaces the entry rather than adding a second one
+   add(cache, "SIP1.example.com", aAnswer("SIP1.example.com", 0x0a000002));
+   resip_assert(cache.lookup("sip1.example.com", RR_A::getRRType(), RRCache::Protocol::Sip, records, status));
+   resip_assert(records.size() == 1);
+   resip_assert(dynamic_cast<DnsHostRecord*>(records[0])->addr().s_addr == htonl(0x0a000002));
+
+   in_addr addr;
+   addr.s_addr = htonl(0x0a000003);
+   cache.updateCacheFromHostFile(DnsHostRecord("hosts.example.com", addr));
+   resip_assert(has(cache, "HOSTS.example.com", RR_A::getRRType()));
+
+   cache.clearCache();
+   resip_assert(!has(cache, "_sip._udp.example.com", RR_SRV::getRRType()));
+   resip_assert(!has(cache, "hosts.example.com", RR_A::getRRType()));
+}
+
+static void
+testEviction()
+{
+   RRCache cache;
+   // the cache evicts when an insertion brings it to its size
+   cache.setSize(4);
+   add(cache, "a.example.com", aAnswer("a.example.com", 1));
+   add(cache, "b.example.com", aAnswer("b.example.com", 2));
+   add(cache, "c.example.com", aAnswer("c.example.com", 3));
+   resip_assert(has(cache, "a.example.com", RR_A::getRRType()));
+   add(cache, "d.example.com", aAnswer("d.example.com", 4));
+
+   resip_assert(!has(cache, "b.example.com", RR_A::getRRType()));
+   resip_assert(has(cache, "a.example.com", RR_A::getRRType()));
+   resip_assert(has(cache, "c.example.com", RR_A::getRRType()));
+   resip_assert(has(cache, "d.example.com", RR_A::getRRType()));
+}
+
+// The refreshing lookup, as made by DnsStub for a user's query.
+static bool
+serve(RRCache& cache, const Data& name, bool& refresh)
+{
+   RRCache::Result records;
+   int status;
+   RRCache::Outcome outcome;
+   bool cached = cache.lookup(name, RR_A::getRRType(), RRCache::Protocol::Sip, records, status, refresh, outcome);
+   cache.countLookup(outcome);
+   return cached && !records.empty();
+}
+
+static void
+testPrefetch()
+{
+   RRCache cache;
+   bool refresh;
+
+   // within an hour of expiry, once looked up twice
+   cache.setPrefetch(3600, 2);
+   add(cache, "busy.example.com", aAnswer("busy.example.com", 1));
+   resip_assert(serve(cache, "busy.example.com", refresh) && !refresh);
+   resip_assert(serve(cache, "busy.example.com", refresh) && refresh);
+   // the refresh is under way
+   resip_assert(serve(cache, "busy.example.com", refresh) && !refresh);
+
+   // the answer resets the count
+   add(cache, "busy.example.com", aAnswer("busy.example.com", 1));
+   resip_assert(serve(cache, "busy.example.com", refresh) && !refresh);
+   resip_assert(serve(cache, "busy.example.com", refresh) && refresh);
+
+   // too far from expiry
+   cache.setPrefetch(60, 2);
+   add(cache, "far.example.com", aAnswer("far.example.com", 2));
+   for (int i = 0; i < 5; ++i)
+   {
+      resip_assert(serve(cache, "far.example.com", refresh) && !refresh);
+   }
+
+   resip_assert(!serve(cache, "unknown.example.com", refresh) && !refresh);
+   resip_assert(cache.getHits() == 10);
+   resip_assert(cache.getMisses() == 1);
+   resip_assert(cache.getStaleHits() == 0);
+}
+
+static void
+testServeStale()
+{
+   RRCache stale;
+   stale.setServeStale(60);
+   RRCache plain;
+   bool refresh;
+
+   // answers are kept for at least 10 seconds
+   add(stale, "short.example.com", aAnswer("short.example.com", 1, 1));
+   add(plain, "short.example.com", aAnswer("short.example.com", 1, 1));
+   resip_assert(serve(stale, "short.example.com", refresh) && !refresh);
+   sleepSeconds(11);
+
+   resip_assert(!serve(plain, "short.example.com", refresh) && !refresh);
+   resip_assert(plain.getMisses() == 1);
+
+   // internal lookups never see stale answers, but leave them in place
+   resip_assert(!has(stale, "short.example.com", RR_A::getRRType()));
+   resip_assert(serve(stale, "short.example.com", refresh) && refresh);
+   resip_assert(serve(stale, "short.example.com", refresh) && !refresh);
+   resip_assert(stale.getStaleHits() == 2);
+
+   add(stale, "short.example.com", aAnswer("short.example.com", 1, 1));
+   resip_assert(has(stale, "short.example.com", RR_A::getRRType()));
+   resip_assert(serve(stale, "short.example.com", refresh) && !refresh);
+   resip_assert(stale.getHits() == 2);
+}
+
+static void
+benchmark(int entries, int passes)
+{
+   RRCache cache;
+   cache.setSize(entries + 1);
+
+   std::vector<Data> names;
+   std::vector<int> types;
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int i = 0; i < entries; ++i)
+   {
+      Data host("host" + Data(i) + ".example.com");
+      switch (i % 3)
+      {
+         case 0:
+            names.push_back("_sip._udp." + host);
+            types.push_back(RR_SRV::getRRType());
+            add(cache, names.back(), srvAnswer(names.back(), host));
+            break;
+         case 1:
+            names.push_back(host);
+            types.push_back(RR_NAPTR::getRRType());
+            add(cache, names.back(), naptrAnswer(names.back(), "_sip._udp." + host));
+            break;
+         default:
+            names.push_back(host);
+            types.push_back(RR_A::getRRType());
+            add(cache, names.back(), aAnswer(names.back(), i));
+            break;
+      }
+   }
+   UInt64 fill = Timer::getTimeMicroSec() - start;
+
+   RRCache::Result records;
+   int status;
+   UInt64 hits = 0;
+   start = Timer::getTimeMicroSec();
+   for (int pass = 0; pass < passes; ++pass)
+   {
+      // stride through the names so consecutive lookups touch unrelated entries
+      for (size_t i = 0, j = 0; i < names.size(); ++i, j = (j + 7919) % names.size())
+      {
+         if (cache.lookup(names[j], types[j], RRCache::Protocol::Sip, records, status))
+         {
+            ++hits;
+         }
+      }
+   }
+   UInt64 elapsed = resipMax(Timer::getTimeMicroSec() - start, (UInt64)1);
+   resip_assert(hits == (UInt64)entries * passes);
+
+   cerr << "filled " << entries << " SRV/NAPTR/A entries in " << fill / 1000 << " ms" << endl
+        << passes << " x " << entries << " cache hits: " << elapsed / 1000 << " ms, "
+        << (hits * 1000 / elapsed) << " hits/ms, "
+        << (elapsed * 1000 / hits) << " ns/hit" << endl;
+}
+
+int
+main(int argc, char** argv)
+{
+   Log::initialize(Log::Cout, Log::Warning, argv[0]);
+
+   int entries = argc > 1 ? atoi(argv[1]) : 100000;
+   int passes = argc > 2 ? atoi(argv[2]) : 10;
+
+   testLookup();
+   testEviction();
+   testPrefetch();
+   testServeStale();
+   benchmark(entries, passes);
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -1234,6 +1234,11 @@ main(int argc, char** argv)
       assert(msg8->getTransactionId() != msg9->getTransactionId());
       assert(msg9->getTransactionId() != msg10->getTransactionId());
       assert(msg10->getTransactionId() == msg11->getTransactionId());
+
+      // the precomputed hash matches for both 3261 and 2543 tids
+      assert(msg1->getTransactionIdHash() == msg1->getTransactionId().caseInsensitiveTokenHash());
+      assert(msg8->getTransactionIdHash() == msg8->getTransactionId().caseInsensitiveTokenHash());
+      assert(msg9->getTransactionIdHash() == msg9->getTransactionId().caseInsensitiveTokenHash());
    }
    
    {
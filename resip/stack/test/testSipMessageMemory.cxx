@@ -4,13 +4,202 @@
 
 #include <iostream>
 #include <memory>
+#include <new>
+#include <stdlib.h>
 
 using namespace resip;
 using namespace std;
 
+// Count every trip to the global heap, so that we can see how much of a
+// message's memory comes from its pool.
+static unsigned long heapAllocations = 0;
+static long liveAllocations = 0;
+
+void* operator new(size_t size)
+{
+   ++heapAllocations;
+   ++liveAllocations;
+   void* ptr = malloc(size ? size : 1);
+   if (!ptr)
+   {
+      throw std::bad_alloc();
+   }
+   return ptr;
+}
+
+void* operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+void operator delete(void* ptr) throw()
+{
+   if (ptr)
+   {
+      --liveAllocations;
+   }
+   free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+   operator delete(ptr);
+}
+
+static const char* inviteText =
+   "INVITE sip:bob@biloxi.example.com SIP/2.0\r\n"
+   "Via: SIP/2.0/TCP ss2.biloxi.example.com:5060;branch=z9hG4bK721e418c4.1;received=192.0.2.111\r\n"
+   "Via: SIP/2.0/TCP ss1.atlanta.example.com:5060;branch=z9hG4bK2d4790.1;received=192.0.2.101\r\n"
+   "Via: SIP/2.0/TCP client.atlanta.example.com:5060;branch=z9hG4bK74bf9;received=192.0.2.103;rport=5060\r\n"
+   "Max-Forwards: 68\r\n"
+   "Record-Route: <sip:ss2.biloxi.example.com;lr>\r\n"
+   "Record-Route: <sip:ss1.atlanta.example.com;lr;transport=tcp>\r\n"
+   "From: Alice <sip:alice@atlanta.example.com>;tag=9fxced76sl\r\n"
+   "To: Bob <sip:bob@biloxi.example.com>\r\n"
+   "Call-ID: 2xTb9vxSit55XU7p8@atlanta.example.com\r\n"
+   "CSeq: 1 INVITE\r\n"
+   "Contact: <sip:alice@client.atlanta.example.com;transport=tcp>;+sip.instance=\"<urn:uuid:00000000-0000-1000-8000-000A95A0E128>\";expires=3600\r\n"
+   "Supported: replaces, timer, gruu\r\n"
+   "Allow: INVITE, ACK, CANCEL, BYE, OPTIONS, UPDATE, REFER\r\n"
+   "Content-Type: application/sdp\r\n"
+   "Content-Length: 0\r\n"
+   "\r\n";
+
+// What a proxy typically does to a request: look at most of it, then
+// modify it.
+static void
+accessAndModify(SipMessage& msg)
+{
+   assert(msg.header(h_Vias).size() == 3);
+   for (Vias::iterator i = msg.header(h_Vias).begin(); i != msg.header(h_Vias).end(); ++i)
+   {
+      assert(!i->param(p_branch).getTransactionId().empty());
+      assert(i->exists(p_received));
+   }
+   assert(msg.header(h_From).param(p_tag) == "9fxced76sl");
+   assert(msg.header(h_From).uri().user() == "alice");
+   assert(!msg.header(h_To).exists(p_tag));
+   assert(msg.header(h_CSeq).sequence() == 1);
+   assert(!msg.header(h_CallId).value().empty());
+   assert(msg.header(h_RecordRoutes).front().uri().exists(p_lr));
+   assert(msg.header(h_Contacts).front().param(p_expires) == 3600);
+   assert(msg.header(h_Supporteds).size() == 3);
+   assert(msg.header(h_MaxForwards).value() == 68);
+
+   msg.header(h_MaxForwards).value()--;
+   msg.header(h_To).param(p_tag) = "8321234356";
+   msg.header(h_Vias).front().param(p_rport).port() = 5060;
+   NameAddr rr;
+   rr.uri().host() = "proxy.example.com";
+   rr.uri().param(p_lr);
+   msg.header(h_RecordRoutes).push_front(rr);
+   Via via;
+   via.sentHost() = "proxy.example.com";
+   via.param(p_branch).reset("1a2b3c4d");
+   msg.header(h_Vias).push_front(via);
+}
+
+static void
+reportAllocationsPerMessage()
+{
+   const int runs = 1000;
+   const Data text(inviteText);
+   unsigned long parse = 0;
+   unsigned long access = 0;
+   unsigned long copy = 0;
+   unsigned long encode = 0;
+
+   for (int i = 0; i < runs; ++i)
+   {
+      unsigned long start = heapAllocations;
+      SipMessage* msg = TestSupport::makeMessage(text);
+      parse += heapAllocations - start;
+
+      start = heapAllocations;
+      accessAndModify(*msg);
+      access += heapAllocations - start;
+
+      start = heapAllocations;
+      SipMessage* copied = new SipMessage(*msg);
+      copy += heapAllocations - start;
+
+      Data buffer;
+      buffer.reserve(2048);
+      start = heapAllocations;
+      {
+         DataStream str(buffer);
+         copied->encode(str);
+      }
+      encode += heapAllocations - start;
+
+      delete copied;
+      delete msg;
+   }
+
+   resipCerr << "Heap allocations per message (sizeof(SipMessage)=" << sizeof(SipMessage) << "):" << endl
+             << "   parse:           " << (double)parse/runs << endl
+             << "   access + modify: " << (double)access/runs << endl
+             << "   copy:            " << (double)copy/runs << endl
+             << "   encode copy:     " << (double)encode/runs << endl;
+}
+
+// What a client keeps doing to the request it refreshes (see
+// ClientRegistration): new CSeq, Contacts, Expires and credentials in the
+// same message every time.  None of that may add to the message for good.
+static void
+refresh(SipMessage& msg, const NameAddrs& contacts, int n)
+{
+   msg.header(h_CSeq).sequence()++;
+   msg.header(h_Vias).front().param(p_branch).reset();
+   msg.header(h_Contacts) = contacts;
+   msg.header(h_Expires).value() = 3600 + n;
+   msg.remove(h_Authorizations);
+   Auth auth;
+   auth.scheme() = "Digest";
+   auth.param(p_username) = "bob";
+   auth.param(p_realm) = "biloxi.com";
+   auth.param(p_nonce) = Data(n);
+   auth.param(p_uri) = "sip:registrar.biloxi.com";
+   auth.param(p_response) = "dfe56131d1958046689d83306477ecc";
+   msg.header(h_Authorizations).push_back(auth);
+   msg.header(h_To).uri().param(p_transport) = "tcp";
+   msg.header(h_To).uri().remove(p_transport);
+}
+
+static void
+testRepeatedModification()
+{
+   const char* txt = "REGISTER sip:registrar.biloxi.com SIP/2.0\r\nVia: SIP/2.0/UDP bobspc.biloxi.com:5060;branch=z9hG4bKnashds7\r\nMax-Forwards: 70\r\nTo: Bob <sip:bob@biloxi.com>\r\nFrom: Bob <sip:bob@biloxi.com>;tag=456248\r\nCall-ID: 843817637684230@998sdasdh09\r\nCSeq: 1826 REGISTER\r\nContact: <sip:bob@192.0.2.4>\r\nExpires: 7200\r\nContent-Length: 0\r\n\r\n";
+   unique_ptr<SipMessage> msg(TestSupport::makeMessage(Data(txt)));
+   NameAddrs contacts;
+   contacts.push_back(NameAddr("<sip:bob@192.0.2.4;transport=tcp>;+sip.instance=\"<urn:uuid:00000000-0000-1000-8000-000A95A0E128>\";reg-id=1"));
+   contacts.push_back(NameAddr("<sip:bob@198.51.100.7>;expires=60"));
+
+   // the first few refreshes may still find room they need, after that
+   // the message must stay the size it is
+   for (int n = 0; n < 10; ++n)
+   {
+      refresh(*msg, contacts, n);
+   }
+   long settled = liveAllocations;
+   for (int n = 10; n < 10000; ++n)
+   {
+      refresh(*msg, contacts, n);
+   }
+   resipCerr << "Live heap allocations after 10 refreshes: " << settled
+             << ", after 10000: " << liveAllocations << endl;
+   assert(liveAllocations <= settled);
+   assert(msg->header(h_CSeq).sequence() == 1826 + 10000);
+   assert(msg->header(h_Authorizations).size() == 1);
+   assert(msg->header(h_Authorizations).front().param(p_nonce) == "9999");
+}
+
 int
 main()
 {
+   reportAllocationsPerMessage();
+   testRepeatedModification();
+
    {
       const char *txt1 = "REGISTER sip:registrar.biloxi.com SIP/2.0\r\nVia: SIP/2.0/UDP bobspc.biloxi.com:5060;branch=z9hG4bKnashds7\r\nMax-Forwards: 70\r\nTo: Bob <sip:bob@biloxi.com>\r\nFrom: Bob <sip:bob@biloxi.com>;tag=456248\r\nCall-ID: 843817637684230@998sdasdh09\r\nCSeq: 1826 REGISTER\r\nContact: <sip:bob@192.0.2.4>\r\nExpires: 7200\r\nContent-Length: 0\r\n\r\n";
 
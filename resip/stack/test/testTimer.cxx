@@ -1,9 +1,11 @@
 #include <iostream>
+#include <cstdlib>
 #include "resip/stack/TransactionMessage.hxx"
 #include "resip/stack/TimerQueue.hxx"
 #include "resip/stack/TuSelector.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/TimeLimitFifo.hxx"
+#include "rutil/TimerWheel.hxx"
 #ifdef WIN32
 #include <io.h>
 #else
@@ -25,11 +27,91 @@ isNear(int value, int reference, int epsilon=250)
    return (diff < epsilon);
 }
 
+class BenchTimer
+{
+   public:
+      BenchTimer(UInt64 when) : mWhen(when) {}
+      UInt64 getWhen() const { return mWhen; }
+      bool operator>(const BenchTimer& rhs) const { return mWhen > rhs.mWhen; }
+   private:
+      UInt64 mWhen;
+};
 
-int
-main()
+// Adds count timers spread over spanMs, then steps the clock a millisecond
+// at a time until all have fired, checking that they fire in order and on
+// time. Compares the wheel against the heap TimerQueue used by default.
+void
+benchmark(int count, int spanMs)
 {
+   // The clock is simulated from base on; the wheel never runs ahead of the
+   // real clock, so base must not be reached while the timers are added.
+   std::vector<UInt64> whens;
+   UInt64 base = Timer::getTimeMs() + 1000;
+   srand(1);
+   for (int i = 0; i < count; ++i)
+   {
+      whens.push_back(base + (rand() % spanMs));
+   }
+
+   {
+      TimerWheel<BenchTimer> wheel;
+      std::vector<BenchTimer> expired;
+      UInt64 start = Timer::getTimeMs();
+      for (int i = 0; i < count; ++i)
+      {
+         wheel.push(BenchTimer(whens[i]));
+      }
+      UInt64 added = Timer::getTimeMs();
+      int fired = 0;
+      UInt64 last = 0;
+      for (UInt64 now = base; now < base + spanMs; ++now)
+      {
+         expired.clear();
+         wheel.expire(now, expired);
+         for (std::vector<BenchTimer>::const_iterator it = expired.begin(); it != expired.end(); ++it)
+         {
+            assert(it->getWhen() <= now);
+            assert(it->getWhen() >= last);
+            last = it->getWhen();
+            ++fired;
+         }
+         assert(wheel.empty() || wheel.nextWhen() > now);
+      }
+      assert(fired == count);
+      assert(wheel.empty());
+      cerr << "wheel: " << count << " timers, add " << added - start 
+           << "ms, expire " << Timer::getTimeMs() - added << "ms" << endl;
+   }
 
+   {
+      std::priority_queue<BenchTimer, std::vector<BenchTimer>, std::greater<BenchTimer> > heap;
+      UInt64 start = Timer::getTimeMs();
+      for (int i = 0; i < count; ++i)
+      {
+         heap.push(BenchTimer(whens[i]));
+      }
+      UInt64 added = Timer::getTimeMs();
+      int fired = 0;
+      UInt64 last = 0;
+      for (UInt64 now = base; now < base + spanMs; ++now)
+      {
+         while (!heap.empty() && !(heap.top().getWhen() > now))
+         {
+            assert(heap.top().getWhen() >= last);
+            last = heap.top().getWhen();
+            heap.pop();
+            ++fired;
+         }
+      }
+      assert(fired == count);
+      cerr << "heap:  " << count << " timers, add " << added - start 
+           << "ms, expire " << Timer::getTimeMs() - added << "ms" << endl;
+   }
+}
+
+void
+testQueue()
+{
    TimeLimitFifo<Message> f(0, 0);
    Fifo<TimerMessage> r;
    
@@ -117,6 +199,20 @@ main()
    assert(r.size() == 5);
    timer.process();   
    assert(r.size() == 5);
+}
+
+int
+main()
+{
+   benchmark(200000, 64000);
+   benchmark(200000, 1000000);
+
+   cerr << "Heap storage" << endl;
+   testQueue();
+
+   cerr << "Wheel storage" << endl;
+   TimerQueueStorage::Default = TimerQueueStorage::Wheel;
+   testQueue();
 
    cerr << "All OK" << endl;
    return 0;
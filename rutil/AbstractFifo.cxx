@@ -3,6 +3,8 @@
 
 using namespace resip;
 
+FifoMode::Type FifoMode::SingleConsumerDefault = FifoMode::Locked;
+
 FifoStatsInterface::FifoStatsInterface() :
    mRole(0)
 {
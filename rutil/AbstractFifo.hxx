@@ -2,12 +2,16 @@
 #define RESIP_AbstractFifo_hxx 
 
 #include "rutil/ResipAssert.h"
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <thread>
 
 #include "rutil/Mutex.hxx"
 #include "rutil/Condition.hxx"
 #include "rutil/Lock.hxx"
 #include "rutil/CongestionManager.hxx"
+#include "rutil/MpscQueue.hxx"
 
 #include "rutil/compat.hxx"
 #include "rutil/Timer.hxx"
@@ -110,12 +114,42 @@ class FifoStatsInterface
 #define RESIP_FIFO_NOWAIT	-1
 #define RESIP_FIFO_FOREVER	0
 
+/**
+   @brief Selects how a fifo synchronizes its producers and consumers.
+
+   Locked fifos take the fifo's mutex for every operation, and may have any
+   number of producer and consumer threads. LockFree fifos let producers add
+   messages without taking any lock (see MpscQueue), and only wake the
+   consumer through the condition when it is actually waiting. The price is
+   that only one thread may take messages out of a LockFree fifo (getNext(),
+   getMultiple() and clear()); size(), empty() and messageAvailable() may
+   still be called from anywhere.
+*/
+class FifoMode
+{
+   public:
+      typedef enum
+      {
+         Locked,
+         LockFree
+      } Type;
+
+      /**
+         The mode used for fifos that only ever have one consumer by design,
+         such as the SipStack's transaction fifo and the transports' send
+         fifos. The mode is fixed when the fifo is constructed, so set this
+         before creating the SipStack.
+      */
+      static Type SingleConsumerDefault;
+};
+
 /**
    @brief The base class from which various templated Fifo classes are derived.
 
    (aka template hoist) 
    AbstractFifo's get operations are all threadsafe; AbstractFifo does not 
-   define any put operations (these are defined in subclasses).
+   define any put operations (these are defined in subclasses). In
+   FifoMode::LockFree mode only one thread may use the get operations.
    @note Users of the resip stack will not need to interact with this class 
       directly in most cases. Look at Fifo and TimeLimitFifo instead.
 
@@ -129,8 +163,10 @@ class AbstractFifo : public FifoStatsInterface
       * @brief Constructor
       * @param maxSize max number of messages to keep
       **/
-      AbstractFifo()
+      AbstractFifo(FifoMode::Type mode=FifoMode::Locked)
          : FifoStatsInterface(),
+            mQueue(mode == FifoMode::LockFree ? new MpscQueue<T> : 0),
+            mConsumerWaiting(false),
             mLastSampleTakenMicroSec(0),
             mCounter(0),
             mAverageServiceTimeMicroSec(0),
@@ -147,6 +183,10 @@ class AbstractFifo : public FifoStatsInterface
        **/
       bool empty() const
       {
+         if (mQueue.get())
+         {
+            return mSize == 0;
+         }
          Lock lock(mMutex); (void)lock;
          return mFifo.empty();
       }
@@ -160,6 +200,10 @@ class AbstractFifo : public FifoStatsInterface
        */
       virtual unsigned int size() const
       {
+         if (mQueue.get())
+         {
+            return mSize;
+         }
          Lock lock(mMutex); (void)lock;
          return (unsigned int)mFifo.size();
       }
@@ -171,6 +215,10 @@ class AbstractFifo : public FifoStatsInterface
        
       bool messageAvailable() const
       {
+         if (mQueue.get())
+         {
+            return mSize != 0;
+         }
          Lock lock(mMutex); (void)lock;
          return !mFifo.empty();
       }
@@ -215,6 +263,12 @@ class AbstractFifo : public FifoStatsInterface
        */
       T getNext()
       {
+         if (mQueue.get())
+         {
+            onFifoPolled();
+            return *popLockFree(RESIP_FIFO_FOREVER);
+         }
+
          Lock lock(mMutex); (void)lock;
          onFifoPolled();
 
@@ -250,6 +304,18 @@ class AbstractFifo : public FifoStatsInterface
             return true;
          }
 
+         if (mQueue.get())
+         {
+            onFifoPolled();
+            T* item = popLockFree(ms);
+            if (!item)
+            {
+               return false;
+            }
+            toReturn = *item;
+            return true;
+         }
+
          if(ms < 0)
          {
             Lock lock(mMutex); (void)lock;
@@ -301,6 +367,12 @@ class AbstractFifo : public FifoStatsInterface
 
       void getMultiple(Messages& other, unsigned int max)
       {
+         if (mQueue.get())
+         {
+            getMultipleLockFree(RESIP_FIFO_FOREVER, other, max);
+            return;
+         }
+
          Lock lock(mMutex); (void)lock;
          onFifoPolled();
          resip_assert(other.empty());
@@ -335,6 +407,11 @@ class AbstractFifo : public FifoStatsInterface
          }
 
          resip_assert(other.empty());
+         if (mQueue.get())
+         {
+            return getMultipleLockFree(ms, other, max);
+         }
+
          const UInt64 begin(Timer::getTimeMs());
          const UInt64 end(begin + (unsigned int)(ms)); // !kh! ms should've been unsigned :(
          Lock lock(mMutex); (void)lock;
@@ -383,6 +460,14 @@ class AbstractFifo : public FifoStatsInterface
 
       size_t add(const T& item)
       {
+         if (mQueue.get())
+         {
+            mQueue->push(item);
+            size_t size = ++mSize;
+            wakeConsumer();
+            return size;
+         }
+
          Lock lock(mMutex); (void)lock;
          mFifo.push_back(item);
          mCondition.signal();
@@ -392,6 +477,19 @@ class AbstractFifo : public FifoStatsInterface
 
       size_t addMultiple(Messages& items)
       {
+         if (mQueue.get())
+         {
+            UInt32 num = (UInt32)items.size();
+            for (typename Messages::const_iterator i = items.begin(); i != items.end(); ++i)
+            {
+               mQueue->push(*i);
+            }
+            items.clear();
+            size_t size = (mSize += num);
+            wakeConsumer();
+            return size;
+         }
+
          Lock lock(mMutex); (void)lock;
          size_t size=items.size();
          if(mFifo.empty())
@@ -413,27 +511,54 @@ class AbstractFifo : public FifoStatsInterface
          return mFifo.size();
       }
 
-      /** @brief container for FIFO items */
+      /** @brief is this a FifoMode::LockFree fifo? */
+      bool isLockFree() const
+      {
+         return mQueue.get() != 0;
+      }
+
+      /** @brief the number of messages; the caller must hold mMutex unless
+          the fifo is lock-free */
+      size_t sizeInternal() const
+      {
+         return mQueue.get() ? (size_t)mSize : mFifo.size();
+      }
+
+      /** @brief container for FIFO items (unused when lock-free) */
       Messages mFifo;
+      /** @brief container for FIFO items when lock-free */
+      std::unique_ptr<MpscQueue<T> > mQueue;
       /** @brief access serialization lock */
       mutable Mutex mMutex;
       /** @brief condition for waiting on new queue items */
       Condition mCondition;
+      /** @brief set while a lock-free fifo's consumer waits on mCondition */
+      std::atomic<bool> mConsumerWaiting;
 
       mutable UInt64 mLastSampleTakenMicroSec;
       mutable UInt32 mCounter;
       mutable UInt32 mAverageServiceTimeMicroSec;
       // std::deque has to perform some amount of traversal to calculate its 
       // size; we maintain this count so that it can be queried without locking, 
-      // in situations where it being off by a small amount is ok.
-      UInt32 mSize;
+      // in situations where it being off by a small amount is ok. For a
+      // lock-free fifo this is the exact count.
+      std::atomic<UInt32> mSize;
 
       virtual void onFifoPolled()
       {
+         if(mQueue.get() && !mLastSampleTakenMicroSec && mSize)
+         {
+            // Producers do not touch the sampling state of a lock-free
+            // fifo; start the sample here instead of in onMessagePushed().
+            mLastSampleTakenMicroSec=Timer::getTimeMicroSec();
+            return;
+         }
+
+         const bool drained = mQueue.get() ? mSize == 0 : mFifo.empty();
          // !bwc! TODO allow this sampling frequency to be tweaked
          if(mLastSampleTakenMicroSec &&
             mCounter &&
-            (mCounter >= 64 || mFifo.empty()))
+            (mCounter >= 64 || drained))
          {
             UInt64 now(Timer::getTimeMicroSec());
             UInt64 diff = now-mLastSampleTakenMicroSec;
@@ -451,7 +576,7 @@ class AbstractFifo : public FifoStatsInterface
                      4096U);
             }
             mCounter=0;
-            if(mFifo.empty())
+            if(drained)
             {
                mLastSampleTakenMicroSec=0;
             }
@@ -483,6 +608,91 @@ class AbstractFifo : public FifoStatsInterface
          mSize+=num;
       }
    private:
+      /**
+         Takes the next message out of a lock-free fifo, waiting for it as
+         getNext(int, T&) does. Returns 0 if there was none in time; the
+         message stays valid until the next pop.
+      */
+      T* popLockFree(int ms)
+      {
+         UInt64 end(0);
+         if (ms > 0)
+         {
+            end = Timer::getTimeMs() + (unsigned int)ms;
+         }
+
+         while (mSize == 0)
+         {
+            unsigned int timeout(0);
+            if (ms < 0)
+            {
+               return 0;
+            }
+            if (ms > 0)
+            {
+               const UInt64 now(Timer::getTimeMs());
+               if (now >= end)
+               {
+                  return 0;
+               }
+               timeout = (unsigned int)(end - now);
+            }
+
+            // Producers check mConsumerWaiting after counting their message,
+            // and we check the count after setting it, so one of us is bound
+            // to see the other.
+            Lock lock(mMutex); (void)lock;
+            mConsumerWaiting = true;
+            if (mSize == 0)
+            {
+               if (ms == 0)
+               {
+                  mCondition.wait(mMutex);
+               }
+               else
+               {
+                  mCondition.wait(mMutex, timeout);
+               }
+            }
+            mConsumerWaiting = false;
+         }
+
+         // The message has been counted, but an earlier producer may not
+         // have finished linking its own message in yet.
+         T* item;
+         while ((item = mQueue->pop()) == 0)
+         {
+            std::this_thread::yield();
+         }
+         onMessagePopped();
+         return item;
+      }
+
+      bool getMultipleLockFree(int ms, Messages& other, unsigned int max)
+      {
+         onFifoPolled();
+         T* item = popLockFree(ms);
+         if (!item)
+         {
+            return false;
+         }
+         other.push_back(*item);
+         while (other.size() < max && (item = popLockFree(RESIP_FIFO_NOWAIT)) != 0)
+         {
+            other.push_back(*item);
+         }
+         return true;
+      }
+
+      void wakeConsumer()
+      {
+         if (mConsumerWaiting)
+         {
+            Lock lock(mMutex); (void)lock;
+            mCondition.signal();
+         }
+      }
+
       // no value semantics
       AbstractFifo(const AbstractFifo&);
       AbstractFifo& operator=(const AbstractFifo&);
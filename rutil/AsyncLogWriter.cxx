@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <string.h>
+#include <thread>
+
+#include "rutil/AsyncLogWriter.hxx"
+#include "rutil/Lock.hxx"
+#include "rutil/Logger.hxx"
+
+using namespace resip;
+
+static inline size_t
+aligned(size_t size)
+{
+   return (size + 7) & ~size_t(7);
+}
+
+LogRing::LogRing(size_t capacity) :
+   mCapacity(4096),
+   mHead(0),
+   mDropped(0),
+   mOrphaned(false),
+   mTail(0),
+   mCollected(0)
+{
+   while (mCapacity < capacity)
+   {
+      mCapacity <<= 1;
+   }
+   mMask = mCapacity - 1;
+   mBuffer = new UInt64[mCapacity / sizeof(UInt64)];
+}
+
+LogRing::~LogRing()
+{
+   delete [] mBuffer;
+}
+
+bool
+LogRing::push(Log::Level level, const Subsystem& subsystem,
+              const char* file, int line, UInt64 time,
+              const char* message, size_t length)
+{
+   // a huge message (a big SIP message at Debug, say) is cut short rather
+   // than hogging the ring
+   if (sizeof(Record) + length > mCapacity / 4)
+   {
+      length = mCapacity / 4 - sizeof(Record);
+   }
+   const size_t size = aligned(sizeof(Record) + length);
+
+   size_t head = mHead.load(std::memory_order_relaxed);
+   const size_t tail = mTail.load(std::memory_order_acquire);
+   const size_t contiguous = mCapacity - (head & mMask);
+   const size_t skip = size > contiguous ? contiguous : 0;
+   if (head + skip + size - tail > mCapacity)
+   {
+      // only this thread writes mDropped
+      mDropped.store(mDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+   }
+   if (skip)
+   {
+      reinterpret_cast<Record*>(at(head))->mSize = 0;
+      head += skip;
+   }
+
+   Record* record = reinterpret_cast<Record*>(at(head));
+   record->mSize = (UInt32)size;
+   record->mLength = (UInt32)length;
+   record->mTime = time;
+   record->mSubsystem = &subsystem;
+   record->mFile = file;
+   record->mThreadId = ThreadIf::selfId();
+   record->mLine = line;
+   record->mLevel = level;
+   memcpy(record + 1, message, length);
+
+   mHead.store(head + size, std::memory_order_release);
+   return true;
+}
+
+bool
+LogRing::filling() const
+{
+   return mHead.load(std::memory_order_relaxed) - mTail.load(std::memory_order_relaxed) > mCapacity / 2;
+}
+
+void
+LogRing::collect(std::vector<const Record*>& records)
+{
+   const size_t head = mHead.load(std::memory_order_acquire);
+   while (mCollected != head)
+   {
+      const Record* record = reinterpret_cast<const Record*>(at(mCollected));
+      if (record->mSize == 0)
+      {
+         mCollected += mCapacity - (mCollected & mMask);
+         continue;
+      }
+      records.push_back(record);
+      mCollected += record->mSize;
+   }
+}
+
+void
+LogRing::release()
+{
+   mTail.store(mCollected, std::memory_order_release);
+}
+
+bool
+LogRing::empty() const
+{
+   return mTail.load(std::memory_order_relaxed) == mHead.load(std::memory_order_acquire);
+}
+
+std::atomic<size_t> AsyncLogWriter::mRingSize(0);
+ThreadIf::TlsKey* AsyncLogWriter::mRingKey = 0;
+Mutex AsyncLogWriter::mRingsMutex;
+std::vector<LogRing*> AsyncLogWriter::mRings;
+UInt64 AsyncLogWriter::mOrphanDropped = 0;
+bool AsyncLogWriter::mRunning = false;
+std::atomic<bool> AsyncLogWriter::mAccepting(false);
+std::atomic<unsigned int> AsyncLogWriter::mPushing(0);
+Mutex AsyncLogWriter::mWakeMutex;
+Condition AsyncLogWriter::mWake;
+
+AsyncLogWriter::AsyncLogWriter(size_t ringSize)
+{
+   mRingSize.store(ringSize);
+   Lock lock(mRingsMutex);
+   if (!mRingKey)
+   {
+      mRingKey = new ThreadIf::TlsKey;
+      ThreadIf::tlsKeyCreate(*mRingKey, orphanRing);
+   }
+   mRunning = true;
+   mAccepting.store(true);
+}
+
+AsyncLogWriter::~AsyncLogWriter()
+{
+   // a push that saw mAccepting set is counted in mPushing, so once that
+   // is back to 0 every queued line is in a ring for the last drain
+   mAccepting.store(false);
+   while (mPushing.load() != 0)
+   {
+      std::this_thread::yield();
+   }
+   shutdown();
+   join();
+
+   Lock lock(mRingsMutex);
+   mRunning = false;
+   deleteOrphans();
+}
+
+void
+AsyncLogWriter::thread()
+{
+   while (!isShutdown())
+   {
+      if (!drain())
+      {
+         Lock lock(mWakeMutex);
+         mWake.wait(mWakeMutex, 20);
+      }
+   }
+   while (drain())
+   {
+   }
+}
+
+LogRing*
+AsyncLogWriter::ring()
+{
+   LogRing* ring = static_cast<LogRing*>(ThreadIf::tlsGetValue(*mRingKey));
+   if (!ring)
+   {
+      ring = new LogRing(mRingSize.load());
+      ThreadIf::tlsSetValue(*mRingKey, ring);
+      Lock lock(mRingsMutex);
+      mRings.push_back(ring);
+   }
+   return ring;
+}
+
+bool
+AsyncLogWriter::push(Log::Level level, const Subsystem& subsystem,
+                     const char* file, int line,
+                     const char* message, size_t length)
+{
+   mPushing.fetch_add(1);
+   if (!mAccepting.load())
+   {
+      mPushing.fetch_sub(1);
+      writeNow(level, subsystem, file, line, message, length);
+      return true;
+   }
+   LogRing* ring = AsyncLogWriter::ring();
+   bool pushed = ring->push(level, subsystem, file, line, Log::wallClockMicroSec(), message, length);
+   mPushing.fetch_sub(1);
+   if (ring->filling())
+   {
+      mWake.signal();
+   }
+   return pushed;
+}
+
+void
+AsyncLogWriter::writeNow(Log::Level level, const Subsystem& subsystem,
+                         const char* file, int line,
+                         const char* message, size_t length)
+{
+   std::vector<UInt64> buffer(aligned(sizeof(LogRing::Record) + length) / sizeof(UInt64));
+   LogRing::Record* record = reinterpret_cast<LogRing::Record*>(&buffer[0]);
+   record->mSize = (UInt32)(buffer.size() * sizeof(UInt64));
+   record->mLength = (UInt32)length;
+   record->mTime = Log::wallClockMicroSec();
+   record->mSubsystem = &subsystem;
+   record->mFile = file;
+   record->mThreadId = ThreadIf::selfId();
+   record->mLine = line;
+   record->mLevel = level;
+   memcpy(record + 1, message, length);
+
+   LineWriter writer;
+   writer.write(*record);
+   Log::flushOutput();
+}
+
+void
+AsyncLogWriter::orphanRing(void* ring)
+{
+   LogRing* logRing = static_cast<LogRing*>(ring);
+   Lock lock(mRingsMutex);
+   logRing->orphan();
+   if (!mRunning)
+   {
+      deleteOrphans();
+   }
+}
+
+void
+AsyncLogWriter::deleteOrphans()
+{
+   for (std::vector<LogRing*>::iterator it = mRings.begin(); it != mRings.end(); )
+   {
+      if ((*it)->orphaned() && (*it)->empty())
+      {
+         mOrphanDropped += (*it)->dropped();
+         delete *it;
+         it = mRings.erase(it);
+      }
+      else
+      {
+         ++it;
+      }
+   }
+}
+
+UInt64
+AsyncLogWriter::dropped()
+{
+   Lock lock(mRingsMutex);
+   UInt64 dropped = mOrphanDropped;
+   for (std::vector<LogRing*>::const_iterator it = mRings.begin(); it != mRings.end(); ++it)
+   {
+      dropped += (*it)->dropped();
+   }
+   return dropped;
+}
+
+static bool
+earlier(const LogRing::Record* a, const LogRing::Record* b)
+{
+   return a->mTime < b->mTime;
+}
+
+bool
+AsyncLogWriter::drain()
+{
+   {
+      Lock lock(mRingsMutex);
+      deleteOrphans();
+      mDraining = mRings;
+   }
+
+   mBatch.clear();
+   for (std::vector<LogRing*>::const_iterator it = mDraining.begin(); it != mDraining.end(); ++it)
+   {
+      (*it)->collect(mBatch);
+   }
+   if (mBatch.empty())
+   {
+      return false;
+   }
+
+   // each ring is in order already; interleave the threads' lines
+   std::stable_sort(mBatch.begin(), mBatch.end(), earlier);
+   for (std::vector<const LogRing::Record*>::const_iterator it = mBatch.begin(); it != mBatch.end(); ++it)
+   {
+      mWriter.write(**it);
+   }
+   Log::flushOutput();
+
+   for (std::vector<LogRing*>::const_iterator it = mDraining.begin(); it != mDraining.end(); ++it)
+   {
+      (*it)->release();
+   }
+   return true;
+}
+
+AsyncLogWriter::LineWriter::LineWriter() :
+   mTimestamp(Data::Borrow, mTimestampBuffer, sizeof(mTimestampBuffer)),
+   mSecond(0)
+{
+}
+
+void
+AsyncLogWriter::LineWriter::write(const LogRing::Record& record)
+{
+#ifdef WIN32
+   const char* file = strrchr(record.mFile, '\\');
+   file = file ? file + 1 : record.mFile;
+#else
+   const char* file = record.mFile;
+#endif
+
+   // the date and time only change once a second
+   const UInt64 second = record.mTime / 1000000;
+   if (second != mSecond)
+   {
+      Log::timestamp(mTimestamp, second * 1000000);
+      mTimestamp.truncate2(mTimestamp.size() - 3);
+      mSecond = second;
+   }
+   const unsigned int ms = (unsigned int)(record.mTime % 1000000) / 1000;
+   char* digits = const_cast<char*>(mTimestamp.data()) + mTimestamp.size();
+   digits[0] = char('0' + ms / 100);
+   digits[1] = char('0' + ms / 10 % 10);
+   digits[2] = char('0' + ms % 10);
+   const Data ts(Data::Share, mTimestamp.data(), mTimestamp.size() + 3);
+
+   mLine.clear();
+   Log::unstructuredTags(record.mLevel, *record.mSubsystem, file, record.mLine,
+                         ts, record.mThreadId, mLine);
+   mLine += Log::delim;
+   const Data::size_type headerLength = mLine.size();
+   mLine.append(record.message(), record.mLength);
+
+   ExternalLogger* external = Log::getExternal();
+   if (external)
+   {
+      const Data rest(Data::Share, mLine.data() + headerLength, mLine.size() - headerLength);
+      if (!(*external)(record.mLevel, *record.mSubsystem, Log::mAppName,
+                       record.mFile, record.mLine, rest, mLine, Log::mInstanceName))
+      {
+         return;
+      }
+   }
+   Log::output(record.mLevel, mLine, false);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
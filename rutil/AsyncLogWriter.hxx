@@ -0,0 +1,224 @@
+#if !defined(RESIP_ASYNCLOGWRITER_HXX)
+#define RESIP_ASYNCLOGWRITER_HXX
+
+#include <atomic>
+#include <vector>
+
+#include "rutil/Condition.hxx"
+#include "rutil/Data.hxx"
+#include "rutil/Log.hxx"
+#include "rutil/Mutex.hxx"
+#include "rutil/ThreadIf.hxx"
+
+namespace resip
+{
+
+class Subsystem;
+
+/**
+   @brief Ring of log records for one producer thread and one consumer
+   thread, without locks.
+
+   Each record is a fixed header followed by the message text, padded to
+   8 bytes, and is never split across the end of the ring: a record that
+   does not fit before the end is preceded by a marker that sends the
+   reader back to the start. push() never waits; when the ring is full the
+   record is counted as dropped.
+*/
+class LogRing
+{
+   public:
+      struct Record
+      {
+         UInt32 mSize;               // bytes taken in the ring; 0 marks the skip to the start
+         UInt32 mLength;             // of the message following the record
+         UInt64 mTime;               // microseconds since the epoch
+         const Subsystem* mSubsystem;
+         const char* mFile;
+         ThreadIf::Id mThreadId;
+         int mLine;
+         Log::Level mLevel;
+
+         const char* message() const { return reinterpret_cast<const char*>(this + 1); }
+      };
+
+      /// capacity is rounded up to a power of two
+      explicit LogRing(size_t capacity);
+      ~LogRing();
+
+      // Producer side.
+      bool push(Log::Level level, const Subsystem& subsystem,
+                const char* file, int line, UInt64 time,
+                const char* message, size_t length);
+      /// true once more than half of the ring is in use
+      bool filling() const;
+
+      // Consumer side.  collect() appends the records queued so far; they
+      // stay valid, and their space taken, until release().
+      void collect(std::vector<const Record*>& records);
+      void release();
+      bool empty() const;
+
+      size_t capacity() const { return mCapacity; }
+      UInt64 dropped() const { return mDropped.load(std::memory_order_relaxed); }
+
+      /// set when the producer thread has exited
+      void orphan() { mOrphaned.store(true, std::memory_order_release); }
+      bool orphaned() const { return mOrphaned.load(std::memory_order_acquire); }
+
+   private:
+      size_t mCapacity;
+      size_t mMask;
+      UInt64* mBuffer;              // UInt64 keeps the records aligned
+
+      // written by the producer, read by the consumer
+      std::atomic<size_t> mHead;
+      std::atomic<UInt64> mDropped;
+      std::atomic<bool> mOrphaned;
+      // written by the consumer, read by the producer
+      std::atomic<size_t> mTail;
+      size_t mCollected;            // consumer only: mTail after release()
+
+      char* at(size_t position) const { return reinterpret_cast<char*>(mBuffer) + (position & mMask); }
+
+      // no value semantics
+      LogRing(const LogRing&);
+      LogRing& operator=(const LogRing&);
+};
+
+/**
+   @brief The writer thread behind Log::startAsyncWriter().
+
+   Logging threads format only the message text and push() it, with the
+   time, level, subsystem, file and line, into a LogRing of their own. The
+   writer thread takes the records from all the rings in batches, in time
+   order, adds the usual log line headers, hands each line to the external
+   logger (if any) and writes it to the default logger's output, flushing
+   once per batch.
+
+   Deleting the writer stops it taking new lines and waits for the lines
+   being pushed, then writes out everything queued.  A line logged after
+   that (by a Guard made while the writer was running) is written at once
+   by the logging thread.
+*/
+class AsyncLogWriter : public ThreadIf
+{
+   public:
+      explicit AsyncLogWriter(size_t ringSize);
+      virtual ~AsyncLogWriter();
+
+      virtual void thread();
+
+      /// Queues a log line from the calling thread, or writes it at once if
+      /// the writer has stopped; false if it was dropped.
+      static bool push(Log::Level level, const Subsystem& subsystem,
+                       const char* file, int line,
+                       const char* message, size_t length);
+      /// lines dropped because a ring was full
+      static UInt64 dropped();
+
+   private:
+      /// Adds the headers to records and writes them out.
+      class LineWriter
+      {
+         public:
+            LineWriter();
+            void write(const LogRing::Record& record);
+
+         private:
+            Data mLine;
+            // the timestamp of mSecond, up to the milliseconds
+            char mTimestampBuffer[256];
+            Data mTimestamp;
+            UInt64 mSecond;
+
+            // no value semantics
+            LineWriter(const LineWriter&);
+            LineWriter& operator=(const LineWriter&);
+      };
+
+      /// writes all the queued records; false if there were none
+      bool drain();
+      static LogRing* ring();
+      static void writeNow(Log::Level level, const Subsystem& subsystem,
+                           const char* file, int line,
+                           const char* message, size_t length);
+      static void orphanRing(void* ring);
+      /// deletes the empty orphaned rings; mRingsMutex must be held
+      static void deleteOrphans();
+
+      std::vector<const LogRing::Record*> mBatch;
+      std::vector<LogRing*> mDraining;
+      LineWriter mWriter;
+
+      static std::atomic<size_t> mRingSize;
+      static ThreadIf::TlsKey* mRingKey;
+      // the rings of all the threads that have logged; an orphaned ring is
+      // deleted by the writer once it is empty, or by its thread when no
+      // writer is running
+      static Mutex mRingsMutex;
+      static std::vector<LogRing*> mRings;
+      static UInt64 mOrphanDropped;
+      static bool mRunning;
+      // cleared, once the pushes counted in mPushing are done, before the
+      // writer's last drain
+      static std::atomic<bool> mAccepting;
+      static std::atomic<unsigned int> mPushing;
+      // wakes the writer early when a ring is filling up
+      static Mutex mWakeMutex;
+      static Condition mWake;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
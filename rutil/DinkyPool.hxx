@@ -11,17 +11,30 @@ namespace resip
 {
 /**
    A dirt-simple lightweight pool allocator meant for use in short-lifetime 
-   objects. This will pool-allocate at most S bytes, after which no further pool
-   allocation will be performed, and fallback to the system new/delete will be 
-   used (deallocating a pool allocated object will _not_ free up room in the 
-   pool; the memory will be freed when the DinkyPool goes away).
+   objects. The first S bytes are pool-allocated from a buffer inside the 
+   DinkyPool itself. After that, allocations of up to C/4 bytes are carved out
+   of C byte chunks taken from the heap, and only larger ones fall back to the
+   system new/delete. Deallocating a pool allocated object will _not_ free up 
+   room in the buffer, or in a chunk that still holds other objects. A chunk
+   goes back to the heap once everything in it has been deallocated, so an
+   owner that keeps replacing the same objects (a message modified over and
+   over, say) does not keep growing; everything else is freed in one go when
+   the DinkyPool goes away.
 */
-template<unsigned int S>
+template<unsigned int S, unsigned int C=4096>
 class DinkyPool : public PoolBase
 {
    public:
-      DinkyPool() : count(0), heapBytes(0) {}
-      ~DinkyPool(){}
+      DinkyPool() : count(0), heapBytes(0), mChunks(0), mChunkCount(0), chunkBytes(0) {}
+      ~DinkyPool()
+      {
+         while(mChunks)
+         {
+            Chunk* next=mChunks->mNext;
+            delete mChunks;
+            mChunks=next;
+         }
+      }
 
       void* allocate(size_t size)
       {
@@ -31,6 +44,23 @@ class DinkyPool : public PoolBase
             count+=(size+7)/8;
             return result;
          }
+         if(size <= C/4)
+         {
+            size_t units=(size+7)/8;
+            if(!mChunks || mChunkCount+units > ChunkUnits)
+            {
+               Chunk* chunk=new Chunk;
+               chunk->mNext=mChunks;
+               chunk->mLive=0;
+               mChunks=chunk;
+               mChunkCount=0;
+               chunkBytes+=sizeof(chunk->mBuf);
+            }
+            void* result=mChunks->mBuf[mChunkCount];
+            mChunkCount+=units;
+            ++mChunks->mLive;
+            return result;
+         }
          heapBytes += size;
          return ::operator new(size);
       }
@@ -41,6 +71,27 @@ class DinkyPool : public PoolBase
          {
             return;
          }
+         for(Chunk** link=&mChunks; *link; link=&(*link)->mNext)
+         {
+            Chunk* chunk=*link;
+            if(ptr >= (const void*)chunk->mBuf[0] && ptr < (const void*)chunk->mBuf[ChunkUnits])
+            {
+               if(--chunk->mLive == 0)
+               {
+                  if(chunk == mChunks)
+                  {
+                     mChunkCount=0; // start the current chunk over
+                  }
+                  else
+                  {
+                     *link=chunk->mNext;
+                     chunkBytes-=sizeof(chunk->mBuf);
+                     delete chunk;
+                  }
+               }
+               return;
+            }
+         }
          ::operator delete(ptr);
       }
 
@@ -50,6 +101,7 @@ class DinkyPool : public PoolBase
       }
 
       size_t getHeapBytes() const { return heapBytes; }
+      size_t getChunkBytes() const { return chunkBytes; }
       size_t getPoolBytes() const { return count*8; }
       size_t getPoolSizeBytes() const { return sizeof(mBuf); }
 
@@ -58,9 +110,21 @@ class DinkyPool : public PoolBase
       DinkyPool& operator=(const DinkyPool& rhs);
       DinkyPool(const DinkyPool& other);
 
+      enum { ChunkUnits = (C+7)/8 };
+      struct Chunk
+      {
+         char mBuf[ChunkUnits][8]; // first, so that it is aligned as new aligns
+         Chunk* mNext;
+         size_t mLive; // allocations not yet deallocated
+      };
+
       size_t count; // 8-byte chunks alloced so far
       char mBuf[(S+7)/8][8]; // 8-byte chunks for alignment
       size_t heapBytes;
+      Chunk* mChunks; // most recent first; only the first has room left, and
+                      // only it can be empty
+      size_t mChunkCount; // 8-byte units alloced from the first chunk
+      size_t chunkBytes; // in chunks currently held
 };
 
 }
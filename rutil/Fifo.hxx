@@ -10,12 +10,14 @@ namespace resip
 
 /**
    @brief A templated, threadsafe message-queue class.
+   @see FifoMode for the restrictions on lock-free fifos.
 */
 template < class Msg >
 class Fifo : public AbstractFifo<Msg*>
 {
    public:
-      Fifo(AsyncProcessHandler* interruptor=0);
+      Fifo(AsyncProcessHandler* interruptor=0,
+           FifoMode::Type mode=FifoMode::Locked);
       virtual ~Fifo();
       
       using AbstractFifo<Msg*>::mFifo;
@@ -63,8 +65,8 @@ class Fifo : public AbstractFifo<Msg*>
 
 
 template <class Msg>
-Fifo<Msg>::Fifo(AsyncProcessHandler* interruptor) : 
-   AbstractFifo<Msg*>(),
+Fifo<Msg>::Fifo(AsyncProcessHandler* interruptor, FifoMode::Type mode) : 
+   AbstractFifo<Msg*>(mode),
    mInterruptor(interruptor)
 {
 }
@@ -88,6 +90,16 @@ template <class Msg>
 void
 Fifo<Msg>::clear()
 {
+   if (this->isLockFree())
+   {
+      Msg* msg(0);
+      while (AbstractFifo<Msg*>::getNext(RESIP_FIFO_NOWAIT, msg))
+      {
+         delete msg;
+      }
+      return;
+   }
+
    Lock lock(mMutex); (void)lock;
    while ( ! mFifo.empty() )
    {
@@ -1,6 +1,7 @@
 #include "rutil/Socket.hxx"
 
 #include "rutil/ResipAssert.h"
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
@@ -15,6 +16,7 @@
 #include <sys/types.h>
 #include <time.h>
 
+#include "rutil/AsyncLogWriter.hxx"
 #include "rutil/Log.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/ParseBuffer.hxx"
@@ -79,6 +81,9 @@ Log::mSyslogPriority[] = { 0, LOG_CRIT, LOG_CRIT, LOG_CRIT, LOG_ERR, LOG_WARNING
 
 Mutex Log::_mutex;
 
+static Mutex asyncWriterMutex;
+static std::atomic<AsyncLogWriter*> asyncWriter(0);
+
 extern "C"
 {
    void freeThreadSetting(void* setting)
@@ -606,34 +611,75 @@ Log::tags(Log::Level level,
       break;
    case Unstructured:
    default:
-      if(resip::Log::getLoggerData().type() == Syslog)
-      {
-         strm // << mDescriptions[level+1] << Log::delim
-      //        << timestamp(ts) << Log::delim
-      //        << mHostname << Log::delim
-      //        << mAppName << Log::delim
-              << subsystem << Log::delim
-              << threadId << Log::delim
-              << file << ":" << line;
-      }
-      else
+      if(resip::Log::getLoggerData().type() != Syslog)
       {
-         strm << mDescriptions[level+1] << Log::delim
-              << timestamp(ts) << Log::delim
-              << mAppName;
-         if(!mInstanceName.empty())
-         {
-            strm << '[' << mInstanceName << ']';
-         }
-         strm << Log::delim
-              << subsystem << Log::delim
-              << threadId << Log::delim
-              << file << ":" << line;
+         timestamp(ts);
       }
+      char headerBuffer[256];
+      Data header(Data::Borrow, headerBuffer, sizeof(headerBuffer));
+      strm << unstructuredTags(level, subsystem, file, line, ts, threadId, header.clear());
    }
    return strm;
 }
 
+// ThreadIf::Id is a number on some platforms and a pointer on others
+template <class T>
+static void
+appendThreadId(Data& result, T* threadId)
+{
+   oDataStream strm(result);
+   strm << static_cast<const void*>(threadId);
+}
+
+template <class T>
+static void
+appendThreadId(Data& result, T threadId)
+{
+   result += Data(UInt64(threadId));
+}
+
+Data&
+Log::unstructuredTags(Log::Level level,
+                      const Subsystem& subsystem,
+                      const char* file,
+                      int line,
+                      const Data& ts,
+                      ThreadIf::Id threadId,
+                      Data& result)
+{
+   if(resip::Log::getLoggerData().type() == Syslog)
+   {
+      // result += mDescriptions[level+1]; result += Log::delim;
+      // result += ts; result += Log::delim;
+      // result += mHostname; result += Log::delim;
+      // result += mAppName; result += Log::delim;
+      result += subsystem.getSubsystem();
+   }
+   else
+   {
+      result += mDescriptions[level+1];
+      result += Log::delim;
+      result += ts;
+      result += Log::delim;
+      result += mAppName;
+      if(!mInstanceName.empty())
+      {
+         result += '[';
+         result += mInstanceName;
+         result += ']';
+      }
+      result += Log::delim;
+      result += subsystem.getSubsystem();
+   }
+   result += Log::delim;
+   appendThreadId(result, threadId);
+   result += Log::delim;
+   result += file;
+   result += ':';
+   result += Data(Int32(line));
+   return result;
+}
+
 Data
 Log::timestamp()
 {
@@ -642,27 +688,39 @@ Log::timestamp()
    return timestamp(result);
 }
 
-Data&
-Log::timestamp(Data& res) 
+UInt64
+Log::wallClockMicroSec()
 {
-   char* datebuf = const_cast<char*>(res.data());
-   const unsigned int datebufSize = 256;
-   res.clear();
-   
 #ifdef WIN32 
-   int result = 1; 
    SYSTEMTIME systemTime;
-   struct { time_t tv_sec; int tv_usec; } tv = {0,0};
-   time(&tv.tv_sec);
+   time_t seconds;
+   time(&seconds);
    GetLocalTime(&systemTime);
-   tv.tv_usec = systemTime.wMilliseconds * 1000; 
+   return UInt64(seconds) * 1000000 + systemTime.wMilliseconds * 1000;
 #else 
-   struct tm localTimeResult;
    struct timeval tv; 
-   int result = gettimeofday (&tv, NULL);
+   if (gettimeofday(&tv, NULL) == -1)
+   {
+      return 0;
+   }
+   return UInt64(tv.tv_sec) * 1000000 + tv.tv_usec;
 #endif   
+}
 
-   if (result == -1)
+Data&
+Log::timestamp(Data& res) 
+{
+   return timestamp(res, wallClockMicroSec());
+}
+
+Data&
+Log::timestamp(Data& res, UInt64 microSeconds) 
+{
+   char* datebuf = const_cast<char*>(res.data());
+   const unsigned int datebufSize = 256;
+   res.clear();
+   
+   if (microSeconds == 0)
    {
       /* If we can't get the time of day, don't print a timestamp.
          Under Unix, this will never happen:  gettimeofday can fail only
@@ -674,7 +732,10 @@ Log::timestamp(Data& res)
    {
       /* The tv_sec field represents the number of seconds passed since
          the Epoch, which is exactly the argument gettimeofday needs. */
-      const time_t timeInSeconds = (time_t) tv.tv_sec;
+      const time_t timeInSeconds = (time_t) (microSeconds / 1000000);
+#ifndef WIN32
+      struct tm localTimeResult;
+#endif
       strftime (datebuf,
                 datebufSize,
                 "%Y%m%d-%H%M%S", /* guaranteed to fit in 256 chars,
@@ -689,7 +750,7 @@ Log::timestamp(Data& res)
    char msbuf[5];
    /* Dividing (without remainder) by 1000 rounds the microseconds
       measure to the nearest millisecond. */
-   result = snprintf(msbuf, 5, ".%3.3ld", long(tv.tv_usec / 1000));
+   int result = snprintf(msbuf, 5, ".%3.3ld", long((microSeconds % 1000000) / 1000));
    if(result < 0)
    {
       // snprint can error (negative return code) and the compiler now generates a warning
@@ -877,6 +938,50 @@ Log::droppingPrivileges(uid_t uid, pid_t pid)
 }
 #endif
 
+bool
+Log::isAsync()
+{
+   if (!asyncWriter.load(std::memory_order_acquire) ||
+       ThreadIf::tlsGetValue(*Log::mLocalLoggerKey) != 0 ||
+       mDefaultLoggerData.messageStructure() != Unstructured)
+   {
+      return false;
+   }
+   Type type = mDefaultLoggerData.type();
+   return type == Cout || type == Cerr || type == File || type == Syslog;
+}
+
+void
+Log::startAsyncWriter(unsigned int ringSize)
+{
+   Lock lock(asyncWriterMutex);
+   if (!asyncWriter.load())
+   {
+      AsyncLogWriter* writer = new AsyncLogWriter(ringSize);
+      writer->run();
+      asyncWriter.store(writer, std::memory_order_release);
+   }
+}
+
+void
+Log::stopAsyncWriter()
+{
+   Lock lock(asyncWriterMutex);
+   AsyncLogWriter* writer = asyncWriter.exchange(0);
+   if (writer)
+   {
+      // stops taking lines, waits for those being queued, then writes
+      // everything still queued before the thread exits
+      delete writer;
+   }
+}
+
+UInt64
+Log::getAsyncDroppedCount()
+{
+   return AsyncLogWriter::dropped();
+}
+
 bool
 Log::isLogging(Log::Level level, const resip::Subsystem& sub)
 {
@@ -994,11 +1099,17 @@ Log::Guard::Guard(resip::Log::Level level,
    mSubsystem(subsystem),
    mFile(file),
    mLine(line),
+   mAsync(isAsync()),
    mData(Data::Borrow, mBuffer, sizeof(mBuffer)),
    mStream(mData.clear())
 {
 	
-   if (resip::Log::getLoggerData().mType != resip::Log::OnlyExternalNoHeaders)
+   if (mAsync)
+   {
+      // the writer thread adds the headers
+      mHeaderLength = 0;
+   }
+   else if (resip::Log::getLoggerData().mType != resip::Log::OnlyExternalNoHeaders)
    {
       MessageStructure messageStructure = resip::Log::getLoggerData().mMessageStructure;
       if(messageStructure == Unstructured)
@@ -1018,6 +1129,13 @@ Log::Guard::Guard(resip::Log::Level level,
 
 Log::Guard::~Guard()
 {
+   if (mAsync)
+   {
+      mStream.flush();
+      AsyncLogWriter::push(mLevel, mSubsystem, mFile, mLine, mData.data(), mData.size());
+      return;
+   }
+
    MessageStructure messageStructure = resip::Log::getLoggerData().mMessageStructure;
    if(messageStructure == JSON_CEE)
    {
@@ -1087,25 +1205,47 @@ Log::Guard::~Guard()
       return;
    }
 
+   output(mLevel, mData, true);
+}
+
+void
+Log::output(Log::Level level, Data& line, bool flush)
+{
+   Type logType = getLoggerData().type();
+
    resip::Lock lock(resip::Log::_mutex);
    // !dlb! implement VSDebugWindow as an external logger
    if (logType == resip::Log::VSDebugWindow)
    {
-      mData += "\r\n";
-      OutputToWin32DebugWindow(mData);
+      line += "\r\n";
+      OutputToWin32DebugWindow(line);
    }
    else 
    {
       // endl is magic in syslog -- so put it here
-      std::ostream& _instance = Instance((int)mData.size()+2);
+      std::ostream& _instance = Instance((int)line.size()+2);
       if (logType == resip::Log::Syslog)
       {
-         _instance << mLevel;
+         _instance << level << line << std::endl;
+      }
+      else if (flush)
+      {
+         _instance << line << std::endl;  
+      }
+      else
+      {
+         _instance << line << '\n';
       }
-      _instance << mData << std::endl;  
    }
 }
 
+void
+Log::flushOutput()
+{
+   resip::Lock lock(resip::Log::_mutex);
+   getLoggerData().flush();
+}
+
 std::ostream&
 Log::ThreadData::Instance(unsigned int bytesToWrite)
 {
@@ -1172,6 +1312,25 @@ Log::ThreadData::reset()
    mLogger = NULL;
 }
 
+void
+Log::ThreadData::flush()
+{
+   switch (mType)
+   {
+      case Log::Cout:
+         std::cout.flush();
+         break;
+      case Log::File:
+         if (mLogger)
+         {
+            mLogger->flush();
+         }
+         break;
+      default:
+         break;
+   }
+}
+
 #ifndef WIN32
 void
 Log::ThreadData::droppingPrivileges(uid_t uid, pid_t pid)
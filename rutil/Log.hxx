@@ -127,6 +127,7 @@ class Log
             resip::Data::size_type mHeaderLength;
             const char* mFile;
             int mLine;
+            bool mAsync;
             char mBuffer[128];
             Data mData;
             oDataStream mStream;
@@ -274,6 +275,25 @@ class Log
       static int setThreadLocalLogger(LocalLoggerId loggerId);
 
 
+      /** @brief Hands the default logger's lines to a writer thread.
+          
+          Logging threads then only format the message text and queue it in
+          a ring of their own (ringSize bytes); the writer thread adds the
+          headers and writes the lines in batches.  When a ring is full the
+          line is dropped and counted, rather than making the logging thread
+          wait.  The external logger, if any, is called from the writer
+          thread.  Lines from threads with a local logger, and lines in the
+          JSON_CEE structure, are still written directly.
+          
+          Call stopAsyncWriter() before exiting, or the lines still queued
+          are lost.
+      */
+      static void startAsyncWriter(unsigned int ringSize = 256*1024);
+      /** Writes out the queued lines and goes back to writing directly. */
+      static void stopAsyncWriter();
+      /** The number of lines dropped because a ring was full. */
+      static UInt64 getAsyncDroppedCount();
+
       static std::ostream& Instance(unsigned int bytesToWrite);
       static bool isLogging(Log::Level level, const Subsystem&);
       static void OutputToWin32DebugWindow(const Data& result);      
@@ -283,6 +303,25 @@ class Log
 #endif
 
    protected:
+      /// appends the Unstructured header, up to the file and line
+      static Data& unstructuredTags(Log::Level level,
+                                    const Subsystem& subsystem,
+                                    const char* file,
+                                    int line,
+                                    const Data& timestamp,
+                                    ThreadIf::Id threadId,
+                                    Data& result);
+      /// the time, in microseconds since the epoch, that timestamp() shows
+      static UInt64 wallClockMicroSec();
+      static Data& timestamp(Data& result, UInt64 microSeconds);
+      /// true if a log line from this thread goes through the writer thread
+      static bool isAsync();
+      /// writes a line to the current logger's output
+      static void output(Log::Level level, Data& line, bool flush);
+      static void flushOutput();
+
+      friend class AsyncLogWriter;
+
       static Mutex _mutex;
       static volatile short touchCount;
       static const Data delim;
@@ -342,11 +381,13 @@ class Log
             unsigned int maxByteCount() { return mMaxByteCount ? mMaxByteCount : MaxByteCount; }  // return local max, if not set use global max
             bool keepAllLogFiles() { return mKeepAllLogFilesSet ? mKeepAllLogFiles : KeepAllLogFiles; } // return local if set, if not use global setting
             Type type() const {return mType;}
+            MessageStructure messageStructure() const {return mMessageStructure;}
 
             void setKeepAllLogFiles(bool keepAllLogFiles) { mKeepAllLogFiles = keepAllLogFiles; mKeepAllLogFilesSet = true; }
 
             std::ostream& Instance(unsigned int bytesToWrite); ///< Return logger stream instance, creating it if needed.
             void reset(); ///< Frees logger stream
+            void flush(); ///< Flushes logger stream, if it is buffered
 #ifndef WIN32
             void droppingPrivileges(uid_t uid, pid_t pid);
 #endif
@@ -0,0 +1,163 @@
+#if !defined(RESIP_MPSCQUEUE_HXX)
+#define RESIP_MPSCQUEUE_HXX
+
+#include <atomic>
+#include "rutil/compat.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Unbounded lock-free queue for many producer threads and a single
+   consumer thread.
+
+   This is the node based queue described by Dmitry Vyukov. A producer
+   swaps its node in as the new tail with a single atomic exchange and then
+   links the previous tail to it, so producers never wait on each other or
+   on the consumer. The consumer follows the links from the head without
+   any atomic read-modify-write operations.
+
+   Between those two steps of a push the queue is briefly cut in two: the
+   nodes behind the new tail are not reachable from the head until the
+   producer has linked them. pop() reports such a queue as empty, so
+   callers that know an item is there (because they keep a count) must
+   retry.
+
+   push() may be called from any thread; pop() and empty() only from the
+   single consumer thread.
+*/
+template <class T>
+class MpscQueue
+{
+   public:
+      MpscQueue() : mHead(&mStub), mTail(&mStub)
+      {
+         mStub.mNext.store(0, std::memory_order_relaxed);
+      }
+
+      ~MpscQueue()
+      {
+         while (pop())
+         {
+         }
+         release(mHead);
+      }
+
+      void push(const T& item)
+      {
+         Node* node = new Node(item);
+         Link* prev = mTail.exchange(node, std::memory_order_acq_rel);
+         prev->mNext.store(node, std::memory_order_release);
+      }
+
+      /**
+         @brief removes the item at the head of the queue.
+         @return the item, which stays valid until the next call to pop(), or
+            0 if the queue is empty (or a push is still being linked in).
+      */
+      T* pop()
+      {
+         Link* next = mHead->mNext.load(std::memory_order_acquire);
+         if (!next)
+         {
+            return 0;
+         }
+         release(mHead);
+         mHead = next;
+         return &static_cast<Node*>(next)->mItem;
+      }
+
+      bool empty() const
+      {
+         return mHead->mNext.load(std::memory_order_acquire) == 0;
+      }
+
+   private:
+      struct Link
+      {
+         std::atomic<Link*> mNext;
+      };
+
+      struct Node : public Link
+      {
+         explicit Node(const T& item) : mItem(item)
+         {
+            this->mNext.store(0, std::memory_order_relaxed);
+         }
+         T mItem;
+      };
+
+      // The head is the node whose item was popped last (or the stub).
+      void release(Link* link)
+      {
+         if (link != &mStub)
+         {
+            delete static_cast<Node*>(link);
+         }
+      }
+
+      Link mStub;
+      // Consumer side.
+      Link* mHead;
+      // Keep the producers' cache line away from the consumer's.
+      char mPad[64];
+      std::atomic<Link*> mTail;
+
+      // no value semantics
+      MpscQueue(const MpscQueue&);
+      MpscQueue& operator=(const MpscQueue&);
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,231 @@
+#include <string.h>
+
+#include "rutil/Sha256.hxx"
+
+using namespace resip;
+
+// FIPS 180-4 section 4.2.2
+static const uint32_t K[64] =
+{
+   0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+   0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+   0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+   0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+   0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+   0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+   0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+   0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t
+rotr(uint32_t x, unsigned int n)
+{
+   return (x >> n) | (x << (32 - n));
+}
+
+SHA256::SHA256()
+{
+   reset();
+}
+
+void
+SHA256::reset()
+{
+   mState[0] = 0x6a09e667;
+   mState[1] = 0xbb67ae85;
+   mState[2] = 0x3c6ef372;
+   mState[3] = 0xa54ff53a;
+   mState[4] = 0x510e527f;
+   mState[5] = 0x9b05688c;
+   mState[6] = 0x1f83d9ab;
+   mState[7] = 0x5be0cd19;
+   mLength = 0;
+   mBuffered = 0;
+}
+
+void
+SHA256::transform(const unsigned char block[BlockSize])
+{
+   uint32_t w[64];
+   for (int i = 0; i < 16; ++i)
+   {
+      w[i] = ((uint32_t)block[i*4] << 24) | ((uint32_t)block[i*4+1] << 16) |
+             ((uint32_t)block[i*4+2] << 8) | (uint32_t)block[i*4+3];
+   }
+   for (int i = 16; i < 64; ++i)
+   {
+      uint32_t s0 = rotr(w[i-15], 7) ^ rotr(w[i-15], 18) ^ (w[i-15] >> 3);
+      uint32_t s1 = rotr(w[i-2], 17) ^ rotr(w[i-2], 19) ^ (w[i-2] >> 10);
+      w[i] = w[i-16] + s0 + w[i-7] + s1;
+   }
+
+   uint32_t a = mState[0], b = mState[1], c = mState[2], d = mState[3];
+   uint32_t e = mState[4], f = mState[5], g = mState[6], h = mState[7];
+   for (int i = 0; i < 64; ++i)
+   {
+      uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      h = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+   }
+   mState[0] += a; mState[1] += b; mState[2] += c; mState[3] += d;
+   mState[4] += e; mState[5] += f; mState[6] += g; mState[7] += h;
+}
+
+void
+SHA256::update(const void* data, size_t len)
+{
+   const unsigned char* in = (const unsigned char*)data;
+   mLength += len;
+   if (mBuffered)
+   {
+      size_t n = BlockSize - mBuffered;
+      if (n > len)
+      {
+         n = len;
+      }
+      memcpy(mBuffer + mBuffered, in, n);
+      mBuffered += n;
+      in += n;
+      len -= n;
+      if (mBuffered < BlockSize)
+      {
+         return;
+      }
+      transform(mBuffer);
+      mBuffered = 0;
+   }
+   while (len >= BlockSize)
+   {
+      transform(in);
+      in += BlockSize;
+      len -= BlockSize;
+   }
+   memcpy(mBuffer, in, len);
+   mBuffered = len;
+}
+
+void
+SHA256::final(unsigned char digest[DigestSize])
+{
+   uint64_t bits = mLength * 8;
+   unsigned char pad[BlockSize + 8];
+   size_t padLen = (mBuffered < 56 ? 56 : 120) - mBuffered;
+   memset(pad, 0, padLen);
+   pad[0] = 0x80;
+   for (int i = 0; i < 8; ++i)
+   {
+      pad[padLen + i] = (unsigned char)(bits >> (56 - i*8));
+   }
+   update(pad, padLen + 8);
+
+   for (int i = 0; i < 8; ++i)
+   {
+      digest[i*4] = (unsigned char)(mState[i] >> 24);
+      digest[i*4+1] = (unsigned char)(mState[i] >> 16);
+      digest[i*4+2] = (unsigned char)(mState[i] >> 8);
+      digest[i*4+3] = (unsigned char)mState[i];
+   }
+   reset();
+}
+
+HmacSHA256::HmacSHA256(const Data& key)
+{
+   unsigned char block[SHA256::BlockSize];
+   memset(block, 0, sizeof(block));
+   if (key.size() > SHA256::BlockSize)
+   {
+      SHA256 hash;
+      hash.update(key);
+      hash.final(block);
+   }
+   else
+   {
+      memcpy(block, key.data(), key.size());
+   }
+
+   unsigned char pad[SHA256::BlockSize];
+   for (size_t i = 0; i < SHA256::BlockSize; ++i)
+   {
+      pad[i] = block[i] ^ 0x36;
+   }
+   mInner.update(pad, sizeof(pad));
+   for (size_t i = 0; i < SHA256::BlockSize; ++i)
+   {
+      pad[i] = block[i] ^ 0x5c;
+   }
+   mOuter.update(pad, sizeof(pad));
+}
+
+void
+HmacSHA256::compute(const void* data, size_t len, unsigned char mac[SHA256::DigestSize]) const
+{
+   SHA256 inner(mInner);
+   inner.update(data, len);
+   end(inner, mac);
+}
+
+void
+HmacSHA256::end(SHA256& inner, unsigned char mac[SHA256::DigestSize]) const
+{
+   inner.final(mac);
+   SHA256 outer(mOuter);
+   outer.update(mac, SHA256::DigestSize);
+   outer.final(mac);
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
@@ -0,0 +1,109 @@
+#if !defined(RESIP_SHA256_HXX)
+#define RESIP_SHA256_HXX
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rutil/Data.hxx"
+
+namespace resip
+{
+
+/* Note:  Like SHA1, this class is for those that don't want to include OpenSSL
+          in their project.  It works on caller supplied buffers only, so
+          hashing short strings costs no allocations. */
+
+class SHA256  // Produces a 256bit hash (64 characters when converted to a hex string)
+{
+public:
+    static const size_t DigestSize = 32;
+    static const size_t BlockSize = 64;
+
+    SHA256();
+    void update(const void* data, size_t len);
+    void update(const Data& data) { update(data.data(), data.size()); }
+    // Writes the hash and resets, ready for new data
+    void final(unsigned char digest[DigestSize]);
+
+private:
+    uint32_t mState[8];
+    uint64_t mLength;   // bytes hashed so far
+    unsigned char mBuffer[BlockSize];
+    size_t mBuffered;
+
+    void reset();
+    void transform(const unsigned char block[BlockSize]);
+};
+
+/* HMAC-SHA256 (RFC 2104) with a fixed key: the key's inner and outer pads are
+   hashed once, up front, so each MAC only costs hashing the message and one
+   more block. */
+class HmacSHA256
+{
+public:
+    explicit HmacSHA256(const Data& key);
+    void compute(const void* data, size_t len, unsigned char mac[SHA256::DigestSize]) const;
+
+    // For messages in several pieces: update() the state returned by begin()
+    // with each piece, then pass it to end() for the MAC.
+    SHA256 begin() const { return mInner; }
+    void end(SHA256& inner, unsigned char mac[SHA256::DigestSize]) const;
+
+private:
+    SHA256 mInner;
+    SHA256 mOuter;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
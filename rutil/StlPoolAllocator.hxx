@@ -4,6 +4,7 @@
 #include <limits>
 #include <memory>
 #include <stddef.h>
+#include <utility>
 
 // .bwc. gcc 4.2 and above support stateful allocators. I don't know about other 
 // compilers; if you do, add them here please.
@@ -130,9 +131,12 @@ class StlPoolAllocator
          return std::numeric_limits<size_type>::max()/_sz;
       }
 
-      void construct(pointer p, const_reference orig)
+      // Forwards its arguments, so that containers can move their elements
+      // (instead of copying them) when they grow.
+      template<class U, class... Args>
+      void construct(U* p, Args&&... args)
       {
-         new (p) T(orig);
+         new (p) U(std::forward<Args>(args)...);
       }
 
       void destroy(pointer ptr)
@@ -2,6 +2,7 @@
 #define RESIP_TimeLimitFifo_hxx 
 
 #include "rutil/ResipAssert.h"
+#include <atomic>
 #include <memory>
 #include "rutil/AbstractFifo.hxx"
 #include <iostream>
@@ -94,8 +95,13 @@ class TimeLimitFifo : public AbstractFifo< Timestamped<Msg*> >
       typedef enum {EnforceTimeDepth, IgnoreTimeDepth, InternalElement} DepthUsage;
 
       /// After it runs out of the lesser of these limits it will start to refuse messages
+      /// @param mode see FifoMode; in a lock-free fifo the limits are
+      ///    checked without a lock, so concurrent producers may overshoot
+      ///    maxSize by a few messages, and the time depth is an upper bound
+      ///    (see timeDepth()).
       TimeLimitFifo(unsigned int maxDurationSecs,
-                    unsigned int maxSize);
+                    unsigned int maxSize,
+                    FifoMode::Type mode=FifoMode::Locked);
 
       virtual ~TimeLimitFifo();
 
@@ -105,6 +111,8 @@ class TimeLimitFifo : public AbstractFifo< Timestamped<Msg*> >
       using AbstractFifo< Timestamped<Msg*> >::empty;
       using AbstractFifo< Timestamped<Msg*> >::size;
       using AbstractFifo< Timestamped<Msg*> >::onMessagePushed;
+      using AbstractFifo< Timestamped<Msg*> >::isLockFree;
+      using AbstractFifo< Timestamped<Msg*> >::sizeInternal;
 
       /// @brief Add a message to the fifo.
       /// return true iff succeeds
@@ -153,6 +161,10 @@ class TimeLimitFifo : public AbstractFifo< Timestamped<Msg*> >
       /** 
          @brief Return the time depth of the queue
          @return the time delta between the youngest and oldest queue members
+         @note A lock-free fifo cannot look at its oldest member from any
+         thread, so it reports the age of the last message taken out (or of
+         the moment it last became non-empty), which is never less than the
+         real depth and only exceeds it by the gap between two arrivals.
       */
       virtual time_t timeDepth() const;
 
@@ -208,6 +220,7 @@ class TimeLimitFifo : public AbstractFifo< Timestamped<Msg*> >
 
    private:
       time_t timeDepthInternal() const;
+      void raiseDepthMark(time_t t);
       inline bool wouldAcceptInteral(DepthUsage usage) const;
       TimeLimitFifo(const TimeLimitFifo& rhs);
       TimeLimitFifo& operator=(const TimeLimitFifo& rhs);
@@ -215,15 +228,21 @@ class TimeLimitFifo : public AbstractFifo< Timestamped<Msg*> >
       time_t mMaxDurationSecs;
       unsigned int mMaxSize;
       unsigned int mUnreservedMaxSize;
+      // Lock-free mode only: no message still in the fifo is older than
+      // this. It is the later of the time the fifo last became non-empty
+      // and the timestamp of the last message taken out.
+      std::atomic<time_t> mDepthMark;
 };
 
 template <class Msg>
 TimeLimitFifo<Msg>::TimeLimitFifo(unsigned int maxDurationSecs,
-                                  unsigned int maxSize)
-   : AbstractFifo< Timestamped<Msg*> >(),
+                                  unsigned int maxSize,
+                                  FifoMode::Type mode)
+   : AbstractFifo< Timestamped<Msg*> >(mode),
      mMaxDurationSecs(maxDurationSecs),
      mMaxSize(maxSize),
-     mUnreservedMaxSize((int)((maxSize*8)/10)) // !dlb! random guess
+     mUnreservedMaxSize((int)((maxSize*8)/10)), // !dlb! random guess
+     mDepthMark(0)
 {}
 
 template <class Msg>
@@ -238,6 +257,20 @@ bool
 TimeLimitFifo<Msg>::add(Msg* msg,
                         DepthUsage usage)
 {
+   if (isLockFree())
+   {
+      if (!wouldAcceptInteral(usage))
+      {
+         return false;
+      }
+      time_t n = time(0);
+      if (AbstractFifo< Timestamped<Msg*> >::add(Timestamped<Msg*>(msg, n)) == 1)
+      {
+         raiseDepthMark(n);
+      }
+      return true;
+   }
+
    Lock lock(mMutex); (void)lock;
 
    if (wouldAcceptInteral(usage))
@@ -258,6 +291,10 @@ template <class Msg>
 bool
 TimeLimitFifo<Msg>::wouldAccept(DepthUsage usage) const
 {
+   if (isLockFree())
+   {
+      return wouldAcceptInteral(usage);
+   }
    Lock lock(mMutex); (void)lock;
 
    return wouldAcceptInteral(usage);
@@ -268,6 +305,10 @@ Msg*
 TimeLimitFifo<Msg>::getNext()
 {
    Timestamped<Msg*> tm(AbstractFifo< Timestamped<Msg*> >::getNext());
+   if (isLockFree())
+   {
+      raiseDepthMark(tm.getTime());
+   }
    return tm.getMsg();
 }
 
@@ -278,6 +319,10 @@ TimeLimitFifo<Msg>::getNext(int ms)
    Timestamped<Msg*> tm(0,0);
    if(AbstractFifo< Timestamped<Msg*> >::getNext(ms, tm))
    {
+      if (isLockFree())
+      {
+         raiseDepthMark(tm.getTime());
+      }
       return tm.getMsg();
    }
    return 0;
@@ -287,6 +332,18 @@ template <class Msg>
 time_t
 TimeLimitFifo<Msg>::timeDepthInternal() const
 {
+   if (isLockFree())
+   {
+      // The consumer owns the head of the queue, so the oldest timestamp
+      // cannot be looked at from here; use the mark instead.
+      if (sizeInternal() == 0)
+      {
+         return 0;
+      }
+      time_t depth = time(0) - mDepthMark;
+      return depth > 0 ? depth : 0;
+   }
+
    if(mFifo.empty())
    {
       return 0;
@@ -295,12 +352,23 @@ TimeLimitFifo<Msg>::timeDepthInternal() const
    return time(0) - mFifo.front().getTime();
 }
 
+template <class Msg>
+void
+TimeLimitFifo<Msg>::raiseDepthMark(time_t t)
+{
+   time_t mark = mDepthMark;
+   while (mark < t && !mDepthMark.compare_exchange_weak(mark, t))
+   {
+   }
+}
+
 template <class Msg>
 bool
 TimeLimitFifo<Msg>::wouldAcceptInteral(DepthUsage usage) const
 {
+   const size_t size = sizeInternal();
    if ((mMaxSize != 0 &&
-        mFifo.size() >= mMaxSize))
+        size >= mMaxSize))
    {
       return false;
    }
@@ -311,7 +379,7 @@ TimeLimitFifo<Msg>::wouldAcceptInteral(DepthUsage usage) const
    }
 
    if (mUnreservedMaxSize != 0 &&
-       mFifo.size() >= mUnreservedMaxSize)
+       size >= mUnreservedMaxSize)
    {
       return false;
    }
@@ -323,7 +391,7 @@ TimeLimitFifo<Msg>::wouldAcceptInteral(DepthUsage usage) const
 
    resip_assert(usage == EnforceTimeDepth);
 
-   if (mFifo.size() == 0 ||
+   if (size == 0 ||
        mMaxDurationSecs == 0 ||
        timeDepthInternal() < mMaxDurationSecs)
    {
@@ -337,6 +405,10 @@ template <class Msg>
 time_t
 TimeLimitFifo<Msg>::timeDepth() const
 {
+   if (isLockFree())
+   {
+      return timeDepthInternal();
+   }
    Lock lock(mMutex); (void)lock;
    return timeDepthInternal();
 }
@@ -345,6 +417,16 @@ template <class Msg>
 void
 TimeLimitFifo<Msg>::clear()
 {
+   if (isLockFree())
+   {
+      Timestamped<Msg*> tm(0, 0);
+      while (AbstractFifo< Timestamped<Msg*> >::getNext(RESIP_FIFO_NOWAIT, tm))
+      {
+         delete tm.getMsg();
+      }
+      return;
+   }
+
    Lock lock(mMutex); (void)lock;
 
    while (!mFifo.empty())
@@ -0,0 +1,321 @@
+#if !defined(RESIP_TIMERWHEEL_HXX)
+#define RESIP_TIMERWHEEL_HXX
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "rutil/compat.hxx"
+#include "rutil/ResipAssert.h"
+#include "rutil/Timer.hxx"
+
+namespace resip
+{
+
+/**
+   @brief Hierarchical timing wheel with millisecond resolution.
+
+   Stores timers of any type T providing UInt64 getWhen() (absolute time in
+   ms). Adding a timer is O(1); expiring is O(1) per timer, plus an
+   occasional cascade of a higher level slot into the lower levels. This
+   suits the transaction layer well, where most timers are added and never
+   looked at again until they fire (usually after the transaction has gone
+   away).
+
+   There are four levels of 256 slots each. Level 0 holds timers that are
+   due within the current 256ms rotation of the cursor, level 1 those due
+   within the current 65.5s rotation, and so on; anything beyond the level
+   3 rotation (about 49 days) sits in an overflow list. Because levels are
+   defined by rotation rather than by distance from the cursor, every timer
+   in level k is due before every timer in level k+1, and slots within a
+   level are in time order. The cursor is the next millisecond not yet
+   expired; timers added in the past are treated as due at the cursor.
+*/
+template <class T>
+class TimerWheel
+{
+   public:
+      TimerWheel() : mCursor(Timer::getTimeMs()), mSize(0), mNext(0), mNextValid(true)
+      {
+         for (int i = 0; i < NumLevels; ++i)
+         {
+            mLevelSize[i] = 0;
+         }
+      }
+
+      void push(const T& timer)
+      {
+         if (mSize == 0)
+         {
+            // The cursor is not moved while the wheel is empty; catch up
+            // so that new timers land in the lower levels. It must never
+            // get ahead of the clock, or timers would fire late.
+            mCursor = resipMax(mCursor, Timer::getTimeMs());
+         }
+         insert(timer);
+         ++mSize;
+         if (mNextValid && (mSize == 1 || timer.getWhen() < mNext))
+         {
+            mNext = timer.getWhen();
+         }
+      }
+
+      size_t size() const
+      {
+         return mSize;
+      }
+
+      bool empty() const
+      {
+         return mSize == 0;
+      }
+
+      /// @brief time of the earliest timer; the wheel must not be empty
+      UInt64 nextWhen() const
+      {
+         resip_assert(mSize);
+         if (!mNextValid)
+         {
+            const std::vector<T>& slot = firstSlot();
+            mNext = std::min_element(slot.begin(), slot.end(), WhenLess())->getWhen();
+            mNextValid = true;
+         }
+         return mNext;
+      }
+
+      /// @brief the earliest timer; the wheel must not be empty
+      const T& top() const
+      {
+         const std::vector<T>& slot = firstSlot();
+         return *std::min_element(slot.begin(), slot.end(), WhenLess());
+      }
+
+      /**
+         @brief moves every timer due at or before now into expired, in
+         order of expiry.
+      */
+      void expire(UInt64 now, std::vector<T>& expired)
+      {
+         while (mSize && mCursor <= now)
+         {
+            if (mLevelSize[0])
+            {
+               std::vector<T>& slot = mSlots[0][mCursor & SlotMask];
+               if (!slot.empty())
+               {
+                  mLevelSize[0] -= slot.size();
+                  mSize -= slot.size();
+                  std::move(slot.begin(), slot.end(), std::back_inserter(expired));
+                  slot.clear();
+                  mNextValid = false;
+               }
+               advanceTo(mCursor + 1);
+            }
+            else
+            {
+               // Nothing in level 0: jump straight to the start of the first
+               // occupied slot above, or to now if that is further away.
+               advanceTo(resipMin(firstSlotStart(), now + 1));
+            }
+         }
+         if (mSize == 0 && mCursor <= now)
+         {
+            mCursor = now + 1;
+         }
+      }
+
+      /// @brief moves all timers into out, in no particular order
+      void clear(std::vector<T>& out)
+      {
+         for (int level = 0; level < NumLevels; ++level)
+         {
+            for (int i = 0; i < NumSlots; ++i)
+            {
+               std::vector<T>& slot = mSlots[level][i];
+               out.insert(out.end(), slot.begin(), slot.end());
+               slot.clear();
+            }
+            mLevelSize[level] = 0;
+         }
+         out.insert(out.end(), mOverflow.begin(), mOverflow.end());
+         mOverflow.clear();
+         mSize = 0;
+         mNextValid = true;
+      }
+
+   private:
+      enum
+      {
+         NumLevels = 4,
+         SlotBits = 8,
+         NumSlots = 1 << SlotBits,
+         SlotMask = NumSlots - 1
+      };
+
+      struct WhenLess
+      {
+         bool operator()(const T& lhs, const T& rhs) const
+         {
+            return lhs.getWhen() < rhs.getWhen();
+         }
+      };
+
+      static unsigned int shift(int level)
+      {
+         return SlotBits * level;
+      }
+
+      void insert(T timer)
+      {
+         UInt64 when = resipMax(timer.getWhen(), mCursor);
+         for (int level = 0; level < NumLevels; ++level)
+         {
+            if ((when >> shift(level + 1)) == (mCursor >> shift(level + 1)))
+            {
+               mSlots[level][(when >> shift(level)) & SlotMask].push_back(std::move(timer));
+               ++mLevelSize[level];
+               return;
+            }
+         }
+         mOverflow.push_back(std::move(timer));
+      }
+
+      // Move the cursor to target, cascading each higher level slot that
+      // the cursor enters at a rotation boundary. Callers guarantee that no
+      // occupied slot is skipped over.
+      void advanceTo(UInt64 target)
+      {
+         mCursor = target;
+         for (int level = NumLevels; level > 0; --level)
+         {
+            if ((mCursor & (((UInt64)1 << shift(level)) - 1)) != 0)
+            {
+               continue;
+            }
+            std::vector<T> cascade;
+            if (level == NumLevels)
+            {
+               cascade.swap(mOverflow);
+            }
+            else
+            {
+               cascade.swap(mSlots[level][(mCursor >> shift(level)) & SlotMask]);
+               mLevelSize[level] -= cascade.size();
+            }
+            for (typename std::vector<T>::iterator it = cascade.begin(); it != cascade.end(); ++it)
+            {
+               insert(std::move(*it));
+            }
+         }
+      }
+
+      int firstLevel() const
+      {
+         for (int level = 0; level < NumLevels; ++level)
+         {
+            if (mLevelSize[level])
+            {
+               return level;
+            }
+         }
+         return NumLevels;
+      }
+
+      int firstSlotIndex(int level) const
+      {
+         unsigned int current = (unsigned int)(mCursor >> shift(level)) & SlotMask;
+         for (unsigned int i = current; i < NumSlots; ++i)
+         {
+            if (!mSlots[level][i].empty())
+            {
+               return (int)i;
+            }
+         }
+         resip_assert(0);
+         return NumSlots - 1;
+      }
+
+      const std::vector<T>& firstSlot() const
+      {
+         int level = firstLevel();
+         if (level == NumLevels)
+         {
+            return mOverflow;
+         }
+         return mSlots[level][firstSlotIndex(level)];
+      }
+
+      // Start time of the first occupied slot; level 0 must be empty.
+      UInt64 firstSlotStart() const
+      {
+         int level = firstLevel();
+         resip_assert(level > 0);
+         if (level == NumLevels)
+         {
+            return ((mCursor >> shift(level)) + 1) << shift(level);
+         }
+         UInt64 rotation = (mCursor >> shift(level + 1)) << shift(level + 1);
+         return rotation | ((UInt64)firstSlotIndex(level) << shift(level));
+      }
+
+      std::vector<T> mSlots[NumLevels][NumSlots];
+      size_t mLevelSize[NumLevels];
+      std::vector<T> mOverflow;
+      UInt64 mCursor;
+      size_t mSize;
+      mutable UInt64 mNext;
+      mutable bool mNextValid;
+};
+
+}
+
+#endif
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */
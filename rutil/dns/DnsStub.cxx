@@ -88,6 +88,8 @@ DnsStub::DnsStub(const NameserverList& additional,
    mTransform(0),
    mDnsProvider(ExternalDnsFactory::createExternalDns()),
    mPollGrp(0),
+   mRefreshCount(0),
+   mRefreshFailures(0),
    mAsyncProcessHandler(asyncProcessHandler)
 {
    setPollGrp(pollGrp);
@@ -115,6 +117,10 @@ DnsStub::~DnsStub()
    {
       delete *it;
    }
+   for (set<Refresh*>::iterator it = mRefreshes.begin(); it != mRefreshes.end(); ++it)
+   {
+      delete *it;
+   }
 
    setPollGrp(0);
    delete mDnsProvider;
@@ -460,6 +466,59 @@ typeToData(int rr)
    }
 }
 
+void
+DnsStub::refresh(const Data& target, int rrType)
+{
+   if (mDnsProvider->hostFileLookupLookupOnlyMode())
+   {
+      return;
+   }
+   StackLog(<< "Refreshing cached " << typeToData(rrType) << " records of " << target);
+   ++mRefreshCount;
+   Refresh* refresh = new Refresh(*this, target, rrType);
+   mRefreshes.insert(refresh);
+   lookupRecords(target, rrType, refresh);
+}
+
+DnsStub::Refresh::Refresh(DnsStub& stub, const Data& target, int rrType)
+   : mStub(stub),
+     mTarget(target),
+     mRRType(rrType)
+{
+}
+
+void
+DnsStub::Refresh::onDnsRaw(int status, const unsigned char* abuf, int alen)
+{
+   try
+   {
+      switch (status)
+      {
+         case 0:
+            mStub.cache(mTarget, abuf, alen);
+            break;
+         case ARES_ENODATA:
+         case ARES_ENOTFOUND:
+            // The name or the records are gone: replace the stale answer.
+            mStub.cacheTTL(mTarget, mRRType, status, abuf, alen);
+            break;
+         default:
+            // Keep serving what we have; the cache retries later.
+            DebugLog(<< "Refresh of " << mTarget << " failed: " << mStub.errorMessage(status));
+            ++mStub.mRefreshFailures;
+            break;
+      }
+   }
+   catch (BaseException& e)
+   {
+      InfoLog(<< "Couldn't cache refreshed records of " << mTarget << ": " << e.getMessage());
+      ++mStub.mRefreshFailures;
+   }
+
+   mStub.mRefreshes.erase(this);
+   delete this;
+}
+
 void
 DnsStub::Query::go()
 {
@@ -468,8 +527,10 @@ DnsStub::Query::go()
    DnsResourceRecordsByPtr records;
    int status = 0;
    bool cached = false;
+   bool refresh = false;
+   RRCache::Outcome outcome = RRCache::Miss;
    Data targetToQuery = mTarget;
-   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status);
+   cached = mStub.mRRCache.lookup(mTarget, mRRType, mProto, records, status, refresh, outcome);
 
    if (!cached)
    {
@@ -490,7 +551,13 @@ DnsStub::Query::go()
    if (targetToQuery != mTarget)
    {
       StackLog(<< mTarget << " mapped to CNAME " << targetToQuery);
-      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status);
+      cached = mStub.mRRCache.lookup(targetToQuery, mRRType, mProto, records, status, refresh, outcome);
+   }
+   mStub.mRRCache.countLookup(outcome);
+
+   if (refresh)
+   {
+      mStub.refresh(targetToQuery, mRRType);
    }
 
    if (!cached)
@@ -861,6 +928,14 @@ DnsStub::doGetDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCa
    resip_assert(handler != 0);
    Data dnsCacheDump;
    mRRCache.getCacheDump(dnsCacheDump);
+   {
+      DataStream strm(dnsCacheDump);
+      strm << "cache hits: " << mRRCache.getHits()
+           << ", stale hits: " << mRRCache.getStaleHits()
+           << ", misses: " << mRRCache.getMisses()
+           << ", prefetches: " << mRefreshCount
+           << " (" << mRefreshFailures << " failed)" << endl;
+   }
    handler->onDnsCacheDumpRetrieved(key, dnsCacheDump);
 }
 
@@ -895,6 +970,18 @@ DnsStub::setDnsCacheSize(int size)
    mRRCache.setSize(size);
 }
 
+void
+DnsStub::setDnsCachePrefetch(int secondsBeforeExpiry, unsigned int minHits)
+{
+   mRRCache.setPrefetch(secondsBeforeExpiry, minHits);
+}
+
+void
+DnsStub::setDnsCacheServeStale(int seconds)
+{
+   mRRCache.setServeStale(seconds);
+}
+
 /* ====================================================================
  * The Vovida Software License, Version 1.0 
  * 
@@ -179,6 +179,20 @@ class DnsStub : public ExternalDnsHandler
       void getDnsCacheDump(std::pair<unsigned long, unsigned long> key, GetDnsCacheDumpHandler* handler);
       void setDnsCacheTTL(int ttl);
       void setDnsCacheSize(int size);
+      /*!
+         @param secondsBeforeExpiry A cached answer that has been used at
+                least minHits times is re-queried in the background once it
+                is this close to expiring, so busy names never miss the
+                cache. 0 (the default) disables prefetching.
+      */
+      void setDnsCachePrefetch(int secondsBeforeExpiry, unsigned int minHits = 2);
+      /*!
+         @param seconds How long an expired answer may still be served
+                while it is being re-queried in the background, or while
+                the servers are not answering (RFC 8767). 0 (the default)
+                disables serving stale answers.
+      */
+      void setDnsCacheServeStale(int seconds);
       void reloadDnsServers();
       bool checkDnsChange();
       bool supportedType(int);
@@ -460,6 +474,22 @@ class DnsStub : public ExternalDnsHandler
                                          std::vector<RROverlay>&,
                                          bool discard=false);
       void removeQuery(Query*);
+
+      // Re-queries a cached answer in the background, for prefetch and
+      // serve-stale; the answer only goes into the cache.
+      class Refresh : public DnsRawSink
+      {
+         public:
+            Refresh(DnsStub& stub, const Data& target, int rrType);
+            void onDnsRaw(int status, const unsigned char* abuf, int alen);
+
+         private:
+            DnsStub& mStub;
+            Data mTarget;
+            int mRRType;
+      };
+
+      void refresh(const Data& target, int rrType);
       void lookupRecords(const Data& target, unsigned short type, DnsRawSink* sink);
       Data errorMessage(int status);
 
@@ -467,6 +497,9 @@ class DnsStub : public ExternalDnsHandler
       ExternalDns* mDnsProvider;
       FdPollGrp* mPollGrp;
       std::set<Query*> mQueries;
+      std::set<Refresh*> mRefreshes;
+      UInt64 mRefreshCount;
+      UInt64 mRefreshFailures;
 
       std::vector<Data> mEnumSuffixes; // where to do enum lookups
       std::map<Data,Data> mEnumDomains;
@@ -23,7 +23,6 @@
 #endif
 #endif
 
-#include <set>
 #include <vector>
 #include <list>
 #include <map>
@@ -50,7 +49,13 @@ RRCache::RRCache()
    : mHead(),
      mLruHead(LruListType::makeList(&mHead)),
      mUserDefinedTTL(DEFAULT_USER_DEFINED_TTL),
-     mSize(DEFAULT_SIZE)
+     mSize(DEFAULT_SIZE),
+     mPrefetchSecs(0),
+     mPrefetchMinHits(0),
+     mServeStaleSecs(0),
+     mHits(0),
+     mStaleHits(0),
+     mMisses(0)
 {
    mFactoryMap[T_CNAME] = &mCnameRecordFactory;
    mFactoryMap[T_NAPTR] = &mNaptrRecordFacotry;
@@ -69,23 +74,19 @@ RRCache::~RRCache()
 void 
 RRCache::updateCacheFromHostFile(const DnsHostRecord &record)
 {
-   //FactoryMap::iterator it = mFactoryMap.find(T_A);
-   RRList* key = new RRList(record, 3600);         
-   RRSet::iterator lb = mRRSet.lower_bound(key);
-   if (lb != mRRSet.end() &&
-       !(mRRSet.key_comp()(key, *lb)))
+   RRMap::iterator it = mRRMap.find(Key(record.name(), T_A));
+   if (it != mRRMap.end())
    {
-      (*lb)->update(record, 3600);
-      touch(*lb);
+      it->second->update(record, 3600);
+      touch(it->second);
    }
    else
    {
       RRList* val = new RRList(record, 3600);
-      mRRSet.insert(val);
+      mRRMap.insert(RRMap::value_type(Key::stored(val->key(), val->rrType()), val));
       mLruHead->push_back(val);
       purge();
    }
-   delete key;
 }
 
 void 
@@ -97,22 +98,19 @@ RRCache::updateCache(const Data& target,
    Data domain = (*begin).domain();
    FactoryMap::iterator it = mFactoryMap.find(rrType);
    resip_assert(it != mFactoryMap.end());
-   RRList* key = new RRList(domain, rrType);         
-   RRSet::iterator lb = mRRSet.lower_bound(key);
-   if (lb != mRRSet.end() &&
-       !(mRRSet.key_comp()(key, *lb)))
+   RRMap::iterator found = mRRMap.find(Key(domain, rrType));
+   if (found != mRRMap.end())
    {
-      (*lb)->update(it->second, begin, end, mUserDefinedTTL);
-      touch(*lb);
+      found->second->update(it->second, begin, end, mUserDefinedTTL);
+      touch(found->second);
    }
    else
    {
       RRList* val = new RRList(it->second, domain, rrType, begin, end, mUserDefinedTTL);
-      mRRSet.insert(val);
+      mRRMap.insert(RRMap::value_type(Key::stored(val->key(), rrType), val));
       mLruHead->push_back(val);
       purge();
    }
-   delete key;
 }
 
 void 
@@ -133,15 +131,14 @@ RRCache::cacheTTL(const Data& target,
       ttl = mUserDefinedTTL;
    }
 
-   RRList* val = new RRList(target, rrType, ttl, status);
-   RRSet::iterator it = mRRSet.find(val);
-   if (it != mRRSet.end())
+   RRMap::iterator it = mRRMap.find(Key(target, rrType));
+   if (it != mRRMap.end())
    {
-      (*it)->remove();
-      delete *it;
-      mRRSet.erase(it);
+      delete it->second;
+      mRRMap.erase(it);
    }
-   mRRSet.insert(val);
+   RRList* val = new RRList(target, rrType, ttl, status);
+   mRRMap.insert(RRMap::value_type(Key::stored(val->key(), rrType), val));
    mLruHead->push_back(val);
    purge();
 }
@@ -155,31 +152,104 @@ RRCache::lookup(const Data& target,
 {
    records.clear();
    status = 0;
-   RRList* key = new RRList(target, type);
-   RRSet::iterator it = mRRSet.find(key);
-   delete key;
-   if (it == mRRSet.end())
+   RRMap::iterator it = mRRMap.find(Key(target, type));
+   if (it == mRRMap.end())
    {
       return false;
    }
    else
    {
-      if (Timer::getTimeSecs() >= (*it)->absoluteExpiry())
+      UInt64 now = Timer::getTimeSecs();
+      if (now >= it->second->absoluteExpiry())
       {
-         delete *it;
-         mRRSet.erase(it);
+         // Keep an answer that may still be served stale.
+         if (expired(it->second, now))
+         {
+            delete it->second;
+            mRRMap.erase(it);
+         }
          return false;
       }
       else
       {
-         records = (*it)->records(protocol);
-         status = (*it)->status();
-         touch(*it);
+         records = it->second->records(protocol);
+         status = it->second->status();
+         touch(it->second);
          return true;
       }
    }
 }
 
+bool 
+RRCache::lookup(const Data& target, 
+                const int type, 
+                const int protocol,
+                Result& records, 
+                int& status,
+                bool& refresh,
+                Outcome& outcome)
+{
+   records.clear();
+   status = 0;
+   refresh = false;
+   outcome = Miss;
+   RRMap::iterator it = mRRMap.find(Key(target, type));
+   if (it == mRRMap.end())
+   {
+      return false;
+   }
+
+   RRList* node = it->second;
+   UInt64 now = Timer::getTimeSecs();
+   if (now >= node->absoluteExpiry())
+   {
+      if (expired(node, now))
+      {
+         delete node;
+         mRRMap.erase(it);
+         return false;
+      }
+      outcome = StaleHit;
+      refresh = now >= node->nextRefresh();
+   }
+   else
+   {
+      outcome = Hit;
+      ++node->hits();
+      refresh = mPrefetchSecs > 0 &&
+         node->status() == 0 &&
+         node->hits() >= mPrefetchMinHits &&
+         now + mPrefetchSecs >= node->absoluteExpiry() &&
+         now >= node->nextRefresh();
+   }
+
+   if (refresh)
+   {
+      node->nextRefresh() = now + REFRESH_RETRY;
+   }
+   records = node->records(protocol);
+   status = node->status();
+   touch(node);
+   return true;
+}
+
+void
+RRCache::countLookup(Outcome outcome)
+{
+   switch (outcome)
+   {
+      case Hit:
+         ++mHits;
+         break;
+      case StaleHit:
+         ++mStaleHits;
+         break;
+      default:
+         ++mMisses;
+         break;
+   }
+}
+
 void 
 RRCache::clearCache()
 {
@@ -196,12 +266,11 @@ RRCache::touch(RRList* node)
 void 
 RRCache::cleanup()
 {
-   for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); it++)
+   for (RRMap::iterator it = mRRMap.begin(); it != mRRMap.end(); ++it)
    {
-      (*it)->remove();
-      delete *it;
+      delete it->second;
    }
-   mRRSet.clear();
+   mRRMap.clear();
 }
 
 int 
@@ -226,29 +295,45 @@ RRCache::getTTL(const RROverlay& overlay)
 void 
 RRCache::purge()
 {
-   if (mRRSet.size() < mSize) return;
-   RRList* lst = *(mLruHead->begin());
-   RRSet::iterator it = mRRSet.find(lst);
-   resip_assert(it != mRRSet.end());
-   lst->remove();
-   delete *it;
-   mRRSet.erase(it);
+   if (mRRMap.size() < mSize) return;
+   erase(*(mLruHead->begin()));
+}
+
+// Negative answers are never served stale.
+bool
+RRCache::expired(RRList* node, UInt64 now) const
+{
+   UInt64 expiry = node->absoluteExpiry();
+   if (node->status() == 0)
+   {
+      expiry += mServeStaleSecs;
+   }
+   return now >= expiry;
+}
+
+void
+RRCache::erase(RRList* node)
+{
+   RRMap::iterator it = mRRMap.find(Key(node->key(), node->rrType()));
+   resip_assert(it != mRRMap.end());
+   mRRMap.erase(it);
+   delete node;
 }
 
 void 
 RRCache::logCache()
 {
    UInt64 now = Timer::getTimeSecs();
-   for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
+   for (RRMap::iterator it = mRRMap.begin(); it != mRRMap.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (expired(it->second, now))
       {
-         delete *it;
-         mRRSet.erase(it++);
+         delete it->second;
+         mRRMap.erase(it++);
       }
       else
       {
-         (*it)->log();
+         it->second->log();
          ++it;
       }
    }
@@ -259,16 +344,16 @@ RRCache::getCacheDump(Data& dnsCacheDump)
 {
    UInt64 now = Timer::getTimeSecs();
    DataStream strm(dnsCacheDump);
-   for (std::set<RRList*, CompareT>::iterator it = mRRSet.begin(); it != mRRSet.end(); )
+   for (RRMap::iterator it = mRRMap.begin(); it != mRRMap.end(); )
    {
-      if (now >= (*it)->absoluteExpiry())
+      if (expired(it->second, now))
       {
-         delete *it;
-         mRRSet.erase(it++);
+         delete it->second;
+         mRRMap.erase(it++);
       }
       else
       {
-         (*it)->encodeRRList(strm);
+         it->second->encodeRRList(strm);
          ++it;
       }
    }
@@ -2,9 +2,10 @@
 #define RESIP_RRCACHE_HXX
 
 #include <map>
-#include <set>
 #include <memory>
 
+#include "rutil/Data.hxx"
+#include "rutil/HashMap.hxx"
 #include "rutil/dns/RRFactory.hxx"
 #include "rutil/dns/DnsResourceRecord.hxx"
 #include "rutil/dns/DnsAAAARecord.hxx"
@@ -31,6 +32,17 @@ class RRCache
       ~RRCache();
       void setTTL(int ttl) { if (ttl > 0) mUserDefinedTTL = ttl * MIN_TO_SEC; }
       void setSize(int size) { mSize = size; }
+      // Entries looked up at least minHits times are refreshed in the
+      // background once they are within secondsBeforeExpiry of expiring.
+      // 0 disables prefetching.
+      void setPrefetch(int secondsBeforeExpiry, unsigned int minHits)
+      {
+         mPrefetchSecs = secondsBeforeExpiry > 0 ? secondsBeforeExpiry : 0;
+         mPrefetchMinHits = minHits;
+      }
+      // Expired positive answers are kept and served for up to this many
+      // seconds while they are being refreshed (RFC 8767). 0 disables it.
+      void setServeStale(int seconds) { mServeStaleSecs = seconds > 0 ? seconds : 0; }
       // Update existing cache record, or add a new one
       void updateCache(const Data& target,
                        const int rrType,
@@ -43,32 +55,66 @@ class RRCache
                     const int status,
                     RROverlay overlay);
       bool lookup(const Data& target, const int type, const int proto, Result& records, int& status);
+      enum Outcome { Miss, Hit, StaleHit };
+      // As above, for a query made on behalf of a user: an expired answer
+      // may be served stale, outcome says which kind of answer this was,
+      // and refresh is set when the caller should re-query the entry in
+      // the background. Once refresh has been reported for an entry it is
+      // not reported again for REFRESH_RETRY seconds, unless the entry is
+      // updated.
+      bool lookup(const Data& target, const int type, const int proto, Result& records, int& status, bool& refresh, Outcome& outcome);
+      // counts one user query in getHits(), getStaleHits() or getMisses();
+      // a query that follows CNAMEs counts once, with the final outcome
+      void countLookup(Outcome outcome);
       void clearCache();
       void logCache();
       void getCacheDump(Data& dnsCacheDump);
 
+      UInt64 getHits() const { return mHits; }
+      UInt64 getStaleHits() const { return mStaleHits; }
+      UInt64 getMisses() const { return mMisses; }
+
    private:
       static const int MIN_TO_SEC = 60;
       static const int DEFAULT_USER_DEFINED_TTL = 10; // in seconds.
 
-      static const int DEFAULT_SIZE = 512;
-      class CompareT
+      static const int DEFAULT_SIZE = 8192;
+      static const int REFRESH_RETRY = 30; // in seconds.
+
+      // Index key. The target is hashed and compared without regard to
+      // case, so a lookup neither copies nor lowercases it: the probe key
+      // shares the caller's buffer. Keys put in the index are made with
+      // stored(), which gives them a buffer of their own.
+      class Key
       {
          public:
-            bool operator()(const RRList* lhs, const RRList* rhs) const
+            Key(const Data& target, int rrType)
+               : mTarget(Data::Share, target.data(), target.size()),
+                 mRRType(rrType)
+            {}
+
+            static Key stored(const Data& target, int rrType)
             {
-               if (lhs->rrType() < rhs->rrType())
-               {
-                  return true;
-               }
-               else if (lhs->rrType() > rhs->rrType())
-               {
-                  return false;
-               }
-               else
-               {
-                  return (Data(lhs->key())).lowercase() < (Data(rhs->key())).lowercase();
-               }
+               Key key(target, rrType);
+               key.mTarget = Data(target.data(), target.size());
+               return key;
+            }
+
+            bool operator==(const Key& rhs) const
+            {
+               return mRRType == rhs.mRRType && isEqualNoCase(mTarget, rhs.mTarget);
+            }
+
+            Data mTarget;
+            int mRRType;
+      };
+
+      class KeyHash
+      {
+         public:
+            size_t operator()(const Key& key) const
+            {
+               return key.mTarget.caseInsensitivehash() ^ (size_t)key.mRRType;
             }
       };
 
@@ -76,13 +122,15 @@ class RRCache
       void cleanup();
       int getTTL(const RROverlay& overlay);
       void purge();
+      void erase(RRList* node);
+      bool expired(RRList* node, UInt64 now) const;
 
       RRList mHead;
       LruListType* mLruHead;                     
       Result Empty;
 
-      typedef std::set<RRList*, CompareT> RRSet;
-      RRSet mRRSet;
+      typedef HashMap<Key, RRList*, KeyHash> RRMap;
+      RRMap mRRMap;
 
       RRFactory<DnsHostRecord> mHostRecordFactory;
       RRFactory<DnsSrvRecord> mSrvRecordFactory;
@@ -95,6 +143,13 @@ class RRCache
       
       int mUserDefinedTTL; // used when the ttl in RR is 0 or less than default(60). in seconds.
       unsigned int mSize;
+      int mPrefetchSecs;
+      unsigned int mPrefetchMinHits;
+      int mServeStaleSecs;
+
+      UInt64 mHits;
+      UInt64 mStaleHits;
+      UInt64 mMisses;
 };
 
 }
@@ -52,6 +52,11 @@ class RRList : public IntrusiveListElement<RRList*>
       int rrType() const { return mRRType; }
       UInt64 absoluteExpiry() const { return mAbsoluteExpiry; }
       UInt64& absoluteExpiry() { return mAbsoluteExpiry; }
+      // Lookups served since the records were last replaced, and the time
+      // (in seconds) before which no background refresh is started again.
+      // Both are reset by update().
+      unsigned int& hits() { return mHits; }
+      UInt64& nextRefresh() { return mNextRefresh; }
       void log();
       EncodeStream& encodeRRList(EncodeStream& strm);
 
@@ -73,6 +78,8 @@ class RRList : public IntrusiveListElement<RRList*>
 
       int mStatus; // dns query status.
       UInt64 mAbsoluteExpiry;
+      unsigned int mHits;
+      UInt64 mNextRefresh;
 
       RecordItr find(const Data&);
       void clear();
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include "rutil/Log.hxx"
 #include "rutil/Fifo.hxx"
 #include "rutil/FiniteFifo.hxx"
@@ -146,6 +147,108 @@ void Producer::thread()
    }
 }
 
+class Item
+{
+   public:
+      Item(unsigned int producer, unsigned int seq)
+         : mProducer(producer),
+           mSeq(seq)
+      {}
+
+      unsigned int mProducer;
+      unsigned int mSeq;
+};
+
+class ItemProducer: public ThreadIf
+{
+   public:
+      ItemProducer(Fifo<Item>& fifo, unsigned int id, unsigned int count)
+         : mFifo(fifo),
+           mId(id),
+           mCount(count)
+      {}
+
+      void thread()
+      {
+         for (unsigned int i = 0; i < mCount; ++i)
+         {
+            mFifo.add(new Item(mId, i));
+         }
+      }
+
+   private:
+      Fifo<Item>& mFifo;
+      unsigned int mId;
+      unsigned int mCount;
+};
+
+// Several producers hammer one fifo while a single consumer drains it,
+// alternating between the blocking, timed and batched get operations.
+// Checks that nothing is lost and that each producer's messages come out in
+// order.
+void
+contentionBenchmark(FifoMode::Type mode, unsigned int producers, unsigned int perProducer)
+{
+   Fifo<Item> fifo(0, mode);
+   std::vector<ItemProducer*> threads;
+   std::vector<unsigned int> next(producers, 0);
+   const unsigned int total = producers*perProducer;
+
+   UInt64 start = Timer::getTimeMicroSec();
+   for (unsigned int p = 0; p < producers; ++p)
+   {
+      threads.push_back(new ItemProducer(fifo, p, perProducer));
+      threads.back()->run();
+   }
+
+   unsigned int received = 0;
+   Fifo<Item>::Messages batch;
+   while (received < total)
+   {
+      switch (received % 3)
+      {
+         case 0:
+            batch.push_back(fifo.getNext());
+            break;
+         case 1:
+         {
+            Item* item = fifo.getNext(1000);
+            assert(item);
+            batch.push_back(item);
+            break;
+         }
+         default:
+            fifo.getMultiple(batch, 16);
+            break;
+      }
+
+      while (!batch.empty())
+      {
+         Item* item = batch.front();
+         batch.pop_front();
+         assert(item->mProducer < producers);
+         assert(item->mSeq == next[item->mProducer]);
+         ++next[item->mProducer];
+         ++received;
+         delete item;
+      }
+   }
+   UInt64 elapsed = Timer::getTimeMicroSec() - start;
+
+   for (unsigned int p = 0; p < producers; ++p)
+   {
+      threads[p]->join();
+      delete threads[p];
+   }
+   assert(fifo.empty());
+   assert(fifo.size() == 0);
+
+   cerr << (mode == FifoMode::LockFree ? "lock-free" : "locked   ") << ": "
+        << producers << " producers, " << total << " messages in "
+        << elapsed/1000 << " ms ("
+        << (elapsed ? (UInt64)total*1000000/elapsed : 0) << " msgs/s)" << endl;
+}
+
 bool
 isNear(int value, int reference, int epsilon=250)
 {
@@ -459,6 +562,74 @@ main()
       sleepMS(1000);
    }
 
+   {
+      cerr << "!! Test lock-free time limit fifo" << endl;
+
+      TimeLimitFifo<Foo> tlfNS(5, 10, FifoMode::LockFree); // 5 seconds, limit 10 (2 reserved)
+      bool c;
+
+      assert(tlfNS.empty());
+      assert(tlfNS.timeDepth() == 0);
+      assert(tlfNS.getNext(RESIP_FIFO_NOWAIT) == 0);
+
+      for (int i = 0; i < 8; ++i)
+      {
+         c = tlfNS.add(new Foo(Data("element") + Data(i)), TimeLimitFifo<Foo>::EnforceTimeDepth);
+         assert(c);
+      }
+      c = tlfNS.add(new Foo("nope"), TimeLimitFifo<Foo>::IgnoreTimeDepth);
+      assert(!c);
+      c = tlfNS.add(new Foo("yep"), TimeLimitFifo<Foo>::InternalElement);
+      assert(c);
+      c = tlfNS.add(new Foo("yepAgain"), TimeLimitFifo<Foo>::InternalElement);
+      assert(c);
+      c = tlfNS.add(new Foo("hard nope!"), TimeLimitFifo<Foo>::InternalElement);
+      assert(!c);
+      assert(tlfNS.size() == 10);
+
+      Foo* fp = tlfNS.getNext();
+      assert(fp->mVal == "element0");
+      delete fp;
+
+      sleepMS(2000);
+      assert(tlfNS.timeDepth() > 1);
+
+      while (!tlfNS.empty())
+      {
+         delete tlfNS.getNext();
+      }
+      assert(tlfNS.timeDepth() == 0);
+
+      // leave some behind for clear() in the destructor
+      c = tlfNS.add(new Foo("first"), TimeLimitFifo<Foo>::EnforceTimeDepth);
+      assert(c);
+      c = tlfNS.add(new Foo("second"), TimeLimitFifo<Foo>::EnforceTimeDepth);
+      assert(c);
+   }
+
+   {
+      cerr << "!! Test lock-free fifo wakeup" << endl;
+
+      Fifo<Foo> fifo(0, FifoMode::LockFree);
+      UInt64 begin(Timer::getTimeMs());
+      assert(fifo.getNext(500) == 0);
+      UInt64 end(Timer::getTimeMs());
+      assert(isNear((int)(end - begin), 500, 200));
+      fifo.add(new Foo("leftover"));
+   }
+
+   {
+      cerr << "!! Fifo contention benchmark" << endl;
+
+      const unsigned int producerCounts[] = { 1, 4, 16 };
+      for (unsigned int i = 0; i < sizeof(producerCounts)/sizeof(producerCounts[0]); ++i)
+      {
+         const unsigned int perProducer = 400000/producerCounts[i];
+         contentionBenchmark(FifoMode::Locked, producerCounts[i], perProducer);
+         contentionBenchmark(FifoMode::LockFree, producerCounts[i], perProducer);
+      }
+   }
+
    cerr << "All OK" << endl;
    return 0;
 }
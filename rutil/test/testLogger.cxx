@@ -1,4 +1,9 @@
 
+#include <assert.h>
+#include <fstream>
+#include <stdio.h>
+
+#include "rutil/AsyncLogWriter.hxx"
 #include "rutil/Logger.hxx"
 #include "rutil/Data.hxx"
 #include "rutil/ThreadIf.hxx"
@@ -131,6 +136,193 @@ testThreadLocalLoggers(const char *appname)
    }
 }
 
+void
+testLogRing()
+{
+   LogRing ring(4096);
+   assert(ring.capacity() == 4096);
+   assert(ring.empty());
+
+   char message[100];
+   memset(message, 'x', sizeof(message));
+
+   // fill it up
+   int pushed = 0;
+   while (ring.push(Log::Info, Subsystem::TEST, __FILE__, pushed, pushed, message, sizeof(message)))
+   {
+      ++pushed;
+   }
+   assert(ring.dropped() == 1);
+   assert(pushed == 4096 / 152);
+   assert(ring.filling());
+
+   std::vector<const LogRing::Record*> records;
+   ring.collect(records);
+   assert((int)records.size() == pushed);
+   for (int i = 0; i < pushed; ++i)
+   {
+      assert(records[i]->mLine == i);
+      assert(records[i]->mTime == (UInt64)i);
+      assert(records[i]->mLength == sizeof(message));
+      assert(records[i]->mSubsystem == &Subsystem::TEST);
+      assert(memcmp(records[i]->message(), message, sizeof(message)) == 0);
+   }
+   // still taken until released
+   assert(!ring.push(Log::Info, Subsystem::TEST, __FILE__, 0, 0, message, sizeof(message)));
+   ring.release();
+   assert(ring.empty());
+
+   // records of all sizes, wrapping around the end of the ring
+   for (int i = 0; i < 1000; ++i)
+   {
+      size_t length = (i * 37) % 900;
+      memset(message, 'a' + i % 26, sizeof(message));
+      assert(ring.push(Log::Debug, Subsystem::TEST, __FILE__, i, i, message, length < 100 ? length : 100));
+      assert(ring.push(Log::Debug, Subsystem::TEST, __FILE__, i, i, message, 0));
+      records.clear();
+      ring.collect(records);
+      assert(records.size() == 2);
+      assert(records[0]->mLine == i && records[1]->mLength == 0);
+      assert(records[0]->mLength == (length < 100 ? length : 100));
+      assert(records[0]->mLength == 0 || records[0]->message()[0] == 'a' + i % 26);
+      ring.release();
+   }
+
+   // a message too big for the ring is cut short
+   Data big("0123456789");
+   while (big.size() < 4096)
+   {
+      big += big;
+   }
+   assert(ring.push(Log::Debug, Subsystem::TEST, __FILE__, 0, 0, big.data(), big.size()));
+   records.clear();
+   ring.collect(records);
+   assert(records.size() == 1 && records[0]->mLength == 1024 - sizeof(LogRing::Record));
+   ring.release();
+   assert(ring.dropped() == 2);
+}
+
+class AsyncLogThread : public ThreadIf
+{
+   public:
+      AsyncLogThread(int id, int lines) : mId(id), mLines(lines) {}
+
+      void thread()
+      {
+         for (int i = 0; i < mLines; ++i)
+         {
+            InfoLog(<< "async " << mId << " " << i);
+         }
+      }
+
+   private:
+      int mId;
+      int mLines;
+};
+
+static int
+countLines(const char* fileName, const char* contains, Data* first = 0)
+{
+   std::ifstream file(fileName);
+   std::string line;
+   int count = 0;
+   while (std::getline(file, line))
+   {
+      if (line.find(contains) != std::string::npos)
+      {
+         if (count++ == 0 && first)
+         {
+            *first = line.c_str();
+         }
+      }
+   }
+   return count;
+}
+
+static UInt64
+timeLogging(int lines)
+{
+   UInt64 start = Timer::getTimeMicroSec();
+   for (int i = 0; i < lines; ++i)
+   {
+      InfoLog(<< "timing line " << i << " of " << lines);
+   }
+   return Timer::getTimeMicroSec() - start;
+}
+
+void
+testAsyncWriter(const char* appname)
+{
+   const char* fileName = "testLogger-async.txt";
+   remove(fileName);
+   Log::initialize(Log::File, Log::Info, appname, fileName);
+   Log::startAsyncWriter();
+
+   const int threads = 4;
+   const int lines = 1000;
+   std::vector<AsyncLogThread*> loggers;
+   for (int i = 0; i < threads; ++i)
+   {
+      loggers.push_back(new AsyncLogThread(i, lines));
+      loggers.back()->run();
+   }
+   for (int i = 0; i < threads; ++i)
+   {
+      loggers[i]->join();
+      delete loggers[i];
+   }
+   InfoLog(<< "Recursive async: " << logsInCall());
+   {
+      // begun while the writer runs, finished once it has stopped
+      Log::Guard late(Log::Info, Subsystem::TEST, __FILE__, __LINE__);
+      late.asStream() << "late line";
+      Log::stopAsyncWriter();
+   }
+
+   assert(Log::getAsyncDroppedCount() == 0);
+   Data first;
+   assert(countLines(fileName, "async ", &first) == threads * lines);
+   assert(countLines(fileName, "Got here?") == 1);
+   assert(countLines(fileName, "Recursive async: 17") == 1);
+   assert(countLines(fileName, "late line") == 1);
+   // the same headers as lines written directly
+   assert(first.prefix("INFO | "));
+   assert(first.find(" | RESIP | ") != Data::npos);
+   assert(first.find("testLogger.cxx:") != Data::npos);
+
+   // lines logged while the writer stops are written one way or the other
+   remove(fileName);
+   Log::initialize(Log::File, Log::Info, appname, fileName);
+   UInt64 droppedBefore = Log::getAsyncDroppedCount();
+   Log::startAsyncWriter();
+   for (int i = 0; i < threads; ++i)
+   {
+      loggers[i] = new AsyncLogThread(i, 5 * lines);
+      loggers[i]->run();
+   }
+   sleepMs(2);
+   Log::stopAsyncWriter();
+   for (int i = 0; i < threads; ++i)
+   {
+      loggers[i]->join();
+      delete loggers[i];
+   }
+   assert(countLines(fileName, "async ") + (Log::getAsyncDroppedCount() - droppedBefore) == threads * 5 * lines);
+
+   // compare the time logging threads spend
+   remove(fileName);
+   Log::initialize(Log::File, Log::Info, appname, fileName);
+   UInt64 direct = timeLogging(20000);
+   droppedBefore = Log::getAsyncDroppedCount();
+   Log::startAsyncWriter();
+   UInt64 async = timeLogging(20000);
+   Log::stopAsyncWriter();
+   cerr << "20000 lines: " << direct << " us direct, " << async << " us through the writer, "
+        << Log::getAsyncDroppedCount() - droppedBefore << " dropped" << endl;
+   assert(countLines(fileName, "timing line ") + (Log::getAsyncDroppedCount() - droppedBefore) == 40000);
+   remove(fileName);
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -258,6 +450,9 @@ main(int argc, char* argv[])
    Log::initialize(Log::Cout, Log::Info, argv[0], 0, 0, "LOG_DAEMON", Log::MessageStructure::JSON_CEE, "TestDev");
    ErrLog(<<"This should appear-back to Cout as JSON, \"Hello World\"");
 
+   testLogRing();
+   testAsyncWriter(argv[0]);
+
    return 0;
 }
 
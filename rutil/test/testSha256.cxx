@@ -0,0 +1,139 @@
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <assert.h>
+#include <iostream>
+#include <string.h>
+
+#include "rutil/Data.hxx"
+#include "rutil/Sha256.hxx"
+
+using namespace resip;
+using namespace std;
+
+static Data
+sha256(const Data& input)
+{
+   SHA256 hash;
+   hash.update(input);
+   unsigned char digest[SHA256::DigestSize];
+   hash.final(digest);
+   return Data(digest, sizeof(digest)).hex();
+}
+
+static Data
+hmacSha256(const Data& key, const Data& input)
+{
+   HmacSHA256 hmac(key);
+   unsigned char mac[SHA256::DigestSize];
+   hmac.compute(input.data(), input.size(), mac);
+   return Data(mac, sizeof(mac)).hex();
+}
+
+static Data
+repeat(size_t count, char c)
+{
+   Data result;
+   for (size_t i = 0; i < count; ++i)
+   {
+      result += c;
+   }
+   return result;
+}
+
+int
+main(void)
+{
+   // FIPS 180-4 examples
+   assert(sha256("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+   assert(sha256("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+   assert(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+   {
+      // a million 'a's, fed in pieces that straddle the blocks
+      SHA256 hash;
+      char chunk[1000];
+      memset(chunk, 'a', sizeof(chunk));
+      for (int i = 0; i < 1000; ++i)
+      {
+         hash.update(chunk, 7);
+         hash.update(chunk, sizeof(chunk) - 7);
+      }
+      unsigned char digest[SHA256::DigestSize];
+      hash.final(digest);
+      assert(Data(digest, sizeof(digest)).hex() ==
+             "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+
+      // final() leaves it ready for more
+      hash.update("abc", 3);
+      hash.final(digest);
+      assert(Data(digest, sizeof(digest)).hex() ==
+             "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+   }
+   // padding at the 55/56/64 byte boundaries
+   assert(sha256(repeat(55, 'a')).size() == 64);
+   assert(sha256(repeat(56, 'a')) != sha256(repeat(55, 'a')));
+   assert(sha256(repeat(64, 'a')) == "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb");
+
+   // RFC 4231 test cases 1, 2 and 6 (a key longer than a block)
+   assert(hmacSha256(repeat(20, '\x0b'), "Hi There") ==
+          "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+   assert(hmacSha256("Jefe", "what do ya want for nothing?") ==
+          "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+   assert(hmacSha256(repeat(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First") ==
+          "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+
+   cerr << "ALL OK" << endl;
+   return 0;
+}
+
+/* ====================================================================
+ * The Vovida Software License, Version 1.0
+ *
+ * Copyright (c) 2000 Vovida Networks, Inc.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * 3. The names "VOCAL", "Vovida Open Communication Application Library",
+ *    and "Vovida Open Communication Application Library (VOCAL)" must
+ *    not be used to endorse or promote products derived from this
+ *    software without prior written permission. For written
+ *    permission, please contact vocal@vovida.org.
+ *
+ * 4. Products derived from this software may not be called "VOCAL", nor
+ *    may "VOCAL" appear in their name, without prior written
+ *    permission of Vovida Networks, Inc.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESSED OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE, TITLE AND
+ * NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL VOVIDA
+ * NETWORKS, INC. OR ITS CONTRIBUTORS BE LIABLE FOR ANY DIRECT DAMAGES
+ * IN EXCESS OF $1,000, NOR FOR ANY INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ * PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+ * OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+ * USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH
+ * DAMAGE.
+ *
+ * ====================================================================
+ *
+ * This software consists of voluntary contributions made by Vovida
+ * Networks, Inc. and many individuals on behalf of Vovida Networks,
+ * Inc.  For more information on Vovida Networks, Inc., please see
+ * <http://www.vovida.org/>.
+ *
+ */